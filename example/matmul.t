@@ -1,6 +1,30 @@
 // Sample script for matrix multiplication example
 // Standard C/C++ line comments can be used to skip operations
 // One operation per line. Operation must not be broken into multiple lines. 
+// Operations can be specialized to ranges of the program parameters: the
+// operations following a line such as "version [N] -> { : N >= 256 }" are only
+// applied if the parameters satisfy the condition. Versions are tried in order
+// and the operations before the first version apply to all other parameters.
+// The operations "vectorize(Mult, 8)", "interleave(Mult, 2)" and "unroll(Mult, 4)"
+// do not change the schedule, they pass hints for the innermost loops generated
+// for a loop on to the LLVM optimizations run after Loopy (a count of 1 disables
+// the optimization).
+// The operation "timetile(Loop, 0, 16, 32)" skews the loops of a stencil starting
+// at loop 0 (the time loop) by the smallest factors that the dependences allow
+// and tiles the time loop and the next loop by 16 and 32 iterations (one size per
+// loop). "diamondtile(Loop, 0, 32, 64)" tiles the time loop and the next loop by
+// diamonds of size 32 instead and the loop after them by 64 iterations.
+// The operation "wavefront(Loop, 0, 1)" skews loop 0 by loop 1 such that the
+// skewed loop carries all dependences of the two loops, the inner loop then runs
+// in parallel (the program must be linked with the OpenMP runtime).
+// The operation "collapse(Mult, 2)" runs the outermost parallel loop generated for
+// a loop and the next parallel loop nested in it as one parallel loop, such that
+// the iterations of both loops are distributed among the threads (with
+// -polly-parallel).
+// The operation "tasks(Mult, 2)" runs each iteration of the second loop generated
+// for a loop as an OpenMP task that waits only for the tasks it depends on, which
+// suits triangular loops better than a parallel loop (the program must be linked
+// with the GNU OpenMP runtime).
 
 realign(Init, Mult, 0)
 affine(Mult, { [i, j, k] -> [i, k, j] } )
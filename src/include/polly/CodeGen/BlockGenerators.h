@@ -17,7 +17,9 @@
 #define POLLY_BLOCK_GENERATORS_H
 
 #include "polly/CodeGen/IRBuilder.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "isl/map.h"
 #include <vector>
@@ -25,6 +27,7 @@
 struct isl_ast_build;
 
 namespace llvm {
+class DataLayout;
 class Pass;
 class Region;
 class ScalarEvolution;
@@ -388,14 +391,59 @@ public:
   /// @param Schedule   A map from the statement to a schedule where the
   ///                   innermost dimension is the dimension of the innermost
   ///                   loop containing the statemenet.
+  /// @param AlignedBases Base addresses that may be assumed to be aligned to
+  ///                   the natural alignment of the generated vector types,
+  ///                   e.g. because this was checked at run time.
+  /// @param Mask       A vector of i1 values that marks the active vector
+  ///                   lanes or nullptr if all lanes are active. Only
+  ///                   statements for which canGenerateMasked() holds can be
+  ///                   generated with a mask.
   static void generate(BlockGenerator &BlockGen, ScopStmt &Stmt,
                        VectorValueMapT &GlobalMaps,
                        std::vector<LoopToScevMapT> &VLTS,
-                       __isl_keep isl_map *Schedule) {
-    VectorBlockGenerator Generator(BlockGen, GlobalMaps, VLTS, Schedule);
+                       __isl_keep isl_map *Schedule,
+                       ArrayRef<Value *> AlignedBases = None,
+                       Value *Mask = nullptr) {
+    VectorBlockGenerator Generator(BlockGen, GlobalMaps, VLTS, Schedule,
+                                   AlignedBases, Mask);
     Generator.copyStmt(Stmt);
   }
 
+  /// @brief Check if @p Stmt can be generated with masked vector lanes.
+  ///
+  /// Inactive lanes must not access memory or have other side effects. This
+  /// is the case if all memory accesses can be expressed as masked vector
+  /// loads/stores or gathers/scatters and all other instructions are safe to
+  /// execute speculatively.
+  ///
+  /// @param Stmt     The statement to check.
+  /// @param Schedule A map from the statement to a schedule where the
+  ///                 innermost dimension is the vectorized dimension.
+  static bool canGenerateMasked(ScopStmt &Stmt, __isl_keep isl_map *Schedule);
+
+  /// @brief Collect base addresses that are worth an alignment check.
+  ///
+  /// Add to @p Bases the base addresses of all stride one accesses in @p Stmt
+  /// whose first vector lane is provably aligned relative to the base
+  /// address, but where the alignment of the base address itself is not
+  /// known. If those base addresses are aligned at run time, all vector
+  /// accesses to them can use the natural alignment of the vector type.
+  ///
+  /// @param Stmt        The statement to analyze.
+  /// @param Schedule    A map from the statement to a schedule where the
+  ///                    innermost dimension is the vectorized dimension.
+  /// @param VectorWidth The number of vector lanes.
+  /// @param Bases       A map from base addresses to the alignment they need
+  ///                    to be checked for.
+  static void
+  collectAlignmentCandidates(ScopStmt &Stmt, __isl_keep isl_map *Schedule,
+                             int VectorWidth,
+                             MapVector<Value *, unsigned> &Bases);
+
+  /// @brief Get the natural alignment of a vector of @p ElementType.
+  static unsigned getVectorAlignment(Type *ElementType, int VectorWidth,
+                                     const DataLayout &DL);
+
 private:
   // This is a vector of global value maps.  The first map is used for the first
   // vector lane, ...
@@ -426,12 +474,34 @@ private:
   // dimension of the innermost loop containing the statemenet.
   isl_map *Schedule;
 
+  // Base addresses that are known to be aligned to the natural alignment of
+  // the vector types generated.
+  ArrayRef<Value *> AlignedBases;
+
+  // A vector of i1 values marking the active lanes, nullptr if all lanes are
+  // active.
+  Value *Mask;
+
   VectorBlockGenerator(BlockGenerator &BlockGen, VectorValueMapT &GlobalMaps,
                        std::vector<LoopToScevMapT> &VLTS,
-                       __isl_keep isl_map *Schedule);
+                       __isl_keep isl_map *Schedule,
+                       ArrayRef<Value *> AlignedBases, Value *Mask);
 
   int getVectorWidth();
 
+  /// @brief Get the data layout of the module code is generated for.
+  const DataLayout &getDataLayout();
+
+  /// @brief Get the alignment of a vector access starting at the first lane.
+  ///
+  /// The alignment is derived from the alignment of the first vector lane
+  /// relative to the base address (see
+  /// MemoryAccess::getFirstLaneAlignment()) and the known alignment of the
+  /// base address. It is never smaller than the ABI alignment of the element
+  /// type.
+  unsigned getFirstLaneAlignment(const MemoryAccess &Access,
+                                 const Value *Pointer);
+
   Value *getVectorValue(ScopStmt &Stmt, const Value *Old, ValueMapT &VectorMap,
                         VectorValueMapT &ScalarMaps, Loop *L);
 
@@ -483,6 +553,39 @@ private:
   Value *generateUnknownStrideLoad(ScopStmt &Stmt, const LoadInst *Load,
                                    VectorValueMapT &ScalarMaps);
 
+  /// @brief Load a vector from scalars with a constant stride
+  ///
+  /// In case the scalars are @p Stride elements apart, load the contiguous
+  /// memory range spanned by all lanes with a single wide load and extract
+  /// the scalars with a shuffle. The memory range loaded lies between the
+  /// first and the last accessed element, so no memory outside of the
+  /// accessed array is touched.
+  ///
+  /// %wide_ptr = bitcast double* %p to <7 x double>*
+  /// %wide = load <7 x double>* %wide_ptr
+  /// %strided = shufflevector <7 x double> %wide, <7 x double> %wide,
+  ///                          <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+  ///
+  Value *generateStridedLoad(ScopStmt &Stmt, const LoadInst *Load,
+                             VectorValueMapT &ScalarMaps, int Stride);
+
+  /// @brief Load a vector with a (masked) gather
+  ///
+  /// %ptrs = <4 x double*> ...
+  /// %vec = call <4 x double> @llvm.masked.gather.v4f64(<4 x double*> %ptrs,
+  ///                           i32 8, <4 x i1> %mask, <4 x double> undef)
+  ///
+  Value *generateGatherLoad(ScopStmt &Stmt, const LoadInst *Load,
+                            VectorValueMapT &ScalarMaps);
+
+  /// @brief Get a vector of the addresses accessed by @p Inst in each lane.
+  Value *getVectorOfPointers(ScopStmt &Stmt, const Instruction *Inst,
+                             const Value *Pointer,
+                             VectorValueMapT &ScalarMaps);
+
+  /// @brief Get a mask with all lanes active or the current lane mask.
+  Value *getMask();
+
   void generateLoad(ScopStmt &Stmt, const LoadInst *Load, ValueMapT &VectorMap,
                     VectorValueMapT &ScalarMaps);
 
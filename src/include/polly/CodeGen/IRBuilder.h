@@ -24,6 +24,7 @@ class ScalarEvolution;
 
 namespace polly {
 class Scop;
+struct LoopHints;
 
 /// @brief Helper class to annotate newly generated SCoPs with metadata.
 ///
@@ -31,7 +32,8 @@ class Scop;
 ///   1) Loops are stored in a stack-like structure in the order they are
 ///      constructed and the LoopID metadata node is added to the backedge.
 ///      Contained memory instructions and loop headers are annotated according
-///      to all parallel surrounding loops.
+///      to all parallel surrounding loops. The LoopID also carries the
+///      optimization hints of the loop, if any.
 ///   2) The new SCoP is assumed alias free (either due to the result of
 ///      AliasAnalysis queries or runtime alias checks). We annotate therefore
 ///      all memory instruction with alias scopes to indicate that fact to
@@ -47,7 +49,10 @@ public:
   void buildAliasScopes(Scop &S);
 
   /// @brief Add a new loop @p L which is parallel if @p IsParallel is true.
-  void pushLoop(llvm::Loop *L, bool IsParallel);
+  ///
+  /// @param Hints The optimization hints of @p L or nullptr.
+  void pushLoop(llvm::Loop *L, bool IsParallel,
+                const LoopHints *Hints = nullptr);
 
   /// @brief Remove the last added loop.
   void popLoop(bool isParallel);
@@ -69,6 +74,10 @@ private:
   /// @brief Metadata pointing to parallel loops currently under construction.
   llvm::SmallVector<llvm::MDNode *, 8> ParallelLoops;
 
+  /// @brief The LoopIDs of all loops currently under construction, nullptr
+  ///        for loops that are neither parallel nor have hints.
+  llvm::SmallVector<llvm::MDNode *, 8> LoopIDs;
+
   /// @brief The alias scope domain for the current SCoP.
   llvm::MDNode *AliasScopeDomain;
 
@@ -24,7 +24,9 @@
 
 #include "polly/Config/config.h"
 #include "polly/ScopPass.h"
+#include "llvm/ADT/SmallVector.h"
 #include "isl/ast.h"
+#include <vector>
 
 namespace llvm {
 class raw_ostream;
@@ -41,18 +43,35 @@ namespace polly {
 class Scop;
 class IslAst;
 class MemoryAccess;
+struct LoopHints;
 
 class IslAstInfo : public ScopPass {
 public:
   using MemoryAccessSet = SmallPtrSet<MemoryAccess *, 4>;
 
+  /// @brief A dependence of the tasks of a task loop on earlier tasks.
+  ///
+  /// If @p Condition holds in the iteration of a task loop, the task of the
+  /// iteration waits for the task identified by @p Tile.
+  struct TaskDependence {
+    /// @brief The condition under which the dependence exists.
+    isl_ast_expr *Condition;
+
+    /// @brief The iterations of the loops run as tasks that identify the task
+    ///        waited for, outermost first.
+    std::vector<isl_ast_expr *> Tile;
+  };
+
   /// @brief Payload information used to annotate an AST node.
   struct IslAstUserPayload {
     /// @brief Construct and initialize the payload.
     IslAstUserPayload()
         : IsInnermost(false), IsInnermostParallel(false),
           IsOutermostParallel(false), IsReductionParallel(false),
-          MinimalDependenceDistance(nullptr), Build(nullptr) {}
+          IsForcedParallel(false), IsCollapsible(false), CollapseCount(0),
+          CollapseIfFewIterations(false), IsTaskRegion(false),
+          IsTaskLoop(false), MinimalDependenceDistance(nullptr),
+          Build(nullptr), Hints(nullptr) {}
 
     /// @brief Cleanup all isl structs on destruction.
     ~IslAstUserPayload();
@@ -69,6 +88,36 @@ public:
     /// @brief Flag to mark parallel loops which break reductions.
     bool IsReductionParallel;
 
+    /// @brief Flag to mark the outermost parallel loops of wavefronts and of
+    ///        the other labels whose loops are run in parallel in any case.
+    bool IsForcedParallel;
+
+    /// @brief Flag to mark parallel loops nested in an outermost parallel loop
+    ///        that can be collapsed with it.
+    bool IsCollapsible;
+
+    /// @brief The number of loops to collapse into an outermost parallel loop,
+    ///        including the loop itself.
+    unsigned CollapseCount;
+
+    /// @brief Flag to collapse the loops only if the outermost parallel loop
+    ///        has fewer iterations than there are threads.
+    bool CollapseIfFewIterations;
+
+    /// @brief Flag to mark the outermost loop of loops run as tasks.
+    bool IsTaskRegion;
+
+    /// @brief Flag to mark the innermost loop of loops run as tasks, whose
+    ///        iterations are the tasks.
+    bool IsTaskLoop;
+
+    /// @brief The iterations of the loops run as tasks that identify the task
+    ///        of an iteration of a task loop, outermost first.
+    std::vector<isl_ast_expr *> TaskTile;
+
+    /// @brief The tasks the tasks of a task loop depend on.
+    std::vector<TaskDependence> TaskDependences;
+
     /// @brief The minimal dependence distance for non parallel loops.
     isl_pw_aff *MinimalDependenceDistance;
 
@@ -77,8 +126,26 @@ public:
 
     /// @brief Set of accesses which break reduction dependences.
     MemoryAccessSet BrokenReductions;
+
+    /// @brief The optimization hints for innermost loops, if any.
+    const LoopHints *Hints;
+  };
+
+  /// @brief The address range [Min, Max) accessed in one array.
+  struct AccessRange {
+    /// @brief The address of the first element accessed.
+    isl_ast_expr *Min;
+
+    /// @brief The address after the last element accessed.
+    isl_ast_expr *Max;
+
+    /// @brief Flag to mark ranges of arrays that are only read.
+    bool ReadOnly;
   };
 
+  /// @brief The access ranges of all arrays in one alias group.
+  using AliasGroupRangesTy = SmallVector<AccessRange, 8>;
+
 private:
   Scop *S;
   IslAst *Ast;
@@ -104,6 +171,23 @@ public:
   /// be executed.
   __isl_give isl_ast_expr *getRunCondition() const;
 
+  /// @brief Get the alias groups not covered by the run condition.
+  ///
+  /// The arrays in these groups are too many to be compared pairwise. The
+  /// run-time check for them needs to sort their access ranges and only
+  /// compare neighbours. A read only range never needs to be checked against
+  /// another read only range.
+  const SmallVectorImpl<AliasGroupRangesTy> &getSortedAliasGroups() const;
+
+  /// @brief Get the levels of the loop nests at the top of the AST.
+  ///
+  /// With -polly-parallel-nests, the children of the block at the root of
+  /// the AST are assigned levels from the dependences between them: the
+  /// nests of a level are independent of each other and only depend on nests
+  /// of lower levels. The result is empty if no two nests can run
+  /// concurrently.
+  const std::vector<unsigned> &getNestLevels() const;
+
   /// @name Extract information attached to an isl ast (for) node.
   ///
   ///{
@@ -129,6 +213,21 @@ public:
   /// @brief Will the loop be run as thread parallel?
   static bool isExecutedInParallel(__isl_keep isl_ast_node *Node);
 
+  /// @brief Can this loop be collapsed with the parallel loop around it?
+  static bool isCollapsible(__isl_keep isl_ast_node *Node);
+
+  /// @brief Get the number of loops to collapse into this parallel loop.
+  static unsigned getCollapseCount(__isl_keep isl_ast_node *Node);
+
+  /// @brief Are the loops only collapsed if this loop has few iterations?
+  static bool collapseIfFewIterations(__isl_keep isl_ast_node *Node);
+
+  /// @brief Is this loop the outermost loop of loops run as tasks?
+  static bool isTaskRegion(__isl_keep isl_ast_node *Node);
+
+  /// @brief Is this loop the loop whose iterations are run as tasks?
+  static bool isTaskLoop(__isl_keep isl_ast_node *Node);
+
   /// @brief Get the nodes schedule or a nullptr if not available.
   static __isl_give isl_union_map *getSchedule(__isl_keep isl_ast_node *Node);
 
@@ -142,6 +241,14 @@ public:
   /// @brief Get the nodes build context or a nullptr if not available.
   static __isl_give isl_ast_build *getBuild(__isl_keep isl_ast_node *Node);
 
+  /// @brief Get the loop hints of the node or a nullptr if not available.
+  static const LoopHints *getLoopHints(__isl_keep isl_ast_node *Node);
+
+  /// @brief Add the statement instances executed by @p Node to @p Instances.
+  static __isl_give isl_union_set *
+  addInstances(__isl_keep isl_ast_node *Node,
+               __isl_take isl_union_set *Instances);
+
   ///}
 
   virtual void getAnalysisUsage(AnalysisUsage &AU) const;
@@ -0,0 +1,104 @@
+//===- IslAstCache.h - Cache of isl AST annotations -------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A cache of the parallelism annotations computed while generating an isl AST.
+//
+// The dependence based parallelism checks performed for every for node are a
+// large part of the AST generation time. Their results only depend on the
+// schedule, the domains, the context, the AST build options and the
+// dependences, such that they can be reused whenever the same kernel is code
+// generated again, either within the same compilation or, if a cache directory
+// is given, across compilations.
+//
+// Only the annotations are cached, not the AST itself: the AST is always
+// rebuilt by isl and the cached results are replayed in place of the
+// dependence checks of its for nodes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef POLLY_ISL_AST_CACHE_H
+#define POLLY_ISL_AST_CACHE_H
+
+#include "isl/ctx.h"
+#include <map>
+#include <string>
+#include <vector>
+
+struct isl_union_map;
+struct isl_set;
+
+namespace polly {
+class Scop;
+class MemoryAccess;
+struct Dependences;
+
+/// @brief The parallelism annotations of one AST generation.
+struct IslAstCacheEntry {
+  /// @brief The result of the parallelism check of a single for node.
+  struct ParallelismResult {
+    ParallelismResult() : IsParallel(false), IsReductionParallel(false) {}
+
+    /// @brief Flag to mark parallel for nodes.
+    bool IsParallel;
+
+    /// @brief Flag to mark parallel for nodes which break reductions.
+    bool IsReductionParallel;
+
+    /// @brief The minimal dependence distance or the empty string if none.
+    std::string MinimalDependenceDistance;
+
+    /// @brief The names of the accesses which break reduction dependences.
+    std::vector<std::string> BrokenReductions;
+  };
+
+  /// @brief The results of the parallelism checks in the order performed.
+  std::vector<ParallelismResult> Results;
+};
+
+/// @brief Cache of parallelism annotations keyed by the AST generation inputs.
+///
+/// The cache does not hold any AST, only the annotations attached to it.
+class IslAstCache {
+public:
+  /// @brief Return the cache of the current compilation.
+  static IslAstCache &get();
+
+  /// @brief Is the cache enabled?
+  static bool isEnabled();
+
+  /// @brief Compute the canonical key of an AST generation.
+  ///
+  /// @param S                   The SCoP the AST is generated for.
+  /// @param D                   The dependences of @p S.
+  /// @param Schedule            The schedule restricted to the domains.
+  /// @param Context             The context of the AST build.
+  /// @param PerformParallelTest Flag to indicate that parallelism is checked.
+  static std::string getKey(Scop &S, const Dependences &D,
+                            __isl_keep isl_union_map *Schedule,
+                            __isl_keep isl_set *Context,
+                            bool PerformParallelTest);
+
+  /// @brief Return the name of @p MA used to refer to it in a cache entry.
+  static std::string getAccessName(const MemoryAccess *MA);
+
+  /// @brief Look up the entry for @p Key in memory or on disk.
+  ///
+  /// @return True if an entry was found and stored in @p Entry.
+  bool lookup(const std::string &Key, IslAstCacheEntry &Entry);
+
+  /// @brief Store @p Entry for @p Key in memory and on disk.
+  void insert(const std::string &Key, const IslAstCacheEntry &Entry);
+
+private:
+  /// @brief The entries in memory, by digest of their key.
+  std::map<std::string, std::pair<std::string, IslAstCacheEntry>> Entries;
+};
+} // End namespace polly.
+
+#endif
@@ -15,10 +15,12 @@
 
 #include "polly/CodeGen/BlockGenerators.h"
 #include "polly/CodeGen/IslExprBuilder.h"
+#include "polly/CodeGen/LabelProfiler.h"
 #include "polly/CodeGen/LoopGenerators.h"
 #include "llvm/Analysis/ScalarEvolutionExpander.h"
 #include "isl/ctx.h"
 #include "isl/union_map.h"
+#include <memory>
 
 using namespace polly;
 using namespace llvm;
@@ -34,17 +36,44 @@ public:
         ExprBuilder(Builder, IDToValue, Rewriter, DT, LI),
         BlockGen(Builder, LI, SE, DT, ScalarMap, PHIOpMap, EscapeMap,
                  &ExprBuilder),
-        RegionGen(BlockGen), P(P), DL(DL), LI(LI), SE(SE), DT(DT) {}
+        RegionGen(BlockGen), P(P), DL(DL), LI(LI), SE(SE), DT(DT),
+        Profiler(LabelProfiler::isEnabled() ? new LabelProfiler(Builder, S)
+                                            : nullptr),
+        InTaskRegion(false) {}
 
   ~IslNodeBuilder() {}
 
   void addParameters(__isl_take isl_set *Context);
+
+  /// @brief Use @p V as the value of the parameter @p Id.
+  ///
+  /// This is used for parameters that are not part of the context of the SCoP,
+  /// but whose value is computed by the generated code.
+  void addParameter(__isl_take isl_id *Id, Value *V);
+
   void create(__isl_take isl_ast_node *Node);
 
+  /// @brief Create LLVM-IR for the block @p Block at the root of the AST,
+  ///        running the independent loop nests in it concurrently.
+  ///
+  /// The nests are run level by level (see IslAstInfo::getNestLevels()). The
+  /// for nodes of a level that contain no parallel loop are run as sections of
+  /// a parallel loop over the sections, the other nests of the level after
+  /// them.
+  ///
+  /// @param Block  The block at the root of the AST.
+  /// @param Levels The level of each child of @p Block.
+  void createConcurrentNests(__isl_take isl_ast_node *Block,
+                             const std::vector<unsigned> &Levels);
+
   /// @brief Finalize code generation for the SCoP @p S.
   ///
   /// @see BlockGenerator::finalizeSCoP(Scop &S)
-  void finalizeSCoP(Scop &S) { BlockGen.finalizeSCoP(S, ValueMap); }
+  void finalizeSCoP(Scop &S) {
+    BlockGen.finalizeSCoP(S, ValueMap);
+    if (Profiler)
+      Profiler->finalize();
+  }
 
   IslExprBuilder &getExprBuilder() { return ExprBuilder; }
 
@@ -85,6 +114,12 @@ private:
   ScalarEvolution &SE;
   DominatorTree &DT;
 
+  /// @brief The profiler of the labelled loop nests, if profiling is enabled.
+  std::unique_ptr<LabelProfiler> Profiler;
+
+  /// @brief Is code being generated for loops run as tasks?
+  bool InTaskRegion;
+
   /// @brief The current iteration of out-of-scop loops
   ///
   /// This map provides for a given loop a llvm::Value that contains the current
@@ -135,6 +170,27 @@ private:
 
   unsigned getNumberOfIterations(__isl_keep isl_ast_node *For);
 
+  /// Get an upper bound of the number of iterations of @p For.
+  ///
+  /// @return The maximal number of iterations or -1 if it is unbounded.
+  int getMaxNumberOfIterations(__isl_keep isl_ast_node *For);
+
+  /// Check if @p For can be vectorized with masked vector operations.
+  bool canCreateMaskedVector(__isl_keep isl_ast_node *For);
+
+  /// Split the current basic block and branch on @p Cond.
+  ///
+  /// Both the then and the else block branch to a common merge block. The
+  /// builder is left at the beginning of the then block.
+  ///
+  /// @param Cond    The i1 condition to branch on.
+  /// @param ThenBB  Set to the block executed if @p Cond is true.
+  /// @param ElseBB  Set to the block executed if @p Cond is false.
+  /// @param MergeBB Set to the block both branches continue at.
+  /// @param Name    The prefix of the names of the new blocks.
+  void createBranch(Value *Cond, BasicBlock *&ThenBB, BasicBlock *&ElseBB,
+                    BasicBlock *&MergeBB, const Twine &Name);
+
   /// Compute the values and loops referenced in this subtree.
   ///
   /// This function looks at all ScopStmts scheduled below the provided For node
@@ -169,8 +225,67 @@ private:
   /// @param NewValues A map that maps certain llvm::Values to new llvm::Values.
   void updateValues(ParallelLoopGenerator::ValueToValueMapTy &NewValues);
 
+  /// @brief Compute the number of iterations of @p For at run time.
+  Value *createNumberOfIterations(__isl_keep isl_ast_node *For);
+
+  /// @brief Create LLVM-IR for the for node @p For.
+  ///
+  /// If profiling is enabled, the generated loop is wrapped with the counters
+  /// of the profiled loops that start at @p For.
   void createFor(__isl_take isl_ast_node *For);
-  void createForVector(__isl_take isl_ast_node *For, int VectorWidth);
+
+  /// @brief Create a vector, parallel or sequential loop for @p For.
+  void createForLoop(__isl_take isl_ast_node *For);
+
+  /// @brief Create a parallel loop that runs each of @p Nests in a separate
+  ///        iteration.
+  void createSections(const std::vector<isl_ast_node *> &Nests);
+
+  /// @brief Create the loops run as tasks that start at @p For.
+  ///
+  /// The loops are generated sequentially in a parallel loop with a single
+  /// iteration, the iterations of the task loop create the tasks.
+  void createTaskRegion(__isl_take isl_ast_node *For);
+
+  /// @brief Create a task that runs the body @p Body of the task loop @p For.
+  void createTask(__isl_keep isl_ast_node *For, __isl_take isl_ast_node *Body);
+
+  /// @brief Get the address that identifies the task of the iterations @p Tile
+  ///        of the loops run as tasks in the dependences of the tasks.
+  Value *createTaskAddress(const std::vector<isl_ast_expr *> &Tile);
+
+  /// Create vector code for the innermost loop @p For.
+  ///
+  /// @param For         The loop to vectorize.
+  /// @param VectorWidth The number of vector lanes.
+  /// @param Masked      If set, the loop may have less than @p VectorWidth
+  ///                    iterations and the inactive lanes are masked.
+  void createForVector(__isl_take isl_ast_node *For, int VectorWidth,
+                       bool Masked = false);
+
+  /// Generate vector code for the statements in the body of a vector loop.
+  ///
+  /// @param Body         The body of the vector loop.
+  /// @param IVS          The values of the loop iterator for each lane.
+  /// @param IteratorID   The id of the loop iterator.
+  /// @param Schedule     The schedule of the vector loop.
+  /// @param AlignedBases Base addresses known to be aligned to the natural
+  ///                     alignment of the vector types generated.
+  /// @param Mask         A vector of i1 marking the active lanes or nullptr if
+  ///                     all lanes are active.
+  void createForVectorBody(__isl_take isl_ast_node *Body,
+                           std::vector<Value *> &IVS,
+                           __isl_keep isl_id *IteratorID,
+                           __isl_keep isl_union_map *Schedule,
+                           ArrayRef<Value *> AlignedBases, Value *Mask);
+
+  /// Create a run-time check that all @p Bases are sufficiently aligned.
+  ///
+  /// @param Bases A map from (original) base addresses to the alignment they
+  ///              are checked for.
+  ///
+  /// @return An i1 value that is true if all base addresses are aligned.
+  Value *createAlignmentCheck(const MapVector<Value *, unsigned> &Bases);
   void createForSequential(__isl_take isl_ast_node *For);
 
   /// Create LLVM-IR that executes a for node thread parallel.
@@ -228,7 +343,9 @@ private:
   void createUserVector(__isl_take isl_ast_node *User,
                         std::vector<Value *> &IVS,
                         __isl_take isl_id *IteratorID,
-                        __isl_take isl_union_map *Schedule);
+                        __isl_take isl_union_map *Schedule,
+                        ArrayRef<Value *> AlignedBases = None,
+                        Value *Mask = nullptr);
   void createUser(__isl_take isl_ast_node *User);
   void createBlock(__isl_take isl_ast_node *Block);
 };
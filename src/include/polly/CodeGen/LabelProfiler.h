@@ -0,0 +1,110 @@
+//===- LabelProfiler.h - Profile the labelled loop nests --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Instrument the generated code of the labelled loop nests of a SCoP with
+// cycle and iteration counters.
+//
+// Every loop nest that only executes statement instances of a single labelled
+// loop of the SCoP (see Scop::LoopDomainMap) is wrapped with code that counts
+// the number of times the nest is entered, the number of iterations of its
+// outermost loop and the cycles spent in the nest. Optionally, the loops nested
+// inside such a nest up to a given depth, e.g., the tile loops of a tiled nest,
+// are profiled as well. The cycles of loops that are executed by several
+// threads are summed over the threads. The counters are printed to the file
+// named by the POLLY_PROFILE_FILE environment variable or to polly-profile.json
+// when the program exits, one JSON object per line and profiled loop.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef POLLY_LABEL_PROFILER_H
+#define POLLY_LABEL_PROFILER_H
+
+#include "polly/CodeGen/IRBuilder.h"
+#include "llvm/ADT/STLExtras.h"
+#include "isl/ctx.h"
+#include <map>
+#include <string>
+#include <vector>
+
+struct isl_ast_node;
+struct isl_union_set;
+
+namespace llvm {
+class GlobalVariable;
+class Value;
+}
+
+namespace polly {
+using namespace llvm;
+class Scop;
+
+class LabelProfiler {
+public:
+  LabelProfiler(PollyIRBuilder &Builder, Scop &S);
+  ~LabelProfiler();
+
+  /// @brief Is the profiling of labelled loop nests enabled?
+  static bool isEnabled();
+
+  /// @brief A loop that is being profiled.
+  struct ProfiledLoop {
+    /// @brief The counters of the loop.
+    GlobalVariable *Counters;
+
+    /// @brief The value of the cycle counter when the loop was entered.
+    Value *StartCycles;
+
+    /// @brief The number of iterations of the loop.
+    Value *Iterations;
+  };
+
+  /// @brief Start profiling the loops that start at @p For.
+  ///
+  /// @param For           The for node code is about to be generated for.
+  /// @param GetIterations Generate the number of iterations of @p For. It is
+  ///                      only called if a loop is profiled from here on.
+  ///
+  /// @return The loops that are profiled from here on.
+  std::vector<ProfiledLoop> enterFor(__isl_keep isl_ast_node *For,
+                                     function_ref<Value *()> GetIterations);
+
+  /// @brief Stop profiling @p Loops after the code of their for node.
+  void exitFor(const std::vector<ProfiledLoop> &Loops);
+
+  /// @brief Print the counters of all profiled loops at program exit.
+  void finalize();
+
+private:
+  PollyIRBuilder &Builder;
+  Scop &S;
+
+  /// @brief The statement instances of each labelled loop of the SCoP.
+  std::map<std::string, isl_union_set *> LabelInstances;
+
+  /// @brief The labels whose nests are being generated, with the depth of
+  ///        the current loop inside the nest.
+  std::map<std::string, unsigned> ActiveLabels;
+
+  /// @brief The active labels before each for node being generated.
+  std::vector<std::map<std::string, unsigned>> SavedActiveLabels;
+
+  /// @brief The counters of each label and depth, in order of creation.
+  std::vector<std::pair<std::pair<std::string, unsigned>, GlobalVariable *>>
+      AllCounters;
+
+  /// @brief Get (and possibly create) the counters for @p Label at @p Depth.
+  GlobalVariable *getCounters(const std::string &Label, unsigned Depth);
+
+  /// @brief Emit the code that starts profiling a loop.
+  ProfiledLoop startLoop(const std::string &Label, unsigned Depth,
+                         Value *Iterations);
+};
+}
+
+#endif
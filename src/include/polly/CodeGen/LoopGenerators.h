@@ -27,6 +27,10 @@ class BasicBlock;
 namespace polly {
 using namespace llvm;
 
+/// @brief Run the loops initializing arrays in parallel with a static schedule
+///        to place the pages of the arrays with the threads that use them.
+extern bool PollyFirstTouch;
+
 /// @brief Create a scalar do/for-style loop.
 ///
 /// @param LowerBound The starting value of the induction variable.
@@ -45,6 +49,8 @@ using namespace llvm;
 /// @param Parallel   If this loop should be marked parallel in the Annotator.
 /// @param UseGuard   Create a guard in front of the header to check if the
 ///                   loop is executed at least once, otherwise just assume it.
+/// @param Hints      The optimization hints of the loop that are passed to the
+///                   Annotator, or nullptr.
 ///
 /// @return Value*    The newly created induction variable for this loop.
 Value *createLoop(Value *LowerBound, Value *UpperBound, Value *Stride,
@@ -52,7 +58,7 @@ Value *createLoop(Value *LowerBound, Value *UpperBound, Value *Stride,
                   DominatorTree &DT, BasicBlock *&ExitBlock,
                   ICmpInst::Predicate Predicate,
                   ScopAnnotator *Annotator = NULL, bool Parallel = false,
-                  bool UseGuard = true);
+                  bool UseGuard = true, const LoopHints *Hints = nullptr);
 
 /// @brief The ParallelLoopGenerator allows to create parallelized loops
 ///
@@ -64,7 +70,15 @@ Value *createLoop(Value *LowerBound, Value *UpperBound, Value *Stride,
 ///      iterations) are distributed between them and make sure each has access
 ///      to the struct holding all needed values.
 ///
-/// At the moment we support only one parallel runtime, OpenMP.
+/// We support two parallel runtimes with the same interface: GNU OpenMP and the
+/// Loopy runtime in tools/LoopyRuntime, which keeps persistent worker threads
+/// to make starting a parallel loop cheap (-polly-parallel-runtime=loopy).
+///
+/// With -polly-parallel-first-touch, the GNU OpenMP loops use a static schedule
+/// instead of the one chosen at run time, such that loops with the same number
+/// of iterations are distributed in the same way among the threads, and ask
+/// the runtime to bind the threads to places (-polly-parallel-proc-bind). The
+/// Loopy runtime uses a static schedule and pins its threads by default.
 ///
 /// If we parallelize the outer loop of the following loop nest,
 ///
@@ -125,6 +139,65 @@ public:
                             SetVector<Value *> &Values, ValueToValueMapTy &VMap,
                             BasicBlock::iterator *LoopBody);
 
+  /// @brief Create a parallel loop for several collapsed loops
+  ///
+  /// The perfectly nested loops are linearized into a single parallel loop
+  /// over the product of their numbers of iterations, such that also the
+  /// iterations of the inner loops are distributed among the threads. At the
+  /// start of each linear iteration, the subfunction reconstructs the
+  /// iteration of the outermost loop and the bounds of the inner loops, which
+  /// the caller generates as sequential loops: a single iteration each if the
+  /// loops are collapsed, all their iterations otherwise.
+  ///
+  /// @param LBs       The lower bounds of the loops, outermost first.
+  /// @param UBs       The (inclusive) upper bounds of the loops, which must not
+  ///                  depend on the iterators of the loops.
+  /// @param Strides   The strides of the loops.
+  /// @param CollapseIfFewIterations Only collapse the loops at run time if the
+  ///                  outermost loop has fewer iterations than threads.
+  /// @param Values    A set of LLVM-IR Values that should be available in
+  ///                  the new loop body.
+  /// @param VMap      A map to allow outside access to the new versions of
+  ///                  the values in @p Values.
+  /// @param LoopBody  A pointer to an iterator that is set to point to the
+  ///                  body of the created loop.
+  /// @param InnerLBs  The lower bounds of the inner loops in the subfunction.
+  /// @param InnerUBs  The (inclusive) upper bounds of the inner loops.
+  /// @param InnerStrides The strides of the inner loops in the subfunction.
+  ///
+  /// @return The induction variable of the outermost loop.
+  Value *createCollapsedParallelLoop(
+      ArrayRef<Value *> LBs, ArrayRef<Value *> UBs, ArrayRef<Value *> Strides,
+      bool CollapseIfFewIterations, SetVector<Value *> &Values,
+      ValueToValueMapTy &VMap, BasicBlock::iterator *LoopBody,
+      SmallVectorImpl<Value *> &InnerLBs, SmallVectorImpl<Value *> &InnerUBs,
+      SmallVectorImpl<Value *> &InnerStrides);
+
+  /// @brief Can the parallel runtime run tasks, see createTask()?
+  static bool supportsTasks();
+
+  /// @brief Create a task that runs asynchronously once the tasks it depends
+  ///        on are done.
+  ///
+  /// The task is run by one of the threads of the parallel loop the calling
+  /// code runs in, at the latest when the threads wait for each other at the
+  /// end of the loop. The dependences of the tasks are given by addresses: a
+  /// task waits for the earlier tasks that have written one of the addresses
+  /// it reads or writes. Only the GNU OpenMP runtime supports tasks.
+  ///
+  /// @param Values    A set of LLVM-IR Values that should be available in
+  ///                  the task.
+  /// @param VMap      A map to allow outside access to the new versions of
+  ///                  the values in @p Values.
+  /// @param Depend    The addresses the task writes, followed by the addresses
+  ///                  it reads.
+  /// @param NumOut    The number of addresses the task writes.
+  /// @param TaskBody  A pointer to an iterator that is set to point to the
+  ///                  body of the task.
+  void createTask(SetVector<Value *> &Values, ValueToValueMapTy &VMap,
+                  ArrayRef<Value *> Depend, unsigned NumOut,
+                  BasicBlock::iterator *TaskBody);
+
 private:
   /// @brief The IR builder we use to create instructions.
   PollyIRBuilder &Builder;
@@ -149,6 +222,9 @@ private:
 
   /// @brief Create a runtime library call to spawn the worker threads.
   ///
+  /// For the static GNU OpenMP schedule, this is a combined call that also
+  /// executes @p SubFn in the calling thread and joins the threads.
+  ///
   /// @param SubFn      The subfunction which holds the loop body.
   /// @param SubFnParam The parameter for the subfunction (basically the struct
   ///                   filled with the outside values).
@@ -161,6 +237,19 @@ private:
   /// @brief Create a runtime library call to join the worker threads.
   void createCallJoinThreads();
 
+  /// @brief Create a runtime library call to get the number of threads used
+  ///        for the parallel loops, unless it is fixed (-polly-num-threads).
+  Value *createCallGetNumThreads();
+
+  /// @brief Create a runtime library call to create a task.
+  ///
+  /// @param TaskFn    The function which holds the task body.
+  /// @param TaskParam The parameter for the task function.
+  /// @param Struct    The struct holding the values of @p TaskParam.
+  /// @param Depend    The array of the dependences of the task.
+  void createCallTask(Value *TaskFn, Value *TaskParam, AllocaInst *Struct,
+                      Value *Depend);
+
   /// @brief Create a runtime library call to get the next work item.
   ///
   /// @param LBPtr A pointer value to store the work item begin in.
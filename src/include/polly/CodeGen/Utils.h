@@ -13,6 +13,9 @@
 #ifndef POLLY_CODEGEN_UTILS_H
 #define POLLY_CODEGEN_UTILS_H
 
+#include "polly/CodeGen/IRBuilder.h"
+#include "llvm/ADT/ArrayRef.h"
+
 namespace llvm {
 class Pass;
 class Value;
@@ -57,5 +60,24 @@ class Scop;
 /// @return The 'StartBlock' to which new code can be added.
 llvm::BasicBlock *executeScopConditionally(Scop &S, llvm::Pass *P,
                                            llvm::Value *RTC);
+
+/// @brief Check at run time that a set of address ranges does not overlap.
+///
+/// The ranges [@p Min[i], @p Max[i]) are stored into stack arrays that are
+/// sorted by their start address at run time. Afterwards each range is only
+/// compared against the end of the ranges before it, which keeps the size of
+/// the generated code linear in the number of ranges. Ranges marked in
+/// @p ReadOnly may overlap each other, but no other range.
+///
+/// @param Builder  The builder used to emit the check.
+/// @param Min      The start addresses of the ranges as pointer sized integers.
+/// @param Max      The end addresses of the ranges as pointer sized integers.
+/// @param ReadOnly Flags marking the ranges that are only read.
+///
+/// @return A value that is true iff no conflicting ranges overlap.
+llvm::Value *createSortedNoOverlapCheck(PollyIRBuilder &Builder,
+                                        llvm::ArrayRef<llvm::Value *> Min,
+                                        llvm::ArrayRef<llvm::Value *> Max,
+                                        llvm::ArrayRef<bool> ReadOnly);
 }
 #endif
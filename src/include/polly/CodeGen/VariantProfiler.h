@@ -0,0 +1,71 @@
+//===- VariantProfiler.h - Profile the variants of a SCoP -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Select and profile the alternative transformations compiled into a SCoP.
+//
+// If a SCoP is compiled with several alternative transformation scripts for
+// profiling (see Scop::VariantSelector), each execution of the SCoP runs the
+// next variant in a round-robin fashion. The variant, the values of the SCoP
+// parameters and the cycles spent in the SCoP are appended to the file named
+// by the POLLY_VARIANT_PROFILE_FILE environment variable or to
+// polly-variants.jsonl, one JSON object per line and execution (JSON lines). A
+// later compilation reads this profile to keep only the variants that performed
+// best.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef POLLY_VARIANT_PROFILER_H
+#define POLLY_VARIANT_PROFILER_H
+
+#include "polly/CodeGen/IRBuilder.h"
+
+namespace llvm {
+class Function;
+class Value;
+}
+
+namespace polly {
+using namespace llvm;
+class IslExprBuilder;
+class Scop;
+
+class VariantProfiler {
+public:
+  VariantProfiler(PollyIRBuilder &Builder, Scop &S)
+      : Builder(Builder), S(S), Variant(nullptr), StartCycles(nullptr) {}
+
+  /// @brief Are the variants of @p S selected and profiled at run time?
+  static bool isEnabled(Scop &S);
+
+  /// @brief Select the variant of this execution and start timing it.
+  ///
+  /// @return The value of Scop::VariantSelector.
+  Value *start();
+
+  /// @brief Record the variant, parameter values and cycles of this execution.
+  ///
+  /// @param ExprBuilder The builder used to get the values of the parameters.
+  void stop(IslExprBuilder &ExprBuilder);
+
+private:
+  PollyIRBuilder &Builder;
+  Scop &S;
+
+  /// @brief The variant of this execution.
+  Value *Variant;
+
+  /// @brief The value of the cycle counter when the SCoP was entered.
+  Value *StartCycles;
+
+  /// @brief Create the function that appends a record to the profile.
+  Function *createRecordFunction();
+};
+}
+
+#endif
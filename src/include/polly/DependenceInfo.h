@@ -37,6 +37,10 @@ using namespace llvm;
 
 namespace polly {
 
+/// @brief Bound on the memory used by isl in the expensive analyses and
+///        transformations, in MB (0 means no bound).
+extern unsigned PollyIslMaxMemory;
+
 class Scop;
 class ScopStmt;
 class MemoryAccess;
@@ -1,7 +1,7 @@
 #ifndef POLLY_OPT_PARSER
 #define POLLY_OPT_PARSER
 
-typedef enum { typeRealign, typeISplit, typeAffine, typeLift } nodeEnum;
+typedef enum { typeRealign, typeISplit, typeAffine, typeLift, typeFuse, typeOp } nodeEnum;
 
 // Variable
 typedef struct {
@@ -37,6 +37,26 @@ typedef struct {
 	unsigned n;	
 } liftNodeType;
 
+// Fuse Node Type
+typedef struct {
+	varNodeType * l1;
+	varNodeType * l2;
+	varNodeType * r;
+	unsigned n;
+	unsigned shift;
+} fuseNodeType;
+
+// Maximum number of arguments of a labelled operation
+#define MAX_OP_ARGS 8
+
+// Labelled Operation Node Type, e.g. unroll(L, 4) or timetile(L, 0, 16, 32)
+typedef struct {
+	char * name;
+	varNodeType * l;
+	unsigned nargs;
+	unsigned args[MAX_OP_ARGS];
+} opNodeType;
+
 
 typedef struct {
     nodeEnum type;              /* type of node */
@@ -46,6 +66,8 @@ typedef struct {
         isplitNodeType is;       
         affineNodeType a;       
         liftNodeType l;       
+        fuseNodeType f;       
+        opNodeType o;
     };
 } nodeType;
 
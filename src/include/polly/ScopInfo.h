@@ -28,6 +28,7 @@
 
 #include <forward_list>
 #include <deque>
+#include <set>
 
 using namespace llvm;
 
@@ -370,6 +371,29 @@ public:
   /// statement.
   bool isStrideZero(__isl_take const isl_map *Schedule) const;
 
+  /// @brief Get the alignment (in elements) of the first accessed element.
+  ///
+  /// For all statement instances that are executed first within the innermost
+  /// dimension of @p Schedule, compute the offset (in elements) of the
+  /// accessed element from the array base and return the largest power of two
+  /// not larger than @p MaxAlign that divides all of them. For a vectorized
+  /// innermost dimension this is the alignment of the first vector lane
+  /// relative to the array base. If nothing can be proven, e.g. because the
+  /// array has non-constant dimension sizes, 1 is returned.
+  unsigned getFirstLaneAlignment(__isl_take const isl_map *Schedule,
+                                 unsigned MaxAlign) const;
+
+  /// @brief Get the stride of this access, if it is constant.
+  ///
+  /// The stride is the distance (in elements) between the elements accessed
+  /// by two consecutive instances of the innermost dimension of @p Schedule.
+  /// Multi-dimensional strides are linearized, which requires the array
+  /// to have constant dimension sizes.
+  ///
+  /// @return True if the stride is a constant, which is stored in @p Stride.
+  bool getConstantStride(__isl_take const isl_map *Schedule,
+                         int64_t &Stride) const;
+
   /// @brief Check if this is a scalar memory access.
   bool isScalar() const;
 
@@ -723,6 +747,37 @@ static inline raw_ostream &operator<<(raw_ostream &O, const ScopStmt &S) {
   return O;
 }
 
+/// @brief Hints for the optimization of a generated loop by LLVM.
+///
+/// The hints are given by the transformation scripts and are emitted as
+/// llvm.loop metadata, such that the optimizations run after Polly do not need
+/// to rediscover them. A value of zero leaves the decision to LLVM.
+///
+/// The collapse count and the task depth are used by Polly itself for the
+/// parallel loops.
+struct LoopHints {
+  LoopHints()
+      : VectorizeWidth(0), InterleaveCount(0), UnrollCount(0),
+        CollapseCount(0), TaskDepth(0) {}
+
+  /// @brief The vectorization width, one disables the vectorization.
+  unsigned VectorizeWidth;
+
+  /// @brief The interleave count, one disables the interleaving.
+  unsigned InterleaveCount;
+
+  /// @brief The unroll count, one disables the unrolling.
+  unsigned UnrollCount;
+
+  /// @brief The number of nested parallel loops that are collapsed into one
+  ///        parallel loop, starting at the outermost parallel loop.
+  unsigned CollapseCount;
+
+  /// @brief The number of outermost loops whose iterations are run as tasks,
+  ///        one task per iteration of the innermost of these loops.
+  unsigned TaskDepth;
+};
+
 ///===----------------------------------------------------------------------===//
 /// @brief Static Control Part
 ///
@@ -752,12 +807,38 @@ public:
   /// @brief Vector of minimal/maximal access vectors one for each alias group.
   using MinMaxVectorVectorTy = SmallVector<MinMaxVectorTy *, 4>;
 
+  /// @brief Pair of minimal/maximal access vectors of an alias group.
+  ///
+  /// The first element holds the accesses to arrays that are written in the
+  /// SCoP, the second one the accesses to arrays that are only read.
+  using MinMaxVectorPairTy = std::pair<MinMaxVectorTy *, MinMaxVectorTy *>;
+
+  /// @brief Vector of read write/read only access vector pairs.
+  using MinMaxVectorPairVectorTy = SmallVector<MinMaxVectorPairTy, 4>;
+
   /// Maps each region in the function to the domain of statements within the region
   std::map<const std::string, isl_set *> LoopDomainMap;
 
   /// Maps each region in the function to the loop Depth within the region
   std::map<const std::string, unsigned> LoopDimMap;
 
+  /// Maps each region in the function to the hints for the innermost loops
+  /// generated for it
+  std::map<const std::string, LoopHints> LoopHintMap;
+
+  /// The regions skewed into wavefronts, the outermost parallel loop generated
+  /// for them is executed in parallel
+  std::set<std::string> WavefrontLabels;
+
+  /// The names of the alternative transformations compiled into the SCoP, in
+  /// the order of their variant number
+  std::vector<std::string> VariantNames;
+
+  /// The parameter that selects the variant executed at run time, if all
+  /// variants are compiled for profiling, or nullptr. It is not a parameter of
+  /// the context, its value is computed by the generated code.
+  isl_id *VariantSelector;
+
 private:
   Scop(const Scop &) = delete;
   const Scop &operator=(const Scop &) = delete;
@@ -808,6 +889,12 @@ private:
   /// this scop and that need to be code generated as a run-time test.
   isl_set *AssumedContext;
 
+  /// @brief The schedule the SCoP was built with.
+  ///
+  /// The loop domains in LoopDomainMap are subsets of the range of this
+  /// schedule, also after the statements have been rescheduled.
+  isl_union_map *InitialSchedule;
+
   /// @brief The set of minimal/maximal accesses for each alias group.
   ///
   /// When building runtime alias checks we look at all memory instructions and
@@ -820,8 +907,10 @@ private:
   /// one for the float pointers.
   ///
   /// During code generation we will create a runtime alias check for each alias
-  /// group to ensure the SCoP is executed in an alias free environment.
-  MinMaxVectorVectorTy MinMaxAliasGroups;
+  /// group to ensure the SCoP is executed in an alias free environment. Read
+  /// only arrays are kept apart as they never need to be checked against each
+  /// other.
+  MinMaxVectorPairVectorTy MinMaxAliasGroups;
 
   /// Create the static control part with a region, max loop depth of this
   /// region and parameters used in this region.
@@ -999,6 +1088,12 @@ public:
   /// @returns True if __no__ error occurred, false otherwise.
   bool buildAliasGroups(AliasAnalysis &AA);
 
+  /// @brief Compute the minimal/maximal accesses to each array in @p Group.
+  ///
+  /// @returns True if __no__ error occurred, false otherwise.
+  bool calculateMinMaxAccess(const SmallVectorImpl<MemoryAccess *> &Group,
+                             MinMaxVectorTy &MinMaxAccesses);
+
   //// @brief Drop all constant dimensions from statment schedules.
   ///
   ///  Schedule dimensions that are constant accross the scop do not carry
@@ -1007,7 +1102,7 @@ public:
   void dropConstantScheduleDims();
 
   /// @brief Return all alias groups for this SCoP.
-  const MinMaxVectorVectorTy &getAliasGroups() const {
+  const MinMaxVectorPairVectorTy &getAliasGroups() const {
     return MinMaxAliasGroups;
   }
 
@@ -1090,6 +1185,12 @@ public:
   /// @brief Get the schedule of all the statements in the SCoP.
   __isl_give isl_union_map *getSchedule();
 
+  /// @brief Get the statement instances executed by the loop @p Label.
+  ///
+  /// @return The instances of the statements in the loop domain of @p Label
+  ///         or nullptr if there is no loop labelled @p Label.
+  __isl_give isl_union_set *getLoopInstances(const std::string &Label);
+
   /// @brief Intersects the domains of all statements in the SCoP.
   ///
   /// @return true if a change was made
@@ -1114,12 +1215,7 @@ class ScopInfo : public RegionPass {
   Scop *scop;
   isl_ctx *ctx;
 
-  void clear() {
-    if (scop) {
-      delete scop;
-      scop = 0;
-    }
-  }
+  void clear();
 
 public:
   static char ID;
@@ -28,6 +28,7 @@ struct isl_multi_aff;
 struct isl_pw_multi_aff;
 struct isl_aff;
 struct isl_pw_aff;
+struct isl_ast_expr;
 struct isl_val;
 
 namespace llvm {
@@ -50,6 +51,7 @@ std::string stringFromIslObj(__isl_keep isl_multi_aff *maff);
 std::string stringFromIslObj(__isl_keep isl_pw_multi_aff *pma);
 std::string stringFromIslObj(__isl_keep isl_aff *aff);
 std::string stringFromIslObj(__isl_keep isl_pw_aff *pwaff);
+std::string stringFromIslObj(__isl_keep isl_ast_expr *expr);
 //@}
 
 inline llvm::raw_ostream &operator<<(llvm::raw_ostream &OS,
@@ -47,6 +47,16 @@ static cl::opt<int> OptComputeOut(
              "computational steps (0 means no bound)"),
     cl::Hidden, cl::init(410000), cl::ZeroOrMore, cl::cat(PollyCategory));
 
+namespace polly {
+unsigned PollyIslMaxMemory;
+}
+static cl::opt<unsigned, true> IslMaxMemory(
+    "polly-isl-max-memory",
+    cl::desc("Bound the memory used by isl while computing dependences and "
+             "schedules, in MB (0 means no bound)"),
+    cl::location(polly::PollyIslMaxMemory), cl::Hidden, cl::init(0),
+    cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<bool> LegalityCheckDisabled(
     "disable-polly-legality", cl::desc("Disable polly legality check"),
     cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
@@ -237,6 +247,9 @@ void Dependences::calculateDependences(Scop &S) {
   long MaxOpsOld = isl_ctx_get_max_operations(S.getIslCtx());
   if (OptComputeOut)
     isl_ctx_set_max_operations(S.getIslCtx(), OptComputeOut);
+  size_t MaxMemoryOld = isl_ctx_get_max_memory(S.getIslCtx());
+  if (PollyIslMaxMemory)
+    isl_ctx_set_max_memory(S.getIslCtx(), (size_t)PollyIslMaxMemory << 20);
   isl_options_set_on_error(S.getIslCtx(), ISL_ON_ERROR_CONTINUE);
 
   DEBUG(dbgs() << "Read: " << Read << "\n";
@@ -329,6 +342,7 @@ void Dependences::calculateDependences(Scop &S) {
   isl_options_set_on_error(S.getIslCtx(), ISL_ON_ERROR_ABORT);
   isl_ctx_reset_operations(S.getIslCtx());
   isl_ctx_set_max_operations(S.getIslCtx(), MaxOpsOld);
+  isl_ctx_set_max_memory(S.getIslCtx(), MaxMemoryOld);
 
   isl_union_map *STMT_RAW, *STMT_WAW, *STMT_WAR;
   STMT_RAW = isl_union_map_intersect_domain(
@@ -517,15 +531,19 @@ bool Dependences::isValidSchedule(Scop &S,
 // Parallelism test: if the distance is zero in all outer dimensions, then it
 // has to be zero in the current dimension as well.
 //
-// Implementation: first, translate dependences into time space, then force
-// outer dimensions to be equal. If the distance is zero in the current
-// dimension, then the loop is parallel. The distance is zero in the current
-// dimension if it is a subset of a map with equal values for the current
-// dimension.
+// Implementation: first, translate dependences into time space. The loop is
+// parallel if these dependences are disjoint from the relation that forces
+// the outer dimensions to be equal and the current dimension to increase.
+// This check is answered directly on the tableaus of the dependences,
+// without computing their deltas. Only if the loop is not parallel and the
+// minimal dependence distance is requested, do we compute the distance
+// polyhedron of the carried dependences.
 bool Dependences::isParallel(isl_union_map *Schedule, isl_union_map *Deps,
                              isl_pw_aff **MinDistancePtr) const {
   isl_set *Deltas, *Distance;
   isl_map *ScheduleDeps;
+  isl_basic_map *Carried;
+  isl_map_feasibility *Feasibility;
   unsigned Dimension;
   bool IsParallel;
 
@@ -540,6 +558,23 @@ bool Dependences::isParallel(isl_union_map *Schedule, isl_union_map *Deps,
   ScheduleDeps = isl_map_from_union_map(Deps);
   Dimension = isl_map_dim(ScheduleDeps, isl_dim_out) - 1;
 
+  // [=, ..., =, <] - Equal outer dimensions and current dimension increasing
+  Carried = isl_basic_map_universe(isl_map_get_space(ScheduleDeps));
+  for (unsigned i = 0; i < Dimension; i++)
+    Carried = isl_basic_map_equate(Carried, isl_dim_out, i, isl_dim_in, i);
+  Carried = isl_basic_map_order_gt(Carried, isl_dim_out, Dimension,
+                                   isl_dim_in, Dimension);
+
+  Feasibility = isl_map_feasibility_alloc(isl_map_copy(ScheduleDeps));
+  IsParallel = isl_map_feasibility_is_disjoint(Feasibility, Carried);
+  isl_map_feasibility_free(Feasibility);
+  isl_basic_map_free(Carried);
+
+  if (IsParallel || !MinDistancePtr) {
+    isl_map_free(ScheduleDeps);
+    return IsParallel;
+  }
+
   for (unsigned i = 0; i < Dimension; i++)
     ScheduleDeps = isl_map_equate(ScheduleDeps, isl_dim_out, i, isl_dim_in, i);
 
@@ -553,12 +588,6 @@ bool Dependences::isParallel(isl_union_map *Schedule, isl_union_map *Deps,
   Distance = isl_set_lower_bound_si(Distance, isl_dim_set, Dimension, 1);
   Distance = isl_set_intersect(Distance, Deltas);
 
-  IsParallel = isl_set_is_empty(Distance);
-  if (IsParallel || !MinDistancePtr) {
-    isl_set_free(Distance);
-    return IsParallel;
-  }
-
   Distance = isl_set_project_out(Distance, isl_dim_set, 0, Dimension);
   Distance = isl_set_coalesce(Distance);
 
@@ -25,7 +25,6 @@
 #include "polly/Support/ScopHelper.h"
 #include "polly/TempScopInfo.h"
 #include "polly/Support/GICHelper.h"
-#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/STLExtras.h"
@@ -73,7 +72,36 @@ static cl::opt<unsigned> RunTimeChecksMaxParameters(
 static cl::opt<unsigned> RunTimeChecksMaxArraysPerGroup(
     "polly-rtc-max-arrays-per-group",
     cl::desc("The maximal number of arrays to compare in each alias group."),
-    cl::Hidden, cl::ZeroOrMore, cl::init(20), cl::cat(PollyCategory));
+    cl::Hidden, cl::ZeroOrMore, cl::init(128), cl::cat(PollyCategory));
+
+static cl::opt<bool> IslSlabAlloc(
+    "polly-isl-slab-alloc",
+    cl::desc("Allocate isl objects from a slab arena owned by the isl_ctx"),
+    cl::Hidden, cl::ZeroOrMore, cl::init(true), cl::cat(PollyCategory));
+
+static cl::opt<int> IslMemoEntries(
+    "polly-isl-memo",
+    cl::desc("Maximal number of isl coalesce, lexmin/lexmax, emptiness and "
+             "subset results to keep for reuse (0 disables the memo table)"),
+    cl::Hidden, cl::ZeroOrMore, cl::init(0), cl::cat(PollyCategory));
+
+static cl::opt<std::string> IslTraceFile(
+    "polly-isl-trace",
+    cl::desc("Record the expensive isl calls made by Polly in the given file "
+             "for replay with isl_replay"),
+    cl::value_desc("filename"), cl::Hidden, cl::init(""), cl::ZeroOrMore,
+    cl::cat(PollyCategory));
+
+static cl::opt<int> IslThreads(
+    "polly-isl-threads",
+    cl::desc("Number of threads isl may use to process the spaces of a union "
+             "map in parallel (0 or 1 disables parallel processing)"),
+    cl::Hidden, cl::ZeroOrMore, cl::init(0), cl::cat(PollyCategory));
+
+static cl::opt<bool> IslPrintStats(
+    "polly-isl-print-stats",
+    cl::desc("Print isl_ctx statistics when the context is freed"),
+    cl::Hidden, cl::ZeroOrMore, cl::init(false), cl::cat(PollyCategory));
 
 /// Translate a 'const SCEV *' expression in an isl_pw_aff.
 struct SCEVAffinator : public SCEVVisitor<SCEVAffinator, isl_pw_aff *> {
@@ -832,6 +860,113 @@ bool MemoryAccess::isStrideZero(const isl_map *Schedule) const {
   return isStrideX(Schedule, 0);
 }
 
+// Compute for each dimension of the array @p SAI the distance (in elements)
+// between two elements that differ by one in this dimension. This is only
+// possible if the array has @p Dims dimensions, all of constant size.
+//
+//   A[*][10][20]: Strides = {200, 20, 1}
+static bool getDimensionStrides(const ScopArrayInfo *SAI, unsigned Dims,
+                                SmallVectorImpl<uint64_t> &Strides) {
+  if (Dims == 0 || Dims != SAI->getNumberOfDimensions())
+    return false;
+
+  Strides.assign(Dims, 1);
+  for (int i = Dims - 2; i >= 0; --i) {
+    auto *Size = dyn_cast<SCEVConstant>(SAI->getDimensionSize(i));
+    if (!Size)
+      return false;
+    Strides[i] = Strides[i + 1] * Size->getValue()->getZExtValue();
+  }
+
+  return true;
+}
+
+unsigned
+MemoryAccess::getFirstLaneAlignment(__isl_take const isl_map *Schedule,
+                                    unsigned MaxAlign) const {
+  isl_map *S = const_cast<isl_map *>(Schedule);
+  isl_map *AccessRelation = getAccessRelation();
+  unsigned Dims = isl_map_n_out(AccessRelation);
+  SmallVector<uint64_t, 4> Strides;
+
+  if (!getDimensionStrides(getScopArrayInfo(), Dims, Strides)) {
+    isl_map_free(S);
+    isl_map_free(AccessRelation);
+    return 1;
+  }
+
+  // The schedule points that have no predecessor in the innermost dimension
+  // are the first lanes.
+  //
+  //   First = Range(S) - (Range(S) . EqualAndLarger)
+  isl_set *Lanes = isl_map_range(isl_map_copy(S));
+  isl_set *Later = isl_set_apply(isl_set_copy(Lanes),
+                                 getEqualAndLarger(isl_set_get_space(Lanes)));
+  isl_set *First = isl_set_subtract(Lanes, Later);
+  First = isl_set_apply(First, isl_map_reverse(S));
+  isl_set *Elements = isl_set_apply(First, AccessRelation);
+
+  // Linearize the element index. As we are only interested in the offset
+  // modulo MaxAlign, the strides are reduced modulo MaxAlign.
+  isl_ctx *Ctx = isl_set_get_ctx(Elements);
+  isl_local_space *LS = isl_local_space_from_space(isl_set_get_space(Elements));
+  isl_aff *Offset = isl_aff_zero_on_domain(isl_local_space_copy(LS));
+  for (unsigned i = 0; i < Dims; ++i) {
+    isl_aff *Dim =
+        isl_aff_var_on_domain(isl_local_space_copy(LS), isl_dim_set, i);
+    isl_val *Stride = isl_val_int_from_ui(Ctx, Strides[i] % MaxAlign);
+    Dim = isl_aff_scale_val(Dim, Stride);
+    Offset = isl_aff_add(Offset, Dim);
+  }
+  isl_local_space_free(LS);
+
+  unsigned Align = 1;
+  for (unsigned K = MaxAlign; K > 1; K /= 2) {
+    isl_aff *Rem = isl_aff_mod_val(isl_aff_copy(Offset),
+                                   isl_val_int_from_ui(Ctx, K));
+    isl_set *Misaligned = isl_pw_aff_non_zero_set(isl_pw_aff_from_aff(Rem));
+    Misaligned = isl_set_intersect(Misaligned, isl_set_copy(Elements));
+    bool IsAligned = isl_set_is_empty(Misaligned);
+    isl_set_free(Misaligned);
+
+    if (IsAligned) {
+      Align = K;
+      break;
+    }
+  }
+
+  isl_aff_free(Offset);
+  isl_set_free(Elements);
+  return Align;
+}
+
+bool MemoryAccess::getConstantStride(__isl_take const isl_map *Schedule,
+                                     int64_t &Stride) const {
+  isl_set *Deltas = getStride(Schedule);
+  unsigned Dims = isl_set_dim(Deltas, isl_dim_set);
+  SmallVector<uint64_t, 4> Strides;
+
+  if (!isl_set_is_singleton(Deltas) ||
+      !getDimensionStrides(getScopArrayInfo(), Dims, Strides)) {
+    isl_set_free(Deltas);
+    return false;
+  }
+
+  isl_point *P = isl_set_sample_point(Deltas);
+  bool IsConstant = !isl_point_is_void(P);
+
+  Stride = 0;
+  for (unsigned i = 0; IsConstant && i < Dims; ++i) {
+    isl_val *V = isl_point_get_coordinate_val(P, isl_dim_set, i);
+    IsConstant = isl_val_is_int(V);
+    Stride += isl_val_get_num_si(V) * (int64_t)Strides[i];
+    isl_val_free(V);
+  }
+
+  isl_point_free(P);
+  return IsConstant;
+}
+
 bool MemoryAccess::isScalar() const {
   return isl_map_n_out(AccessRelation) == 0;
 }
@@ -1492,8 +1627,9 @@ bool Scop::buildAliasGroups(AliasAnalysis &AA) {
   //      accesses. That means two minimal/maximal accesses are only in a group
   //      if their access domains intersect, otherwise they are in different
   //      ones.
-  //   o) We split groups such that they contain at most one read only base
-  //      address.
+  //   o) We split each group into the accesses to read write and the accesses
+  //      to read only arrays, as two read only arrays never need to be
+  //      checked against each other.
   //   o) For each group with more than one base pointer we then compute minimal
   //      and maximal accesses to each array in this group.
   using AliasGroupTy = SmallVector<MemoryAccess *, 4>;
@@ -1557,89 +1693,85 @@ bool Scop::buildAliasGroups(AliasAnalysis &AA) {
     isl_set_free(AGDomain);
   }
 
-  MapVector<const Value *, SmallPtrSet<MemoryAccess *, 8>> ReadOnlyPairs;
+  // Split each alias group into the accesses to arrays that are written and
+  // the accesses to arrays that are only read. Read only arrays may overlap
+  // each other, hence they are only checked against the read write ones.
+  SmallVector<std::pair<AliasGroupTy, AliasGroupTy>, 4> SplitAliasGroups;
   SmallPtrSet<const Value *, 4> NonReadOnlyBaseValues;
   for (AliasGroupTy &AG : AliasGroups) {
-    NonReadOnlyBaseValues.clear();
-    ReadOnlyPairs.clear();
-
-    if (AG.size() < 2) {
-      AG.clear();
+    if (AG.size() < 2)
       continue;
-    }
 
-    for (auto II = AG.begin(); II != AG.end();) {
-      Value *BaseAddr = (*II)->getBaseAddr();
+    AliasGroupTy ReadWriteAccesses, ReadOnlyAccesses;
+    NonReadOnlyBaseValues.clear();
+    for (MemoryAccess *MA : AG) {
+      Value *BaseAddr = MA->getBaseAddr();
       if (HasWriteAccess.count(BaseAddr)) {
         NonReadOnlyBaseValues.insert(BaseAddr);
-        II++;
+        ReadWriteAccesses.push_back(MA);
       } else {
-        ReadOnlyPairs[BaseAddr].insert(*II);
-        II = AG.erase(II);
+        ReadOnlyAccesses.push_back(MA);
       }
     }
 
-    // If we don't have read only pointers check if there are at least two
-    // non read only pointers, otherwise clear the alias group.
-    if (ReadOnlyPairs.empty()) {
-      if (NonReadOnlyBaseValues.size() <= 1)
-        AG.clear();
+    // If we don't have non read only pointers there is nothing to check.
+    if (NonReadOnlyBaseValues.empty())
       continue;
-    }
 
-    // If we don't have non read only pointers clear the alias group.
-    if (NonReadOnlyBaseValues.empty()) {
-      AG.clear();
+    // A single non read only pointer needs to be checked only if there are
+    // read only pointers it could overlap with.
+    if (NonReadOnlyBaseValues.size() == 1 && ReadOnlyAccesses.empty())
       continue;
-    }
 
-    // If we have both read only and non read only base pointers we combine
-    // the non read only ones with exactly one read only one at a time into a
-    // new alias group and clear the old alias group in the end.
-    for (const auto &ReadOnlyPair : ReadOnlyPairs) {
-      AliasGroupTy AGNonReadOnly = AG;
-      for (MemoryAccess *MA : ReadOnlyPair.second)
-        AGNonReadOnly.push_back(MA);
-      AliasGroups.push_back(std::move(AGNonReadOnly));
-    }
-    AG.clear();
+    SplitAliasGroups.push_back(
+        std::make_pair(std::move(ReadWriteAccesses),
+                       std::move(ReadOnlyAccesses)));
   }
 
-  for (AliasGroupTy &AG : AliasGroups) {
-    if (AG.empty())
-      continue;
-
-    MinMaxVectorTy *MinMaxAccesses = new MinMaxVectorTy();
-    MinMaxAccesses->reserve(AG.size());
-
-    isl_union_map *Accesses = isl_union_map_empty(getParamSpace());
-    for (MemoryAccess *MA : AG)
-      Accesses = isl_union_map_add_map(Accesses, MA->getAccessRelation());
-    Accesses = isl_union_map_intersect_domain(Accesses, getDomains());
-
-    isl_union_set *Locations = isl_union_map_range(Accesses);
-    Locations = isl_union_set_intersect_params(Locations, getAssumedContext());
-    Locations = isl_union_set_coalesce(Locations);
-    Locations = isl_union_set_detect_equalities(Locations);
-    bool Valid = (0 == isl_union_set_foreach_set(Locations, buildMinMaxAccess,
-                                                 MinMaxAccesses));
-    isl_union_set_free(Locations);
-    MinMaxAliasGroups.push_back(MinMaxAccesses);
+  for (auto &Pair : SplitAliasGroups) {
+    MinMaxVectorTy *MinMaxAccessesReadWrite = new MinMaxVectorTy();
+    MinMaxVectorTy *MinMaxAccessesReadOnly = new MinMaxVectorTy();
+    MinMaxAliasGroups.push_back(
+        std::make_pair(MinMaxAccessesReadWrite, MinMaxAccessesReadOnly));
 
-    if (!Valid)
+    if (!calculateMinMaxAccess(Pair.first, *MinMaxAccessesReadWrite) ||
+        !calculateMinMaxAccess(Pair.second, *MinMaxAccessesReadOnly))
       return false;
   }
 
-  // Bail out if the number of values we need to compare is too large.
-  // This is important as the number of comparisions grows quadratically with
-  // the number of values we need to compare.
-  for (const auto *Values : MinMaxAliasGroups)
-    if (Values->size() > RunTimeChecksMaxArraysPerGroup)
+  // Bail out if the number of values we need to compare is too large. Large
+  // alias groups are checked by sorting the accessed ranges at run time, so
+  // this limit only bounds the effort spent on computing the ranges.
+  for (const auto &Pair : MinMaxAliasGroups)
+    if (Pair.first->size() + Pair.second->size() >
+        RunTimeChecksMaxArraysPerGroup)
       return false;
 
   return true;
 }
 
+bool Scop::calculateMinMaxAccess(const SmallVectorImpl<MemoryAccess *> &Group,
+                                 MinMaxVectorTy &MinMaxAccesses) {
+  if (Group.empty())
+    return true;
+
+  MinMaxAccesses.reserve(Group.size());
+
+  isl_union_map *Accesses = isl_union_map_empty(getParamSpace());
+  for (MemoryAccess *MA : Group)
+    Accesses = isl_union_map_add_map(Accesses, MA->getAccessRelation());
+  Accesses = isl_union_map_intersect_domain(Accesses, getDomains());
+
+  isl_union_set *Locations = isl_union_map_range(Accesses);
+  Locations = isl_union_set_intersect_params(Locations, getAssumedContext());
+  Locations = isl_union_set_coalesce(Locations);
+  Locations = isl_union_set_detect_equalities(Locations);
+  bool Valid = (0 == isl_union_set_foreach_set(Locations, buildMinMaxAccess,
+                                               &MinMaxAccesses));
+  isl_union_set_free(Locations);
+  return Valid;
+}
+
 static unsigned getMaxLoopDepthInRegion(const Region &R, LoopInfo &LI,
                                         ScopDetection &SD) {
 
@@ -1739,6 +1871,8 @@ Scop::Scop(TempScop &tempScop, LoopInfo &LI, ScalarEvolution &ScalarEvolution,
   realignParams();
   addParameterBounds();
   simplifyAssumedContext();
+  InitialSchedule = getSchedule();
+  VariantSelector = nullptr;
   // dropConstantScheduleDims();
   
   // remove Non-Loop Regions
@@ -1748,17 +1882,24 @@ Scop::Scop(TempScop &tempScop, LoopInfo &LI, ScalarEvolution &ScalarEvolution,
 Scop::~Scop() {
   isl_set_free(Context);
   isl_set_free(AssumedContext);
+  isl_union_map_free(InitialSchedule);
+  isl_id_free(VariantSelector);
   for (const auto &It : LoopDomainMap) {
       isl_set_free(It.second);
   }
 
   // Free the alias groups
-  for (MinMaxVectorTy *MinMaxAccesses : MinMaxAliasGroups) {
-    for (MinMaxAccessTy &MMA : *MinMaxAccesses) {
+  for (MinMaxVectorPairTy &MinMaxAccessPair : MinMaxAliasGroups) {
+    for (MinMaxAccessTy &MMA : *MinMaxAccessPair.first) {
+      isl_pw_multi_aff_free(MMA.first);
+      isl_pw_multi_aff_free(MMA.second);
+    }
+    for (MinMaxAccessTy &MMA : *MinMaxAccessPair.second) {
       isl_pw_multi_aff_free(MMA.first);
       isl_pw_multi_aff_free(MMA.second);
     }
-    delete MinMaxAccesses;
+    delete MinMaxAccessPair.first;
+    delete MinMaxAccessPair.second;
   }
 }
 
@@ -1843,9 +1984,12 @@ void Scop::printAliasAssumptions(raw_ostream &OS) const {
     OS.indent(8) << "n/a\n";
     return;
   }
-  for (MinMaxVectorTy *MinMaxAccesses : MinMaxAliasGroups) {
+  for (const MinMaxVectorPairTy &Pair : MinMaxAliasGroups) {
     OS.indent(8) << "[[";
-    for (MinMaxAccessTy &MinMacAccess : *MinMaxAccesses)
+    for (MinMaxAccessTy &MinMacAccess : *Pair.first)
+      OS << " <" << MinMacAccess.first << ", " << MinMacAccess.second << ">";
+    OS << " ] [";
+    for (MinMaxAccessTy &MinMacAccess : *Pair.second)
       OS << " <" << MinMacAccess.first << ", " << MinMacAccess.second << ">";
     OS << " ]]\n";
   }
@@ -1981,6 +2125,17 @@ __isl_give isl_union_map *Scop::getSchedule() {
   return isl_union_map_coalesce(Schedule);
 }
 
+__isl_give isl_union_set *Scop::getLoopInstances(const std::string &Label) {
+  auto It = LoopDomainMap.find(Label);
+  if (It == LoopDomainMap.end() || !It->second)
+    return nullptr;
+
+  isl_union_set *Instances = isl_union_set_from_set(isl_set_copy(It->second));
+  Instances = isl_union_set_apply(
+      Instances, isl_union_map_reverse(isl_union_map_copy(InitialSchedule)));
+  return isl_union_set_intersect(Instances, getDomains());
+}
+
 bool Scop::restrictDomains(__isl_take isl_union_set *Domain) {
   bool Changed = false;
   for (ScopStmt &Stmt : *this) {
@@ -2108,10 +2263,29 @@ ScopStmt *Scop::getStmtForBasicBlock(BasicBlock *BB) const {
 ScopInfo::ScopInfo() : RegionPass(ID), scop(0) {
   ctx = isl_ctx_alloc();
   isl_options_set_on_error(ctx, ISL_ON_ERROR_ABORT);
+  isl_options_set_slab_alloc(ctx, IslSlabAlloc);
+  isl_options_set_print_stats(ctx, IslPrintStats);
+  isl_options_set_memo_max_entries(ctx, IslMemoEntries);
+  isl_options_set_union_map_threads(ctx, IslThreads);
+  if (!IslTraceFile.empty())
+    isl_options_set_trace_file(ctx, IslTraceFile.c_str());
+}
+
+void ScopInfo::clear() {
+  if (!scop)
+    return;
+
+  // The peak is only tracked by isl if statistics are printed.
+  if (IslPrintStats)
+    errs() << "isl peak memory usage of " << scop->getNameStr() << ": "
+           << isl_ctx_get_peak_memory(ctx) << " bytes\n";
+  delete scop;
+  scop = 0;
 }
 
 ScopInfo::~ScopInfo() {
   clear();
+  // Freeing the context also releases its slab arena in one go.
   isl_ctx_free(ctx);
 }
 
@@ -2139,6 +2313,8 @@ bool ScopInfo::runOnRegion(Region *R, RGPassManager &RGM) {
     return false;
   }
 
+  // Measure the memory used by isl for each SCoP separately.
+  isl_ctx_reset_memory(ctx);
   scop = new Scop(*tempScop, LI, SE, SD, ctx);
 
   DEBUG(scop->print(dbgs()));
@@ -25,9 +25,13 @@
 #include "llvm/Analysis/RegionInfo.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
 #include "isl/aff.h"
 #include "isl/ast.h"
 #include "isl/ast_build.h"
@@ -42,6 +46,18 @@ static cl::opt<bool> Aligned("enable-polly-aligned",
                              cl::Hidden, cl::init(false), cl::ZeroOrMore,
                              cl::cat(PollyCategory));
 
+static cl::opt<bool> VectorGather(
+    "polly-vector-gather",
+    cl::desc("Use masked gather/scatter intrinsics for vector accesses that "
+             "are not consecutive in memory"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<unsigned> VectorMaxShuffleStride(
+    "polly-vector-max-shuffle-stride",
+    cl::desc("The maximal constant stride for which vector loads are "
+             "generated as a wide load followed by a shuffle"),
+    cl::Hidden, cl::init(4), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 bool polly::canSynthesize(const Instruction *I, const llvm::LoopInfo *LI,
                           ScalarEvolution *SE, const Region *R) {
   if (!I || !SE->isSCEVable(I->getType()))
@@ -670,13 +686,134 @@ void BlockGenerator::finalizeSCoP(Scop &S, ValueMapT &GlobalMap) {
 VectorBlockGenerator::VectorBlockGenerator(BlockGenerator &BlockGen,
                                            VectorValueMapT &GlobalMaps,
                                            std::vector<LoopToScevMapT> &VLTS,
-                                           isl_map *Schedule)
+                                           isl_map *Schedule,
+                                           ArrayRef<Value *> AlignedBases,
+                                           Value *Mask)
     : BlockGenerator(BlockGen), GlobalMaps(GlobalMaps), VLTS(VLTS),
-      Schedule(Schedule) {
+      Schedule(Schedule), AlignedBases(AlignedBases), Mask(Mask) {
   assert(GlobalMaps.size() > 1 && "Only one vector lane found");
   assert(Schedule && "No statement domain provided");
 }
 
+unsigned VectorBlockGenerator::getVectorAlignment(Type *ElementType,
+                                                  int VectorWidth,
+                                                  const DataLayout &DL) {
+  return DL.getABITypeAlignment(VectorType::get(ElementType, VectorWidth));
+}
+
+/// @brief Get the alignment of the first lane of @p Access relative to its
+///        base address in bytes, but at most @p VecAlign.
+static unsigned getFirstLaneOffsetAlignment(const MemoryAccess &Access,
+                                            __isl_keep isl_map *Schedule,
+                                            Type *ElementType,
+                                            unsigned VecAlign,
+                                            const DataLayout &DL) {
+  unsigned ElemSize = DL.getTypeAllocSize(ElementType);
+
+  if (!isPowerOf2_32(ElemSize) || VecAlign <= ElemSize)
+    return ElemSize;
+
+  return ElemSize * Access.getFirstLaneAlignment(isl_map_copy(Schedule),
+                                                 VecAlign / ElemSize);
+}
+
+void VectorBlockGenerator::collectAlignmentCandidates(
+    ScopStmt &Stmt, __isl_keep isl_map *Schedule, int VectorWidth,
+    MapVector<Value *, unsigned> &Bases) {
+  for (MemoryAccess *MA : Stmt) {
+    if (MA->isScalar() || !MA->isStrideOne(isl_map_copy(Schedule)))
+      continue;
+
+    Instruction *Inst = MA->getAccessInstruction();
+    const DataLayout &DL =
+        Inst->getParent()->getParent()->getParent()->getDataLayout();
+    Type *ElementType = getPointerOperand(*Inst)->getType();
+    ElementType = cast<PointerType>(ElementType)->getElementType();
+
+    if (!VectorType::isValidElementType(ElementType))
+      continue;
+
+    unsigned VecAlign = getVectorAlignment(ElementType, VectorWidth, DL);
+    if (VecAlign <= DL.getABITypeAlignment(ElementType))
+      continue;
+
+    if (getFirstLaneOffsetAlignment(*MA, Schedule, ElementType, VecAlign, DL) <
+        VecAlign)
+      continue;
+
+    Value *Base = MA->getBaseAddr();
+    if (getOrEnforceKnownAlignment(Base, VecAlign, DL) < VecAlign)
+      Bases[Base] = std::max(Bases[Base], VecAlign);
+  }
+}
+
+bool VectorBlockGenerator::canGenerateMasked(ScopStmt &Stmt,
+                                             __isl_keep isl_map *Schedule) {
+  for (Instruction &Inst : *Stmt.getBasicBlock()) {
+    if (Inst.isTerminator() || isIgnoredIntrinsic(&Inst) ||
+        isa<DbgInfoIntrinsic>(Inst))
+      continue;
+
+    // Memory accesses are checked below.
+    if (isa<LoadInst>(Inst) || isa<StoreInst>(Inst))
+      continue;
+
+    if (!isSafeToSpeculativelyExecute(&Inst))
+      return false;
+  }
+
+  for (MemoryAccess *MA : Stmt) {
+    if (MA->isScalar())
+      return false;
+
+    Instruction *Inst = MA->getAccessInstruction();
+    Type *ElementType = getPointerOperand(*Inst)->getType();
+    ElementType = cast<PointerType>(ElementType)->getElementType();
+    if (!VectorType::isValidElementType(ElementType))
+      return false;
+
+    if (MA->isStrideOne(isl_map_copy(Schedule)))
+      continue;
+
+    if (isa<LoadInst>(Inst) && (MA->isStrideZero(isl_map_copy(Schedule)) ||
+                                MA->isStrideX(isl_map_copy(Schedule), -1)))
+      continue;
+
+    if (!VectorGather)
+      return false;
+  }
+
+  return true;
+}
+
+const DataLayout &VectorBlockGenerator::getDataLayout() {
+  return Builder.GetInsertBlock()->getParent()->getParent()->getDataLayout();
+}
+
+unsigned VectorBlockGenerator::getFirstLaneAlignment(const MemoryAccess &Access,
+                                                     const Value *Pointer) {
+  const DataLayout &DL = getDataLayout();
+  Type *ElementType = cast<PointerType>(Pointer->getType())->getElementType();
+  unsigned ElemAlign = DL.getABITypeAlignment(ElementType);
+  unsigned VecAlign = getVectorAlignment(ElementType, getVectorWidth(), DL);
+
+  if (Aligned)
+    return VecAlign;
+
+  unsigned OffsetAlign = getFirstLaneOffsetAlignment(Access, Schedule,
+                                                     ElementType, VecAlign, DL);
+
+  Value *Base = Access.getBaseAddr();
+  unsigned BaseAlign;
+  if (std::find(AlignedBases.begin(), AlignedBases.end(), Base) !=
+      AlignedBases.end())
+    BaseAlign = VecAlign;
+  else
+    BaseAlign = getOrEnforceKnownAlignment(Base, VecAlign, DL);
+
+  return std::max(ElemAlign, std::min(BaseAlign, OffsetAlign));
+}
+
 Value *VectorBlockGenerator::getVectorValue(ScopStmt &Stmt, const Value *Old,
                                             ValueMapT &VectorMap,
                                             VectorValueMapT &ScalarMaps,
@@ -709,6 +846,25 @@ Type *VectorBlockGenerator::getVectorPtrTy(const Value *Val, int Width) {
   return PointerType::getUnqual(VectorType);
 }
 
+/// @brief Reverse the order of the elements of @p Vector.
+static Value *reverseVector(PollyIRBuilder &Builder, Value *Vector,
+                            const Twine &Name) {
+  unsigned VectorWidth = cast<VectorType>(Vector->getType())->getNumElements();
+  SmallVector<Constant *, 16> Indices;
+  for (int i = VectorWidth - 1; i >= 0; i--)
+    Indices.push_back(ConstantInt::get(Builder.getInt32Ty(), i));
+  Constant *SV = llvm::ConstantVector::get(Indices);
+  return Builder.CreateShuffleVector(Vector, Vector, SV, Name);
+}
+
+Value *VectorBlockGenerator::getMask() {
+  if (Mask)
+    return Mask;
+
+  return Constant::getAllOnesValue(
+      VectorType::get(Builder.getInt1Ty(), getVectorWidth()));
+}
+
 Value *VectorBlockGenerator::generateStrideOneLoad(
     ScopStmt &Stmt, const LoadInst *Load, VectorValueMapT &ScalarMaps,
     bool NegativeStride = false) {
@@ -722,21 +878,31 @@ Value *VectorBlockGenerator::generateStrideOneLoad(
                                         GlobalMaps[Offset], VLTS[Offset]);
   Value *VectorPtr =
       Builder.CreateBitCast(NewPointer, VectorPtrType, "vector_ptr");
-  LoadInst *VecLoad =
-      Builder.CreateLoad(VectorPtr, Load->getName() + "_p_vec_full");
-  if (!Aligned)
-    VecLoad->setAlignment(8);
-
-  if (NegativeStride) {
-    SmallVector<Constant *, 16> Indices;
-    for (int i = VectorWidth - 1; i >= 0; i--)
-      Indices.push_back(ConstantInt::get(Builder.getInt32Ty(), i));
-    Constant *SV = llvm::ConstantVector::get(Indices);
-    Value *RevVecLoad = Builder.CreateShuffleVector(
-        VecLoad, VecLoad, SV, Load->getName() + "_reverse");
-    return RevVecLoad;
+
+  // For negative strides the vector starts at the last lane, for which no
+  // alignment has been derived.
+  unsigned Align;
+  if (NegativeStride)
+    Align = getDataLayout().getABITypeAlignment(Load->getType());
+  else
+    Align = getFirstLaneAlignment(Stmt.getAccessFor(Load), Pointer);
+
+  Value *VecLoad;
+  if (Mask) {
+    Value *LaneMask =
+        NegativeStride ? reverseVector(Builder, Mask, "reverse_mask") : Mask;
+    VecLoad = Builder.CreateMaskedLoad(VectorPtr, Align, LaneMask, nullptr,
+                                       Load->getName() + "_p_vec_masked");
+  } else {
+    LoadInst *FullLoad =
+        Builder.CreateLoad(VectorPtr, Load->getName() + "_p_vec_full");
+    FullLoad->setAlignment(Align);
+    VecLoad = FullLoad;
   }
 
+  if (NegativeStride)
+    return reverseVector(Builder, VecLoad, Load->getName() + "_reverse");
+
   return VecLoad;
 }
 
@@ -752,8 +918,8 @@ Value *VectorBlockGenerator::generateStrideZeroLoad(ScopStmt &Stmt,
   LoadInst *ScalarLoad =
       Builder.CreateLoad(VectorPtr, Load->getName() + "_p_splat_one");
 
-  if (!Aligned)
-    ScalarLoad->setAlignment(8);
+  ScalarLoad->setAlignment(
+      getDataLayout().getABITypeAlignment(Load->getType()));
 
   Constant *SplatVector = Constant::getNullValue(
       VectorType::get(Builder.getInt32Ty(), getVectorWidth()));
@@ -784,6 +950,80 @@ Value *VectorBlockGenerator::generateUnknownStrideLoad(
   return Vector;
 }
 
+Value *VectorBlockGenerator::generateStridedLoad(ScopStmt &Stmt,
+                                                 const LoadInst *Load,
+                                                 VectorValueMapT &ScalarMaps,
+                                                 int Stride) {
+  int VectorWidth = getVectorWidth();
+  const Value *Pointer = Load->getPointerOperand();
+  unsigned AbsStride = std::abs(Stride);
+  unsigned Span = (VectorWidth - 1) * AbsStride + 1;
+
+  // The lowest address is accessed by the first lane for positive strides and
+  // by the last lane for negative strides.
+  unsigned Offset = Stride > 0 ? 0 : VectorWidth - 1;
+  Value *NewPointer = generateLocationAccessed(
+      Stmt, Load, Pointer, ScalarMaps[Offset], GlobalMaps[Offset],
+      VLTS[Offset]);
+  Value *WidePtr = Builder.CreateBitCast(
+      NewPointer, getVectorPtrTy(Pointer, Span), "wide_ptr");
+  LoadInst *WideLoad =
+      Builder.CreateLoad(WidePtr, Load->getName() + "_p_vec_wide");
+
+  if (Stride > 0)
+    WideLoad->setAlignment(
+        getFirstLaneAlignment(Stmt.getAccessFor(Load), Pointer));
+  else
+    WideLoad->setAlignment(
+        getDataLayout().getABITypeAlignment(Load->getType()));
+
+  SmallVector<Constant *, 16> Indices;
+  for (int i = 0; i < VectorWidth; i++) {
+    unsigned Index = (Stride > 0 ? i : VectorWidth - 1 - i) * AbsStride;
+    Indices.push_back(Builder.getInt32(Index));
+  }
+  Constant *SV = llvm::ConstantVector::get(Indices);
+
+  return Builder.CreateShuffleVector(WideLoad, WideLoad, SV,
+                                     Load->getName() + "_p_vec_strided");
+}
+
+Value *VectorBlockGenerator::getVectorOfPointers(ScopStmt &Stmt,
+                                                 const Instruction *Inst,
+                                                 const Value *Pointer,
+                                                 VectorValueMapT &ScalarMaps) {
+  int VectorWidth = getVectorWidth();
+  Value *Pointers =
+      UndefValue::get(VectorType::get(Pointer->getType(), VectorWidth));
+
+  for (int i = 0; i < VectorWidth; i++) {
+    Value *NewPointer = generateLocationAccessed(
+        Stmt, Inst, Pointer, ScalarMaps[i], GlobalMaps[i], VLTS[i]);
+    NewPointer = Builder.CreateBitCast(NewPointer, Pointer->getType());
+    Pointers = Builder.CreateInsertElement(Pointers, NewPointer,
+                                           Builder.getInt32(i), "lane_ptrs");
+  }
+
+  return Pointers;
+}
+
+Value *VectorBlockGenerator::generateGatherLoad(ScopStmt &Stmt,
+                                                const LoadInst *Load,
+                                                VectorValueMapT &ScalarMaps) {
+  const Value *Pointer = Load->getPointerOperand();
+  VectorType *VecTy = VectorType::get(Load->getType(), getVectorWidth());
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  Function *Gather =
+      Intrinsic::getDeclaration(M, Intrinsic::masked_gather, VecTy);
+
+  Value *Pointers = getVectorOfPointers(Stmt, Load, Pointer, ScalarMaps);
+  unsigned Align = getDataLayout().getABITypeAlignment(Load->getType());
+  Value *Args[] = {Pointers, Builder.getInt32(Align), getMask(),
+                   UndefValue::get(VecTy)};
+
+  return Builder.CreateCall(Gather, Args, Load->getName() + "_p_gather");
+}
+
 void VectorBlockGenerator::generateLoad(ScopStmt &Stmt, const LoadInst *Load,
                                         ValueMapT &VectorMap,
                                         VectorValueMapT &ScalarMaps) {
@@ -800,13 +1040,26 @@ void VectorBlockGenerator::generateLoad(ScopStmt &Stmt, const LoadInst *Load,
   // the data location.
   extractScalarValues(Load, VectorMap, ScalarMaps);
 
+  // For masked vector code the first lane is known to be active, so a
+  // stride zero load does not need to be masked.
   Value *NewLoad;
+  int64_t Stride;
   if (Access.isStrideZero(isl_map_copy(Schedule)))
     NewLoad = generateStrideZeroLoad(Stmt, Load, ScalarMaps[0]);
   else if (Access.isStrideOne(isl_map_copy(Schedule)))
     NewLoad = generateStrideOneLoad(Stmt, Load, ScalarMaps);
   else if (Access.isStrideX(isl_map_copy(Schedule), -1))
     NewLoad = generateStrideOneLoad(Stmt, Load, ScalarMaps, true);
+  else if (!Access.getConstantStride(isl_map_copy(Schedule), Stride))
+    NewLoad = VectorGather ? generateGatherLoad(Stmt, Load, ScalarMaps)
+                           : generateUnknownStrideLoad(Stmt, Load, ScalarMaps);
+  else if (Stride == 1 || Stride == -1)
+    NewLoad = generateStrideOneLoad(Stmt, Load, ScalarMaps, Stride == -1);
+  else if (!Mask && Stride != 0 &&
+           (uint64_t)std::abs(Stride) <= VectorMaxShuffleStride)
+    NewLoad = generateStridedLoad(Stmt, Load, ScalarMaps, Stride);
+  else if (VectorGather)
+    NewLoad = generateGatherLoad(Stmt, Load, ScalarMaps);
   else
     NewLoad = generateUnknownStrideLoad(Stmt, Load, ScalarMaps);
 
@@ -865,10 +1118,23 @@ void VectorBlockGenerator::copyStore(ScopStmt &Stmt, const StoreInst *Store,
 
     Value *VectorPtr =
         Builder.CreateBitCast(NewPointer, VectorPtrType, "vector_ptr");
-    StoreInst *Store = Builder.CreateStore(Vector, VectorPtr);
+    unsigned Align = getFirstLaneAlignment(Access, Pointer);
 
-    if (!Aligned)
-      Store->setAlignment(8);
+    if (Mask) {
+      Builder.CreateMaskedStore(Vector, VectorPtr, Align, Mask);
+    } else {
+      StoreInst *NewStore = Builder.CreateStore(Vector, VectorPtr);
+      NewStore->setAlignment(Align);
+    }
+  } else if (VectorGather) {
+    Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+    Function *Scatter = Intrinsic::getDeclaration(M, Intrinsic::masked_scatter,
+                                                  Vector->getType());
+    Value *Pointers = getVectorOfPointers(Stmt, Store, Pointer, ScalarMaps);
+    unsigned Align = getDataLayout().getABITypeAlignment(
+        Store->getValueOperand()->getType());
+    Value *Args[] = {Vector, Pointers, Builder.getInt32(Align), getMask()};
+    Builder.CreateCall(Scatter, Args);
   } else {
     for (unsigned i = 0; i < ScalarMaps.size(); i++) {
       Value *Scalar = Builder.CreateExtractElement(Vector, Builder.getInt32(i));
@@ -965,6 +1231,14 @@ void VectorBlockGenerator::copyInstruction(ScopStmt &Stmt,
     return;
   }
 
+  // With inactive lanes, all stores need to be masked, even if they do not
+  // have vector operands.
+  if (Mask)
+    if (const StoreInst *Store = dyn_cast<StoreInst>(Inst)) {
+      copyStore(Stmt, Store, VectorMap, ScalarMaps);
+      return;
+    }
+
   if (hasVectorOperands(Inst, VectorMap)) {
     if (const StoreInst *Store = dyn_cast<StoreInst>(Inst)) {
       copyStore(Stmt, Store, VectorMap, ScalarMaps);
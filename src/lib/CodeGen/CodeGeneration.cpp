@@ -22,20 +22,28 @@
 #include "polly/CodeGen/IslNodeBuilder.h"
 #include "polly/CodeGen/IslAst.h"
 #include "polly/CodeGen/Utils.h"
+#include "polly/CodeGen/VariantProfiler.h"
 #include "polly/DependenceInfo.h"
 #include "polly/LinkAllPasses.h"
+#include "polly/Options.h"
 #include "polly/ScopInfo.h"
 #include "polly/Support/ScopHelper.h"
 #include "polly/TempScopInfo.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/Debug.h"
+#include "isl/id.h"
 
 using namespace polly;
 using namespace llvm;
 
 #define DEBUG_TYPE "polly-codegen"
 
+static cl::opt<bool> PollyHoistRTC(
+    "polly-rtc-hoist",
+    cl::desc("Hoist the run-time checks out of loops surrounding the SCoP"),
+    cl::Hidden, cl::init(true), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 namespace {
 class CodeGeneration : public ScopPass {
 public:
@@ -58,6 +66,65 @@ public:
   /// @brief The loop annotator to generate llvm.loop metadata.
   ScopAnnotator Annotator;
 
+  /// @brief Hoist the computation of @p Values out of the loops around @p BB.
+  ///
+  /// The run-time check is evaluated each time the SCoP is entered. If the
+  /// SCoP is nested in loops that are not part of it and the values the check
+  /// depends on do not change in these loops, we compute them only once in
+  /// the preheader of the outermost such loop.
+  ///
+  /// @return The outermost loop the values were hoisted out of, or nullptr.
+  Loop *hoistOutOfLoops(ArrayRef<Value *> Values, BasicBlock *BB) {
+    Loop *OutermostLoop = nullptr;
+
+    if (!PollyHoistRTC)
+      return nullptr;
+
+    for (Loop *L = LI->getLoopFor(BB); L; L = L->getParentLoop()) {
+      if (!L->getLoopPreheader())
+        break;
+
+      bool Changed = false;
+      for (Value *V : Values)
+        if (!L->makeLoopInvariant(V, Changed))
+          return OutermostLoop;
+
+      OutermostLoop = L;
+    }
+
+    return OutermostLoop;
+  }
+
+  /// @brief Build the run-time alias check for an alias group of many arrays.
+  ///
+  /// @param SplitBB The block in which the SCoP is entered conditionally.
+  /// @param Ranges  The access ranges of the arrays in the alias group.
+  ///
+  /// @return A value evaluating to true iff no conflicting ranges overlap.
+  Value *buildSortedAliasCheck(PollyIRBuilder &Builder,
+                               IslExprBuilder &ExprBuilder, BasicBlock *SplitBB,
+                               const IslAstInfo::AliasGroupRangesTy &Ranges) {
+    Type *IntPtrTy = DL->getIntPtrType(SplitBB->getContext());
+    SmallVector<Value *, 8> Min, Max, Bounds;
+    SmallVector<bool, 8> ReadOnly;
+
+    Builder.SetInsertPoint(SplitBB->getTerminator());
+    for (const IslAstInfo::AccessRange &Range : Ranges) {
+      Value *MinV = ExprBuilder.create(isl_ast_expr_copy(Range.Min));
+      Value *MaxV = ExprBuilder.create(isl_ast_expr_copy(Range.Max));
+      Min.push_back(Builder.CreatePtrToInt(MinV, IntPtrTy));
+      Max.push_back(Builder.CreatePtrToInt(MaxV, IntPtrTy));
+      ReadOnly.push_back(Range.ReadOnly);
+    }
+
+    Bounds.append(Min.begin(), Min.end());
+    Bounds.append(Max.begin(), Max.end());
+    if (Loop *L = hoistOutOfLoops(Bounds, SplitBB))
+      Builder.SetInsertPoint(L->getLoopPreheader()->getTerminator());
+
+    return createSortedNoOverlapCheck(Builder, Min, Max, ReadOnly);
+  }
+
   /// @brief Build the runtime condition.
   ///
   /// Build the condition that evaluates at run-time to true iff all
@@ -65,10 +132,20 @@ public:
   ///
   /// @return A value evaluating to true/false if execution is save/unsafe.
   Value *buildRTC(PollyIRBuilder &Builder, IslExprBuilder &ExprBuilder) {
-    Builder.SetInsertPoint(Builder.GetInsertBlock()->getTerminator());
+    BasicBlock *SplitBB = Builder.GetInsertBlock();
+    Builder.SetInsertPoint(SplitBB->getTerminator());
     Value *RTC = ExprBuilder.create(AI->getRunCondition());
     if (!RTC->getType()->isIntegerTy(1))
       RTC = Builder.CreateIsNotNull(RTC);
+
+    for (const auto &Ranges : AI->getSortedAliasGroups()) {
+      Value *NoOverlap =
+          buildSortedAliasCheck(Builder, ExprBuilder, SplitBB, Ranges);
+      Builder.SetInsertPoint(SplitBB->getTerminator());
+      RTC = Builder.CreateAnd(RTC, NoOverlap);
+    }
+
+    hoistOutOfLoops(RTC, SplitBB);
     return RTC;
   }
 
@@ -129,7 +206,19 @@ public:
     SplitBlock->getTerminator()->setOperand(0, RTC);
     Builder.SetInsertPoint(StartBlock->begin());
 
-    NodeBuilder.create(AstRoot);
+    VariantProfiler Variants(Builder, S);
+    if (VariantProfiler::isEnabled(S))
+      NodeBuilder.addParameter(isl_id_copy(S.VariantSelector),
+                               Variants.start());
+
+    const std::vector<unsigned> &NestLevels = AI->getNestLevels();
+    if (NestLevels.empty())
+      NodeBuilder.create(AstRoot);
+    else
+      NodeBuilder.createConcurrentNests(AstRoot, NestLevels);
+
+    if (VariantProfiler::isEnabled(S))
+      Variants.stop(NodeBuilder.getExprBuilder());
 
     NodeBuilder.finalizeSCoP(S);
 
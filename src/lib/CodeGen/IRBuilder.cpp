@@ -47,6 +47,45 @@ static MDNode *getID(LLVMContext &Ctx, Metadata *arg0 = nullptr,
   return ID;
 }
 
+/// @brief Get a loop hint metadata node '!{!"Name", i32 Value}'.
+static MDNode *getHint(LLVMContext &Ctx, StringRef Name, Constant *Value) {
+  Metadata *Args[] = {MDString::get(Ctx, Name),
+                      ConstantAsMetadata::get(Value)};
+  return MDNode::get(Ctx, Args);
+}
+
+/// @brief Get the self referencing LoopID for a loop with the hints @p Hints.
+static MDNode *getLoopID(LLVMContext &Ctx, const LoopHints *Hints) {
+  if (!Hints)
+    return getID(Ctx);
+
+  Type *Int1Ty = Type::getInt1Ty(Ctx);
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  SmallVector<Metadata *, 5> Args;
+  auto TempNode = MDNode::getTemporary(Ctx, None);
+  Args.push_back(TempNode.get());
+
+  if (Hints->VectorizeWidth > 1)
+    Args.push_back(getHint(Ctx, "llvm.loop.vectorize.enable",
+                           ConstantInt::get(Int1Ty, 1)));
+  if (Hints->VectorizeWidth)
+    Args.push_back(getHint(Ctx, "llvm.loop.vectorize.width",
+                           ConstantInt::get(Int32Ty, Hints->VectorizeWidth)));
+  if (Hints->InterleaveCount)
+    Args.push_back(getHint(Ctx, "llvm.loop.interleave.count",
+                           ConstantInt::get(Int32Ty, Hints->InterleaveCount)));
+  if (Hints->UnrollCount == 1) {
+    Metadata *Disable = MDString::get(Ctx, "llvm.loop.unroll.disable");
+    Args.push_back(MDNode::get(Ctx, Disable));
+  } else if (Hints->UnrollCount)
+    Args.push_back(getHint(Ctx, "llvm.loop.unroll.count",
+                           ConstantInt::get(Int32Ty, Hints->UnrollCount)));
+
+  MDNode *ID = MDNode::get(Ctx, Args);
+  ID->replaceOperandWith(0, ID);
+  return ID;
+}
+
 ScopAnnotator::ScopAnnotator() : SE(nullptr), AliasScopeDomain(nullptr) {}
 
 void ScopAnnotator::buildAliasScopes(Scop &S) {
@@ -84,24 +123,36 @@ void ScopAnnotator::buildAliasScopes(Scop &S) {
   }
 }
 
-void ScopAnnotator::pushLoop(Loop *L, bool IsParallel) {
+void ScopAnnotator::pushLoop(Loop *L, bool IsParallel,
+                             const LoopHints *Hints) {
 
   ActiveLoops.push_back(L);
-  if (!IsParallel)
+  if (!IsParallel && !Hints) {
+    LoopIDs.push_back(nullptr);
     return;
+  }
 
-  BasicBlock *Header = L->getHeader();
-  MDNode *Id = getID(Header->getContext());
+  LLVMContext &Ctx = L->getHeader()->getContext();
+  MDNode *Id = getLoopID(Ctx, Hints);
   assert(Id->getOperand(0) == Id && "Expected Id to be a self-reference");
-  assert(Id->getNumOperands() == 1 && "Unexpected extra operands in Id");
-  MDNode *Ids = ParallelLoops.empty()
-                    ? Id
-                    : MDNode::concatenate(ParallelLoops.back(), Id);
+  LoopIDs.push_back(Id);
+  if (!IsParallel)
+    return;
+
+  // The hints of a LoopID must not end up in the list of parallel loops.
+  MDNode *Ids = Id;
+  if (Id->getNumOperands() != 1) {
+    Metadata *Args = {Id};
+    Ids = MDNode::get(Ctx, Args);
+  }
+  if (!ParallelLoops.empty())
+    Ids = MDNode::concatenate(ParallelLoops.back(), Ids);
   ParallelLoops.push_back(Ids);
 }
 
 void ScopAnnotator::popLoop(bool IsParallel) {
   ActiveLoops.pop_back();
+  LoopIDs.pop_back();
   if (!IsParallel)
     return;
 
@@ -111,13 +162,10 @@ void ScopAnnotator::popLoop(bool IsParallel) {
 
 void ScopAnnotator::annotateLoopLatch(BranchInst *B, Loop *L,
                                       bool IsParallel) const {
-  if (!IsParallel)
-    return;
-
-  assert(!ParallelLoops.empty() && "Expected a parallel loop to annotate");
-  MDNode *Ids = ParallelLoops.back();
-  MDNode *Id = cast<MDNode>(Ids->getOperand(Ids->getNumOperands() - 1));
-  B->setMetadata("llvm.loop", Id);
+  assert(!LoopIDs.empty() && "Expected a loop to annotate");
+  assert((!IsParallel || LoopIDs.back()) && "Expected a parallel LoopID");
+  if (MDNode *Id = LoopIDs.back())
+    B->setMetadata("llvm.loop", Id);
 }
 
 void ScopAnnotator::annotate(Instruction *Inst) {
@@ -21,6 +21,8 @@
 
 #include "polly/CodeGen/CodeGeneration.h"
 #include "polly/CodeGen/IslAst.h"
+#include "polly/CodeGen/IslAstCache.h"
+#include "polly/CodeGen/LoopGenerators.h"
 #include "polly/DependenceInfo.h"
 #include "polly/LinkAllPasses.h"
 #include "polly/Options.h"
@@ -34,6 +36,8 @@
 #include "isl/map.h"
 #include "isl/set.h"
 #include "isl/union_map.h"
+#include "isl/union_set.h"
+#include <algorithm>
 
 #define DEBUG_TYPE "polly-ast"
 
@@ -63,6 +67,30 @@ static cl::opt<bool> DetectParallel("polly-ast-detect-parallel",
                                     cl::init(false), cl::ZeroOrMore,
                                     cl::cat(PollyCategory));
 
+static cl::opt<unsigned> RunTimeChecksSortThreshold(
+    "polly-rtc-sort-threshold",
+    cl::desc("Check alias groups with more arrays than this by sorting their "
+             "access ranges at run time"),
+    cl::Hidden, cl::ZeroOrMore, cl::init(8), cl::cat(PollyCategory));
+
+static cl::opt<unsigned> AutoCollapse(
+    "polly-parallel-auto-collapse",
+    cl::desc("Collapse up to this many nested parallel loops into one if the "
+             "outermost loop has fewer iterations than threads"),
+    cl::Hidden, cl::init(0), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<bool> ConcurrentNests(
+    "polly-parallel-nests",
+    cl::desc("Run independent loop nests at the top of a SCoP concurrently "
+             "(the program must be linked with the parallel runtime)"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<unsigned> MaxTaskDependences(
+    "polly-tasks-max-dependences",
+    cl::desc("The maximal number of dependences between the tasks of a loop "
+             "run as tasks, otherwise the loop is generated as usual"),
+    cl::Hidden, cl::init(8), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<bool> NoEarlyExit(
     "polly-no-early-exit",
     cl::desc("Do not exit early if no benefit of the Polly version was found."),
@@ -83,11 +111,26 @@ public:
   /// @brief Get the run-time conditions for the Scop.
   __isl_give isl_ast_expr *getRunCondition();
 
+  /// @brief Get the alias groups that are checked by sorting at run time.
+  const SmallVectorImpl<IslAstInfo::AliasGroupRangesTy> &
+  getSortedAliasGroups() const {
+    return SortedAliasGroups;
+  }
+
+  /// @brief Get the levels of the loop nests at the top of the AST.
+  const std::vector<unsigned> &getNestLevels() const { return NestLevels; }
+
 private:
   Scop *S;
   isl_ast_node *Root;
   isl_ast_expr *RunCondition;
 
+  /// @brief Access ranges of the alias groups too large for pairwise checks.
+  SmallVector<IslAstInfo::AliasGroupRangesTy, 4> SortedAliasGroups;
+
+  /// @brief The levels of the nests run concurrently, see getNestLevels().
+  std::vector<unsigned> NestLevels;
+
   void buildRunCondition(__isl_keep isl_ast_build *Build);
 };
 } // End namespace polly.
@@ -100,22 +143,65 @@ static void freeIslAstUserPayload(void *Ptr) {
 IslAstInfo::IslAstUserPayload::~IslAstUserPayload() {
   isl_ast_build_free(Build);
   isl_pw_aff_free(MinimalDependenceDistance);
+  for (isl_ast_expr *Expr : TaskTile)
+    isl_ast_expr_free(Expr);
+  for (IslAstInfo::TaskDependence &Dep : TaskDependences) {
+    isl_ast_expr_free(Dep.Condition);
+    for (isl_ast_expr *Expr : Dep.Tile)
+      isl_ast_expr_free(Expr);
+  }
 }
 
 /// @brief Temporary information used when building the ast.
 struct AstBuildUserInfo {
   /// @brief Construct and initialize the helper struct for AST creation.
   AstBuildUserInfo()
-      : Deps(nullptr), InParallelFor(false), LastForNodeId(nullptr) {}
+      : Deps(nullptr), TestAllLoops(false), InParallelFor(false), Depth(0),
+        CollapseDepth(0), LastForNodeId(nullptr), Replay(nullptr),
+        NextResult(0), ReplayFailed(false), Record(nullptr) {}
 
   /// @brief The dependence information used for the parallelism check.
   const Dependences *Deps;
 
+  /// @brief Flag to indicate that all loops are checked for parallelism, not
+  ///        only the loops of @p ParallelLabels.
+  bool TestAllLoops;
+
   /// @brief Flag to indicate that we are inside a parallel for node.
   bool InParallelFor;
 
+  /// @brief The number of for nodes around the current for node, plus one.
+  unsigned Depth;
+
+  /// @brief The depth up to which the loops inside the current parallel for
+  ///        node are checked for collapsing.
+  unsigned CollapseDepth;
+
   /// @brief The last iterator id created for the current SCoP.
   isl_id *LastForNodeId;
+
+  /// @brief Cached results to use instead of the parallelism checks.
+  const IslAstCacheEntry *Replay;
+
+  /// @brief The next result in @p Replay.
+  unsigned NextResult;
+
+  /// @brief Flag to indicate that @p Replay does not match this AST.
+  bool ReplayFailed;
+
+  /// @brief The accesses of the SCoP by their name in @p Replay.
+  std::map<std::string, MemoryAccess *> Accesses;
+
+  /// @brief Entry in which to record the results of the parallelism checks.
+  IslAstCacheEntry *Record;
+
+  /// @brief The statement instances and the hints of the labels with loop
+  ///        hints, the most deeply nested labels first.
+  std::vector<std::pair<isl_union_set *, const LoopHints *>> Hints;
+
+  /// @brief The statement instances of the labels whose outermost parallel
+  ///        loops are run in parallel in any case, e.g., wavefronts.
+  std::vector<isl_union_set *> ParallelLabels;
 };
 
 /// @brief Print a string @p str in a single line using @p Printer.
@@ -168,6 +254,8 @@ static isl_printer *cbPrintFor(__isl_take isl_printer *Printer,
   const std::string DepDisPragmaStr = "#pragma minimal dependence distance: ";
   const std::string SimdPragmaStr = "#pragma simd";
   const std::string OmpPragmaStr = "#pragma omp parallel for";
+  const std::string OmpSinglePragmaStr = "#pragma omp parallel single";
+  const std::string OmpTaskPragmaStr = "#pragma omp task per iteration";
 
   if (DD)
     Printer = printLine(Printer, DepDisPragmaStr, DD);
@@ -175,11 +263,16 @@ static isl_printer *cbPrintFor(__isl_take isl_printer *Printer,
   if (IslAstInfo::isInnermostParallel(Node))
     Printer = printLine(Printer, SimdPragmaStr + BrokenReductionsStr);
 
-  if (IslAstInfo::isExecutedInParallel(Node))
+  if (IslAstInfo::isTaskRegion(Node))
+    Printer = printLine(Printer, OmpSinglePragmaStr);
+  else if (IslAstInfo::isExecutedInParallel(Node))
     Printer = printLine(Printer, OmpPragmaStr);
   else if (IslAstInfo::isOutermostParallel(Node))
     Printer = printLine(Printer, KnownParallelStr + BrokenReductionsStr);
 
+  if (IslAstInfo::isTaskLoop(Node))
+    Printer = printLine(Printer, OmpTaskPragmaStr);
+
   isl_pw_aff_free(DD);
   return isl_ast_node_for_print(Node, Printer, Options);
 }
@@ -229,12 +322,114 @@ static bool astScheduleDimIsParallel(__isl_keep isl_ast_build *Build,
   return true;
 }
 
+/// @brief Take the result of the next parallelism check from the cache.
+static bool replayScheduleDimIsParallel(__isl_keep isl_ast_build *Build,
+                                        AstBuildUserInfo *BuildInfo,
+                                        IslAstUserPayload *NodeInfo) {
+  const auto &Results = BuildInfo->Replay->Results;
+  if (BuildInfo->NextResult >= Results.size()) {
+    BuildInfo->ReplayFailed = true;
+    return false;
+  }
+
+  const auto &Result = Results[BuildInfo->NextResult++];
+  NodeInfo->IsReductionParallel = Result.IsReductionParallel;
+  if (!Result.MinimalDependenceDistance.empty())
+    NodeInfo->MinimalDependenceDistance =
+        isl_pw_aff_read_from_str(isl_ast_build_get_ctx(Build),
+                                 Result.MinimalDependenceDistance.c_str());
+  for (const std::string &Name : Result.BrokenReductions) {
+    auto It = BuildInfo->Accesses.find(Name);
+    if (It == BuildInfo->Accesses.end())
+      BuildInfo->ReplayFailed = true;
+    else
+      NodeInfo->BrokenReductions.insert(It->second);
+  }
+
+  return Result.IsParallel;
+}
+
+/// @brief Check if the current scheduling dimension is parallel, using or
+///        filling the AST cache if requested.
+static bool checkScheduleDimIsParallel(__isl_keep isl_ast_build *Build,
+                                       AstBuildUserInfo *BuildInfo,
+                                       IslAstUserPayload *NodeInfo) {
+  if (BuildInfo->Replay)
+    return replayScheduleDimIsParallel(Build, BuildInfo, NodeInfo);
+
+  bool IsParallel = astScheduleDimIsParallel(Build, BuildInfo->Deps, NodeInfo);
+  if (!BuildInfo->Record)
+    return IsParallel;
+
+  IslAstCacheEntry::ParallelismResult Result;
+  Result.IsParallel = IsParallel;
+  Result.IsReductionParallel = NodeInfo->IsReductionParallel;
+  if (NodeInfo->MinimalDependenceDistance)
+    Result.MinimalDependenceDistance =
+        stringFromIslObj(NodeInfo->MinimalDependenceDistance);
+  for (MemoryAccess *MA : NodeInfo->BrokenReductions)
+    Result.BrokenReductions.push_back(IslAstCache::getAccessName(MA));
+  std::sort(Result.BrokenReductions.begin(), Result.BrokenReductions.end());
+  BuildInfo->Record->Results.push_back(Result);
+
+  return IsParallel;
+}
+
+/// @brief Does the loop built at @p Build only execute instances of one of
+///        the labels in @p BuildInfo->ParallelLabels?
+static bool isParallelLabelLoop(__isl_keep isl_ast_build *Build,
+                                AstBuildUserInfo *BuildInfo) {
+  if (BuildInfo->ParallelLabels.empty())
+    return false;
+
+  bool InLabel = false;
+  isl_union_set *Instances =
+      isl_union_map_domain(isl_ast_build_get_schedule(Build));
+  for (isl_union_set *Label : BuildInfo->ParallelLabels)
+    if (isl_union_set_is_subset(Instances, Label) == isl_bool_true) {
+      InLabel = true;
+      break;
+    }
+  isl_union_set_free(Instances);
+
+  return InLabel;
+}
+
+/// @brief Set how many loops are collapsed into the outermost parallel loop
+///        built at @p Build.
+///
+/// The count given for the most deeply nested label whose instances the loop
+/// executes is used, otherwise the loops are collapsed automatically if the
+/// loop has fewer iterations than threads.
+static void setCollapseCount(__isl_keep isl_ast_build *Build,
+                             AstBuildUserInfo *BuildInfo,
+                             IslAstUserPayload *Payload) {
+  isl_union_set *Instances =
+      isl_union_map_domain(isl_ast_build_get_schedule(Build));
+  for (const auto &Label : BuildInfo->Hints)
+    if (Label.second->CollapseCount &&
+        isl_union_set_is_subset(Instances, Label.first) == isl_bool_true) {
+      Payload->CollapseCount = Label.second->CollapseCount;
+      break;
+    }
+  isl_union_set_free(Instances);
+
+  if (!Payload->CollapseCount && AutoCollapse > 1) {
+    Payload->CollapseCount = AutoCollapse;
+    Payload->CollapseIfFewIterations = true;
+  }
+}
+
 // This method is executed before the construction of a for node. It creates
 // an isl_id that is used to annotate the subsequently generated ast for nodes.
 //
 // In this function we also run the following analyses:
 //
-// - Detection of openmp parallel loops
+// - Detection of openmp parallel loops, either of all loops or only of the
+//   loops of wavefronts and first-touch initializations
+//
+// - Detection of the parallel loops nested in an outermost parallel loop that
+//   can be collapsed with it
 //
 static __isl_give isl_id *astBuildBeforeFor(__isl_keep isl_ast_build *Build,
                                             void *User) {
@@ -243,15 +438,53 @@ static __isl_give isl_id *astBuildBeforeFor(__isl_keep isl_ast_build *Build,
   isl_id *Id = isl_id_alloc(isl_ast_build_get_ctx(Build), "", Payload);
   Id = isl_id_set_free_user(Id, freeIslAstUserPayload);
   BuildInfo->LastForNodeId = Id;
+  BuildInfo->Depth++;
 
   // Test for parallelism only if we are not already inside a parallel loop
-  if (!BuildInfo->InParallelFor)
-    BuildInfo->InParallelFor = Payload->IsOutermostParallel =
-        astScheduleDimIsParallel(Build, BuildInfo->Deps, Payload);
+  if (BuildInfo->Deps && !BuildInfo->InParallelFor) {
+    bool IsForced = isParallelLabelLoop(Build, BuildInfo);
+    if (BuildInfo->TestAllLoops || IsForced) {
+      BuildInfo->InParallelFor = Payload->IsOutermostParallel =
+          checkScheduleDimIsParallel(Build, BuildInfo, Payload);
+      Payload->IsForcedParallel = IsForced && Payload->IsOutermostParallel;
+    }
+    if (Payload->IsOutermostParallel) {
+      setCollapseCount(Build, BuildInfo, Payload);
+      BuildInfo->CollapseDepth = BuildInfo->Depth;
+      if (Payload->CollapseCount > 1)
+        BuildInfo->CollapseDepth += Payload->CollapseCount - 1;
+    }
+  } else if (BuildInfo->InParallelFor &&
+             BuildInfo->Depth <= BuildInfo->CollapseDepth) {
+    Payload->IsCollapsible =
+        checkScheduleDimIsParallel(Build, BuildInfo, Payload) &&
+        !Payload->IsReductionParallel;
+  }
 
   return Id;
 }
 
+/// @brief Get the hints for the innermost loop built at @p Build, i.e., the
+///        hints of the most deeply nested label that contains all instances
+///        executed by the loop.
+static const LoopHints *getLoopHints(__isl_keep isl_ast_build *Build,
+                                     AstBuildUserInfo *BuildInfo) {
+  if (BuildInfo->Hints.empty())
+    return nullptr;
+
+  const LoopHints *Hints = nullptr;
+  isl_union_set *Instances =
+      isl_union_map_domain(isl_ast_build_get_schedule(Build));
+  for (const auto &Label : BuildInfo->Hints)
+    if (isl_union_set_is_subset(Instances, Label.first) == isl_bool_true) {
+      Hints = Label.second;
+      break;
+    }
+  isl_union_set_free(Instances);
+
+  return Hints;
+}
+
 // This method is executed after the construction of a for node.
 //
 // It performs the following actions:
@@ -259,6 +492,8 @@ static __isl_give isl_id *astBuildBeforeFor(__isl_keep isl_ast_build *Build,
 // - Reset the 'InParallelFor' flag, as soon as we leave a for node,
 //   that is marked as openmp parallel.
 //
+// - Attach the loop hints of the scripts to innermost loops.
+//
 static __isl_give isl_ast_node *
 astBuildAfterFor(__isl_take isl_ast_node *Node, __isl_keep isl_ast_build *Build,
                  void *User) {
@@ -276,14 +511,24 @@ astBuildAfterFor(__isl_take isl_ast_node *Node, __isl_keep isl_ast_build *Build,
   // tested for parallelism. Test them here to ensure we check all innermost
   // loops for parallelism.
   if (Payload->IsInnermost && BuildInfo->InParallelFor) {
-    if (Payload->IsOutermostParallel)
+    if (Payload->IsOutermostParallel || Payload->IsCollapsible)
       Payload->IsInnermostParallel = true;
+    else if (BuildInfo->Depth <= BuildInfo->CollapseDepth)
+      // Already checked for collapsing, only reduction parallel loops are
+      // parallel but not collapsible.
+      Payload->IsInnermostParallel = Payload->IsReductionParallel;
     else
       Payload->IsInnermostParallel =
-          astScheduleDimIsParallel(Build, BuildInfo->Deps, Payload);
+          checkScheduleDimIsParallel(Build, BuildInfo, Payload);
   }
-  if (Payload->IsOutermostParallel)
+  if (Payload->IsOutermostParallel) {
     BuildInfo->InParallelFor = false;
+    BuildInfo->CollapseDepth = 0;
+  }
+  BuildInfo->Depth--;
+
+  if (Payload->IsInnermost)
+    Payload->Hints = getLoopHints(Build, BuildInfo);
 
   isl_id_free(Id);
   return Node;
@@ -303,6 +548,28 @@ static __isl_give isl_ast_node *AtEachDomain(__isl_take isl_ast_node *Node,
   return isl_ast_node_set_annotation(Node, Id);
 }
 
+/// @brief Create the address expression of the access described by @p PMA.
+static __isl_give isl_ast_expr *
+buildAddressExpr(__isl_keep isl_ast_build *Build,
+                 __isl_keep isl_pw_multi_aff *PMA) {
+  return isl_ast_expr_address_of(isl_ast_build_access_from_pw_multi_aff(
+      Build, isl_pw_multi_aff_copy(PMA)));
+}
+
+/// @brief Create an AST expression that ensures @p It0 and @p It1 don't alias.
+static __isl_give isl_ast_expr *
+buildCondition(__isl_keep isl_ast_build *Build,
+               const Scop::MinMaxAccessTy *It0,
+               const Scop::MinMaxAccessTy *It1) {
+  isl_ast_expr *NonAliasGroup, *MinExpr, *MaxExpr;
+  MinExpr = buildAddressExpr(Build, It0->first);
+  MaxExpr = buildAddressExpr(Build, It1->second);
+  NonAliasGroup = isl_ast_expr_le(MaxExpr, MinExpr);
+  MinExpr = buildAddressExpr(Build, It1->first);
+  MaxExpr = buildAddressExpr(Build, It0->second);
+  return isl_ast_expr_or(NonAliasGroup, isl_ast_expr_le(MaxExpr, MinExpr));
+}
+
 void IslAst::buildRunCondition(__isl_keep isl_ast_build *Build) {
   // The conditions that need to be checked at run-time for this scop are
   // available as an isl_set in the AssumedContext from which we can directly
@@ -310,30 +577,37 @@ void IslAst::buildRunCondition(__isl_keep isl_ast_build *Build) {
   RunCondition = isl_ast_build_expr_from_set(Build, S->getAssumedContext());
 
   // Create the alias checks from the minimal/maximal accesses in each alias
-  // group. This operation is by construction quadratic in the number of
-  // elements in each alias group.
-  isl_ast_expr *NonAliasGroup, *MinExpr, *MaxExpr;
-  for (const Scop::MinMaxVectorTy *MinMaxAccesses : S->getAliasGroups()) {
-    auto AccEnd = MinMaxAccesses->end();
-    for (auto AccIt0 = MinMaxAccesses->begin(); AccIt0 != AccEnd; ++AccIt0) {
-      for (auto AccIt1 = AccIt0 + 1; AccIt1 != AccEnd; ++AccIt1) {
-        MinExpr =
-            isl_ast_expr_address_of(isl_ast_build_access_from_pw_multi_aff(
-                Build, isl_pw_multi_aff_copy(AccIt0->first)));
-        MaxExpr =
-            isl_ast_expr_address_of(isl_ast_build_access_from_pw_multi_aff(
-                Build, isl_pw_multi_aff_copy(AccIt1->second)));
-        NonAliasGroup = isl_ast_expr_le(MaxExpr, MinExpr);
-        MinExpr =
-            isl_ast_expr_address_of(isl_ast_build_access_from_pw_multi_aff(
-                Build, isl_pw_multi_aff_copy(AccIt1->first)));
-        MaxExpr =
-            isl_ast_expr_address_of(isl_ast_build_access_from_pw_multi_aff(
-                Build, isl_pw_multi_aff_copy(AccIt0->second)));
-        NonAliasGroup =
-            isl_ast_expr_or(NonAliasGroup, isl_ast_expr_le(MaxExpr, MinExpr));
-        RunCondition = isl_ast_expr_and(RunCondition, NonAliasGroup);
-      }
+  // group. Comparing each pair of accesses is quadratic in the number of
+  // arrays in a group, hence large groups are only described by their access
+  // ranges here and checked during code generation by sorting the ranges at
+  // run time and comparing neighbours. Accesses to read only arrays never
+  // need to be compared with each other.
+  for (const Scop::MinMaxVectorPairTy &MinMaxAccessPair : S->getAliasGroups()) {
+    auto *MinMaxReadWrite = MinMaxAccessPair.first;
+    auto *MinMaxReadOnly = MinMaxAccessPair.second;
+
+    if (MinMaxReadWrite->size() + MinMaxReadOnly->size() >
+        RunTimeChecksSortThreshold) {
+      IslAstInfo::AliasGroupRangesTy Ranges;
+      for (const Scop::MinMaxAccessTy &MMA : *MinMaxReadWrite)
+        Ranges.push_back({buildAddressExpr(Build, MMA.first),
+                          buildAddressExpr(Build, MMA.second), false});
+      for (const Scop::MinMaxAccessTy &MMA : *MinMaxReadOnly)
+        Ranges.push_back({buildAddressExpr(Build, MMA.first),
+                          buildAddressExpr(Build, MMA.second), true});
+      SortedAliasGroups.push_back(std::move(Ranges));
+      continue;
+    }
+
+    auto RWAccEnd = MinMaxReadWrite->end();
+    for (auto RWAccIt0 = MinMaxReadWrite->begin(); RWAccIt0 != RWAccEnd;
+         ++RWAccIt0) {
+      for (auto RWAccIt1 = RWAccIt0 + 1; RWAccIt1 != RWAccEnd; ++RWAccIt1)
+        RunCondition = isl_ast_expr_and(
+            RunCondition, buildCondition(Build, RWAccIt0, RWAccIt1));
+      for (const Scop::MinMaxAccessTy &ROAccIt : *MinMaxReadOnly)
+        RunCondition = isl_ast_expr_and(
+            RunCondition, buildCondition(Build, RWAccIt0, &ROAccIt));
     }
   }
 }
@@ -360,6 +634,309 @@ static bool benefitsFromPolly(Scop *Scop, bool PerformParallelTest) {
   return true;
 }
 
+/// @brief Get the labels that initialize arrays for other loop nests.
+///
+/// A label initializes an array if its statements write the array and the
+/// statements of another label, which has no statement in common with it,
+/// read the array. With first-touch placement, the pages of such an array are
+/// allocated on the NUMA node of the thread that first writes them, so the
+/// initializing nest is run in parallel with the same static distribution of
+/// the iterations as the nests reading the array.
+static std::set<std::string> getInitLabels(Scop &S) {
+  std::map<std::string, std::set<ScopStmt *>> Stmts;
+  std::map<std::string, std::set<const Value *>> Writes, Reads;
+
+  for (const auto &Label : S.LoopDomainMap) {
+    isl_union_set *Instances = S.getLoopInstances(Label.first);
+    if (!Instances)
+      continue;
+
+    for (ScopStmt &Stmt : S) {
+      isl_set *Domain =
+          isl_union_set_extract_set(Instances, Stmt.getDomainSpace());
+      bool InLabel = isl_set_is_empty(Domain) == isl_bool_false;
+      isl_set_free(Domain);
+      if (!InLabel)
+        continue;
+
+      Stmts[Label.first].insert(&Stmt);
+      for (MemoryAccess *MA : Stmt)
+        if (MA->isWrite())
+          Writes[Label.first].insert(MA->getBaseAddr());
+        else
+          Reads[Label.first].insert(MA->getBaseAddr());
+    }
+    isl_union_set_free(Instances);
+  }
+
+  std::set<std::string> InitLabels;
+  for (const auto &Init : Writes)
+    for (const auto &Use : Reads) {
+      const std::set<ScopStmt *> &InitStmts = Stmts[Init.first];
+      const std::set<ScopStmt *> &UseStmts = Stmts[Use.first];
+      bool Disjoint = std::none_of(
+          InitStmts.begin(), InitStmts.end(),
+          [&](ScopStmt *Stmt) { return UseStmts.count(Stmt); });
+      bool ReadsArray = std::any_of(
+          Init.second.begin(), Init.second.end(),
+          [&](const Value *Array) { return Use.second.count(Array); });
+      if (Disjoint && ReadsArray) {
+        InitLabels.insert(Init.first);
+        break;
+      }
+    }
+
+  return InitLabels;
+}
+
+/// @brief Compute the levels of the loop nests at the top of the AST @p Root.
+///
+/// The nests are the children of the block at the root of the AST. A nest
+/// that depends on earlier nests gets the level after the highest level of
+/// these nests, the other nests get level zero. The nests of a level do not
+/// depend on each other and can run concurrently once the nests of the lower
+/// levels are done.
+///
+/// @return The level of each nest, or nothing if no two nests have the same
+///         level.
+static std::vector<unsigned> computeNestLevels(__isl_keep isl_ast_node *Root,
+                                               Scop &S, const Dependences &D) {
+  std::vector<unsigned> Levels;
+  if (!Root || isl_ast_node_get_type(Root) != isl_ast_node_block ||
+      !D.hasValidDependences())
+    return Levels;
+
+  isl_union_map *Deps =
+      D.getDependences(Dependences::TYPE_RAW | Dependences::TYPE_WAR |
+                       Dependences::TYPE_WAW | Dependences::TYPE_RED);
+  isl_ast_node_list *List = isl_ast_node_block_get_children(Root);
+  std::vector<isl_union_set *> Instances;
+  bool Concurrent = false;
+
+  for (int i = 0; i < isl_ast_node_list_n_ast_node(List); ++i) {
+    isl_ast_node *Nest = isl_ast_node_list_get_ast_node(List, i);
+    Instances.push_back(IslAstInfo::addInstances(
+        Nest, isl_union_set_empty(S.getParamSpace())));
+    isl_ast_node_free(Nest);
+
+    unsigned Level = 0;
+    for (int j = i - 1; j >= 0; --j) {
+      if (Levels[j] < Level)
+        continue;
+      isl_union_map *Between = isl_union_map_intersect_range(
+          isl_union_map_intersect_domain(isl_union_map_copy(Deps),
+                                         isl_union_set_copy(Instances[j])),
+          isl_union_set_copy(Instances[i]));
+      if (isl_union_map_is_empty(Between) == isl_bool_false)
+        Level = Levels[j] + 1;
+      isl_union_map_free(Between);
+    }
+
+    Concurrent |= std::count(Levels.begin(), Levels.end(), Level) > 0;
+    Levels.push_back(Level);
+  }
+
+  for (isl_union_set *Nest : Instances)
+    isl_union_set_free(Nest);
+  isl_ast_node_list_free(List);
+  isl_union_map_free(Deps);
+
+  if (!Concurrent)
+    Levels.clear();
+  return Levels;
+}
+
+/// @brief Collect the last earlier task of each basic map of the dependences
+///        between tasks.
+static isl_stat addLastTask(__isl_take isl_basic_map *Earlier, void *User) {
+  auto *LastTasks = (std::vector<isl_pw_multi_aff *> *)User;
+  LastTasks->push_back(
+      isl_map_lexmax_pw_multi_aff(isl_map_from_basic_map(Earlier)));
+  return isl_stat_ok;
+}
+
+/// @brief The data needed to create the task dependences of a task loop.
+struct TaskDependenceInfo {
+  isl_ast_build *Build;
+  const std::vector<unsigned> *Dims;
+  std::vector<IslAstInfo::TaskDependence> *Deps;
+};
+
+/// @brief Create the task dependence of one piece of a last earlier task.
+static isl_stat addTaskDependence(__isl_take isl_set *Set,
+                                  __isl_take isl_multi_aff *Task, void *User) {
+  auto *Info = (TaskDependenceInfo *)User;
+  IslAstInfo::TaskDependence Dep;
+
+  Dep.Condition = isl_ast_build_expr_from_set(Info->Build, isl_set_copy(Set));
+  for (unsigned Dim : *Info->Dims)
+    Dep.Tile.push_back(isl_ast_build_expr_from_pw_aff(
+        Info->Build,
+        isl_pw_aff_alloc(isl_set_copy(Set), isl_multi_aff_get_aff(Task, Dim))));
+  Info->Deps->push_back(Dep);
+
+  isl_set_free(Set);
+  isl_multi_aff_free(Task);
+  return isl_stat_ok;
+}
+
+/// @brief Run the iterations of the perfectly nested loops @p Loops as tasks.
+///
+/// The dependences between the statement instances executed by the loops
+/// are mapped to dependences between their iterations, the tasks. Each task
+/// only waits for the last earlier task of each basic map of these
+/// dependences, which is only enough if the dependences on all other earlier
+/// tasks follow: every earlier task a task depends on must be either a last
+/// earlier task or an earlier task of one of them. Otherwise, or if there are
+/// too many dependences, the loops are generated as usual.
+///
+/// @return True if the iterations of the loops are run as tasks.
+static bool annotateTaskLoops(const std::vector<isl_ast_node *> &Loops,
+                              Scop &S, const Dependences &D) {
+  isl_ast_build *Build = IslAstInfo::getBuild(Loops.back());
+
+  // The position of the schedule dimension of each loop.
+  std::vector<unsigned> Dims;
+  for (isl_ast_node *Loop : Loops) {
+    isl_space *Space =
+        isl_ast_build_get_schedule_space(IslAstInfo::getBuild(Loop));
+    Dims.push_back(isl_space_dim(Space, isl_dim_set) - 1);
+    isl_space_free(Space);
+  }
+
+  isl_union_map *Schedule = isl_ast_build_get_schedule(Build);
+  isl_union_set *Instances = isl_union_map_domain(isl_union_map_copy(Schedule));
+  isl_union_map *Deps =
+      D.getDependences(Dependences::TYPE_RAW | Dependences::TYPE_WAR |
+                       Dependences::TYPE_WAW | Dependences::TYPE_RED);
+  Deps = isl_union_map_intersect_domain(Deps, isl_union_set_copy(Instances));
+  Deps = isl_union_map_intersect_range(Deps, Instances);
+  Deps = isl_union_map_apply_domain(Deps, isl_union_map_copy(Schedule));
+  Deps = isl_union_map_apply_range(Deps, Schedule);
+
+  std::vector<isl_pw_multi_aff *> LastTasks;
+  bool Covered = true;
+  if (isl_union_map_is_empty(Deps) == isl_bool_false) {
+    // The loops around the loops are not run as tasks, only the dependences
+    // within an iteration of them and between different tasks matter.
+    isl_map *Earlier = isl_map_reverse(isl_map_from_union_map(Deps));
+    for (unsigned i = 0; i < Dims.front(); ++i)
+      Earlier = isl_map_equate(Earlier, isl_dim_in, i, isl_dim_out, i);
+    Earlier = isl_map_subtract(
+        Earlier, isl_map_identity(isl_map_get_space(Earlier)));
+    Earlier = isl_map_intersect_params(Earlier, S.getContext());
+    Earlier = isl_map_coalesce(Earlier);
+
+    if ((unsigned)isl_map_n_basic_map(Earlier) > MaxTaskDependences) {
+      DEBUG(dbgs() << "Too many task dependences: "
+                   << stringFromIslObj(Earlier) << "\n");
+      Covered = false;
+    } else {
+      isl_map_foreach_basic_map(Earlier, &addLastTask, &LastTasks);
+      isl_map *Last = isl_map_empty(isl_map_get_space(Earlier));
+      for (isl_pw_multi_aff *Task : LastTasks)
+        Last = isl_map_union(
+            Last, isl_map_from_pw_multi_aff(isl_pw_multi_aff_copy(Task)));
+      isl_map *Implied = isl_map_union(
+          isl_map_copy(Last),
+          isl_map_apply_range(isl_map_copy(Last), isl_map_copy(Earlier)));
+      Covered = isl_map_is_subset(Earlier, Implied) == isl_bool_true;
+      DEBUG(if (!Covered) dbgs() << "Task dependences not implied by "
+                                 << stringFromIslObj(Last) << "\n");
+      isl_map_free(Implied);
+      isl_map_free(Last);
+    }
+    isl_map_free(Earlier);
+  } else {
+    isl_union_map_free(Deps);
+  }
+
+  IslAstUserPayload *Payload = IslAstInfo::getNodePayload(Loops.back());
+  if (Covered) {
+    TaskDependenceInfo Info = {Build, &Dims, &Payload->TaskDependences};
+    for (isl_pw_multi_aff *Task : LastTasks)
+      isl_pw_multi_aff_foreach_piece(Task, &addTaskDependence, &Info);
+    for (isl_ast_node *Loop : Loops)
+      Payload->TaskTile.push_back(isl_ast_node_for_get_iterator(Loop));
+    Payload->IsTaskLoop = true;
+    IslAstInfo::getNodePayload(Loops.front())->IsTaskRegion = true;
+  }
+
+  for (isl_pw_multi_aff *Task : LastTasks)
+    isl_pw_multi_aff_free(Task);
+  return Covered;
+}
+
+/// @brief Run the loops of the labels with a task depth in the AST @p Node
+///        as tasks.
+///
+/// The outermost loop that only executes instances of a label with a task
+/// depth and the loops perfectly nested in it, up to the task depth, are run
+/// as tasks. The task depth of the most deeply nested label is used.
+static void annotateTasks(
+    __isl_keep isl_ast_node *Node, Scop &S, const Dependences &D,
+    const std::vector<std::pair<isl_union_set *, const LoopHints *>> &Hints) {
+  switch (isl_ast_node_get_type(Node)) {
+  case isl_ast_node_for: {
+    unsigned Depth = 0;
+    isl_union_set *Instances =
+        isl_union_map_domain(IslAstInfo::getSchedule(Node));
+    for (const auto &Label : Hints)
+      if (Label.second->TaskDepth &&
+          isl_union_set_is_subset(Instances, Label.first) == isl_bool_true) {
+        Depth = Label.second->TaskDepth;
+        break;
+      }
+    isl_union_set_free(Instances);
+
+    if (Depth) {
+      std::vector<isl_ast_node *> Loops = {isl_ast_node_copy(Node)};
+      while (Loops.size() < Depth) {
+        isl_ast_node *Body = isl_ast_node_for_get_body(Loops.back());
+        if (isl_ast_node_get_type(Body) != isl_ast_node_for) {
+          isl_ast_node_free(Body);
+          break;
+        }
+        Loops.push_back(Body);
+      }
+      bool Tasks = annotateTaskLoops(Loops, S, D);
+      for (isl_ast_node *Loop : Loops)
+        isl_ast_node_free(Loop);
+      if (Tasks)
+        return;
+    }
+
+    isl_ast_node *Body = isl_ast_node_for_get_body(Node);
+    annotateTasks(Body, S, D, Hints);
+    isl_ast_node_free(Body);
+    break;
+  }
+  case isl_ast_node_if: {
+    isl_ast_node *Then = isl_ast_node_if_get_then(Node);
+    annotateTasks(Then, S, D, Hints);
+    isl_ast_node_free(Then);
+    if (isl_ast_node_if_has_else(Node)) {
+      isl_ast_node *Else = isl_ast_node_if_get_else(Node);
+      annotateTasks(Else, S, D, Hints);
+      isl_ast_node_free(Else);
+    }
+    break;
+  }
+  case isl_ast_node_block: {
+    isl_ast_node_list *List = isl_ast_node_block_get_children(Node);
+    for (int i = 0; i < isl_ast_node_list_n_ast_node(List); ++i) {
+      isl_ast_node *Child = isl_ast_node_list_get_ast_node(List, i);
+      annotateTasks(Child, S, D, Hints);
+      isl_ast_node_free(Child);
+    }
+    isl_ast_node_list_free(List);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
 IslAst::IslAst(Scop *Scop, const Dependences &D)
     : S(Scop), Root(nullptr), RunCondition(nullptr) {
 
@@ -387,24 +964,140 @@ IslAst::IslAst(Scop *Scop, const Dependences &D)
 
   if (PerformParallelTest) {
     BuildInfo.Deps = &D;
+    BuildInfo.TestAllLoops = true;
     BuildInfo.InParallelFor = 0;
+  }
 
+  // The loops of wavefronts are checked for parallelism in any case, and so
+  // are the loops initializing arrays for the parallel loops with first-touch
+  // placement.
+  std::set<std::string> ParallelLabels = S->WavefrontLabels;
+  if (PollyParallel && PollyFirstTouch)
+    for (const std::string &Label : getInitLabels(*S))
+      ParallelLabels.insert(Label);
+  for (const auto &Label : ParallelLabels)
+    if (isl_union_set *Instances = S->getLoopInstances(Label))
+      BuildInfo.ParallelLabels.push_back(Instances);
+  if (!BuildInfo.ParallelLabels.empty())
+    BuildInfo.Deps = &D;
+
+  // Loops are annotated with the hints of the most deeply nested label whose
+  // instances they execute.
+  std::vector<std::pair<unsigned, std::string>> Labels;
+  for (const auto &Label : S->LoopHintMap)
+    Labels.push_back(std::make_pair(S->LoopDimMap[Label.first], Label.first));
+  std::sort(Labels.rbegin(), Labels.rend());
+  for (const auto &Label : Labels)
+    if (isl_union_set *Instances = S->getLoopInstances(Label.second))
+      BuildInfo.Hints.push_back(
+          std::make_pair(Instances, &S->LoopHintMap[Label.second]));
+
+  if (BuildInfo.Deps || !BuildInfo.Hints.empty()) {
     Build = isl_ast_build_set_before_each_for(Build, &astBuildBeforeFor,
                                               &BuildInfo);
     Build =
         isl_ast_build_set_after_each_for(Build, &astBuildAfterFor, &BuildInfo);
   }
 
+  // Reuse the results of the parallelism checks of an earlier generation of
+  // the same AST. isl generates the for nodes in a deterministic order, such
+  // that the results can simply be replayed in the order they were recorded.
+  std::string CacheKey;
+  IslAstCacheEntry CacheEntry;
+  if (PerformParallelTest && IslAstCache::isEnabled()) {
+    isl_set *Context = UseContext ? S->getContext()
+                                  : isl_set_universe(S->getParamSpace());
+    CacheKey = IslAstCache::getKey(*S, D, Schedule, Context, true);
+    isl_set_free(Context);
+
+    // The loops checked for collapsing depend on the collapse counts.
+    CacheKey += "collapse: " + std::to_string(AutoCollapse);
+    for (const auto &Label : S->LoopHintMap)
+      if (Label.second.CollapseCount)
+        CacheKey += " " + Label.first + "=" +
+                    std::to_string(Label.second.CollapseCount);
+    CacheKey += "\n";
+
+    // So do the loops additionally checked for parallelism, i.e., those of
+    // wavefronts and of the first-touch initializations.
+    CacheKey += "wavefronts:";
+    for (const auto &Label : S->WavefrontLabels)
+      CacheKey += " " + Label;
+    CacheKey += "\nfirst-touch: " + std::to_string(PollyFirstTouch) + "\n";
+    CacheKey += "parallel labels:";
+    for (const auto &Label : ParallelLabels)
+      CacheKey += " " + Label;
+    CacheKey += "\n";
+
+    if (IslAstCache::get().lookup(CacheKey, CacheEntry)) {
+      DEBUG(dbgs() << "Using cached AST annotations\n");
+      BuildInfo.Replay = &CacheEntry;
+      for (ScopStmt &Stmt : *S)
+        for (MemoryAccess *MA : Stmt)
+          BuildInfo.Accesses[IslAstCache::getAccessName(MA)] = MA;
+    } else {
+      BuildInfo.Record = &CacheEntry;
+    }
+  }
+
   buildRunCondition(Build);
 
-  Root = isl_ast_build_ast_from_schedule(Build, Schedule);
+  Root = isl_ast_build_ast_from_schedule(Build, isl_union_map_copy(Schedule));
+
+  if (BuildInfo.Replay && (BuildInfo.ReplayFailed ||
+                           BuildInfo.NextResult != CacheEntry.Results.size())) {
+    DEBUG(dbgs() << "Cached AST annotations do not match, regenerating\n");
+    isl_ast_node_free(Root);
+    CacheEntry.Results.clear();
+    BuildInfo.Replay = nullptr;
+    BuildInfo.Record = &CacheEntry;
+    BuildInfo.InParallelFor = false;
+    BuildInfo.Depth = BuildInfo.CollapseDepth = 0;
+    BuildInfo.LastForNodeId = nullptr;
+    Root = isl_ast_build_ast_from_schedule(Build, isl_union_map_copy(Schedule));
+  }
+
+  if (BuildInfo.Record && Root)
+    IslAstCache::get().insert(CacheKey, CacheEntry);
+
+  // The loops of labels with a task depth are run as tasks of the GNU OpenMP
+  // runtime.
+  bool HasTasks = std::any_of(
+      BuildInfo.Hints.begin(), BuildInfo.Hints.end(),
+      [](const std::pair<isl_union_set *, const LoopHints *> &Label) {
+        return Label.second->TaskDepth > 0;
+      });
+  if (Root && HasTasks && D.hasValidDependences() &&
+      ParallelLoopGenerator::supportsTasks())
+    annotateTasks(Root, *S, D, BuildInfo.Hints);
+
+  if (ConcurrentNests) {
+    NestLevels = computeNestLevels(Root, *S, D);
+    DEBUG({
+      dbgs() << "Nest levels:";
+      for (unsigned Level : NestLevels)
+        dbgs() << " " << Level;
+      dbgs() << "\n";
+    });
+  }
 
+  for (const auto &Label : BuildInfo.Hints)
+    isl_union_set_free(Label.first);
+  for (isl_union_set *Label : BuildInfo.ParallelLabels)
+    isl_union_set_free(Label);
+  isl_union_map_free(Schedule);
   isl_ast_build_free(Build);
 }
 
 IslAst::~IslAst() {
   isl_ast_node_free(Root);
   isl_ast_expr_free(RunCondition);
+
+  for (IslAstInfo::AliasGroupRangesTy &Ranges : SortedAliasGroups)
+    for (IslAstInfo::AccessRange &Range : Ranges) {
+      isl_ast_expr_free(Range.Min);
+      isl_ast_expr_free(Range.Max);
+    }
 }
 
 __isl_give isl_ast_node *IslAst::getAst() { return isl_ast_node_copy(Root); }
@@ -437,6 +1130,13 @@ __isl_give isl_ast_node *IslAstInfo::getAst() const { return Ast->getAst(); }
 __isl_give isl_ast_expr *IslAstInfo::getRunCondition() const {
   return Ast->getRunCondition();
 }
+const SmallVectorImpl<IslAstInfo::AliasGroupRangesTy> &
+IslAstInfo::getSortedAliasGroups() const {
+  return Ast->getSortedAliasGroups();
+}
+const std::vector<unsigned> &IslAstInfo::getNestLevels() const {
+  return Ast->getNestLevels();
+}
 
 IslAstUserPayload *IslAstInfo::getNodePayload(__isl_keep isl_ast_node *Node) {
   isl_id *Id = isl_ast_node_get_annotation(Node);
@@ -474,6 +1174,13 @@ bool IslAstInfo::isReductionParallel(__isl_keep isl_ast_node *Node) {
 
 bool IslAstInfo::isExecutedInParallel(__isl_keep isl_ast_node *Node) {
 
+  // The scripts ask for the outermost parallel loops of wavefronts to be run
+  // in parallel, whatever their position. With first-touch placement, so are
+  // the loops initializing the arrays of the parallel loops.
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  if (Payload && Payload->IsForcedParallel)
+    return !Payload->IsReductionParallel;
+
   if (!PollyParallel)
     return false;
 
@@ -515,6 +1222,86 @@ isl_ast_build *IslAstInfo::getBuild(__isl_keep isl_ast_node *Node) {
   return Payload ? Payload->Build : nullptr;
 }
 
+__isl_give isl_union_set *
+IslAstInfo::addInstances(__isl_keep isl_ast_node *Node,
+                         __isl_take isl_union_set *Instances) {
+  switch (isl_ast_node_get_type(Node)) {
+  case isl_ast_node_for: {
+    isl_ast_node *Body = isl_ast_node_for_get_body(Node);
+    Instances = addInstances(Body, Instances);
+    isl_ast_node_free(Body);
+    break;
+  }
+  case isl_ast_node_if: {
+    isl_ast_node *Then = isl_ast_node_if_get_then(Node);
+    Instances = addInstances(Then, Instances);
+    isl_ast_node_free(Then);
+    if (isl_ast_node_if_has_else(Node)) {
+      isl_ast_node *Else = isl_ast_node_if_get_else(Node);
+      Instances = addInstances(Else, Instances);
+      isl_ast_node_free(Else);
+    }
+    break;
+  }
+  case isl_ast_node_block: {
+    isl_ast_node_list *List = isl_ast_node_block_get_children(Node);
+    for (int i = 0; i < isl_ast_node_list_n_ast_node(List); ++i) {
+      isl_ast_node *Child = isl_ast_node_list_get_ast_node(List, i);
+      Instances = addInstances(Child, Instances);
+      isl_ast_node_free(Child);
+    }
+    isl_ast_node_list_free(List);
+    break;
+  }
+  case isl_ast_node_mark: {
+    isl_ast_node *Child = isl_ast_node_mark_get_node(Node);
+    Instances = addInstances(Child, Instances);
+    isl_ast_node_free(Child);
+    break;
+  }
+  case isl_ast_node_user: {
+    isl_ast_build *Build = getBuild(Node);
+    if (Build)
+      Instances = isl_union_set_union(
+          Instances, isl_union_map_domain(isl_ast_build_get_schedule(Build)));
+    break;
+  }
+  case isl_ast_node_error:
+    break;
+  }
+  return Instances;
+}
+
+bool IslAstInfo::isCollapsible(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload && Payload->IsCollapsible;
+}
+
+unsigned IslAstInfo::getCollapseCount(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload ? Payload->CollapseCount : 0;
+}
+
+bool IslAstInfo::collapseIfFewIterations(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload && Payload->CollapseIfFewIterations;
+}
+
+bool IslAstInfo::isTaskRegion(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload && Payload->IsTaskRegion;
+}
+
+bool IslAstInfo::isTaskLoop(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload && Payload->IsTaskLoop;
+}
+
+const LoopHints *IslAstInfo::getLoopHints(__isl_keep isl_ast_node *Node) {
+  IslAstUserPayload *Payload = getNodePayload(Node);
+  return Payload ? Payload->Hints : nullptr;
+}
+
 void IslAstInfo::printScop(raw_ostream &OS, Scop &S) const {
   isl_ast_print_options *Options;
   isl_ast_node *RootNode = getAst();
@@ -550,7 +1337,17 @@ void IslAstInfo::printScop(raw_ostream &OS, Scop &S) const {
     dbgs() << S.getContextStr() << "\n";
     dbgs() << stringFromIslObj(Schedule);
   });
-  OS << "\nif (" << RtCStr << ")\n\n";
+  OS << "\nif (" << RtCStr;
+  for (const AliasGroupRangesTy &Ranges : getSortedAliasGroups()) {
+    OS << " && sorted_no_overlap(";
+    for (const AccessRange &Range : Ranges) {
+      OS << (&Range == Ranges.begin() ? "" : ", ")
+         << (Range.ReadOnly ? "ro[" : "rw[") << stringFromIslObj(Range.Min)
+         << ", " << stringFromIslObj(Range.Max) << ")";
+    }
+    OS << ")";
+  }
+  OS << ")\n\n";
   OS << AstStr << "\n";
   OS << "else\n";
   OS << "    {  /* original code */ }\n\n";
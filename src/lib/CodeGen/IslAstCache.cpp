@@ -0,0 +1,261 @@
+//===- IslAstCache.cpp - Cache of isl AST annotations ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A cache of the parallelism annotations computed while generating an isl AST.
+//
+// Entries are keyed by a canonical description of all inputs of the AST
+// generation. isl prints the maps of a union map in an order that depends on
+// the addresses of the identifiers involved, so every union map is printed
+// one map at a time and the resulting strings are sorted. Entries are kept in
+// memory for the duration of the compilation and, if -polly-ast-cache-dir is
+// given, also stored as one JSON file per entry, named after the MD5 digest of
+// the key.
+//
+//===----------------------------------------------------------------------===//
+
+#include "polly/CodeGen/IslAstCache.h"
+#include "polly/DependenceInfo.h"
+#include "polly/Options.h"
+#include "polly/ScopInfo.h"
+#include "polly/Support/GICHelper.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "isl/ast.h"
+#include "isl/ast_build.h"
+#include "isl/map.h"
+#include "isl/set.h"
+#include "isl/union_map.h"
+#include "json/reader.h"
+#include "json/writer.h"
+#include <algorithm>
+
+#define DEBUG_TYPE "polly-ast"
+
+using namespace llvm;
+using namespace polly;
+
+static cl::opt<bool> AstCache(
+    "polly-ast-cache",
+    cl::desc("Reuse the parallelism annotations of ASTs generated before for "
+             "the same schedule, context and dependences"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<std::string> AstCacheDir(
+    "polly-ast-cache-dir",
+    cl::desc("Directory in which the AST parallelism annotations are kept "
+             "across compilations (implies -polly-ast-cache)"),
+    cl::value_desc("directory"), cl::Hidden, cl::init(""), cl::ZeroOrMore,
+    cl::cat(PollyCategory));
+
+static ManagedStatic<IslAstCache> Cache;
+
+IslAstCache &IslAstCache::get() { return *Cache; }
+
+bool IslAstCache::isEnabled() { return AstCache || !AstCacheDir.empty(); }
+
+static isl_stat collectMapString(__isl_take isl_map *Map, void *User) {
+  auto *Strings = (std::vector<std::string> *)User;
+  Strings->push_back(stringFromIslObj(Map));
+  isl_map_free(Map);
+  return isl_stat_ok;
+}
+
+/// @brief Print @p UMap in a canonical way and append it to @p Key.
+static void appendUnionMap(std::string &Key, const char *Name,
+                           __isl_take isl_union_map *UMap) {
+  std::vector<std::string> Strings;
+
+  isl_union_map_foreach_map(UMap, &collectMapString, &Strings);
+  isl_union_map_free(UMap);
+  std::sort(Strings.begin(), Strings.end());
+
+  Key += Name;
+  Key += ":\n";
+  for (const std::string &Str : Strings)
+    Key += Str + "\n";
+}
+
+std::string IslAstCache::getAccessName(const MemoryAccess *MA) {
+  ScopStmt *Stmt = MA->getStatement();
+  unsigned Idx = 0;
+
+  for (MemoryAccess *Acc : *Stmt) {
+    if (Acc == MA)
+      break;
+    Idx++;
+  }
+  return std::string(Stmt->getBaseName()) + "#" + std::to_string(Idx);
+}
+
+std::string IslAstCache::getKey(Scop &S, const Dependences &D,
+                                __isl_keep isl_union_map *Schedule,
+                                __isl_keep isl_set *Context,
+                                bool PerformParallelTest) {
+  isl_ctx *Ctx = S.getIslCtx();
+  std::string Key;
+
+  appendUnionMap(Key, "schedule", isl_union_map_copy(Schedule));
+  Key += "context:\n" + stringFromIslObj(Context) + "\n";
+
+  int Options[] = {isl_options_get_ast_build_atomic_upper_bound(Ctx),
+                   isl_options_get_ast_build_prefer_pdiv(Ctx),
+                   isl_options_get_ast_build_exploit_nested_bounds(Ctx),
+                   isl_options_get_ast_build_group_coscheduled(Ctx),
+                   isl_options_get_ast_build_separation_bounds(Ctx),
+                   isl_options_get_ast_build_scale_strides(Ctx),
+                   isl_options_get_ast_build_allow_else(Ctx),
+                   isl_options_get_ast_build_allow_or(Ctx),
+                   PerformParallelTest};
+  Key += "options:";
+  for (int Option : Options)
+    Key += " " + std::to_string(Option);
+  Key += "\n";
+
+  if (!PerformParallelTest)
+    return Key;
+
+  if (!D.hasValidDependences())
+    return Key + "dependences: invalid\n";
+
+  appendUnionMap(Key, "dependences",
+                 D.getDependences(Dependences::TYPE_RAW |
+                                  Dependences::TYPE_WAW |
+                                  Dependences::TYPE_WAR));
+  appendUnionMap(Key, "reduction dependences",
+                 D.getDependences(Dependences::TYPE_TC_RED));
+
+  std::vector<std::string> Reductions;
+  for (const auto &MaRedPair : D.getReductionDependences())
+    if (MaRedPair.second)
+      Reductions.push_back(getAccessName(MaRedPair.first) + " " +
+                           stringFromIslObj(MaRedPair.second));
+  std::sort(Reductions.begin(), Reductions.end());
+  Key += "reductions:\n";
+  for (const std::string &Str : Reductions)
+    Key += Str + "\n";
+
+  return Key;
+}
+
+/// @brief Return the MD5 digest of @p Key as a hexadecimal string.
+static std::string getDigest(const std::string &Key) {
+  MD5 Hash;
+  MD5::MD5Result Result;
+  SmallString<32> Digest;
+
+  Hash.update(Key);
+  Hash.final(Result);
+  MD5::stringifyResult(Result, Digest);
+  return Digest.str();
+}
+
+static std::string getFileName(const std::string &Digest) {
+  return AstCacheDir + "/" + Digest + ".json";
+}
+
+/// @brief Read the entry for @p Key from @p FileName.
+static bool readEntry(const std::string &FileName, const std::string &Key,
+                      IslAstCacheEntry &Entry) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(FileName);
+  if (Buffer.getError())
+    return false;
+
+  Json::Reader Reader;
+  Json::Value Root;
+  if (!Reader.parse(Buffer.get()->getBufferStart(),
+                    Buffer.get()->getBufferEnd(), Root) ||
+      !Root.isObject() || Root["key"].asString() != Key ||
+      !Root["results"].isArray())
+    return false;
+
+  Json::Value Results = Root["results"];
+  Entry.Results.clear();
+  for (unsigned i = 0; i < Results.size(); i++) {
+    Json::Value Value = Results[i];
+    Json::Value Broken = Value["broken_reductions"];
+    IslAstCacheEntry::ParallelismResult Result;
+
+    Result.IsParallel = Value["parallel"].asBool();
+    Result.IsReductionParallel = Value["reduction_parallel"].asBool();
+    Result.MinimalDependenceDistance = Value["min_distance"].asString();
+    for (unsigned j = 0; j < Broken.size(); j++)
+      Result.BrokenReductions.push_back(Broken[j].asString());
+    Entry.Results.push_back(Result);
+  }
+  return true;
+}
+
+/// @brief Write the entry for @p Key to @p FileName.
+///
+/// The entry is first written to a temporary file, which is then renamed, such
+/// that concurrent compilations never see a partially written entry.
+static void writeEntry(const std::string &FileName, const std::string &Key,
+                       const IslAstCacheEntry &Entry) {
+  Json::Value Root;
+  Root["key"] = Key;
+  Root["results"] = Json::Value(Json::arrayValue);
+  for (const IslAstCacheEntry::ParallelismResult &Result : Entry.Results) {
+    Json::Value Value;
+    Value["parallel"] = Result.IsParallel;
+    Value["reduction_parallel"] = Result.IsReductionParallel;
+    Value["min_distance"] = Result.MinimalDependenceDistance;
+    Value["broken_reductions"] = Json::Value(Json::arrayValue);
+    for (const std::string &Name : Result.BrokenReductions)
+      Value["broken_reductions"].append(Name);
+    Root["results"].append(Value);
+  }
+
+  int FD;
+  SmallString<128> TmpName;
+  if (sys::fs::createUniqueFile(FileName + ".%%%%%%.tmp", FD, TmpName)) {
+    DEBUG(dbgs() << "Could not create AST cache file in '" << AstCacheDir
+                 << "'\n");
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(FD, true);
+    Json::FastWriter Writer;
+    OS << Writer.write(Root);
+  }
+
+  if (sys::fs::rename(TmpName, FileName))
+    sys::fs::remove(TmpName);
+}
+
+bool IslAstCache::lookup(const std::string &Key, IslAstCacheEntry &Entry) {
+  std::string Digest = getDigest(Key);
+
+  auto It = Entries.find(Digest);
+  if (It != Entries.end() && It->second.first == Key) {
+    Entry = It->second.second;
+    return true;
+  }
+
+  if (AstCacheDir.empty() || !readEntry(getFileName(Digest), Key, Entry))
+    return false;
+
+  Entries[Digest] = std::make_pair(Key, Entry);
+  return true;
+}
+
+void IslAstCache::insert(const std::string &Key,
+                         const IslAstCacheEntry &Entry) {
+  std::string Digest = getDigest(Key);
+
+  Entries[Digest] = std::make_pair(Key, Entry);
+  if (!AstCacheDir.empty())
+    writeEntry(getFileName(Digest), Key, Entry);
+}
@@ -22,6 +22,7 @@
 #include "polly/Config/config.h"
 #include "polly/DependenceInfo.h"
 #include "polly/LinkAllPasses.h"
+#include "polly/Options.h"
 #include "polly/ScopInfo.h"
 #include "polly/Support/GICHelper.h"
 #include "polly/Support/SCEVValidator.h"
@@ -41,6 +42,7 @@
 #include "isl/aff.h"
 #include "isl/ast.h"
 #include "isl/ast_build.h"
+#include "isl/ilp.h"
 #include "isl/list.h"
 #include "isl/map.h"
 #include "isl/set.h"
@@ -50,6 +52,18 @@
 using namespace polly;
 using namespace llvm;
 
+static cl::opt<bool> PollyVectorMaskedRemainder(
+    "polly-vector-masked-remainder",
+    cl::desc("Vectorize innermost loops with a bounded, but not constant "
+             "number of iterations using masked vector operations"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<bool> PollyVectorAlignmentCheck(
+    "polly-vector-alignment-check",
+    cl::desc("Version vector loops on a run-time check of the alignment of "
+             "the accessed arrays"),
+    cl::Hidden, cl::init(true), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 __isl_give isl_ast_expr *
 IslNodeBuilder::getUpperBound(__isl_keep isl_ast_node *For,
                               ICmpInst::Predicate &Predicate) {
@@ -102,7 +116,12 @@ IslNodeBuilder::getUpperBound(__isl_keep isl_ast_node *For,
   return UB;
 }
 
-unsigned IslNodeBuilder::getNumberOfIterations(__isl_keep isl_ast_node *For) {
+/// @brief Compute the extent of the loop @p For.
+///
+/// For each iteration of the loops surrounding @p For, compute the difference
+/// between the last and the first iteration of @p For. The result is a set
+/// in the schedule space where all but the last dimension are zero.
+static __isl_give isl_set *getLoopExtent(__isl_keep isl_ast_node *For) {
   isl_union_map *Schedule = IslAstInfo::getSchedule(For);
   isl_set *LoopDomain = isl_set_from_union_set(isl_union_map_range(Schedule));
   int Dim = isl_set_dim(LoopDomain, isl_dim_set);
@@ -128,7 +147,12 @@ unsigned IslNodeBuilder::getNumberOfIterations(__isl_keep isl_ast_node *For) {
   isl_map *LexMin = isl_map_lexmin(Map);
   isl_map *Sub = isl_map_sum(LexMax, isl_map_neg(LexMin));
 
-  isl_set *Elements = isl_map_range(Sub);
+  return isl_map_range(Sub);
+}
+
+unsigned IslNodeBuilder::getNumberOfIterations(__isl_keep isl_ast_node *For) {
+  isl_set *Elements = getLoopExtent(For);
+  int Dim = isl_set_dim(Elements, isl_dim_set);
 
   if (!isl_set_is_singleton(Elements)) {
     isl_set_free(Elements);
@@ -147,6 +171,24 @@ unsigned IslNodeBuilder::getNumberOfIterations(__isl_keep isl_ast_node *For) {
   return NumberIterations + 1;
 }
 
+int IslNodeBuilder::getMaxNumberOfIterations(__isl_keep isl_ast_node *For) {
+  isl_set *Elements = getLoopExtent(For);
+  int Dim = isl_set_dim(Elements, isl_dim_set);
+
+  isl_local_space *LS = isl_local_space_from_space(isl_set_get_space(Elements));
+  isl_aff *Extent = isl_aff_var_on_domain(LS, isl_dim_set, Dim - 1);
+  isl_val *V = isl_set_max_val(Elements, Extent);
+  isl_aff_free(Extent);
+  isl_set_free(Elements);
+
+  int NumberIterations = -1;
+  if (isl_val_is_int(V))
+    NumberIterations = isl_val_get_num_si(V) + 1;
+  isl_val_free(V);
+
+  return NumberIterations;
+}
+
 struct FindValuesUser {
   LoopInfo &LI;
   ScalarEvolution &SE;
@@ -255,7 +297,9 @@ void IslNodeBuilder::updateValues(
 void IslNodeBuilder::createUserVector(__isl_take isl_ast_node *User,
                                       std::vector<Value *> &IVS,
                                       __isl_take isl_id *IteratorID,
-                                      __isl_take isl_union_map *Schedule) {
+                                      __isl_take isl_union_map *Schedule,
+                                      ArrayRef<Value *> AlignedBases,
+                                      Value *Mask) {
   isl_ast_expr *Expr = isl_ast_node_user_get_expr(User);
   isl_ast_expr *StmtExpr = isl_ast_expr_get_op_arg(Expr, 0);
   isl_id *Id = isl_ast_expr_get_id(StmtExpr);
@@ -270,15 +314,122 @@ void IslNodeBuilder::createUserVector(__isl_take isl_ast_node *User,
   isl_map *S = isl_map_from_union_map(Schedule);
 
   createSubstitutionsVector(Expr, Stmt, VectorMap, VLTS, IVS, IteratorID);
-  VectorBlockGenerator::generate(BlockGen, *Stmt, VectorMap, VLTS, S);
+  VectorBlockGenerator::generate(BlockGen, *Stmt, VectorMap, VLTS, S,
+                                 AlignedBases, Mask);
 
   isl_map_free(S);
   isl_id_free(Id);
   isl_ast_node_free(User);
 }
 
+/// @brief Get the statements in the body of a vector loop.
+static void getVectorLoopStmts(__isl_keep isl_ast_node *Body,
+                               SmallVectorImpl<ScopStmt *> &Stmts) {
+  isl_ast_node_list *List;
+  if (isl_ast_node_get_type(Body) == isl_ast_node_block)
+    List = isl_ast_node_block_get_children(Body);
+  else
+    List = isl_ast_node_list_from_ast_node(isl_ast_node_copy(Body));
+
+  for (int i = 0; i < isl_ast_node_list_n_ast_node(List); ++i) {
+    isl_ast_node *User = isl_ast_node_list_get_ast_node(List, i);
+    isl_ast_expr *Expr = isl_ast_node_user_get_expr(User);
+    isl_ast_expr *StmtExpr = isl_ast_expr_get_op_arg(Expr, 0);
+    isl_id *Id = isl_ast_expr_get_id(StmtExpr);
+    Stmts.push_back((ScopStmt *)isl_id_get_user(Id));
+
+    isl_id_free(Id);
+    isl_ast_expr_free(StmtExpr);
+    isl_ast_expr_free(Expr);
+    isl_ast_node_free(User);
+  }
+
+  isl_ast_node_list_free(List);
+}
+
+/// @brief Restrict the schedule of a vector loop to the statement @p Stmt.
+static __isl_give isl_map *getStmtSchedule(ScopStmt *Stmt,
+                                           __isl_keep isl_union_map *Schedule) {
+  isl_union_set *Domain = isl_union_set_from_set(Stmt->getDomain());
+  return isl_map_from_union_map(
+      isl_union_map_intersect_domain(isl_union_map_copy(Schedule), Domain));
+}
+
+bool IslNodeBuilder::canCreateMaskedVector(__isl_keep isl_ast_node *For) {
+  // The mask is computed from the upper bound of the loop, which needs to be
+  // atomic.
+  isl_ast_expr *Cond = isl_ast_node_for_get_cond(For);
+  bool AtomicUB = isl_ast_expr_get_type(Cond) == isl_ast_expr_op &&
+                  (isl_ast_expr_get_op_type(Cond) == isl_ast_op_le ||
+                   isl_ast_expr_get_op_type(Cond) == isl_ast_op_lt);
+  isl_ast_expr_free(Cond);
+
+  if (!AtomicUB)
+    return false;
+
+  isl_ast_node *Body = isl_ast_node_for_get_body(For);
+  isl_ast_node_type Type = isl_ast_node_get_type(Body);
+  if (Type != isl_ast_node_user && Type != isl_ast_node_block) {
+    isl_ast_node_free(Body);
+    return false;
+  }
+
+  SmallVector<ScopStmt *, 4> Stmts;
+  getVectorLoopStmts(Body, Stmts);
+  isl_ast_node_free(Body);
+
+  isl_union_map *Schedule = IslAstInfo::getSchedule(For);
+  bool CanMask = true;
+  for (ScopStmt *Stmt : Stmts) {
+    isl_map *S = getStmtSchedule(Stmt, Schedule);
+    CanMask = VectorBlockGenerator::canGenerateMasked(*Stmt, S);
+    isl_map_free(S);
+
+    if (!CanMask)
+      break;
+  }
+  isl_union_map_free(Schedule);
+
+  return CanMask;
+}
+
+void IslNodeBuilder::createBranch(Value *Cond, BasicBlock *&ThenBB,
+                                  BasicBlock *&ElseBB, BasicBlock *&MergeBB,
+                                  const Twine &Name) {
+  Function *F = Builder.GetInsertBlock()->getParent();
+  LLVMContext &Context = F->getContext();
+
+  BasicBlock *CondBB =
+      SplitBlock(Builder.GetInsertBlock(), Builder.GetInsertPoint(), &DT, &LI);
+  CondBB->setName(Name + ".cond");
+  MergeBB = SplitBlock(CondBB, CondBB->begin(), &DT, &LI);
+  MergeBB->setName(Name + ".merge");
+  ThenBB = BasicBlock::Create(Context, Name + ".then", F);
+  ElseBB = BasicBlock::Create(Context, Name + ".else", F);
+
+  DT.addNewBlock(ThenBB, CondBB);
+  DT.addNewBlock(ElseBB, CondBB);
+  DT.changeImmediateDominator(MergeBB, CondBB);
+
+  Loop *L = LI.getLoopFor(CondBB);
+  if (L) {
+    L->addBasicBlockToLoop(ThenBB, LI);
+    L->addBasicBlockToLoop(ElseBB, LI);
+  }
+
+  CondBB->getTerminator()->eraseFromParent();
+
+  Builder.SetInsertPoint(CondBB);
+  Builder.CreateCondBr(Cond, ThenBB, ElseBB);
+  Builder.SetInsertPoint(ThenBB);
+  Builder.CreateBr(MergeBB);
+  Builder.SetInsertPoint(ElseBB);
+  Builder.CreateBr(MergeBB);
+  Builder.SetInsertPoint(ThenBB->begin());
+}
+
 void IslNodeBuilder::createForVector(__isl_take isl_ast_node *For,
-                                     int VectorWidth) {
+                                     int VectorWidth, bool Masked) {
   isl_ast_node *Body = isl_ast_node_for_get_body(For);
   isl_ast_expr *Init = isl_ast_node_for_get_init(For);
   isl_ast_expr *Inc = isl_ast_node_for_get_inc(For);
@@ -287,11 +438,20 @@ void IslNodeBuilder::createForVector(__isl_take isl_ast_node *For,
 
   Value *ValueLB = ExprBuilder.create(Init);
   Value *ValueInc = ExprBuilder.create(Inc);
+  Value *ValueUB = nullptr;
+  CmpInst::Predicate Predicate;
 
   Type *MaxType = ExprBuilder.getType(Iterator);
   MaxType = ExprBuilder.getWidestType(MaxType, ValueLB->getType());
   MaxType = ExprBuilder.getWidestType(MaxType, ValueInc->getType());
 
+  if (Masked) {
+    ValueUB = ExprBuilder.create(getUpperBound(For, Predicate));
+    MaxType = ExprBuilder.getWidestType(MaxType, ValueUB->getType());
+    if (MaxType != ValueUB->getType())
+      ValueUB = Builder.CreateSExt(ValueUB, MaxType);
+  }
+
   if (MaxType != ValueLB->getType())
     ValueLB = Builder.CreateSExt(ValueLB, MaxType);
   if (MaxType != ValueInc->getType())
@@ -303,22 +463,98 @@ void IslNodeBuilder::createForVector(__isl_take isl_ast_node *For,
   for (int i = 1; i < VectorWidth; i++)
     IVS[i] = Builder.CreateAdd(IVS[i - 1], ValueInc, "p_vector_iv");
 
+  // In a masked vector loop, lane i is only active if IVS[i] is within the
+  // loop bounds. As the loop may not be executed at all, we only execute the
+  // vector body if the first lane is active.
+  Value *Mask = nullptr;
+  BasicBlock *MaskedMergeBB = nullptr;
+  if (Masked) {
+    Type *MaskTy = VectorType::get(Builder.getInt1Ty(), VectorWidth);
+    Mask = UndefValue::get(MaskTy);
+    Value *FirstLane = nullptr;
+    for (int i = 0; i < VectorWidth; i++) {
+      Value *Lane =
+          Builder.CreateICmp(Predicate, IVS[i], ValueUB, "polly.vec.lane");
+      Mask = Builder.CreateInsertElement(Mask, Lane, Builder.getInt32(i),
+                                         "polly.vec.mask");
+      if (i == 0)
+        FirstLane = Lane;
+    }
+
+    BasicBlock *ThenBB, *ElseBB;
+    createBranch(FirstLane, ThenBB, ElseBB, MaskedMergeBB, "polly.vec.masked");
+  }
+
   isl_union_map *Schedule = IslAstInfo::getSchedule(For);
   assert(Schedule && "For statement annotation does not contain its schedule");
 
   IDToValue[IteratorID] = ValueLB;
 
+  // Collect the base addresses for which the vector accesses are aligned
+  // relative to the base address, but the alignment of the base address itself
+  // is unknown. If there are any, we generate two versions of the vector code
+  // and select the one that uses aligned accesses if a run-time check shows
+  // the base addresses are aligned.
+  MapVector<Value *, unsigned> AlignmentChecks;
+  if (PollyVectorAlignmentCheck) {
+    SmallVector<ScopStmt *, 4> Stmts;
+    getVectorLoopStmts(Body, Stmts);
+
+    for (ScopStmt *Stmt : Stmts) {
+      isl_map *S = getStmtSchedule(Stmt, Schedule);
+      VectorBlockGenerator::collectAlignmentCandidates(*Stmt, S, VectorWidth,
+                                                       AlignmentChecks);
+      isl_map_free(S);
+    }
+  }
+
+  if (AlignmentChecks.empty()) {
+    createForVectorBody(Body, IVS, IteratorID, Schedule, None, Mask);
+  } else {
+    SmallVector<Value *, 4> AlignedBases;
+    for (auto &Check : AlignmentChecks)
+      AlignedBases.push_back(Check.first);
+
+    BasicBlock *AlignedBB, *UnalignedBB, *MergeBB;
+    Value *IsAligned = createAlignmentCheck(AlignmentChecks);
+    createBranch(IsAligned, AlignedBB, UnalignedBB, MergeBB, "polly.vec.align");
+
+    createForVectorBody(isl_ast_node_copy(Body), IVS, IteratorID, Schedule,
+                        AlignedBases, Mask);
+    Builder.SetInsertPoint(UnalignedBB->begin());
+    createForVectorBody(Body, IVS, IteratorID, Schedule, None, Mask);
+    Builder.SetInsertPoint(MergeBB->begin());
+  }
+
+  if (MaskedMergeBB)
+    Builder.SetInsertPoint(MaskedMergeBB->begin());
+
+  IDToValue.erase(IDToValue.find(IteratorID));
+  isl_id_free(IteratorID);
+  isl_union_map_free(Schedule);
+
+  isl_ast_node_free(For);
+  isl_ast_expr_free(Iterator);
+}
+
+void IslNodeBuilder::createForVectorBody(__isl_take isl_ast_node *Body,
+                                         std::vector<Value *> &IVS,
+                                         __isl_keep isl_id *IteratorID,
+                                         __isl_keep isl_union_map *Schedule,
+                                         ArrayRef<Value *> AlignedBases,
+                                         Value *Mask) {
   switch (isl_ast_node_get_type(Body)) {
   case isl_ast_node_user:
     createUserVector(Body, IVS, isl_id_copy(IteratorID),
-                     isl_union_map_copy(Schedule));
+                     isl_union_map_copy(Schedule), AlignedBases, Mask);
     break;
   case isl_ast_node_block: {
     isl_ast_node_list *List = isl_ast_node_block_get_children(Body);
 
     for (int i = 0; i < isl_ast_node_list_n_ast_node(List); ++i)
       createUserVector(isl_ast_node_list_get_ast_node(List, i), IVS,
-                       isl_id_copy(IteratorID), isl_union_map_copy(Schedule));
+                       isl_id_copy(IteratorID), isl_union_map_copy(Schedule),
+                       AlignedBases, Mask);
 
     isl_ast_node_free(Body);
     isl_ast_node_list_free(List);
@@ -328,13 +564,29 @@ void IslNodeBuilder::createForVector(__isl_take isl_ast_node *For,
     isl_ast_node_dump(Body);
     llvm_unreachable("Unhandled isl_ast_node in vectorizer");
   }
+}
 
-  IDToValue.erase(IDToValue.find(IteratorID));
-  isl_id_free(IteratorID);
-  isl_union_map_free(Schedule);
+Value *IslNodeBuilder::createAlignmentCheck(
+    const MapVector<Value *, unsigned> &Bases) {
+  Value *Check = Builder.getTrue();
+
+  for (auto &Base : Bases) {
+    // Array base addresses may have been rewritten, e.g., when generating code
+    // in a parallel subfunction.
+    Value *Ptr = ValueMap.lookup(Base.first);
+    if (!Ptr)
+      Ptr = Base.first;
+
+    Type *IntPtrTy = DL.getIntPtrType(Ptr->getType());
+    Value *Addr = Builder.CreatePtrToInt(Ptr, IntPtrTy, "polly.vec.base");
+    Value *Offset = Builder.CreateAnd(
+        Addr, ConstantInt::get(IntPtrTy, Base.second - 1), "polly.vec.offset");
+    Value *IsAligned = Builder.CreateICmpEQ(
+        Offset, ConstantInt::get(IntPtrTy, 0), "polly.vec.is_aligned");
+    Check = Builder.CreateAnd(Check, IsAligned, "polly.vec.aligned_check");
+  }
 
-  isl_ast_node_free(For);
-  isl_ast_expr_free(Iterator);
+  return Check;
 }
 
 void IslNodeBuilder::createForSequential(__isl_take isl_ast_node *For) {
@@ -386,10 +638,14 @@ void IslNodeBuilder::createForSequential(__isl_take isl_ast_node *For) {
   bool UseGuardBB =
       !SE.isKnownPredicate(Predicate, SE.getSCEV(ValueLB), SE.getSCEV(ValueUB));
   IV = createLoop(ValueLB, ValueUB, ValueInc, Builder, P, LI, DT, ExitBlock,
-                  Predicate, &Annotator, Parallel, UseGuardBB);
+                  Predicate, &Annotator, Parallel, UseGuardBB,
+                  IslAstInfo::getLoopHints(For));
   IDToValue[IteratorID] = IV;
 
-  create(Body);
+  if (InTaskRegion && IslAstInfo::isTaskLoop(For))
+    createTask(For, Body);
+  else
+    create(Body);
 
   Annotator.popLoop(Parallel);
 
@@ -446,6 +702,78 @@ static void removeSubFuncFromDomTree(Function *F, DominatorTree &DT) {
     DT.eraseNode(BB);
 }
 
+/// @brief Does @p Expr use one of the iterators @p Iterators?
+static bool usesIterators(__isl_keep isl_ast_expr *Expr,
+                          const std::vector<isl_id *> &Iterators) {
+  switch (isl_ast_expr_get_type(Expr)) {
+  case isl_ast_expr_id: {
+    isl_id *Id = isl_ast_expr_get_id(Expr);
+    bool Uses = std::find(Iterators.begin(), Iterators.end(), Id) !=
+                Iterators.end();
+    isl_id_free(Id);
+    return Uses;
+  }
+  case isl_ast_expr_op:
+    for (int i = 0; i < isl_ast_expr_get_op_n_arg(Expr); ++i) {
+      isl_ast_expr *Arg = isl_ast_expr_get_op_arg(Expr, i);
+      bool Uses = usesIterators(Arg, Iterators);
+      isl_ast_expr_free(Arg);
+      if (Uses)
+        return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+/// @brief Get the loops nested in the parallel loop @p For that are collapsed
+///        with it, outermost first.
+///
+/// A loop is collapsed if it is the body of the loop around it, it is parallel
+/// and its bounds do not depend on the iterators of the loops around it that
+/// are collapsed. Innermost loops are not collapsed, such that they can still
+/// be vectorized.
+static std::vector<isl_ast_node *>
+getCollapsedLoops(__isl_keep isl_ast_node *For) {
+  std::vector<isl_ast_node *> Loops;
+  unsigned Count = IslAstInfo::getCollapseCount(For);
+  if (Count < 2)
+    return Loops;
+
+  std::vector<isl_id *> Iterators;
+  isl_ast_expr *Iterator = isl_ast_node_for_get_iterator(For);
+  Iterators.push_back(isl_ast_expr_get_id(Iterator));
+  isl_ast_expr_free(Iterator);
+
+  isl_ast_node *Body = isl_ast_node_for_get_body(For);
+  while (Loops.size() + 1 < Count &&
+         isl_ast_node_get_type(Body) == isl_ast_node_for &&
+         IslAstInfo::isCollapsible(Body) && !IslAstInfo::isInnermost(Body)) {
+    isl_ast_expr *Bounds[] = {isl_ast_node_for_get_init(Body),
+                              isl_ast_node_for_get_cond(Body),
+                              isl_ast_node_for_get_inc(Body)};
+    bool Rectangular = true;
+    for (isl_ast_expr *Bound : Bounds) {
+      Rectangular &= !usesIterators(Bound, Iterators);
+      isl_ast_expr_free(Bound);
+    }
+    if (!Rectangular)
+      break;
+
+    Loops.push_back(Body);
+    Iterator = isl_ast_node_for_get_iterator(Body);
+    Iterators.push_back(isl_ast_expr_get_id(Iterator));
+    isl_ast_expr_free(Iterator);
+    Body = isl_ast_node_for_get_body(Body);
+  }
+  isl_ast_node_free(Body);
+
+  for (isl_id *Id : Iterators)
+    isl_id_free(Id);
+  return Loops;
+}
+
 void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   isl_ast_node *Body;
   isl_ast_expr *Init, *Inc, *Iterator, *UB;
@@ -484,6 +812,21 @@ void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   if (MaxType != ValueInc->getType())
     ValueInc = Builder.CreateSExt(ValueInc, MaxType);
 
+  // The bounds of the collapsed loops do not depend on the iterators of the
+  // parallel loop, so they are computed before it.
+  std::vector<isl_ast_node *> Collapsed = getCollapsedLoops(For);
+  SmallVector<Value *, 4> LBs = {ValueLB}, UBs = {ValueUB}, Incs = {ValueInc};
+  for (isl_ast_node *Inner : Collapsed) {
+    CmpInst::Predicate InnerPredicate;
+    Value *InnerUB = ExprBuilder.create(getUpperBound(Inner, InnerPredicate));
+    if (InnerPredicate == CmpInst::ICMP_SLT)
+      InnerUB = Builder.CreateAdd(
+          InnerUB, Builder.CreateSExt(Builder.getTrue(), InnerUB->getType()));
+    LBs.push_back(ExprBuilder.create(isl_ast_node_for_get_init(Inner)));
+    UBs.push_back(InnerUB);
+    Incs.push_back(ExprBuilder.create(isl_ast_node_for_get_inc(Inner)));
+  }
+
   BasicBlock::iterator LoopBody;
 
   SetVector<Value *> SubtreeValues;
@@ -506,8 +849,15 @@ void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   ParallelLoopGenerator::ValueToValueMapTy NewValues;
   ParallelLoopGenerator ParallelLoopGen(Builder, P, LI, DT, DL);
 
-  IV = ParallelLoopGen.createParallelLoop(ValueLB, ValueUB, ValueInc,
-                                          SubtreeValues, NewValues, &LoopBody);
+  SmallVector<Value *, 4> InnerLBs, InnerUBs, InnerIncs;
+  if (Collapsed.empty())
+    IV = ParallelLoopGen.createParallelLoop(ValueLB, ValueUB, ValueInc,
+                                            SubtreeValues, NewValues,
+                                            &LoopBody);
+  else
+    IV = ParallelLoopGen.createCollapsedParallelLoop(
+        LBs, UBs, Incs, IslAstInfo::collapseIfFewIterations(For),
+        SubtreeValues, NewValues, &LoopBody, InnerLBs, InnerUBs, InnerIncs);
   BasicBlock::iterator AfterLoop = Builder.GetInsertPoint();
   Builder.SetInsertPoint(LoopBody);
 
@@ -518,8 +868,34 @@ void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   updateValues(NewValues);
   IDToValue[IteratorID] = IV;
 
+  // The collapsed loops execute a single iteration each if the loops are
+  // collapsed at run time, otherwise all their iterations.
+  std::vector<BasicBlock *> ExitBlocks;
+  for (unsigned i = 0; i < Collapsed.size(); i++) {
+    BasicBlock *ExitBlock;
+    Value *InnerIV = createLoop(InnerLBs[i], InnerUBs[i], InnerIncs[i],
+                                Builder, P, LI, DT, ExitBlock,
+                                CmpInst::ICMP_SLE);
+    isl_ast_expr *InnerIterator = isl_ast_node_for_get_iterator(Collapsed[i]);
+    isl_id *InnerID = isl_ast_expr_get_id(InnerIterator);
+    IDToValue[InnerID] = InnerIV;
+    isl_id_free(InnerID);
+    isl_ast_expr_free(InnerIterator);
+    ExitBlocks.push_back(ExitBlock);
+  }
+
+  if (!Collapsed.empty()) {
+    isl_ast_node_free(Body);
+    Body = isl_ast_node_for_get_body(Collapsed.back());
+  }
+
   create(Body);
 
+  for (auto It = ExitBlocks.rbegin(), End = ExitBlocks.rend(); It != End; ++It)
+    Builder.SetInsertPoint((*It)->begin());
+  for (isl_ast_node *Inner : Collapsed)
+    isl_ast_node_free(Inner);
+
   // Restore the original values.
   ValueMap = ValueMapCopy;
   IDToValue = IDToValueCopy;
@@ -535,7 +911,201 @@ void IslNodeBuilder::createForParallel(__isl_take isl_ast_node *For) {
   isl_id_free(IteratorID);
 }
 
+void IslNodeBuilder::createSections(const std::vector<isl_ast_node *> &Nests) {
+  SetVector<Value *> SubtreeValues;
+  SetVector<const Loop *> Loops;
+
+  for (isl_ast_node *Nest : Nests)
+    getReferencesInSubtree(Nest, SubtreeValues, Loops);
+
+  // See createForParallel.
+  for (const Loop *L : Loops) {
+    const SCEV *OuterLIV = SE.getAddRecExpr(SE.getUnknown(Builder.getInt64(0)),
+                                            SE.getUnknown(Builder.getInt64(1)),
+                                            L, SCEV::FlagAnyWrap);
+    Value *V = generateSCEV(OuterLIV);
+    OutsideLoopIterations[L] = SE.getUnknown(V);
+    SubtreeValues.insert(V);
+  }
+
+  BasicBlock::iterator LoopBody;
+  ParallelLoopGenerator::ValueToValueMapTy NewValues;
+  ParallelLoopGenerator ParallelLoopGen(Builder, P, LI, DT, DL);
+
+  Value *IV = ParallelLoopGen.createParallelLoop(
+      Builder.getInt64(0), Builder.getInt64(Nests.size() - 1),
+      Builder.getInt64(1), SubtreeValues, NewValues, &LoopBody);
+  BasicBlock::iterator AfterLoop = Builder.GetInsertPoint();
+  Builder.SetInsertPoint(LoopBody);
+
+  // Save the current values.
+  ValueMapT ValueMapCopy = ValueMap;
+  IslExprBuilder::IDToValueTy IDToValueCopy = IDToValue;
+
+  updateValues(NewValues);
+
+  // Branch to the nest of the current iteration.
+  BasicBlock *DispatchBB = Builder.GetInsertBlock();
+  Function *F = DispatchBB->getParent();
+  BasicBlock *MergeBB =
+      SplitBlock(DispatchBB, Builder.GetInsertPoint(), &DT, &LI);
+  MergeBB->setName("polly.section.merge");
+  DispatchBB->getTerminator()->eraseFromParent();
+  Builder.SetInsertPoint(DispatchBB);
+  SwitchInst *Switch = Builder.CreateSwitch(IV, MergeBB, Nests.size());
+
+  Loop *DispatchLoop = LI.getLoopFor(DispatchBB);
+  for (unsigned i = 0; i < Nests.size(); i++) {
+    BasicBlock *SectionBB =
+        BasicBlock::Create(F->getContext(), "polly.section", F);
+    DT.addNewBlock(SectionBB, DispatchBB);
+    if (DispatchLoop)
+      DispatchLoop->addBasicBlockToLoop(SectionBB, LI);
+    Switch->addCase(cast<ConstantInt>(ConstantInt::get(IV->getType(), i)),
+                    SectionBB);
+
+    Builder.SetInsertPoint(SectionBB);
+    Builder.CreateBr(MergeBB);
+    Builder.SetInsertPoint(SectionBB->begin());
+    create(Nests[i]);
+  }
+
+  // Restore the original values.
+  ValueMap = ValueMapCopy;
+  IDToValue = IDToValueCopy;
+
+  Builder.SetInsertPoint(AfterLoop);
+  removeSubFuncFromDomTree((*LoopBody).getParent()->getParent(), DT);
+
+  for (const Loop *L : Loops)
+    OutsideLoopIterations.erase(L);
+}
+
+void IslNodeBuilder::createTaskRegion(__isl_take isl_ast_node *For) {
+  // A single thread creates the tasks, the other threads of the parallel loop
+  // run them while they wait for the end of the loop.
+  InTaskRegion = true;
+  createSections({For});
+  InTaskRegion = false;
+}
+
+Value *
+IslNodeBuilder::createTaskAddress(const std::vector<isl_ast_expr *> &Tile) {
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  GlobalVariable *Base = M->getGlobalVariable("polly.task.addresses", true);
+  if (!Base)
+    Base = new GlobalVariable(*M, Builder.getInt8Ty(), true,
+                              GlobalValue::PrivateLinkage, Builder.getInt8(0),
+                              "polly.task.addresses");
+
+  // Different tasks may get the same address if the iterations are large,
+  // which only adds dependences.
+  Value *Offset = Builder.getInt64(0);
+  for (isl_ast_expr *Expr : Tile) {
+    Value *Iteration = Builder.CreateSExtOrTrunc(
+        ExprBuilder.create(isl_ast_expr_copy(Expr)), Builder.getInt64Ty());
+    Offset = Builder.CreateAdd(
+        Builder.CreateMul(Offset, Builder.getInt64(1 << 20)), Iteration);
+  }
+  return Builder.CreateGEP(Base, Offset, "polly.task.address");
+}
+
+void IslNodeBuilder::createTask(__isl_keep isl_ast_node *For,
+                                __isl_take isl_ast_node *Body) {
+  IslAstInfo::IslAstUserPayload *Payload = IslAstInfo::getNodePayload(For);
+
+  // The task writes its own address and reads the addresses of the tasks it
+  // depends on, or the null address if a dependence does not exist.
+  std::vector<Value *> Depend = {createTaskAddress(Payload->TaskTile)};
+  for (const IslAstInfo::TaskDependence &Dep : Payload->TaskDependences) {
+    Value *Cond = ExprBuilder.create(isl_ast_expr_copy(Dep.Condition));
+    if (!Cond->getType()->isIntegerTy(1))
+      Cond = Builder.CreateIsNotNull(Cond);
+    Depend.push_back(Builder.CreateSelect(
+        Cond, createTaskAddress(Dep.Tile),
+        ConstantPointerNull::get(Builder.getInt8PtrTy())));
+  }
+
+  // The values are passed in their versions in the task region.
+  SetVector<Value *> SubtreeValues, Values;
+  SetVector<const Loop *> Loops;
+  getReferencesInSubtree(For, SubtreeValues, Loops);
+  auto GetRegionValue = [this](Value *V) {
+    Value *RegionValue = ValueMap.lookup(V);
+    return RegionValue ? RegionValue : V;
+  };
+  for (Value *V : SubtreeValues)
+    Values.insert(GetRegionValue(V));
+
+  BasicBlock::iterator TaskBody;
+  ParallelLoopGenerator::ValueToValueMapTy NewValues;
+  ParallelLoopGenerator ParallelLoopGen(Builder, P, LI, DT, DL);
+  ParallelLoopGen.createTask(Values, NewValues, Depend, 1, &TaskBody);
+  BasicBlock::iterator AfterTask = Builder.GetInsertPoint();
+  Builder.SetInsertPoint(TaskBody);
+
+  // Save the current values.
+  ValueMapT ValueMapCopy = ValueMap;
+  IslExprBuilder::IDToValueTy IDToValueCopy = IDToValue;
+
+  for (auto &I : IDToValue)
+    I.second = NewValues[I.second];
+  for (Value *V : SubtreeValues) {
+    Value *TaskValue = NewValues[GetRegionValue(V)];
+    ValueMap[V] = TaskValue;
+  }
+
+  create(Body);
+
+  // Restore the original values.
+  ValueMap = ValueMapCopy;
+  IDToValue = IDToValueCopy;
+
+  Builder.SetInsertPoint(AfterTask);
+  removeSubFuncFromDomTree((*TaskBody).getParent()->getParent(), DT);
+}
+
+Value *IslNodeBuilder::createNumberOfIterations(__isl_keep isl_ast_node *For) {
+  CmpInst::Predicate Predicate;
+  Type *Int64Ty = Builder.getInt64Ty();
+
+  isl_ast_expr *Init = isl_ast_node_for_get_init(For);
+  isl_ast_expr *Inc = isl_ast_node_for_get_inc(For);
+  isl_ast_expr *UB = getUpperBound(For, Predicate);
+
+  Value *ValueLB = Builder.CreateSExtOrTrunc(ExprBuilder.create(Init), Int64Ty);
+  Value *ValueUB = Builder.CreateSExtOrTrunc(ExprBuilder.create(UB), Int64Ty);
+  Value *ValueInc = Builder.CreateSExtOrTrunc(ExprBuilder.create(Inc), Int64Ty);
+
+  if (Predicate == CmpInst::ICMP_SLT)
+    ValueUB = Builder.CreateSub(ValueUB, Builder.getInt64(1));
+
+  Value *Iterations = Builder.CreateAdd(
+      Builder.CreateSDiv(Builder.CreateSub(ValueUB, ValueLB), ValueInc),
+      Builder.getInt64(1));
+  return Builder.CreateSelect(Builder.CreateICmpSGE(ValueUB, ValueLB),
+                              Iterations, Builder.getInt64(0),
+                              "polly.profile.iterations");
+}
+
 void IslNodeBuilder::createFor(__isl_take isl_ast_node *For) {
+  if (!InTaskRegion && IslAstInfo::isTaskRegion(For)) {
+    createTaskRegion(For);
+    return;
+  }
+
+  if (!Profiler) {
+    createForLoop(For);
+    return;
+  }
+
+  std::vector<LabelProfiler::ProfiledLoop> ProfiledLoops = Profiler->enterFor(
+      For, [this, For]() { return createNumberOfIterations(For); });
+  createForLoop(For);
+  Profiler->exitFor(ProfiledLoops);
+}
+
+void IslNodeBuilder::createForLoop(__isl_take isl_ast_node *For) {
   bool Vector = PollyVectorizerChoice == VECTORIZER_POLLY;
 
   if (Vector && IslAstInfo::isInnermostParallel(For) &&
@@ -545,9 +1115,21 @@ void IslNodeBuilder::createFor(__isl_take isl_ast_node *For) {
       createForVector(For, VectorWidth);
       return;
     }
+
+    // Loops with a non-constant number of iterations, e.g. the remainder of a
+    // strip-mined loop, can be vectorized with masked vector operations if
+    // the number of iterations is bounded.
+    if (PollyVectorMaskedRemainder && VectorWidth == -1) {
+      VectorWidth = getMaxNumberOfIterations(For);
+      if (1 < VectorWidth && VectorWidth <= 16 && canCreateMaskedVector(For)) {
+        createForVector(For, VectorWidth, true);
+        return;
+      }
+    }
   }
 
-  if (IslAstInfo::isExecutedInParallel(For)) {
+  // The tasks already run in parallel.
+  if (!InTaskRegion && IslAstInfo::isExecutedInParallel(For)) {
     createForParallel(For);
     return;
   }
@@ -680,6 +1262,85 @@ void IslNodeBuilder::createBlock(__isl_take isl_ast_node *Block) {
   isl_ast_node_list_free(List);
 }
 
+/// @brief Does @p Node contain a loop that is executed in parallel?
+static bool containsParallelLoop(__isl_keep isl_ast_node *Node) {
+  bool Contains = false;
+
+  switch (isl_ast_node_get_type(Node)) {
+  case isl_ast_node_for: {
+    if (IslAstInfo::isExecutedInParallel(Node) ||
+        IslAstInfo::isTaskRegion(Node))
+      return true;
+    isl_ast_node *Body = isl_ast_node_for_get_body(Node);
+    Contains = containsParallelLoop(Body);
+    isl_ast_node_free(Body);
+    break;
+  }
+  case isl_ast_node_if: {
+    isl_ast_node *Then = isl_ast_node_if_get_then(Node);
+    Contains = containsParallelLoop(Then);
+    isl_ast_node_free(Then);
+    if (!Contains && isl_ast_node_if_has_else(Node)) {
+      isl_ast_node *Else = isl_ast_node_if_get_else(Node);
+      Contains = containsParallelLoop(Else);
+      isl_ast_node_free(Else);
+    }
+    break;
+  }
+  case isl_ast_node_block: {
+    isl_ast_node_list *List = isl_ast_node_block_get_children(Node);
+    for (int i = 0; !Contains && i < isl_ast_node_list_n_ast_node(List); ++i) {
+      isl_ast_node *Child = isl_ast_node_list_get_ast_node(List, i);
+      Contains = containsParallelLoop(Child);
+      isl_ast_node_free(Child);
+    }
+    isl_ast_node_list_free(List);
+    break;
+  }
+  default:
+    break;
+  }
+
+  return Contains;
+}
+
+void IslNodeBuilder::createConcurrentNests(__isl_take isl_ast_node *Block,
+                                           const std::vector<unsigned> &Levels) {
+  isl_ast_node_list *List = isl_ast_node_block_get_children(Block);
+  assert(Levels.size() == (unsigned)isl_ast_node_list_n_ast_node(List) &&
+         "Expected a level for each nest");
+
+  unsigned MaxLevel = *std::max_element(Levels.begin(), Levels.end());
+  for (unsigned Level = 0; Level <= MaxLevel; ++Level) {
+    std::vector<isl_ast_node *> Sections, Others;
+
+    // Nests with parallel loops already use all threads.
+    for (unsigned i = 0; i < Levels.size(); ++i) {
+      if (Levels[i] != Level)
+        continue;
+      isl_ast_node *Nest = isl_ast_node_list_get_ast_node(List, i);
+      if (isl_ast_node_get_type(Nest) == isl_ast_node_for &&
+          !containsParallelLoop(Nest))
+        Sections.push_back(Nest);
+      else
+        Others.push_back(Nest);
+    }
+
+    if (Sections.size() == 1) {
+      Others.insert(Others.begin(), Sections.front());
+      Sections.clear();
+    }
+
+    if (!Sections.empty())
+      createSections(Sections);
+    for (isl_ast_node *Nest : Others)
+      create(Nest);
+  }
+
+  isl_ast_node_free(Block);
+  isl_ast_node_list_free(List);
+}
+
 void IslNodeBuilder::create(__isl_take isl_ast_node *Node) {
   switch (isl_ast_node_get_type(Node)) {
   case isl_ast_node_error:
@@ -703,6 +1364,11 @@ void IslNodeBuilder::create(__isl_take isl_ast_node *Node) {
   llvm_unreachable("Unknown isl_ast_node type");
 }
 
+void IslNodeBuilder::addParameter(__isl_take isl_id *Id, Value *V) {
+  IDToValue[Id] = V;
+  isl_id_free(Id);
+}
+
 void IslNodeBuilder::addParameters(__isl_take isl_set *Context) {
 
   for (unsigned i = 0; i < isl_set_dim(Context, isl_dim_param); ++i) {
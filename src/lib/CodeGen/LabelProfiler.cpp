@@ -0,0 +1,240 @@
+//===- LabelProfiler.cpp - Profile the labelled loop nests ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Instrument the generated code of the labelled loop nests of a SCoP with
+// cycle and iteration counters.
+//
+// The counters of a profiled loop are kept in a global array of three 64 bit
+// integers: the number of times the loop was entered, the total number of
+// iterations and the total number of cycles. As profiled loops may be nested
+// inside OpenMP parallel loops, the counters are updated atomically. At
+// program exit, a destructor of each instrumented SCoP appends one JSON object
+// per profiled loop to the profile file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "polly/CodeGen/LabelProfiler.h"
+#include "polly/CodeGen/IslAst.h"
+#include "polly/Options.h"
+#include "polly/ScopInfo.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "isl/ast.h"
+#include "isl/union_map.h"
+#include "isl/union_set.h"
+
+using namespace llvm;
+using namespace polly;
+
+static cl::opt<bool> ProfileLabels(
+    "polly-profile-labels",
+    cl::desc("Count the cycles and iterations spent in each labelled loop "
+             "nest and print them at program exit"),
+    cl::Hidden, cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<unsigned> ProfileDepth(
+    "polly-profile-depth",
+    cl::desc("Also profile the loops nested up to this depth inside each "
+             "labelled loop nest, e.g., the tile loops"),
+    cl::Hidden, cl::init(0), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+/// @brief The number of counters of a profiled loop.
+static const unsigned NumCounters = 3;
+
+bool LabelProfiler::isEnabled() { return ProfileLabels; }
+
+LabelProfiler::LabelProfiler(PollyIRBuilder &Builder, Scop &S)
+    : Builder(Builder), S(S) {
+  for (const auto &Loop : S.LoopDomainMap)
+    if (isl_union_set *Instances = S.getLoopInstances(Loop.first))
+      LabelInstances[Loop.first] = Instances;
+}
+
+LabelProfiler::~LabelProfiler() {
+  for (const auto &Label : LabelInstances)
+    isl_union_set_free(Label.second);
+}
+
+GlobalVariable *LabelProfiler::getCounters(const std::string &Label,
+                                           unsigned Depth) {
+  for (const auto &Counters : AllCounters)
+    if (Counters.first.first == Label && Counters.first.second == Depth)
+      return Counters.second;
+
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  ArrayType *Ty = ArrayType::get(Builder.getInt64Ty(), NumCounters);
+  GlobalVariable *Counters =
+      new GlobalVariable(*M, Ty, false, GlobalValue::InternalLinkage,
+                         ConstantAggregateZero::get(Ty),
+                         "polly.profile." + Label + "." + Twine(Depth));
+  AllCounters.push_back(
+      std::make_pair(std::make_pair(Label, Depth), Counters));
+  return Counters;
+}
+
+/// @brief Return the current value of the cycle counter.
+static Value *createReadCycleCounter(PollyIRBuilder &Builder) {
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  Function *F = Intrinsic::getDeclaration(M, Intrinsic::readcyclecounter);
+  return Builder.CreateCall(F, {}, "polly.profile.cycles");
+}
+
+LabelProfiler::ProfiledLoop
+LabelProfiler::startLoop(const std::string &Label, unsigned Depth,
+                         Value *Iterations) {
+  ProfiledLoop Loop;
+  Loop.Counters = getCounters(Label, Depth);
+  Loop.Iterations = Iterations;
+  Loop.StartCycles = createReadCycleCounter(Builder);
+  return Loop;
+}
+
+std::vector<LabelProfiler::ProfiledLoop>
+LabelProfiler::enterFor(__isl_keep isl_ast_node *For,
+                        function_ref<Value *()> GetIterations) {
+  std::vector<std::pair<std::string, unsigned>> Labels;
+  std::vector<ProfiledLoop> Loops;
+
+  SavedActiveLabels.push_back(ActiveLabels);
+
+  // Profile the loops nested inside the nests that are already being profiled,
+  // up to the requested depth.
+  for (auto &Active : ActiveLabels)
+    if (++Active.second <= ProfileDepth)
+      Labels.push_back(Active);
+
+  // A labelled nest starts at the outermost for node that only executes
+  // instances of the statements in the labelled loop.
+  isl_union_set *Instances =
+      IslAstInfo::addInstances(For, isl_union_set_empty(S.getParamSpace()));
+  if (isl_union_set_is_empty(Instances) == isl_bool_false)
+    for (const auto &Label : LabelInstances) {
+      if (ActiveLabels.count(Label.first))
+        continue;
+      if (isl_union_set_is_subset(Instances, Label.second) != isl_bool_true)
+        continue;
+      ActiveLabels[Label.first] = 0;
+      Labels.push_back(std::make_pair(Label.first, 0));
+    }
+  isl_union_set_free(Instances);
+
+  // Only compute the number of iterations for loops that are profiled, such
+  // that the code of all other loops is left unchanged.
+  if (Labels.empty())
+    return Loops;
+
+  Value *Iterations = GetIterations();
+  for (const auto &Label : Labels)
+    Loops.push_back(startLoop(Label.first, Label.second, Iterations));
+  return Loops;
+}
+
+void LabelProfiler::exitFor(const std::vector<ProfiledLoop> &Loops) {
+  Value *EndCycles = nullptr;
+
+  if (!Loops.empty())
+    EndCycles = createReadCycleCounter(Builder);
+
+  // Stop the innermost loops first, such that the overhead of updating the
+  // counters is not attributed to them.
+  for (auto It = Loops.rbegin(), End = Loops.rend(); It != End; ++It) {
+    Value *Cycles = Builder.CreateSub(EndCycles, It->StartCycles);
+    Value *Updates[NumCounters] = {Builder.getInt64(1), It->Iterations,
+                                   Cycles};
+    for (unsigned i = 0; i < NumCounters; ++i) {
+      Value *Ptr = Builder.CreateConstInBoundsGEP2_64(It->Counters, 0, i);
+      Builder.CreateAtomicRMW(AtomicRMWInst::Add, Ptr, Updates[i],
+                              AtomicOrdering::Monotonic);
+    }
+  }
+
+  ActiveLabels = SavedActiveLabels.back();
+  SavedActiveLabels.pop_back();
+}
+
+/// @brief Escape @p Str for use in a JSON string printed with printf.
+static std::string escape(StringRef Str) {
+  std::string Escaped;
+
+  for (char C : Str) {
+    if (C == '"' || C == '\\')
+      Escaped += '\\';
+    else if (C == '%')
+      Escaped += '%';
+    Escaped += C;
+  }
+  return Escaped;
+}
+
+void LabelProfiler::finalize() {
+  if (AllCounters.empty())
+    return;
+
+  Function *ScopF = Builder.GetInsertBlock()->getParent();
+  Module *M = ScopF->getParent();
+  LLVMContext &Context = M->getContext();
+  Type *Int8PtrTy = Builder.getInt8PtrTy();
+  Type *Int32Ty = Builder.getInt32Ty();
+
+  // The FILE type is not known here, so the file is passed around as an i8*.
+  // If the module already declares these functions with a FILE*, we get a
+  // bitcast of the existing declaration.
+  Constant *GetEnv = M->getOrInsertFunction("getenv", Int8PtrTy, Int8PtrTy,
+                                            nullptr);
+  Constant *FOpen = M->getOrInsertFunction("fopen", Int8PtrTy, Int8PtrTy,
+                                           Int8PtrTy, nullptr);
+  Constant *FClose =
+      M->getOrInsertFunction("fclose", Int32Ty, Int8PtrTy, nullptr);
+  Constant *FPrintF = M->getOrInsertFunction(
+      "fprintf", FunctionType::get(Int32Ty, {Int8PtrTy, Int8PtrTy}, true));
+
+  Function *F = Function::Create(
+      FunctionType::get(Builder.getVoidTy(), false),
+      Function::InternalLinkage, "polly.profile.dump", M);
+  BasicBlock *EntryBB = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *PrintBB = BasicBlock::Create(Context, "print", F);
+  BasicBlock *ExitBB = BasicBlock::Create(Context, "exit", F);
+  IRBuilder<> DumpBuilder(EntryBB);
+
+  Value *Name =
+      DumpBuilder.CreateCall(GetEnv, DumpBuilder.CreateGlobalStringPtr(
+                                         "POLLY_PROFILE_FILE"));
+  Value *HasName = DumpBuilder.CreateIsNotNull(Name);
+  Name = DumpBuilder.CreateSelect(
+      HasName, Name, DumpBuilder.CreateGlobalStringPtr("polly-profile.json"));
+  Value *File = DumpBuilder.CreateCall(
+      FOpen, {Name, DumpBuilder.CreateGlobalStringPtr("a")});
+  DumpBuilder.CreateCondBr(DumpBuilder.CreateIsNotNull(File), PrintBB, ExitBB);
+
+  DumpBuilder.SetInsertPoint(PrintBB);
+  std::string Prefix = "{\"function\": \"" + escape(ScopF->getName()) +
+                       "\", \"region\": \"" + escape(S.getNameStr()) + "\"";
+  for (const auto &Counters : AllCounters) {
+    std::string Format = Prefix + ", \"label\": \"" +
+                         escape(Counters.first.first) + "\", \"depth\": " +
+                         std::to_string(Counters.first.second) +
+                         ", \"calls\": %llu, \"iterations\": %llu"
+                         ", \"cycles\": %llu}\n";
+    std::vector<Value *> Args = {File,
+                                 DumpBuilder.CreateGlobalStringPtr(Format)};
+    for (unsigned i = 0; i < NumCounters; ++i)
+      Args.push_back(DumpBuilder.CreateLoad(
+          DumpBuilder.CreateConstInBoundsGEP2_64(Counters.second, 0, i)));
+    DumpBuilder.CreateCall(FPrintF, Args);
+  }
+  DumpBuilder.CreateCall(FClose, File);
+  DumpBuilder.CreateBr(ExitBB);
+
+  DumpBuilder.SetInsertPoint(ExitBB);
+  DumpBuilder.CreateRetVoid();
+
+  appendToGlobalDtors(*M, F, 0);
+}
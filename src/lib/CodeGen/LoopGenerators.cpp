@@ -13,6 +13,7 @@
 
 #include "polly/ScopDetection.h"
 #include "polly/CodeGen/LoopGenerators.h"
+#include "polly/Options.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Dominators.h"
@@ -28,6 +29,66 @@ static cl::opt<int>
                     cl::desc("Number of threads to use (0 = auto)"), cl::Hidden,
                     cl::init(0));
 
+enum ParallelRuntimeChoice { PARALLEL_RUNTIME_GOMP, PARALLEL_RUNTIME_LOOPY };
+
+static cl::opt<ParallelRuntimeChoice> PollyParallelRuntime(
+    "polly-parallel-runtime",
+    cl::desc("Select the runtime library of the parallel loops"),
+    cl::values(clEnumValN(PARALLEL_RUNTIME_GOMP, "gomp", "GNU OpenMP"),
+               clEnumValN(PARALLEL_RUNTIME_LOOPY, "loopy",
+                          "Loopy runtime with persistent threads"),
+               clEnumValEnd),
+    cl::Hidden, cl::init(PARALLEL_RUNTIME_GOMP), cl::ZeroOrMore,
+    cl::cat(PollyCategory));
+
+bool polly::PollyFirstTouch;
+
+static cl::opt<bool, true> XPollyFirstTouch(
+    "polly-parallel-first-touch",
+    cl::desc("Run the loop nests initializing the arrays of parallel loops in "
+             "parallel, with the same static schedule as the parallel loops"),
+    cl::location(PollyFirstTouch), cl::Hidden, cl::init(false),
+    cl::ZeroOrMore, cl::cat(PollyCategory));
+
+/// @brief The thread binding policies of OpenMP, with the values used in the
+///        flags of the GNU OpenMP runtime calls.
+enum ProcBindChoice {
+  PROC_BIND_NONE = 0,
+  PROC_BIND_CLOSE = 3,
+  PROC_BIND_SPREAD = 4
+};
+
+static cl::opt<ProcBindChoice> PollyProcBind(
+    "polly-parallel-proc-bind",
+    cl::desc("Bind the threads of the statically scheduled parallel loops "
+             "(with -polly-parallel-first-touch)"),
+    cl::values(clEnumValN(PROC_BIND_NONE, "none", "Use OMP_PROC_BIND"),
+               clEnumValN(PROC_BIND_CLOSE, "close",
+                          "Bind the threads to places close to each other"),
+               clEnumValN(PROC_BIND_SPREAD, "spread",
+                          "Spread the threads over the places"),
+               clEnumValEnd),
+    cl::Hidden, cl::init(PROC_BIND_CLOSE), cl::ZeroOrMore,
+    cl::cat(PollyCategory));
+
+/// @brief Return the name of a function of the selected parallel runtime.
+///
+/// The Loopy runtime has the same interface as the GNU OpenMP functions used.
+static const char *getRuntimeFunctionName(const char *GOMPName,
+                                          const char *LoopyName) {
+  return PollyParallelRuntime == PARALLEL_RUNTIME_LOOPY ? LoopyName : GOMPName;
+}
+
+/// @brief Do the GNU OpenMP loops use the static schedule?
+///
+/// The static schedule assigns the same iterations to the same threads in all
+/// loops with the same bounds, which is what first-touch placement relies on.
+/// The static loops are started with a single call that takes the binding of
+/// the threads, runs the subfunction and joins the threads (GCC 4.9 or later).
+static bool useStaticSchedule() {
+  return PollyFirstTouch && PollyParallelRuntime == PARALLEL_RUNTIME_GOMP;
+}
+
 // We generate a loop of either of the following structures:
 //
 //              BeforeBB                      BeforeBB
@@ -54,7 +115,7 @@ Value *polly::createLoop(Value *LB, Value *UB, Value *Stride,
                          DominatorTree &DT, BasicBlock *&ExitBB,
                          ICmpInst::Predicate Predicate,
                          ScopAnnotator *Annotator, bool Parallel,
-                         bool UseGuard) {
+                         bool UseGuard, const LoopHints *Hints) {
   Function *F = Builder.GetInsertBlock()->getParent();
   LLVMContext &Context = F->getContext();
 
@@ -89,7 +150,7 @@ Value *polly::createLoop(Value *LB, Value *UB, Value *Stride,
   // Notify the annotator (if present) that we have a new loop, but only
   // after the header block is set.
   if (Annotator)
-    Annotator->pushLoop(NewLoop, Parallel);
+    Annotator->pushLoop(NewLoop, Parallel, Hints);
 
   // ExitBB
   ExitBB = SplitBlock(BeforeBB, Builder.GetInsertPoint()++, &DT, &LI);
@@ -164,8 +225,10 @@ Value *ParallelLoopGenerator::createParallelLoop(
 
   // Tell the runtime we start a parallel loop
   createCallSpawnThreads(SubFn, SubFnParam, LB, UB, Stride);
-  Builder.CreateCall(SubFn, SubFnParam);
-  createCallJoinThreads();
+  if (!useStaticSchedule()) {
+    Builder.CreateCall(SubFn, SubFnParam);
+    createCallJoinThreads();
+  }
 
   // Mark the end of the lifetime for the parameter struct.
   Type *Ty = Struct->getType();
@@ -175,10 +238,197 @@ Value *ParallelLoopGenerator::createParallelLoop(
   return IV;
 }
 
+Value *ParallelLoopGenerator::createCollapsedParallelLoop(
+    ArrayRef<Value *> LBs, ArrayRef<Value *> UBs, ArrayRef<Value *> Strides,
+    bool CollapseIfFewIterations, SetVector<Value *> &UsedValues,
+    ValueToValueMapTy &Map, BasicBlock::iterator *LoopBody,
+    SmallVectorImpl<Value *> &InnerLBs, SmallVectorImpl<Value *> &InnerUBs,
+    SmallVectorImpl<Value *> &InnerStrides) {
+  unsigned NumLoops = LBs.size();
+  Value *Zero = ConstantInt::get(LongType, 0);
+  Value *One = ConstantInt::get(LongType, 1);
+
+  // Compute the number of iterations of each loop and of the collapsed loop.
+  SmallVector<Value *, 4> LB, UB, Stride, NumIterations;
+  for (unsigned i = 0; i < NumLoops; i++) {
+    LB.push_back(Builder.CreateSExtOrTrunc(LBs[i], LongType));
+    UB.push_back(Builder.CreateSExtOrTrunc(UBs[i], LongType));
+    Stride.push_back(Builder.CreateSExtOrTrunc(Strides[i], LongType));
+    Value *N = Builder.CreateAdd(
+        Builder.CreateSDiv(Builder.CreateSub(UB[i], LB[i]), Stride[i]), One);
+    NumIterations.push_back(Builder.CreateSelect(
+        Builder.CreateICmpSGE(UB[i], LB[i]), N, Zero, "polly.par.collapse.n"));
+  }
+
+  Value *Collapse = Builder.getTrue();
+  if (CollapseIfFewIterations)
+    Collapse = Builder.CreateICmpSLT(NumIterations[0],
+                                     createCallGetNumThreads(),
+                                     "polly.par.collapse");
+
+  Value *Total = NumIterations[0];
+  for (unsigned i = 1; i < NumLoops; i++)
+    Total = Builder.CreateMul(
+        Total, Builder.CreateSelect(Collapse, NumIterations[i], One));
+
+  for (unsigned i = 0; i < NumLoops; i++)
+    for (Value *V : {LB[i], UB[i], Stride[i], NumIterations[i]})
+      if (!isa<Constant>(V))
+        UsedValues.insert(V);
+  if (!isa<Constant>(Collapse))
+    UsedValues.insert(Collapse);
+
+  Value *IV = createParallelLoop(Zero, Builder.CreateSub(Total, One), One,
+                                 UsedValues, Map, LoopBody);
+  BasicBlock::iterator AfterLoop = Builder.GetInsertPoint();
+  Builder.SetInsertPoint(*LoopBody);
+
+  auto GetValue = [&](Value *V) { return isa<Constant>(V) ? V : Map[V]; };
+
+  // Split the linear iteration into the iterations of the loops, the inner
+  // loops first.
+  Collapse = GetValue(Collapse);
+  SmallVector<Value *, 4> Index(NumLoops);
+  for (unsigned i = NumLoops - 1; i > 0; i--) {
+    Value *N = Builder.CreateSelect(Collapse, GetValue(NumIterations[i]), One);
+    Index[i] = Builder.CreateSRem(IV, N, "polly.par.collapse.idx");
+    IV = Builder.CreateSDiv(IV, N);
+  }
+  Index[0] = IV;
+
+  IV = Builder.CreateAdd(GetValue(LB[0]),
+                         Builder.CreateMul(Index[0], GetValue(Stride[0])),
+                         "polly.par.collapse.iv");
+  for (unsigned i = 1; i < NumLoops; i++) {
+    Value *InnerLB = Builder.CreateAdd(
+        GetValue(LB[i]), Builder.CreateMul(Index[i], GetValue(Stride[i])));
+    InnerLBs.push_back(InnerLB);
+    InnerUBs.push_back(
+        Builder.CreateSelect(Collapse, InnerLB, GetValue(UB[i])));
+    InnerStrides.push_back(GetValue(Stride[i]));
+  }
+
+  *LoopBody = Builder.GetInsertPoint();
+  Builder.SetInsertPoint(AfterLoop);
+  return IV;
+}
+
+bool ParallelLoopGenerator::supportsTasks() {
+  return PollyParallelRuntime == PARALLEL_RUNTIME_GOMP;
+}
+
+void ParallelLoopGenerator::createTask(SetVector<Value *> &UsedValues,
+                                       ValueToValueMapTy &Map,
+                                       ArrayRef<Value *> Depend,
+                                       unsigned NumOut,
+                                       BasicBlock::iterator *TaskBody) {
+  assert(supportsTasks() && "Tasks need the GNU OpenMP runtime");
+
+  AllocaInst *Struct = storeValuesIntoStruct(UsedValues);
+  BasicBlock::iterator BeforeTask = Builder.GetInsertPoint();
+  BasicBlock *PrevBB = Builder.GetInsertBlock();
+
+  Function *TaskFn = createSubFnDefinition();
+  LLVMContext &Context = TaskFn->getContext();
+  BasicBlock *HeaderBB =
+      BasicBlock::Create(Context, "polly.task.setup", TaskFn);
+  BasicBlock *ExitBB = BasicBlock::Create(Context, "polly.task.exit", TaskFn);
+  DT.addNewBlock(HeaderBB, PrevBB);
+  DT.addNewBlock(ExitBB, HeaderBB);
+
+  Builder.SetInsertPoint(HeaderBB);
+  Value *UserContext = Builder.CreateBitCast(
+      TaskFn->arg_begin(), Struct->getType(), "polly.task.userContext");
+  extractValuesFromStruct(UsedValues, Struct->getAllocatedType(), UserContext,
+                          Map);
+  Builder.CreateBr(ExitBB);
+
+  Builder.SetInsertPoint(ExitBB);
+  Builder.CreateRetVoid();
+  Builder.SetInsertPoint(--Builder.GetInsertPoint());
+  *TaskBody = Builder.GetInsertPoint();
+  Builder.SetInsertPoint(BeforeTask);
+
+  // The dependences are passed as an array with the number of addresses and
+  // the number of addresses written, followed by the addresses.
+  BasicBlock &EntryBB = PrevBB->getParent()->getEntryBlock();
+  ArrayType *DependTy =
+      ArrayType::get(Builder.getInt8PtrTy(), Depend.size() + 2);
+  AllocaInst *DependArray = new AllocaInst(DependTy, 0, "polly.task.depend",
+                                           EntryBB.getFirstInsertionPt());
+  Value *Counts[] = {ConstantInt::get(LongType, Depend.size()),
+                     ConstantInt::get(LongType, NumOut)};
+  for (unsigned i = 0; i < Depend.size() + 2; i++) {
+    Value *Address = Builder.CreateConstGEP2_32(DependTy, DependArray, 0, i);
+    Value *Dep = i < 2 ? Builder.CreateIntToPtr(Counts[i],
+                                                Builder.getInt8PtrTy())
+                       : Builder.CreateBitCast(Depend[i - 2],
+                                               Builder.getInt8PtrTy());
+    Builder.CreateStore(Dep, Address);
+  }
+
+  Value *TaskParam = Builder.CreateBitCast(Struct, Builder.getInt8PtrTy(),
+                                           "polly.task.userContext");
+  createCallTask(TaskFn, TaskParam, Struct,
+                 Builder.CreateConstGEP2_32(DependTy, DependArray, 0, 0));
+
+  // The runtime copies the values of deferred tasks, the struct can be reused.
+  Type *Ty = Struct->getType();
+  ConstantInt *SizeOf = Builder.getInt64(DL.getTypeAllocSize(Ty));
+  Builder.CreateLifetimeEnd(Struct, SizeOf);
+}
+
+void ParallelLoopGenerator::createCallTask(Value *TaskFn, Value *TaskParam,
+                                           AllocaInst *Struct, Value *Depend) {
+  const std::string Name = "GOMP_task";
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    Type *Int8PtrTy = Builder.getInt8PtrTy();
+    Type *Params[] = {
+        PointerType::getUnqual(
+            FunctionType::get(Builder.getVoidTy(), Int8PtrTy, false)),
+        Int8PtrTy,
+        PointerType::getUnqual(FunctionType::get(
+            Builder.getVoidTy(), {Int8PtrTy, Int8PtrTy}, false)),
+        LongType,
+        LongType,
+        Builder.getInt8Ty(),
+        Builder.getInt32Ty(),
+        Int8PtrTy->getPointerTo()};
+
+    FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  // The values are copied with memcpy (no copy function) and the task is
+  // deferred (the if clause is true) with dependences (flag 8).
+  Type *StructTy = Struct->getAllocatedType();
+  Value *Args[] = {
+      TaskFn,
+      TaskParam,
+      ConstantPointerNull::get(
+          cast<PointerType>(F->getFunctionType()->getParamType(2))),
+      ConstantInt::get(LongType, DL.getTypeAllocSize(StructTy)),
+      ConstantInt::get(LongType, DL.getABITypeAlignment(StructTy)),
+      Builder.getInt8(1),
+      Builder.getInt32(8),
+      Depend};
+  Builder.CreateCall(F, Args);
+}
+
 void ParallelLoopGenerator::createCallSpawnThreads(Value *SubFn,
                                                    Value *SubFnParam, Value *LB,
                                                    Value *UB, Value *Stride) {
-  const std::string Name = "GOMP_parallel_loop_runtime_start";
+  const std::string Name =
+      useStaticSchedule()
+          ? "GOMP_parallel_loop_static"
+          : getRuntimeFunctionName("GOMP_parallel_loop_runtime_start",
+                                   "loopy_parallel_loop_start");
 
   Function *F = M->getFunction(Name);
 
@@ -186,24 +436,61 @@ void ParallelLoopGenerator::createCallSpawnThreads(Value *SubFn,
   if (!F) {
     GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
 
-    Type *Params[] = {PointerType::getUnqual(FunctionType::get(
-                          Builder.getVoidTy(), Builder.getInt8PtrTy(), false)),
-                      Builder.getInt8PtrTy(), Builder.getInt32Ty(), LongType,
-                      LongType, LongType};
+    std::vector<Type *> Params = {
+        PointerType::getUnqual(FunctionType::get(
+            Builder.getVoidTy(), Builder.getInt8PtrTy(), false)),
+        Builder.getInt8PtrTy(), Builder.getInt32Ty(), LongType, LongType,
+        LongType};
+
+    // The static loop additionally takes the chunk size and the flags.
+    if (useStaticSchedule()) {
+      Params.push_back(LongType);
+      Params.push_back(Builder.getInt32Ty());
+    }
 
     FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, false);
     F = Function::Create(Ty, Linkage, Name, M);
   }
 
   Value *NumberOfThreads = Builder.getInt32(PollyNumThreads);
-  Value *Args[] = {SubFn, SubFnParam, NumberOfThreads, LB, UB, Stride};
+  std::vector<Value *> Args = {SubFn, SubFnParam, NumberOfThreads, LB, UB,
+                               Stride};
+
+  // A chunk size of zero gives each thread one contiguous block of iterations.
+  if (useStaticSchedule()) {
+    Args.push_back(ConstantInt::get(LongType, 0));
+    Args.push_back(Builder.getInt32(PollyProcBind));
+  }
 
   Builder.CreateCall(F, Args);
 }
 
+Value *ParallelLoopGenerator::createCallGetNumThreads() {
+  if (PollyNumThreads > 0)
+    return ConstantInt::get(LongType, PollyNumThreads);
+
+  const std::string Name =
+      getRuntimeFunctionName("omp_get_max_threads", "loopy_get_max_threads");
+
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+
+    FunctionType *Ty = FunctionType::get(Builder.getInt32Ty(), false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  return Builder.CreateZExt(Builder.CreateCall(F, {}), LongType);
+}
+
 Value *ParallelLoopGenerator::createCallGetWorkItem(Value *LBPtr,
                                                     Value *UBPtr) {
-  const std::string Name = "GOMP_loop_runtime_next";
+  const std::string Name =
+      useStaticSchedule()
+          ? "GOMP_loop_static_next"
+          : getRuntimeFunctionName("GOMP_loop_runtime_next", "loopy_loop_next");
 
   Function *F = M->getFunction(Name);
 
@@ -223,7 +510,8 @@ Value *ParallelLoopGenerator::createCallGetWorkItem(Value *LBPtr,
 }
 
 void ParallelLoopGenerator::createCallJoinThreads() {
-  const std::string Name = "GOMP_parallel_end";
+  const std::string Name =
+      getRuntimeFunctionName("GOMP_parallel_end", "loopy_parallel_end");
 
   Function *F = M->getFunction(Name);
 
@@ -239,7 +527,8 @@ void ParallelLoopGenerator::createCallJoinThreads() {
 }
 
 void ParallelLoopGenerator::createCallCleanupThread() {
-  const std::string Name = "GOMP_loop_end_nowait";
+  const std::string Name =
+      getRuntimeFunctionName("GOMP_loop_end_nowait", "loopy_loop_end_nowait");
 
   Function *F = M->getFunction(Name);
 
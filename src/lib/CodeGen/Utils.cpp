@@ -16,6 +16,7 @@
 #include "polly/ScopInfo.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/RegionInfo.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
@@ -86,3 +87,176 @@ BasicBlock *polly::executeScopConditionally(Scop &S, Pass *P, Value *RTC) {
     DT.changeImmediateDominator(MergeBlock, SplitBlock);
   return StartBlock;
 }
+
+/// @brief Get the function that checks sorted ranges for overlaps.
+///
+/// The function is emitted once per module and has the signature
+///
+///   i1 (intptr *Min, intptr *Max, i8 *ReadOnly, intptr NumRanges)
+///
+/// It first sorts the ranges by their start address with an insertion sort.
+/// Then it walks the ranges in order and tracks the largest end address of
+/// all ranges and of the read write ranges seen so far. Two ranges overlap iff
+/// the later starting one starts before the earlier one ends, hence a read
+/// write range must start after all previous ranges ended and a read only
+/// range after all previous read write ranges ended.
+static Function *getSortedNoOverlapFunction(Module *M, Type *IntPtrTy) {
+  const char *Name = "polly.rtc.sortedNoOverlap";
+  Function *F = M->getFunction(Name);
+  if (F)
+    return F;
+
+  LLVMContext &Context = M->getContext();
+  Type *Int8Ty = Type::getInt8Ty(Context);
+  Type *Params[] = {IntPtrTy->getPointerTo(), IntPtrTy->getPointerTo(),
+                    Int8Ty->getPointerTo(), IntPtrTy};
+  FunctionType *Ty =
+      FunctionType::get(Type::getInt1Ty(Context), Params, false);
+  F = Function::Create(Ty, Function::InternalLinkage, Name, M);
+  F->addFnAttr(Attribute::NoUnwind);
+
+  Function::arg_iterator AI = F->arg_begin();
+  Value *MinArr = &*AI++;
+  Value *MaxArr = &*AI++;
+  Value *ReadOnlyArr = &*AI++;
+  Value *NumRanges = &*AI;
+
+  BasicBlock *EntryBB = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *SortHeaderBB = BasicBlock::Create(Context, "sort.header", F);
+  BasicBlock *SortBodyBB = BasicBlock::Create(Context, "sort.body", F);
+  BasicBlock *InsertHeaderBB = BasicBlock::Create(Context, "insert.header", F);
+  BasicBlock *InsertCmpBB = BasicBlock::Create(Context, "insert.cmp", F);
+  BasicBlock *InsertShiftBB = BasicBlock::Create(Context, "insert.shift", F);
+  BasicBlock *InsertDoneBB = BasicBlock::Create(Context, "insert.done", F);
+  BasicBlock *SweepHeaderBB = BasicBlock::Create(Context, "sweep.header", F);
+  BasicBlock *SweepBodyBB = BasicBlock::Create(Context, "sweep.body", F);
+  BasicBlock *SweepNextBB = BasicBlock::Create(Context, "sweep.next", F);
+  BasicBlock *OverlapBB = BasicBlock::Create(Context, "overlap", F);
+  BasicBlock *NoOverlapBB = BasicBlock::Create(Context, "no_overlap", F);
+
+  IRBuilder<> Builder(EntryBB);
+  Value *Zero = ConstantInt::get(IntPtrTy, 0);
+  Value *One = ConstantInt::get(IntPtrTy, 1);
+  Builder.CreateBr(SortHeaderBB);
+
+  // for (i = 1; i < NumRanges; i++)
+  Builder.SetInsertPoint(SortHeaderBB);
+  PHINode *I = Builder.CreatePHI(IntPtrTy, 2, "i");
+  I->addIncoming(One, EntryBB);
+  Builder.CreateCondBr(Builder.CreateICmpSLT(I, NumRanges), SortBodyBB,
+                       SweepHeaderBB);
+
+  Builder.SetInsertPoint(SortBodyBB);
+  Value *KeyMin = Builder.CreateLoad(Builder.CreateGEP(MinArr, I), "key.min");
+  Value *KeyMax = Builder.CreateLoad(Builder.CreateGEP(MaxArr, I), "key.max");
+  Value *KeyReadOnly =
+      Builder.CreateLoad(Builder.CreateGEP(ReadOnlyArr, I), "key.ro");
+  Builder.CreateBr(InsertHeaderBB);
+
+  //   for (j = i; j > 0 && Min[j - 1] > Min[i]; j--)
+  //     Range[j] = Range[j - 1];
+  Builder.SetInsertPoint(InsertHeaderBB);
+  PHINode *J = Builder.CreatePHI(IntPtrTy, 2, "j");
+  J->addIncoming(I, SortBodyBB);
+  Builder.CreateCondBr(Builder.CreateICmpSGT(J, Zero), InsertCmpBB,
+                       InsertDoneBB);
+
+  Builder.SetInsertPoint(InsertCmpBB);
+  Value *Prev = Builder.CreateSub(J, One, "j.prev");
+  Value *PrevMin = Builder.CreateLoad(Builder.CreateGEP(MinArr, Prev));
+  Builder.CreateCondBr(Builder.CreateICmpUGT(PrevMin, KeyMin), InsertShiftBB,
+                       InsertDoneBB);
+
+  Builder.SetInsertPoint(InsertShiftBB);
+  Value *PrevMax = Builder.CreateLoad(Builder.CreateGEP(MaxArr, Prev));
+  Value *PrevReadOnly = Builder.CreateLoad(Builder.CreateGEP(ReadOnlyArr, Prev));
+  Builder.CreateStore(PrevMin, Builder.CreateGEP(MinArr, J));
+  Builder.CreateStore(PrevMax, Builder.CreateGEP(MaxArr, J));
+  Builder.CreateStore(PrevReadOnly, Builder.CreateGEP(ReadOnlyArr, J));
+  J->addIncoming(Prev, InsertShiftBB);
+  Builder.CreateBr(InsertHeaderBB);
+
+  //   Range[j] = Range[i];
+  Builder.SetInsertPoint(InsertDoneBB);
+  Builder.CreateStore(KeyMin, Builder.CreateGEP(MinArr, J));
+  Builder.CreateStore(KeyMax, Builder.CreateGEP(MaxArr, J));
+  Builder.CreateStore(KeyReadOnly, Builder.CreateGEP(ReadOnlyArr, J));
+  I->addIncoming(Builder.CreateAdd(I, One, "i.next"), InsertDoneBB);
+  Builder.CreateBr(SortHeaderBB);
+
+  // for (k = 0; k < NumRanges; k++)
+  Builder.SetInsertPoint(SweepHeaderBB);
+  PHINode *K = Builder.CreatePHI(IntPtrTy, 2, "k");
+  PHINode *AnyEnd = Builder.CreatePHI(IntPtrTy, 2, "any.end");
+  PHINode *ReadWriteEnd = Builder.CreatePHI(IntPtrTy, 2, "rw.end");
+  K->addIncoming(Zero, SortHeaderBB);
+  AnyEnd->addIncoming(Zero, SortHeaderBB);
+  ReadWriteEnd->addIncoming(Zero, SortHeaderBB);
+  Builder.CreateCondBr(Builder.CreateICmpSLT(K, NumRanges), SweepBodyBB,
+                       NoOverlapBB);
+
+  Builder.SetInsertPoint(SweepBodyBB);
+  Value *RangeMin = Builder.CreateLoad(Builder.CreateGEP(MinArr, K), "min");
+  Value *RangeMax = Builder.CreateLoad(Builder.CreateGEP(MaxArr, K), "max");
+  Value *IsReadOnly = Builder.CreateIsNotNull(
+      Builder.CreateLoad(Builder.CreateGEP(ReadOnlyArr, K)), "is.ro");
+  Value *End = Builder.CreateSelect(IsReadOnly, ReadWriteEnd, AnyEnd);
+  Builder.CreateCondBr(Builder.CreateICmpULT(RangeMin, End), OverlapBB,
+                       SweepNextBB);
+
+  Builder.SetInsertPoint(SweepNextBB);
+  Value *NewAnyEnd = Builder.CreateSelect(
+      Builder.CreateICmpUGT(RangeMax, AnyEnd), RangeMax, AnyEnd);
+  Value *NewReadWriteEnd = Builder.CreateSelect(
+      Builder.CreateICmpUGT(RangeMax, ReadWriteEnd), RangeMax, ReadWriteEnd);
+  NewReadWriteEnd =
+      Builder.CreateSelect(IsReadOnly, ReadWriteEnd, NewReadWriteEnd);
+  K->addIncoming(Builder.CreateAdd(K, One, "k.next"), SweepNextBB);
+  AnyEnd->addIncoming(NewAnyEnd, SweepNextBB);
+  ReadWriteEnd->addIncoming(NewReadWriteEnd, SweepNextBB);
+  Builder.CreateBr(SweepHeaderBB);
+
+  Builder.SetInsertPoint(OverlapBB);
+  Builder.CreateRet(Builder.getFalse());
+
+  Builder.SetInsertPoint(NoOverlapBB);
+  Builder.CreateRet(Builder.getTrue());
+
+  return F;
+}
+
+Value *polly::createSortedNoOverlapCheck(PollyIRBuilder &Builder,
+                                         ArrayRef<Value *> Min,
+                                         ArrayRef<Value *> Max,
+                                         ArrayRef<bool> ReadOnly) {
+  assert(Min.size() == Max.size() && Min.size() == ReadOnly.size() &&
+         "Expected a start, an end and a flag for each range");
+  assert(!Min.empty() && "Expected at least one range");
+
+  Function *F = Builder.GetInsertBlock()->getParent();
+  Module *M = F->getParent();
+  Type *IntPtrTy = Min[0]->getType();
+  Type *Int8Ty = Builder.getInt8Ty();
+  unsigned NumRanges = Min.size();
+
+  // We do not want to allocate the arrays inside any loop, thus we allocate
+  // them in the entry block of the function.
+  Instruction *IP = F->getEntryBlock().getFirstInsertionPt();
+  Value *Size = Builder.getInt32(NumRanges);
+  Value *MinArr = new AllocaInst(IntPtrTy, Size, "polly.rtc.min", IP);
+  Value *MaxArr = new AllocaInst(IntPtrTy, Size, "polly.rtc.max", IP);
+  Value *ReadOnlyArr = new AllocaInst(Int8Ty, Size, "polly.rtc.ro", IP);
+
+  for (unsigned i = 0; i < NumRanges; i++) {
+    Value *Idx = Builder.getInt32(i);
+    Builder.CreateStore(Min[i], Builder.CreateGEP(MinArr, Idx));
+    Builder.CreateStore(Max[i], Builder.CreateGEP(MaxArr, Idx));
+    Builder.CreateStore(Builder.getInt8(ReadOnly[i]),
+                        Builder.CreateGEP(ReadOnlyArr, Idx));
+  }
+
+  Function *CheckFn = getSortedNoOverlapFunction(M, IntPtrTy);
+  Value *Args[] = {MinArr, MaxArr, ReadOnlyArr,
+                   ConstantInt::get(IntPtrTy, NumRanges)};
+  return Builder.CreateCall(CheckFn, Args, "polly.rtc.no_overlap");
+}
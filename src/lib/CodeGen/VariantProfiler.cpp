@@ -0,0 +1,184 @@
+//===- VariantProfiler.cpp - Profile the variants of a SCoP ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Select and profile the alternative transformations compiled into a SCoP.
+//
+// The variant of an execution is taken from a per-SCoP counter that is
+// incremented atomically, such that executions of the SCoP from several threads
+// still cycle through all variants. Each execution calls a function private to
+// the SCoP that prints its record. The profile file is opened on the first
+// record and shared by all SCoPs of the module.
+//
+//===----------------------------------------------------------------------===//
+
+#include "polly/CodeGen/VariantProfiler.h"
+#include "polly/CodeGen/IslExprBuilder.h"
+#include "polly/ScopInfo.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "isl/ast.h"
+#include "isl/space.h"
+
+using namespace llvm;
+using namespace polly;
+
+bool VariantProfiler::isEnabled(Scop &S) {
+  return S.VariantSelector != nullptr;
+}
+
+/// @brief Return the current value of the cycle counter.
+static Value *createReadCycleCounter(PollyIRBuilder &Builder) {
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  Function *F = Intrinsic::getDeclaration(M, Intrinsic::readcyclecounter);
+  return Builder.CreateCall(F, {}, "polly.variant.cycles");
+}
+
+/// @brief Escape @p Str for use in a JSON string.
+static std::string escape(StringRef Str) {
+  std::string Escaped;
+
+  for (char C : Str) {
+    if (C == '"' || C == '\\')
+      Escaped += '\\';
+    Escaped += C;
+  }
+  return Escaped;
+}
+
+Value *VariantProfiler::start() {
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  Type *Int64Ty = Builder.getInt64Ty();
+
+  GlobalVariable *Counter =
+      new GlobalVariable(*M, Int64Ty, false, GlobalValue::InternalLinkage,
+                         Builder.getInt64(0), "polly.variant.counter");
+  Value *Count = Builder.CreateAtomicRMW(AtomicRMWInst::Add, Counter,
+                                         Builder.getInt64(1),
+                                         AtomicOrdering::Monotonic);
+  Variant = Builder.CreateURem(
+      Count, Builder.getInt64(S.VariantNames.size()), "polly.variant");
+  StartCycles = createReadCycleCounter(Builder);
+  return Variant;
+}
+
+void VariantProfiler::stop(IslExprBuilder &ExprBuilder) {
+  Function *Record = createRecordFunction();
+  Value *EndCycles = createReadCycleCounter(Builder);
+  std::vector<Value *> Args = {Variant,
+                               Builder.CreateSub(EndCycles, StartCycles)};
+
+  isl_space *Space = S.getParamSpace();
+  for (unsigned i = 0; i < isl_space_dim(Space, isl_dim_param); ++i) {
+    isl_id *Id = isl_space_get_dim_id(Space, isl_dim_param, i);
+    Value *V = ExprBuilder.create(isl_ast_expr_from_id(Id));
+    Args.push_back(Builder.CreateSExtOrTrunc(V, Builder.getInt64Ty()));
+  }
+  isl_space_free(Space);
+
+  Builder.CreateCall(Record, Args);
+}
+
+Function *VariantProfiler::createRecordFunction() {
+  Function *ScopF = Builder.GetInsertBlock()->getParent();
+  Module *M = ScopF->getParent();
+  LLVMContext &Context = M->getContext();
+  PointerType *Int8PtrTy = Builder.getInt8PtrTy();
+  Type *Int32Ty = Builder.getInt32Ty();
+
+  GlobalVariable *File = M->getNamedGlobal("polly.variant.file");
+  if (!File)
+    File = new GlobalVariable(*M, Int8PtrTy, false,
+                              GlobalValue::InternalLinkage,
+                              ConstantPointerNull::get(Int8PtrTy),
+                              "polly.variant.file");
+
+  // The FILE type is not known here, so the file is passed around as an i8*.
+  Constant *GetEnv = M->getOrInsertFunction("getenv", Int8PtrTy, Int8PtrTy,
+                                            nullptr);
+  Constant *FOpen = M->getOrInsertFunction("fopen", Int8PtrTy, Int8PtrTy,
+                                           Int8PtrTy, nullptr);
+  Constant *FPrintF = M->getOrInsertFunction(
+      "fprintf", FunctionType::get(Int32Ty, {Int8PtrTy, Int8PtrTy}, true));
+
+  // The record function takes the variant, the cycles and the values of the
+  // parameters of the SCoP.
+  isl_space *Space = S.getParamSpace();
+  unsigned NumParams = isl_space_dim(Space, isl_dim_param);
+  std::vector<Type *> ArgTypes(NumParams + 2, Builder.getInt64Ty());
+  Function *F = Function::Create(
+      FunctionType::get(Builder.getVoidTy(), ArgTypes, false),
+      Function::InternalLinkage, "polly.variant.record", M);
+  std::vector<Value *> Args;
+  for (Argument &Arg : F->args())
+    Args.push_back(&Arg);
+
+  BasicBlock *EntryBB = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *OpenBB = BasicBlock::Create(Context, "open", F);
+  BasicBlock *PrintBB = BasicBlock::Create(Context, "print", F);
+  BasicBlock *ExitBB = BasicBlock::Create(Context, "exit", F);
+  IRBuilder<> RecordBuilder(EntryBB);
+
+  Value *OpenFile = RecordBuilder.CreateLoad(File);
+  RecordBuilder.CreateCondBr(RecordBuilder.CreateIsNull(OpenFile), OpenBB,
+                             PrintBB);
+
+  RecordBuilder.SetInsertPoint(OpenBB);
+  Value *Name = RecordBuilder.CreateCall(
+      GetEnv,
+      RecordBuilder.CreateGlobalStringPtr("POLLY_VARIANT_PROFILE_FILE"));
+  Name = RecordBuilder.CreateSelect(
+      RecordBuilder.CreateIsNotNull(Name), Name,
+      RecordBuilder.CreateGlobalStringPtr("polly-variants.jsonl"));
+  Value *NewFile = RecordBuilder.CreateCall(
+      FOpen, {Name, RecordBuilder.CreateGlobalStringPtr("a")});
+  RecordBuilder.CreateStore(NewFile, File);
+  RecordBuilder.CreateCondBr(RecordBuilder.CreateIsNotNull(NewFile), PrintBB,
+                             ExitBB);
+
+  RecordBuilder.SetInsertPoint(PrintBB);
+  PHINode *FileV = RecordBuilder.CreatePHI(Int8PtrTy, 2);
+  FileV->addIncoming(OpenFile, EntryBB);
+  FileV->addIncoming(NewFile, OpenBB);
+
+  Value *VariantName = RecordBuilder.CreateGlobalStringPtr(
+      escape(S.VariantNames[0]));
+  for (unsigned i = 1; i < S.VariantNames.size(); ++i)
+    VariantName = RecordBuilder.CreateSelect(
+        RecordBuilder.CreateICmpEQ(Args[0], RecordBuilder.getInt64(i)),
+        RecordBuilder.CreateGlobalStringPtr(escape(S.VariantNames[i])),
+        VariantName);
+
+  // The names are printed as arguments of the format, such that they are
+  // copied verbatim.
+  std::string Format = "{\"function\": \"%s\", \"region\": \"%s\", "
+                       "\"variant\": \"%s\", \"params\": {";
+  std::vector<Value *> PrintArgs = {
+      FileV, nullptr,
+      RecordBuilder.CreateGlobalStringPtr(escape(ScopF->getName())),
+      RecordBuilder.CreateGlobalStringPtr(escape(S.getNameStr())),
+      VariantName};
+  for (unsigned i = 0; i < NumParams; ++i) {
+    Format += i ? ", \"%s\": %lld" : "\"%s\": %lld";
+    PrintArgs.push_back(RecordBuilder.CreateGlobalStringPtr(
+        escape(isl_space_get_dim_name(Space, isl_dim_param, i))));
+    PrintArgs.push_back(Args[i + 2]);
+  }
+  Format += "}, \"cycles\": %llu}\n";
+  PrintArgs.push_back(Args[1]);
+  PrintArgs[1] = RecordBuilder.CreateGlobalStringPtr(Format);
+  isl_space_free(Space);
+
+  RecordBuilder.CreateCall(FPrintF, PrintArgs);
+  RecordBuilder.CreateBr(ExitBB);
+
+  RecordBuilder.SetInsertPoint(ExitBB);
+  RecordBuilder.CreateRetVoid();
+
+  return F;
+}
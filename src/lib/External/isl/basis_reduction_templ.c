@@ -15,6 +15,7 @@
 #include <isl_map_private.h>
 #include <isl_vec_private.h>
 #include <isl_options_private.h>
+#include <isl_thread.h>
 #include "isl_basis_reduction.h"
 
 static void save_alpha(GBR_LP *lp, int first, int n, GBR_type *alpha)
@@ -131,7 +132,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 	i = tab->n_zero;
 
 	GBR_lp_set_obj(lp, B->row[1+i]+1, dim);
-	ctx->stats->gbr_solved_lps++;
+	ISL_ATOMIC_INC(ctx, ctx->stats->gbr_solved_lps);
 	if (GBR_lp_solve(lp) < 0)
 		goto error;
 	GBR_lp_get_obj_val(lp, &F[i]);
@@ -149,7 +150,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 	do {
 		if (i+1 == tab->n_zero) {
 			GBR_lp_set_obj(lp, B->row[1+i+1]+1, dim);
-			ctx->stats->gbr_solved_lps++;
+			ISL_ATOMIC_INC(ctx, ctx->stats->gbr_solved_lps);
 			if (GBR_lp_solve(lp) < 0)
 				goto error;
 			GBR_lp_get_obj_val(lp, &F_new);
@@ -164,7 +165,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 		} else {
 			row = GBR_lp_add_row(lp, B->row[1+i]+1, dim);
 			GBR_lp_set_obj(lp, B->row[1+i+1]+1, dim);
-			ctx->stats->gbr_solved_lps++;
+			ISL_ATOMIC_INC(ctx, ctx->stats->gbr_solved_lps);
 			if (GBR_lp_solve(lp) < 0)
 				goto error;
 			GBR_lp_get_obj_val(lp, &F_new);
@@ -194,7 +195,7 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 						ctx->one, B->row[1+i+1]+1,
 						tmp, B->row[1+i]+1, dim);
 				GBR_lp_set_obj(lp, b_tmp->el, dim);
-				ctx->stats->gbr_solved_lps++;
+				ISL_ATOMIC_INC(ctx, ctx->stats->gbr_solved_lps);
 				if (GBR_lp_solve(lp) < 0)
 					goto error;
 				GBR_lp_get_obj_val(lp, &mu_F[j]);
@@ -167,6 +167,11 @@ void isl_ctx_set_max_operations(isl_ctx *ctx, unsigned long max_operations);
 unsigned long isl_ctx_get_max_operations(isl_ctx *ctx);
 void isl_ctx_reset_operations(isl_ctx *ctx);
 
+void isl_ctx_set_max_memory(isl_ctx *ctx, size_t max_memory);
+size_t isl_ctx_get_max_memory(isl_ctx *ctx);
+void isl_ctx_reset_memory(isl_ctx *ctx);
+size_t isl_ctx_get_peak_memory(isl_ctx *ctx);
+
 #define ISL_ARG_CTX_DECL(prefix,st,args)				\
 st *isl_ctx_peek_ ## prefix(isl_ctx *ctx);
 
@@ -530,6 +530,16 @@ isl_bool isl_map_is_equal(__isl_keep isl_map *map1, __isl_keep isl_map *map2);
 __isl_export
 isl_bool isl_map_is_disjoint(__isl_keep isl_map *map1,
 	__isl_keep isl_map *map2);
+
+struct isl_map_feasibility;
+typedef struct isl_map_feasibility isl_map_feasibility;
+__isl_give isl_map_feasibility *isl_map_feasibility_alloc(
+	__isl_take isl_map *map);
+__isl_null isl_map_feasibility *isl_map_feasibility_free(
+	__isl_take isl_map_feasibility *f);
+isl_ctx *isl_map_feasibility_get_ctx(__isl_keep isl_map_feasibility *f);
+isl_bool isl_map_feasibility_is_disjoint(__isl_keep isl_map_feasibility *f,
+	__isl_keep isl_basic_map *bmap);
 isl_bool isl_basic_map_is_single_valued(__isl_keep isl_basic_map *bmap);
 isl_bool isl_map_plain_is_single_valued(__isl_keep isl_map *map);
 __isl_export
@@ -43,6 +43,21 @@ int isl_options_get_schedule_algorithm(isl_ctx *ctx);
 isl_stat isl_options_set_coalesce_bounded_wrapping(isl_ctx *ctx, int val);
 int isl_options_get_coalesce_bounded_wrapping(isl_ctx *ctx);
 
+isl_stat isl_options_set_slab_alloc(isl_ctx *ctx, int val);
+int isl_options_get_slab_alloc(isl_ctx *ctx);
+
+isl_stat isl_options_set_print_stats(isl_ctx *ctx, int val);
+int isl_options_get_print_stats(isl_ctx *ctx);
+
+isl_stat isl_options_set_memo_max_entries(isl_ctx *ctx, int val);
+int isl_options_get_memo_max_entries(isl_ctx *ctx);
+
+isl_stat isl_options_set_trace_file(isl_ctx *ctx, const char *val);
+const char *isl_options_get_trace_file(isl_ctx *ctx);
+
+isl_stat isl_options_set_union_map_threads(isl_ctx *ctx, int val);
+int isl_options_get_union_map_threads(isl_ctx *ctx);
+
 #if defined(__cplusplus)
 }
 #endif
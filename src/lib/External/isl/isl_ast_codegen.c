@@ -24,6 +24,7 @@
 #include <isl_ast_build_expr.h>
 #include <isl_ast_build_private.h>
 #include <isl_ast_graft_private.h>
+#include <isl_trace.h>
 
 /* Data used in generate_domain.
  *
@@ -4890,7 +4891,7 @@ error:
  * the schedule domain in the domain and the elements to be executed
  * in the range) called "executed".
  */
-__isl_give isl_ast_node *isl_ast_build_node_from_schedule_map(
+static __isl_give isl_ast_node *build_node_from_schedule_map(
 	__isl_keep isl_ast_build *build, __isl_take isl_union_map *schedule)
 {
 	isl_ast_graft_list *list;
@@ -4909,6 +4910,43 @@ __isl_give isl_ast_node *isl_ast_build_node_from_schedule_map(
 	return node;
 }
 
+/* Generate an AST that visits the elements in the domain of "schedule"
+ * in the relative order specified by the corresponding image element(s),
+ * as described in build_node_from_schedule_map.
+ *
+ * The call is recorded in the trace of the ctx with as arguments
+ * the domain and the options of "build" and the schedule and
+ * with as result the generated AST printed in C format.
+ * Any callbacks set on "build" are not recorded.
+ */
+__isl_give isl_ast_node *isl_ast_build_node_from_schedule_map(
+	__isl_keep isl_ast_build *build, __isl_take isl_union_map *schedule)
+{
+	isl_ctx *ctx;
+	isl_ast_node *node;
+	struct isl_trace_call call;
+
+	if (!build || !schedule)
+		goto error;
+
+	ctx = isl_ast_build_get_ctx(build);
+	isl_trace_enter(ctx, &call, "ast_build_node_from_schedule_map");
+	if (call.op) {
+		isl_trace_add_arg(&call, isl_set_to_str(build->domain));
+		isl_trace_add_arg(&call, isl_union_map_to_str(build->options));
+		isl_trace_add_arg(&call, isl_union_map_to_str(schedule));
+	}
+	node = build_node_from_schedule_map(build, schedule);
+	if (call.op)
+		isl_trace_add_res(&call, isl_trace_ast_node_to_str(node));
+	isl_trace_leave(ctx, &call);
+
+	return node;
+error:
+	isl_union_map_free(schedule);
+	return NULL;
+}
+
 /* The old name for isl_ast_build_node_from_schedule_map.
  * It is being kept for backward compatibility, but
  * it will be removed in the future.
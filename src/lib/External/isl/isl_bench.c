@@ -0,0 +1,259 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+/* Microbenchmarks for the integer row kernels that dominate the time
+ * spent in the tableau and in Fourier-Motzkin elimination.
+ *
+ * Each benchmark prints its name and the number of seconds it took.
+ * The optional first argument is the number of repetitions.
+ * The results of isl_seq_combine are checked against a reference
+ * implementation that combines the rows one element at a time.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <isl_ctx_private.h>
+#include <isl_int.h>
+#include <isl_seq.h>
+#include <isl/set.h>
+
+#define ROW_LEN	32
+#define N_ROWS	64
+
+static void report(const char *name, clock_t start)
+{
+	printf("%s: %.3f\n", name, (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
+/* Fill "row" with small pseudo-random values, occasionally
+ * mixing in a value that does not fit in 32 bits.
+ */
+static void fill_row(isl_int *row, unsigned len, unsigned seed, int big)
+{
+	int i;
+
+	for (i = 0; i < len; ++i) {
+		seed = seed * 1103515245 + 12345;
+		isl_int_set_si(row[i], (int) ((seed >> 16) % 2001) - 1000);
+		if (big && i % 7 == 0)
+			isl_int_mul_ui(row[i], row[i], 1u << 31);
+	}
+}
+
+static void combine_ref(isl_int *dst, isl_int m1, isl_int *src1,
+	isl_int m2, isl_int *src2, unsigned len)
+{
+	int i;
+	isl_int tmp;
+
+	isl_int_init(tmp);
+	for (i = 0; i < len; ++i) {
+		isl_int_mul(tmp, m1, src1[i]);
+		isl_int_addmul(tmp, m2, src2[i]);
+		isl_int_set(dst[i], tmp);
+	}
+	isl_int_clear(tmp);
+}
+
+static isl_int *rows_alloc(isl_ctx *ctx, int big)
+{
+	int i;
+	isl_int *rows;
+
+	rows = isl_alloc_array(ctx, isl_int, N_ROWS * ROW_LEN);
+	for (i = 0; i < N_ROWS * ROW_LEN; ++i)
+		isl_int_init(rows[i]);
+	for (i = 0; i < N_ROWS; ++i)
+		fill_row(rows + i * ROW_LEN, ROW_LEN, i + 1, big);
+	return rows;
+}
+
+static void rows_free(isl_ctx *ctx, isl_int *rows)
+{
+	int i;
+
+	for (i = 0; i < N_ROWS * ROW_LEN; ++i)
+		isl_int_clear(rows[i]);
+	free(rows);
+}
+
+/* Repeatedly eliminate the first element of each row using the row before,
+ * keeping the rows small by dividing out their gcd, as isl_tab_pivot does.
+ */
+static void bench_combine(isl_ctx *ctx, int reps, int big)
+{
+	int r, i;
+	isl_int *rows, *ref;
+	isl_int m1, m2, g;
+	clock_t start;
+
+	rows = rows_alloc(ctx, big);
+	ref = isl_alloc_array(ctx, isl_int, ROW_LEN);
+	for (i = 0; i < ROW_LEN; ++i)
+		isl_int_init(ref[i]);
+	isl_int_init(m1);
+	isl_int_init(m2);
+	isl_int_init(g);
+
+	start = clock();
+	for (r = 0; r < reps; ++r) {
+		for (i = 1; i < N_ROWS; ++i) {
+			isl_int *src = rows + (i - 1) * ROW_LEN;
+			isl_int *dst = rows + i * ROW_LEN;
+
+			isl_int_set(m1, src[0]);
+			isl_int_neg(m2, dst[0]);
+			if (isl_int_is_zero(m1))
+				isl_int_set_si(m1, 1);
+			if (r == 0)
+				combine_ref(ref, m1, dst, m2, src, ROW_LEN);
+			isl_seq_combine(dst, m1, dst, m2, src, ROW_LEN);
+			if (r == 0)
+				assert(isl_seq_eq(dst, ref, ROW_LEN));
+			isl_seq_gcd(dst, ROW_LEN, &g);
+			if (!isl_int_is_zero(g) && !isl_int_is_one(g))
+				isl_seq_scale_down(dst, dst, g, ROW_LEN);
+			if (isl_int_is_zero(dst[0]))
+				fill_row(dst, ROW_LEN, r * N_ROWS + i, big);
+		}
+	}
+	report(big ? "combine (mixed)" : "combine (small)", start);
+
+	isl_int_clear(g);
+	isl_int_clear(m2);
+	isl_int_clear(m1);
+	for (i = 0; i < ROW_LEN; ++i)
+		isl_int_clear(ref[i]);
+	free(ref);
+	rows_free(ctx, rows);
+}
+
+static void bench_gcd(isl_ctx *ctx, int reps)
+{
+	int r, i;
+	isl_int *rows;
+	isl_int g;
+	clock_t start;
+
+	rows = rows_alloc(ctx, 0);
+	isl_int_init(g);
+	for (i = 0; i < N_ROWS * ROW_LEN; ++i)
+		isl_int_mul_ui(rows[i], rows[i], 6);
+
+	start = clock();
+	for (r = 0; r < 10 * reps; ++r)
+		for (i = 0; i < N_ROWS; ++i) {
+			isl_seq_gcd(rows + i * ROW_LEN, ROW_LEN, &g);
+			assert(isl_int_is_divisible_by(rows[i * ROW_LEN], g));
+		}
+	report("gcd", start);
+
+	isl_int_clear(g);
+	rows_free(ctx, rows);
+}
+
+/* Pivoting in the tableau: lexicographic optimization over a polytope
+ * with many facets.
+ */
+static void bench_lexmin(isl_ctx *ctx, int reps)
+{
+	int r;
+	isl_set *set;
+	clock_t start;
+
+	set = isl_set_read_from_str(ctx,
+		"[N] -> { [i, j, k] : 0 <= i < N and 0 <= j <= i and "
+		"0 <= k <= j and 3i + 5j - 7k <= 2N and "
+		"2i - 3j + 11k >= -N and i + j + k >= 5 and "
+		"13i - 17j + 19k <= 4N + 3 }");
+
+	start = clock();
+	for (r = 0; r < reps; ++r) {
+		isl_set_free(isl_set_lexmin(isl_set_copy(set)));
+		isl_set_free(isl_set_lexmax(isl_set_copy(set)));
+	}
+	report("lexmin", start);
+
+	isl_set_free(set);
+}
+
+/* Fourier-Motzkin elimination of the inner dimensions.
+ */
+static void bench_project(isl_ctx *ctx, int reps)
+{
+	int r;
+	isl_basic_set *bset;
+	clock_t start;
+
+	bset = isl_basic_set_read_from_str(ctx,
+		"[N, M] -> { [i, j, k, l] : 0 <= i <= N and 0 <= j <= M and "
+		"i <= k <= i + j and j <= l <= k + 3 and "
+		"2i + 3j - 5k + 7l <= 4N and 3i - 2j + k - l >= -M and "
+		"i - j + 2k - 3l <= N + M and 5i + j - k + 2l >= 1 }");
+
+	start = clock();
+	for (r = 0; r < reps; ++r) {
+		isl_basic_set *proj;
+		proj = isl_basic_set_project_out(isl_basic_set_copy(bset),
+						isl_dim_set, 1, 3);
+		isl_basic_set_free(proj);
+	}
+	report("project", start);
+
+	isl_basic_set_free(bset);
+}
+
+/* Coalescing of a union of many pieces at different constant schedule
+ * positions, as produced by index set splitting, where only
+ * the pieces at consecutive positions can be fused.
+ */
+static void bench_coalesce(isl_ctx *ctx, int reps)
+{
+	int r, k;
+	isl_set *set;
+	clock_t start;
+
+	set = NULL;
+	for (k = 0; k < 200; ++k) {
+		isl_set *piece;
+		char buf[100];
+
+		snprintf(buf, sizeof(buf),
+			"[N] -> { [%d, i, %d] : 0 <= i < N }", 3 * (k / 2) + k % 2,
+			k % 3);
+		piece = isl_set_read_from_str(ctx, buf);
+		set = set ? isl_set_union(set, piece) : piece;
+	}
+
+	start = clock();
+	for (r = 0; r < reps / 200 + 1; ++r)
+		isl_set_free(isl_set_coalesce(isl_set_copy(set)));
+	report("coalesce", start);
+
+	isl_set_free(set);
+}
+
+int main(int argc, char **argv)
+{
+	int reps = 1000;
+	isl_ctx *ctx;
+
+	if (argc > 1)
+		reps = atoi(argv[1]);
+	if (reps <= 0)
+		reps = 1;
+
+	ctx = isl_ctx_alloc();
+	bench_combine(ctx, reps, 0);
+	bench_combine(ctx, reps, 1);
+	bench_gcd(ctx, reps);
+	bench_lexmin(ctx, reps);
+	bench_project(ctx, reps);
+	bench_coalesce(ctx, reps);
+	isl_ctx_free(ctx);
+
+	return 0;
+}
@@ -0,0 +1,623 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+/* Benchmark the operations that the polyhedral loop optimizers built
+ * on top of isl rely on, on a corpus of kernels.
+ *
+ * Each kernel is described by a YAML mapping in a file with the keys
+ *
+ *	context		the constraints on the parameters (optional)
+ *	domain		the iteration domains of the statements
+ *	schedule	the original schedule
+ *	reads		the read accesses
+ *	writes		the write accesses
+ *	transform	the schedule after transformation (optional)
+ *
+ * The kernel is named after the file, without directory and extension.
+ * The kernels in bench_inputs were taken from the PolyBench SCoPs,
+ * with the transformations of the corresponding loop transformation
+ * scripts.
+ *
+ * For each kernel and operation, the number of operations per second
+ * and the peak memory used by a single operation, as sampled
+ * by the isl_ctx, are printed
+ * in JSON format.  The output can be used as a baseline for
+ * a later run, in which case the program exits with a non-zero status
+ * if any operation has become slower than the baseline by more than
+ * the given tolerance.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <isl/options.h>
+#include <isl/obj.h>
+#include <isl/stream.h>
+#include <isl/set.h>
+#include <isl/map.h>
+#include <isl/union_set.h>
+#include <isl/union_map.h>
+#include <isl/flow.h>
+#include <isl/ast_build.h>
+
+struct bench_options {
+	struct isl_options	*isl;
+	int			 repeat;
+	char			*baseline;
+	int			 tolerance;
+};
+
+ISL_ARGS_START(struct bench_options, bench_options_args)
+ISL_ARG_CHILD(struct bench_options, isl, "isl", &isl_options_args,
+	"isl options")
+ISL_ARG_INT(struct bench_options, repeat, 0, "repeat", "n", 100,
+	"perform each operation <n> times")
+ISL_ARG_STR(struct bench_options, baseline, 0, "baseline", "file", NULL,
+	"compare the results to those in <file>")
+ISL_ARG_INT(struct bench_options, tolerance, 0, "tolerance", "percent", 10,
+	"allowed slowdown with respect to the baseline")
+ISL_ARGS_END
+
+ISL_ARG_DEF(bench_options, struct bench_options, bench_options_args)
+
+/* A kernel read from the corpus.
+ *
+ * The sets and maps are kept in textual form such that
+ * every operation can be performed on freshly constructed inputs.
+ * "transform" is NULL if the kernel does not specify
+ * a transformed schedule, in which case "schedule" is used instead.
+ */
+struct bench_kernel {
+	char	*name;
+	char	*context;
+	char	*domain;
+	char	*schedule;
+	char	*reads;
+	char	*writes;
+	char	*transform;
+};
+
+/* The measurements of the repeated execution of an operation.
+ *
+ * "time" is the total time spent in the operation and
+ * "peak_memory" is the largest peak memory usage of a single execution.
+ * "start" is the time at which the current execution started.
+ */
+struct bench_run {
+	isl_ctx	*ctx;
+	clock_t	 start;
+	clock_t	 time;
+	size_t	 peak_memory;
+};
+
+static void run_start(struct bench_run *run)
+{
+	isl_ctx_reset_memory(run->ctx);
+	run->start = clock();
+}
+
+static void run_stop(struct bench_run *run)
+{
+	size_t peak;
+
+	run->time += clock() - run->start;
+	peak = isl_ctx_get_peak_memory(run->ctx);
+	if (peak > run->peak_memory)
+		run->peak_memory = peak;
+}
+
+static void kernel_clear(struct bench_kernel *kernel)
+{
+	free(kernel->name);
+	free(kernel->context);
+	free(kernel->domain);
+	free(kernel->schedule);
+	free(kernel->reads);
+	free(kernel->writes);
+	free(kernel->transform);
+}
+
+/* Return the name of the kernel described by the file "filename",
+ * i.e., the file name without directory and extension.
+ */
+static char *kernel_name(const char *filename)
+{
+	const char *base, *ext;
+	char *name;
+
+	base = strrchr(filename, '/');
+	base = base ? base + 1 : filename;
+	ext = strrchr(base, '.');
+	if (!ext)
+		ext = base + strlen(base);
+	name = malloc(ext - base + 1);
+	if (!name)
+		return NULL;
+	memcpy(name, base, ext - base);
+	name[ext - base] = '\0';
+	return name;
+}
+
+/* Read a union set from "s" and return it in textual form.
+ */
+static char *read_union_set(isl_stream *s)
+{
+	struct isl_obj obj;
+	char *str;
+
+	obj = isl_stream_read_obj(s);
+	if (obj.v && obj.type == isl_obj_set) {
+		obj.type = isl_obj_union_set;
+		obj.v = isl_union_set_from_set(obj.v);
+	}
+	if (!obj.v || obj.type != isl_obj_union_set) {
+		if (obj.v)
+			obj.type->free(obj.v);
+		isl_die(isl_stream_get_ctx(s), isl_error_invalid,
+			"expecting set", return NULL);
+	}
+	str = isl_union_set_to_str(obj.v);
+	isl_union_set_free(obj.v);
+	return str;
+}
+
+/* Read a set from "s" and return it in textual form.
+ */
+static char *read_set(isl_stream *s)
+{
+	isl_set *set;
+	char *str;
+
+	set = isl_stream_read_set(s);
+	str = isl_set_to_str(set);
+	isl_set_free(set);
+	return str;
+}
+
+/* Read a union map from "s" and return it in textual form.
+ */
+static char *read_union_map(isl_stream *s)
+{
+	isl_union_map *umap;
+	char *str;
+
+	umap = isl_stream_read_union_map(s);
+	str = isl_union_map_to_str(umap);
+	isl_union_map_free(umap);
+	return str;
+}
+
+/* Read the value of the mapping key "key" from "s" into "kernel".
+ */
+static isl_stat read_value(isl_stream *s, const char *key,
+	struct bench_kernel *kernel)
+{
+	char **field;
+	char *(*read)(isl_stream *s) = &read_union_map;
+
+	if (!strcmp(key, "context")) {
+		field = &kernel->context;
+		read = &read_set;
+	} else if (!strcmp(key, "domain")) {
+		field = &kernel->domain;
+		read = &read_union_set;
+	} else if (!strcmp(key, "schedule"))
+		field = &kernel->schedule;
+	else if (!strcmp(key, "reads"))
+		field = &kernel->reads;
+	else if (!strcmp(key, "writes"))
+		field = &kernel->writes;
+	else if (!strcmp(key, "transform"))
+		field = &kernel->transform;
+	else
+		isl_die(isl_stream_get_ctx(s), isl_error_invalid,
+			"unknown key", return isl_stat_error);
+
+	if (*field)
+		isl_die(isl_stream_get_ctx(s), isl_error_invalid,
+			"duplicate key", return isl_stat_error);
+	*field = read(s);
+	return *field ? isl_stat_ok : isl_stat_error;
+}
+
+/* Read the kernel described by the file "filename" into "kernel".
+ * If no context is specified, then the parameters are unconstrained.
+ */
+static isl_stat read_kernel(isl_ctx *ctx, const char *filename,
+	struct bench_kernel *kernel)
+{
+	FILE *file;
+	isl_stream *s;
+	int more = 0;
+	isl_stat r = isl_stat_ok;
+
+	memset(kernel, 0, sizeof(*kernel));
+	kernel->name = kernel_name(filename);
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "unable to open %s\n", filename);
+		return isl_stat_error;
+	}
+	s = isl_stream_new_file(ctx, file);
+	if (!s || isl_stream_yaml_read_start_mapping(s) < 0)
+		r = isl_stat_error;
+	while (r >= 0 && (more = isl_stream_yaml_next(s)) > 0) {
+		struct isl_token *tok;
+		char *key;
+
+		tok = isl_stream_next_token(s);
+		if (!tok) {
+			isl_stream_error(s, NULL, "unexpected EOF");
+			r = isl_stat_error;
+			break;
+		}
+		key = isl_token_get_str(ctx, tok);
+		isl_token_free(tok);
+		if (!key || isl_stream_yaml_next(s) < 0)
+			r = isl_stat_error;
+		else
+			r = read_value(s, key, kernel);
+		free(key);
+	}
+	if (r >= 0 && (more < 0 || isl_stream_yaml_read_end_mapping(s) < 0))
+		r = isl_stat_error;
+	isl_stream_free(s);
+	fclose(file);
+
+	if (r >= 0 && (!kernel->domain || !kernel->schedule ||
+			!kernel->reads || !kernel->writes)) {
+		fprintf(stderr, "%s: missing domain, schedule, reads or writes\n",
+			filename);
+		r = isl_stat_error;
+	}
+	if (r >= 0 && !kernel->context)
+		kernel->context = strdup("{ : }");
+	if (r < 0 || !kernel->name || !kernel->context) {
+		kernel_clear(kernel);
+		return isl_stat_error;
+	}
+	return isl_stat_ok;
+}
+
+/* Return the transformed schedule of "kernel", restricted to its domain.
+ */
+static __isl_give isl_union_map *get_transform(isl_ctx *ctx,
+	struct bench_kernel *kernel)
+{
+	const char *str;
+	isl_union_map *transform;
+	isl_union_set *domain;
+
+	str = kernel->transform ? kernel->transform : kernel->schedule;
+	transform = isl_union_map_read_from_str(ctx, str);
+	domain = isl_union_set_read_from_str(ctx, kernel->domain);
+	return isl_union_map_intersect_domain(transform, domain);
+}
+
+/* Return the domain of "kernel" in the order of execution,
+ * i.e., the image of the domain under the transformed schedule,
+ * within the context.
+ */
+static __isl_give isl_union_set *get_scheduled_domain(isl_ctx *ctx,
+	struct bench_kernel *kernel)
+{
+	isl_union_set *domain;
+	isl_set *context;
+
+	domain = isl_union_map_range(get_transform(ctx, kernel));
+	context = isl_set_read_from_str(ctx, kernel->context);
+	return isl_union_set_intersect_params(domain, context);
+}
+
+/* Compose the write accesses of "kernel" with the inverse
+ * of the read accesses, i.e., compute the pairs of statement instances
+ * that access the same array elements.
+ */
+static isl_stat bench_apply(struct bench_run *run, struct bench_kernel *kernel)
+{
+	isl_union_map *reads, *writes, *res;
+
+	reads = isl_union_map_read_from_str(run->ctx, kernel->reads);
+	writes = isl_union_map_read_from_str(run->ctx, kernel->writes);
+	run_start(run);
+	res = isl_union_map_apply_range(writes, isl_union_map_reverse(reads));
+	run_stop(run);
+	if (!res)
+		return isl_stat_error;
+	isl_union_map_free(res);
+	return isl_stat_ok;
+}
+
+static isl_stat bench_coalesce(struct bench_run *run,
+	struct bench_kernel *kernel)
+{
+	isl_union_set *domain;
+
+	domain = get_scheduled_domain(run->ctx, kernel);
+	run_start(run);
+	domain = isl_union_set_coalesce(domain);
+	run_stop(run);
+	if (!domain)
+		return isl_stat_error;
+	isl_union_set_free(domain);
+	return isl_stat_ok;
+}
+
+static isl_stat bench_lexmin(struct bench_run *run,
+	struct bench_kernel *kernel)
+{
+	isl_union_set *domain;
+
+	domain = get_scheduled_domain(run->ctx, kernel);
+	run_start(run);
+	domain = isl_union_set_lexmin(domain);
+	run_stop(run);
+	if (!domain)
+		return isl_stat_error;
+	isl_union_set_free(domain);
+	return isl_stat_ok;
+}
+
+static isl_stat bench_lexmax(struct bench_run *run,
+	struct bench_kernel *kernel)
+{
+	isl_union_set *domain;
+
+	domain = get_scheduled_domain(run->ctx, kernel);
+	run_start(run);
+	domain = isl_union_set_lexmax(domain);
+	run_stop(run);
+	if (!domain)
+		return isl_stat_error;
+	isl_union_set_free(domain);
+	return isl_stat_ok;
+}
+
+static isl_stat bench_is_injective(struct bench_run *run,
+	struct bench_kernel *kernel)
+{
+	isl_union_map *transform;
+	isl_bool injective;
+
+	transform = get_transform(run->ctx, kernel);
+	run_start(run);
+	injective = isl_union_map_is_injective(transform);
+	run_stop(run);
+	isl_union_map_free(transform);
+	return injective < 0 ? isl_stat_error : isl_stat_ok;
+}
+
+static isl_stat bench_is_disjoint(struct bench_run *run,
+	struct bench_kernel *kernel)
+{
+	isl_union_map *reads, *writes;
+	isl_bool disjoint;
+
+	reads = isl_union_map_read_from_str(run->ctx, kernel->reads);
+	writes = isl_union_map_read_from_str(run->ctx, kernel->writes);
+	run_start(run);
+	disjoint = isl_union_map_is_disjoint(reads, writes);
+	run_stop(run);
+	isl_union_map_free(reads);
+	isl_union_map_free(writes);
+	return disjoint < 0 ? isl_stat_error : isl_stat_ok;
+}
+
+/* Compute the flow dependences of "kernel" with respect to
+ * its original schedule.
+ */
+static isl_stat bench_compute_flow(struct bench_run *run,
+	struct bench_kernel *kernel)
+{
+	isl_union_set *domain;
+	isl_union_map *reads, *writes, *schedule;
+	isl_union_access_info *access;
+	isl_union_flow *flow;
+
+	domain = isl_union_set_read_from_str(run->ctx, kernel->domain);
+	reads = isl_union_map_read_from_str(run->ctx, kernel->reads);
+	reads = isl_union_map_intersect_domain(reads,
+						isl_union_set_copy(domain));
+	writes = isl_union_map_read_from_str(run->ctx, kernel->writes);
+	writes = isl_union_map_intersect_domain(writes,
+						isl_union_set_copy(domain));
+	schedule = isl_union_map_read_from_str(run->ctx, kernel->schedule);
+	schedule = isl_union_map_intersect_domain(schedule, domain);
+	run_start(run);
+	access = isl_union_access_info_from_sink(reads);
+	access = isl_union_access_info_set_must_source(access, writes);
+	access = isl_union_access_info_set_schedule_map(access, schedule);
+	flow = isl_union_access_info_compute_flow(access);
+	run_stop(run);
+	if (!flow)
+		return isl_stat_error;
+	isl_union_flow_free(flow);
+	return isl_stat_ok;
+}
+
+/* Generate an AST for the transformed schedule of "kernel".
+ */
+static isl_stat bench_ast_build(struct bench_run *run,
+	struct bench_kernel *kernel)
+{
+	isl_set *context;
+	isl_union_map *transform;
+	isl_ast_build *build;
+	isl_ast_node *tree;
+
+	context = isl_set_read_from_str(run->ctx, kernel->context);
+	transform = get_transform(run->ctx, kernel);
+	run_start(run);
+	build = isl_ast_build_from_context(context);
+	tree = isl_ast_build_node_from_schedule_map(build, transform);
+	isl_ast_build_free(build);
+	run_stop(run);
+	if (!tree)
+		return isl_stat_error;
+	isl_ast_node_free(tree);
+	return isl_stat_ok;
+}
+
+static struct {
+	const char *name;
+	isl_stat (*fn)(struct bench_run *run, struct bench_kernel *kernel);
+} operations[] = {
+	{ "apply", &bench_apply },
+	{ "coalesce", &bench_coalesce },
+	{ "lexmin", &bench_lexmin },
+	{ "lexmax", &bench_lexmax },
+	{ "is_injective", &bench_is_injective },
+	{ "is_disjoint", &bench_is_disjoint },
+	{ "compute_flow", &bench_compute_flow },
+	{ "ast_build", &bench_ast_build },
+};
+
+/* A result read from a baseline.
+ */
+struct bench_result {
+	char	kernel[100];
+	char	operation[100];
+	double	ops_per_sec;
+	size_t	peak_memory;
+};
+
+/* Read the results in the baseline file "filename", in the format
+ * printed by print_result, into "results".
+ * Return the number of results or -1 on error.
+ */
+static int read_baseline(const char *filename, struct bench_result **results)
+{
+	FILE *file;
+	char line[1024];
+	int n = 0, size = 0;
+
+	*results = NULL;
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "unable to open %s\n", filename);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), file)) {
+		struct bench_result result;
+
+		if (sscanf(line, " { \"kernel\": \"%99[^\"]\", "
+				"\"operation\": \"%99[^\"]\", "
+				"\"ops_per_sec\": %lf, \"peak_memory\": %zu",
+				result.kernel, result.operation,
+				&result.ops_per_sec, &result.peak_memory) != 4)
+			continue;
+		if (n >= size) {
+			struct bench_result *grown;
+
+			size = 2 * size + 16;
+			grown = realloc(*results, size * sizeof(**results));
+			if (!grown) {
+				n = -1;
+				break;
+			}
+			*results = grown;
+		}
+		(*results)[n++] = result;
+	}
+	fclose(file);
+
+	return n;
+}
+
+/* Return the result for "operation" on "kernel" in the "n" results
+ * of the baseline or NULL if there is no such result.
+ */
+static struct bench_result *find_result(struct bench_result *baseline,
+	int n, const char *kernel, const char *operation)
+{
+	int i;
+
+	for (i = 0; i < n; ++i)
+		if (!strcmp(baseline[i].kernel, kernel) &&
+		    !strcmp(baseline[i].operation, operation))
+			return &baseline[i];
+	return NULL;
+}
+
+static void print_result(const char *kernel, const char *operation,
+	double ops_per_sec, size_t peak_memory, int first)
+{
+	printf("%s{ \"kernel\": \"%s\", \"operation\": \"%s\", "
+		"\"ops_per_sec\": %.1f, \"peak_memory\": %zu }",
+		first ? "" : ",\n", kernel, operation, ops_per_sec,
+		peak_memory);
+}
+
+/* Perform each operation on each kernel named on the command line,
+ * print the results and compare them to those of the baseline, if any.
+ *
+ * The memory usage of the isl_ctx is only tracked if it is bounded,
+ * so the bound is set to the largest possible value,
+ * unless it was set on the command line.
+ */
+int main(int argc, char **argv)
+{
+	int i, j, k;
+	int n_baseline = 0;
+	int first = 1;
+	int slower = 0;
+	struct bench_result *baseline = NULL;
+	struct bench_options *options;
+	isl_ctx *ctx;
+
+	options = bench_options_new_with_defaults();
+	argc = bench_options_parse(options, argc, argv, 0);
+	ctx = isl_ctx_alloc_with_options(&bench_options_args, options);
+	if (!isl_ctx_get_max_memory(ctx))
+		isl_ctx_set_max_memory(ctx, (size_t) -1);
+
+	if (options->baseline) {
+		n_baseline = read_baseline(options->baseline, &baseline);
+		if (n_baseline < 0)
+			return EXIT_FAILURE;
+	}
+
+	printf("[\n");
+	for (i = 1; i < argc; ++i) {
+		struct bench_kernel kernel;
+
+		if (read_kernel(ctx, argv[i], &kernel) < 0)
+			return EXIT_FAILURE;
+		for (j = 0; j < sizeof(operations) / sizeof(*operations); ++j) {
+			struct bench_run run = { ctx, 0, 0, 0 };
+			struct bench_result *base;
+			double sec, ops_per_sec;
+
+			for (k = 0; k < options->repeat; ++k)
+				if (operations[j].fn(&run, &kernel) < 0)
+					return EXIT_FAILURE;
+			sec = (double) run.time / CLOCKS_PER_SEC;
+			if (sec <= 0)
+				sec = 1.0 / CLOCKS_PER_SEC;
+			ops_per_sec = options->repeat / sec;
+			print_result(kernel.name, operations[j].name,
+				    ops_per_sec, run.peak_memory, first);
+			first = 0;
+
+			base = find_result(baseline, n_baseline, kernel.name,
+					    operations[j].name);
+			if (!base || ops_per_sec >= base->ops_per_sec *
+					(100 - options->tolerance) / 100)
+				continue;
+			fprintf(stderr, "%s %s: %.1f ops/sec, "
+				"baseline %.1f ops/sec\n",
+				kernel.name, operations[j].name,
+				ops_per_sec, base->ops_per_sec);
+			slower = 1;
+		}
+		kernel_clear(&kernel);
+	}
+	printf("\n]\n");
+
+	free(baseline);
+	isl_ctx_free(ctx);
+
+	return slower ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -77,7 +77,7 @@ struct isl_blk isl_blk_alloc(struct isl_ctx *ctx, size_t n)
 	struct isl_blk block;
 
 	block = isl_blk_empty();
-	if (n && ctx->n_cached) {
+	if (n && ctx->n_cached && !ctx->parallel) {
 		int best = 0;
 		for (i = 1; ctx->cache[best].size != n && i < ctx->n_cached; ++i) {
 			if (ctx->cache[best].size < n) {
@@ -118,7 +118,7 @@ void isl_blk_free(struct isl_ctx *ctx, struct isl_blk block)
 	if (isl_blk_is_empty(block) || isl_blk_is_error(block))
 		return;
 
-	if (ctx->n_cached < ISL_BLK_CACHE_SIZE)
+	if (!ctx->parallel && ctx->n_cached < ISL_BLK_CACHE_SIZE)
 		ctx->cache[ctx->n_cached++] = block;
 	else
 		isl_blk_free_force(ctx, block);
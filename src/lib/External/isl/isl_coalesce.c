@@ -16,7 +16,9 @@
  */
 
 #include "isl_map_private.h"
+#include <isl_memo.h>
 #include <isl_seq.h>
+#include <isl_trace.h>
 #include <isl/options.h>
 #include "isl_tab.h"
 #include <isl_mat_private.h>
@@ -165,6 +167,10 @@ static int all(int *con, unsigned len, int status)
  * the other basic map.  The number of elements in the "eq" array
  * is twice the number of equalities in the "bmap", corresponding
  * to the two inequalities that make up each equality.
+ *
+ * "box", "lo" and "hi" describe an integer bounding box of "bmap"
+ * that is used to quickly rule out pairs of basic maps that cannot
+ * be coalesced.  See coalesce_info_set_box.
  */
 struct isl_coalesce_info {
 	isl_basic_map *bmap;
@@ -174,8 +180,22 @@ struct isl_coalesce_info {
 	int simplify;
 	int *eq;
 	int *ineq;
+	int *box;
+	isl_vec *lo;
+	isl_vec *hi;
 };
 
+/* Flags in the "box" array of an isl_coalesce_info.
+ *
+ * ISL_BOX_LO: the variable has a constant lower bound, stored in "lo"
+ * ISL_BOX_HI: the variable has a constant upper bound, stored in "hi"
+ * ISL_BOX_MIXED: the variable appears in a constraint together with
+ *	some other variable
+ */
+#define ISL_BOX_LO	1
+#define ISL_BOX_HI	2
+#define ISL_BOX_MIXED	4
+
 /* Compute the hash of the (apparent) affine hull of info->bmap (with
  * the existentially quantified variables removed) and store it
  * in info->hash.
@@ -196,6 +216,157 @@ static int coalesce_info_set_hull_hash(struct isl_coalesce_info *info)
 	return hull ? 0 : -1;
 }
 
+static void clear_box(struct isl_coalesce_info *info)
+{
+	free(info->box);
+	info->box = NULL;
+	info->lo = isl_vec_free(info->lo);
+	info->hi = isl_vec_free(info->hi);
+}
+
+/* Update the bound on variable "pos" in "info" based on the constraint
+ * "c" of length "len", in which this variable has coefficient "c[pos]".
+ * The constraint is an equality if "eq" is set and an inequality otherwise.
+ * If any other variable appears in the constraint, then only mark
+ * the variable as being involved in a mixed constraint.
+ */
+static void update_box(struct isl_coalesce_info *info, isl_int *c,
+	unsigned len, int pos, int eq, isl_int t)
+{
+	int sgn;
+
+	if (isl_seq_first_non_zero(c + 1, pos - 1) != -1 ||
+	    isl_seq_first_non_zero(c + pos + 1, len - pos - 1) != -1) {
+		info->box[pos - 1] |= ISL_BOX_MIXED;
+		return;
+	}
+
+	sgn = isl_int_sgn(c[pos]);
+	if (eq || sgn > 0) {
+		/* a x + c >= 0 with a > 0: x >= ceil(-c/a) */
+		isl_int_neg(t, c[0]);
+		if (sgn < 0)
+			isl_int_neg(t, t);
+		isl_int_abs(info->lo->el[0], c[pos]);
+		isl_int_cdiv_q(t, t, info->lo->el[0]);
+		if (!(info->box[pos - 1] & ISL_BOX_LO) ||
+		    isl_int_gt(t, info->lo->el[pos]))
+			isl_int_set(info->lo->el[pos], t);
+		info->box[pos - 1] |= ISL_BOX_LO;
+	}
+	if (eq || sgn < 0) {
+		/* -a x + c >= 0 with a > 0: x <= floor(c/a) */
+		isl_int_set(t, c[0]);
+		if (sgn > 0)
+			isl_int_neg(t, t);
+		isl_int_abs(info->hi->el[0], c[pos]);
+		isl_int_fdiv_q(t, t, info->hi->el[0]);
+		if (!(info->box[pos - 1] & ISL_BOX_HI) ||
+		    isl_int_lt(t, info->hi->el[pos]))
+			isl_int_set(info->hi->el[pos], t);
+		info->box[pos - 1] |= ISL_BOX_HI;
+	}
+}
+
+/* Compute an integer bounding box of info->bmap.
+ *
+ * For each variable that is not existentially quantified,
+ * we only look at the constraints that involve this variable and
+ * no other variable (including the existentially quantified variables).
+ * The bounds are only used if the variable does not appear
+ * in any other constraint.  That is, if the basic map is the product
+ * of the interval described by the bounds and a set
+ * in the other variables.
+ * The first element of "lo" and "hi" is used as scratch space.
+ */
+static int coalesce_info_set_box(struct isl_coalesce_info *info)
+{
+	int i, pos;
+	unsigned total, dim;
+	isl_ctx *ctx;
+	isl_basic_map *bmap = info->bmap;
+	isl_int t;
+
+	clear_box(info);
+	if (!bmap)
+		return -1;
+
+	ctx = isl_basic_map_get_ctx(bmap);
+	total = isl_basic_map_total_dim(bmap);
+	dim = total - bmap->n_div;
+	info->box = isl_calloc_array(ctx, int, dim);
+	info->lo = isl_vec_alloc(ctx, 1 + dim);
+	info->hi = isl_vec_alloc(ctx, 1 + dim);
+	if ((dim && !info->box) || !info->lo || !info->hi)
+		return -1;
+
+	isl_int_init(t);
+	for (pos = 1; pos <= dim; ++pos) {
+		for (i = 0; i < bmap->n_eq; ++i)
+			if (!isl_int_is_zero(bmap->eq[i][pos]))
+				update_box(info, bmap->eq[i], 1 + total,
+					    pos, 1, t);
+		for (i = 0; i < bmap->n_ineq; ++i)
+			if (!isl_int_is_zero(bmap->ineq[i][pos]))
+				update_box(info, bmap->ineq[i], 1 + total,
+					    pos, 0, t);
+	}
+	isl_int_clear(t);
+
+	return 0;
+}
+
+/* Can we tell from the bounding boxes of "info1" and "info2"
+ * that the corresponding basic maps cannot be coalesced?
+ *
+ * This is the case if there is a variable that only appears
+ * in constraints on its own in both basic maps and the ranges
+ * of this variable in the two basic maps are separated by
+ * at least one integer value.  Any basic map containing both basic
+ * maps would then also have to contain some of the points
+ * in between, while none of the coalescing operations can introduce
+ * the strides needed to avoid them.
+ * In particular, adjacent ranges are not separated since the basic
+ * maps may then still be fused.
+ */
+static int boxes_separated(struct isl_coalesce_info *info1,
+	struct isl_coalesce_info *info2)
+{
+	int i;
+	unsigned dim;
+	isl_int gap;
+	int separated = 0;
+
+	if (!info1->box || !info2->box)
+		return 0;
+	if (info1->lo->size != info2->lo->size)
+		return 0;
+
+	dim = info1->lo->size - 1;
+	isl_int_init(gap);
+	for (i = 0; !separated && i < dim; ++i) {
+		if ((info1->box[i] | info2->box[i]) & ISL_BOX_MIXED)
+			continue;
+		if ((info1->box[i] & ISL_BOX_HI) &&
+		    (info2->box[i] & ISL_BOX_LO)) {
+			isl_int_sub(gap, info2->lo->el[1 + i],
+					info1->hi->el[1 + i]);
+			if (isl_int_cmp_si(gap, 1) > 0)
+				separated = 1;
+		}
+		if ((info2->box[i] & ISL_BOX_HI) &&
+		    (info1->box[i] & ISL_BOX_LO)) {
+			isl_int_sub(gap, info1->lo->el[1 + i],
+					info2->hi->el[1 + i]);
+			if (isl_int_cmp_si(gap, 1) > 0)
+				separated = 1;
+		}
+	}
+	isl_int_clear(gap);
+
+	return separated;
+}
+
 /* Free all the allocated memory in an array
  * of "n" isl_coalesce_info elements.
  */
@@ -209,6 +380,7 @@ static void clear_coalesce_info(int n, struct isl_coalesce_info *info)
 	for (i = 0; i < n; ++i) {
 		isl_basic_map_free(info[i].bmap);
 		isl_tab_free(info[i].tab);
+		clear_box(&info[i]);
 	}
 
 	free(info);
@@ -223,6 +395,7 @@ static void drop(struct isl_coalesce_info *info)
 	info->bmap = isl_basic_map_free(info->bmap);
 	isl_tab_free(info->tab);
 	info->tab = NULL;
+	clear_box(info);
 	info->removed = 1;
 }
 
@@ -2482,6 +2655,9 @@ static int isl_max(int a, int b)
  * If the two basic maps got fused, then we recheck the fused basic map
  * against the previously considered basic maps, starting at i + 1
  * (even if start2 is greater than i + 1).
+ * Pairs of basic maps with separated bounding boxes are skipped
+ * without performing any of the more expensive tests.
+ * After a fuse, the bounding box of the fused basic map is recomputed.
  */
 static int coalesce_range(isl_ctx *ctx, struct isl_coalesce_info *info,
 	int start1, int end1, int start2, int end2)
@@ -2500,6 +2676,8 @@ static int coalesce_range(isl_ctx *ctx, struct isl_coalesce_info *info,
 				isl_die(ctx, isl_error_internal,
 					"basic map unexpectedly removed",
 					return -1);
+			if (boxes_separated(&info[i], &info[j]))
+				continue;
 			changed = coalesce_pair(i, j, info);
 			switch (changed) {
 			case isl_change_error:
@@ -2511,6 +2689,8 @@ static int coalesce_range(isl_ctx *ctx, struct isl_coalesce_info *info,
 				j = end2;
 				break;
 			case isl_change_fuse:
+				if (coalesce_info_set_box(&info[i]) < 0)
+					return -1;
 				j = i;
 				break;
 			}
@@ -2608,7 +2788,7 @@ static __isl_give isl_map *update_basic_maps(__isl_take isl_map *map,
  * For each basic map, we also compute the hash of the apparent affine hull
  * for use in coalesce.
  */
-struct isl_map *isl_map_coalesce(struct isl_map *map)
+static __isl_give isl_map *map_coalesce(__isl_take isl_map *map)
 {
 	int i;
 	unsigned n;
@@ -2655,6 +2835,8 @@ struct isl_map *isl_map_coalesce(struct isl_map *map)
 				goto error;
 		if (coalesce_info_set_hull_hash(&info[i]) < 0)
 			goto error;
+		if (coalesce_info_set_box(&info[i]) < 0)
+			goto error;
 	}
 	for (i = map->n - 1; i >= 0; --i)
 		if (info[i].tab->empty)
@@ -2674,6 +2856,52 @@ error:
 	return NULL;
 }
 
+/* Coalesce "map", reusing the result of an earlier call
+ * on a structurally identical map if the memo table of the ctx is enabled.
+ */
+static __isl_give isl_map *memo_coalesce(__isl_take isl_map *map)
+{
+	isl_ctx *ctx;
+	isl_map *res, *key;
+
+	if (!isl_memo_is_enabled(map->ctx))
+		return map_coalesce(map);
+
+	ctx = isl_map_get_ctx(map);
+	res = isl_memo_find_map(ctx, isl_memo_coalesce, map);
+	if (res) {
+		isl_map_free(map);
+		return res;
+	}
+	key = isl_map_copy(map);
+	res = map_coalesce(map);
+	isl_memo_add_map(ctx, isl_memo_coalesce, key, res);
+	isl_map_free(key);
+	return res;
+}
+
+/* Coalesce "map", recording the call in the trace of the ctx
+ * if there is more than one basic map to coalesce.
+ */
+struct isl_map *isl_map_coalesce(struct isl_map *map)
+{
+	isl_ctx *ctx;
+	struct isl_trace_call call;
+
+	if (!map || map->n <= 1)
+		return map_coalesce(map);
+
+	ctx = isl_map_get_ctx(map);
+	isl_trace_enter(ctx, &call, "map_coalesce");
+	if (call.op)
+		isl_trace_add_arg(&call, isl_map_to_str(map));
+	map = memo_coalesce(map);
+	if (call.op)
+		isl_trace_add_res(&call, isl_map_to_str(map));
+	isl_trace_leave(ctx, &call);
+	return map;
+}
+
 /* For each pair of basic sets in the set, check if the union of the two
  * can be represented by a single basic set.
  * If so, replace the pair by the single basic set and start over.
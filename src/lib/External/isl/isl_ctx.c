@@ -10,10 +10,25 @@
 #include <isl_ctx_private.h>
 #include <isl/vec.h>
 #include <isl_options_private.h>
+#include <isl_memo.h>
+#include <isl_trace.h>
+#include <isl_thread.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+#define ISL_HAVE_MALLINFO2
+#endif
+#endif
 
 #define __isl_calloc(type,size)		((type *)calloc(1, size))
 #define __isl_calloc_type(type)		__isl_calloc(type,sizeof(type))
 
+/* The number of bytes that may be requested through an isl_ctx
+ * before its heap usage is sampled again.
+ */
+#define ISL_MEMORY_SAMPLE	(1 << 20)
+
 /* Check that the result of an allocation ("p") is not NULL and
  * complain if it is.
  * The only exception is when allocation size ("size") is equal to zero.
@@ -31,6 +46,8 @@ static void *check_non_null(isl_ctx *ctx, void *p, size_t size)
  *
  * In particular, we should stop if the user has explicitly aborted
  * the computation or if the maximal number of operations has been exceeded.
+ * Inside a parallel region, the maximal number of operations
+ * may be exceeded by the number of threads.
  */
 int isl_ctx_next_operation(isl_ctx *ctx)
 {
@@ -40,10 +57,111 @@ int isl_ctx_next_operation(isl_ctx *ctx)
 		isl_ctx_set_error(ctx, isl_error_abort);
 		return -1;
 	}
-	if (ctx->max_operations && ctx->operations >= ctx->max_operations)
+	if (ctx->max_operations &&
+	    ISL_ATOMIC_GET(ctx, ctx->operations) >= ctx->max_operations)
 		isl_die(ctx, isl_error_quota,
 			"maximal number of operations exceeded", return -1);
-	ctx->operations++;
+	ISL_ATOMIC_INC(ctx, ctx->operations);
+	return 0;
+}
+
+/* Return the number of bytes currently allocated from the heap.
+ * If the C library does not provide this information, then
+ * return the total number of bytes requested through "ctx" instead.
+ */
+static size_t heap_in_use(isl_ctx *ctx)
+{
+#if defined(ISL_HAVE_MALLINFO2)
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+	struct mallinfo info = mallinfo();
+	return (size_t) (unsigned) info.uordblks + (unsigned) info.hblkhd;
+#else
+	return ctx->memory_requested;
+#endif
+}
+
+/* Should the memory usage of "ctx" be tracked?
+ * This is the case if the memory usage is bounded or
+ * if statistics should be printed.
+ * Note that the options are not available yet while "ctx"
+ * itself is being constructed.
+ */
+static int memory_is_tracked(isl_ctx *ctx)
+{
+	return ctx->max_memory || (ctx->opt && ctx->opt->print_stats);
+}
+
+/* Sample the heap usage of "ctx", update the peak usage and
+ * return the current usage.
+ * The usage is measured with respect to the heap usage
+ * at the last call to isl_ctx_reset_memory.
+ */
+static size_t sample_memory(isl_ctx *ctx)
+{
+	size_t used;
+
+	used = heap_in_use(ctx);
+	used = used > ctx->memory_base ? used - ctx->memory_base : 0;
+	if (used > ctx->memory_peak)
+		ctx->memory_peak = used;
+	ctx->memory_pending = 0;
+
+	return used;
+}
+
+/* Prepare for allocating "size" bytes in the context.
+ * Return 0 if we are allowed to perform this allocation and
+ * return -1 if we should abort the computation.
+ *
+ * Besides counting the allocation as an operation, we also
+ * check that the memory usage does not exceed the bound.
+ * Since the heap usage may be expensive to determine, it is
+ * only sampled after ISL_MEMORY_SAMPLE bytes have been requested.
+ * Once the bound has been exceeded, all further allocations fail
+ * until the bound is changed or the memory usage is reset.
+ * Return 1 if the bound has been exceeded.
+ */
+static int track_allocation(isl_ctx *ctx, size_t size)
+{
+	size_t used;
+
+	if (ctx->memory_exceeded)
+		return 1;
+	ctx->memory_requested += size;
+	ctx->memory_pending += size;
+	if (ctx->memory_pending < ISL_MEMORY_SAMPLE)
+		return 0;
+	used = sample_memory(ctx);
+	if (ctx->max_memory && used + size > ctx->max_memory)
+		ctx->memory_exceeded = 1;
+	return ctx->memory_exceeded;
+}
+
+/* Prepare for allocating "size" bytes in the context.
+ * Return 0 if we are allowed to perform this allocation and
+ * return -1 if we should abort the computation.
+ *
+ * Besides counting the allocation as an operation, we also
+ * check that the memory usage does not exceed the bound, if any.
+ * The memory usage is shared by all threads of a parallel region,
+ * so it is tracked while holding the lock on "ctx".
+ */
+static int next_allocation(isl_ctx *ctx, size_t size)
+{
+	int exceeded;
+
+	if (isl_ctx_next_operation(ctx) < 0)
+		return -1;
+	if (!memory_is_tracked(ctx))
+		return 0;
+	isl_ctx_lock(ctx);
+	exceeded = track_allocation(ctx, size);
+	isl_ctx_unlock(ctx);
+	if (exceeded)
+		isl_die(ctx, isl_error_quota,
+			"maximal memory usage exceeded", return -1);
 	return 0;
 }
 
@@ -52,7 +170,7 @@ int isl_ctx_next_operation(isl_ctx *ctx)
  */
 void *isl_malloc_or_die(isl_ctx *ctx, size_t size)
 {
-	if (isl_ctx_next_operation(ctx) < 0)
+	if (next_allocation(ctx, size) < 0)
 		return NULL;
 	return ctx ? check_non_null(ctx, malloc(size), size) : NULL;
 }
@@ -62,7 +180,7 @@ void *isl_malloc_or_die(isl_ctx *ctx, size_t size)
  */
 void *isl_calloc_or_die(isl_ctx *ctx, size_t nmemb, size_t size)
 {
-	if (isl_ctx_next_operation(ctx) < 0)
+	if (next_allocation(ctx, nmemb * size) < 0)
 		return NULL;
 	return ctx ? check_non_null(ctx, calloc(nmemb, size), nmemb) : NULL;
 }
@@ -72,7 +190,7 @@ void *isl_calloc_or_die(isl_ctx *ctx, size_t nmemb, size_t size)
  */
 void *isl_realloc_or_die(isl_ctx *ctx, void *ptr, size_t size)
 {
-	if (isl_ctx_next_operation(ctx) < 0)
+	if (next_allocation(ctx, size) < 0)
 		return NULL;
 	return ctx ? check_non_null(ctx, realloc(ptr, size), size) : NULL;
 }
@@ -164,6 +282,9 @@ isl_ctx *isl_ctx_alloc_with_options(struct isl_args *args, void *user_opt)
 	if (!ctx)
 		goto error;
 
+	if (isl_thread_init(ctx) < 0)
+		goto error;
+
 	if (isl_hash_table_init(ctx, &ctx->id_table, 0))
 		goto error;
 
@@ -189,15 +310,16 @@ isl_ctx *isl_ctx_alloc_with_options(struct isl_args *args, void *user_opt)
 	isl_int_init(ctx->negone);
 	isl_int_set_si(ctx->negone, -1);
 
-	isl_int_init(ctx->normalize_gcd);
-
 	ctx->n_cached = 0;
 	ctx->n_miss = 0;
+	ctx->slab.enabled = -1;
 
 	ctx->error = isl_error_none;
 
 	ctx->operations = 0;
 	isl_ctx_set_max_operations(ctx, ctx->opt->max_operations);
+	isl_ctx_reset_memory(ctx);
+	isl_ctx_set_max_memory(ctx, ctx->opt->max_memory);
 
 	return ctx;
 error:
@@ -219,13 +341,13 @@ struct isl_ctx *isl_ctx_alloc()
 
 void isl_ctx_ref(struct isl_ctx *ctx)
 {
-	ctx->ref++;
+	ISL_ATOMIC_INC(ctx, ctx->ref);
 }
 
 void isl_ctx_deref(struct isl_ctx *ctx)
 {
-	isl_assert(ctx, ctx->ref > 0, return);
-	ctx->ref--;
+	isl_assert(ctx, ISL_ATOMIC_GET(ctx, ctx->ref) > 0, return);
+	ISL_ATOMIC_DEC(ctx, ctx->ref);
 }
 
 /* Print statistics on usage.
@@ -233,12 +355,21 @@ void isl_ctx_deref(struct isl_ctx *ctx)
 static void print_stats(isl_ctx *ctx)
 {
 	fprintf(stderr, "operations: %lu\n", ctx->operations);
+	fprintf(stderr, "peak memory: %lu\n",
+		(unsigned long) isl_ctx_get_peak_memory(ctx));
+	isl_slab_print_stats(ctx);
 }
 
 void isl_ctx_free(struct isl_ctx *ctx)
 {
 	if (!ctx)
 		return;
+	/* The maps in the memo table hold references to the ctx. */
+	if (ctx->opt->print_stats)
+		isl_memo_print_stats(ctx);
+	isl_memo_free(ctx);
+	isl_trace_free(ctx);
+	isl_thread_free(ctx);
 	if (ctx->ref != 0)
 		isl_die(ctx, isl_error_invalid,
 			"isl_ctx freed, but some objects still reference it",
@@ -249,11 +380,11 @@ void isl_ctx_free(struct isl_ctx *ctx)
 
 	isl_hash_table_clear(&ctx->id_table);
 	isl_blk_clear_cache(ctx);
+	isl_slab_clear(ctx);
 	isl_int_clear(ctx->zero);
 	isl_int_clear(ctx->one);
 	isl_int_clear(ctx->two);
 	isl_int_clear(ctx->negone);
-	isl_int_clear(ctx->normalize_gcd);
 	isl_args_free(ctx->user_args, ctx->user_opt);
 	if (ctx->opt_allocated)
 		isl_options_free(ctx->opt);
@@ -280,8 +411,11 @@ void isl_ctx_reset_error(isl_ctx *ctx)
 
 void isl_ctx_set_error(isl_ctx *ctx, enum isl_error error)
 {
-	if (ctx)
-		ctx->error = error;
+	if (!ctx)
+		return;
+	isl_ctx_lock(ctx);
+	ctx->error = error;
+	isl_ctx_unlock(ctx);
 }
 
 void isl_ctx_abort(isl_ctx *ctx)
@@ -332,3 +466,50 @@ void isl_ctx_reset_operations(isl_ctx *ctx)
 		return;
 	ctx->operations = 0;
 }
+
+/* Set the maximal memory usage of "ctx" to "max_memory" bytes.
+ * The memory usage is measured with respect to the heap usage
+ * at the last call to isl_ctx_reset_memory.
+ * Changing the bound allows allocations to succeed again
+ * after the previous bound has been exceeded.
+ */
+void isl_ctx_set_max_memory(isl_ctx *ctx, size_t max_memory)
+{
+	if (!ctx)
+		return;
+	ctx->max_memory = max_memory;
+	ctx->memory_exceeded = 0;
+}
+
+/* Return the maximal memory usage of "ctx".
+ */
+size_t isl_ctx_get_max_memory(isl_ctx *ctx)
+{
+	return ctx ? ctx->max_memory : 0;
+}
+
+/* Start measuring the memory usage of "ctx" from the current heap usage.
+ */
+void isl_ctx_reset_memory(isl_ctx *ctx)
+{
+	if (!ctx)
+		return;
+	ctx->memory_base = heap_in_use(ctx);
+	ctx->memory_peak = 0;
+	ctx->memory_pending = 0;
+	ctx->memory_exceeded = 0;
+}
+
+/* Return the peak memory usage of "ctx" since the last call
+ * to isl_ctx_reset_memory, as observed by the sampling of the heap usage.
+ * The peak is only tracked if the memory usage is bounded or
+ * if statistics are being printed.
+ */
+size_t isl_ctx_get_peak_memory(isl_ctx *ctx)
+{
+	if (!ctx)
+		return 0;
+	if (memory_is_tracked(ctx))
+		sample_memory(ctx);
+	return ctx->memory_peak;
+}
@@ -1,5 +1,14 @@
+#ifndef ISL_CTX_PRIVATE_H
+#define ISL_CTX_PRIVATE_H
+
+#include <isl_config.h>
 #include <isl/ctx.h>
 #include <isl_blk.h>
+#include <isl_slab.h>
+
+#ifdef ISL_USE_THREADS
+#include <pthread.h>
+#endif
 
 struct isl_ctx {
 	int			ref;
@@ -16,11 +25,12 @@ struct isl_ctx {
 	isl_int			two;
 	isl_int			negone;
 
-	isl_int			normalize_gcd;
-
 	int			n_cached;
 	int			n_miss;
 	struct isl_blk		cache[ISL_BLK_CACHE_SIZE];
+	struct isl_slab		slab;
+	struct isl_memo		*memo;
+	struct isl_trace	*trace;
 	struct isl_hash_table	id_table;
 
 	enum isl_error		error;
@@ -29,6 +39,21 @@ struct isl_ctx {
 
 	unsigned long		operations;
 	unsigned long		max_operations;
+
+	size_t			max_memory;
+	size_t			memory_base;
+	size_t			memory_peak;
+	size_t			memory_requested;
+	size_t			memory_pending;
+	int			memory_exceeded;
+
+	struct isl_thread_pool	*pool;
+	int			parallel;
+#ifdef ISL_USE_THREADS
+	pthread_mutex_t		lock;
+#endif
 };
 
 int isl_ctx_next_operation(isl_ctx *ctx);
+
+#endif
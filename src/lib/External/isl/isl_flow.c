@@ -16,6 +16,7 @@
  * and Ecole Normale Superieure, 45 rue d'Ulm, 75230 Paris, France
  */
 
+#include <isl_map_private.h>
 #include <isl/set.h>
 #include <isl/map.h>
 #include <isl/union_set.h>
@@ -23,6 +24,8 @@
 #include <isl/flow.h>
 #include <isl/schedule_node.h>
 #include <isl_sort.h>
+#include <isl_thread.h>
+#include <isl_trace.h>
 
 enum isl_restriction_type {
 	isl_restriction_type_empty,
@@ -1635,6 +1638,14 @@ static __isl_give isl_union_flow *isl_union_flow_drop_schedule(
 	return flow;
 }
 
+/* Data used by compute_flow and compute_flow_union_map_parallel.
+ *
+ * If "unshared" is set, then the accesses are constructed
+ * from unshared copies of the access relations such that
+ * the dependence analysis can be performed in a parallel region.
+ * "task" is only used by compute_flow_union_map_parallel
+ * and contains the "n_task" tasks constructed so far.
+ */
 struct isl_compute_flow_data {
 	isl_union_map *must_source;
 	isl_union_map *may_source;
@@ -1646,8 +1657,77 @@ struct isl_compute_flow_data {
 	struct isl_sched_info *sink_info;
 	struct isl_sched_info **source_info;
 	isl_access_info *accesses;
+
+	int unshared;
+	int n_task;
+	struct isl_compute_flow_task *task;
 };
 
+/* A single dependence analysis performed by a task
+ * of isl_ctx_parallel_for.
+ *
+ * "access" is the input of the analysis and "flow" its result.
+ * "sink_info" and the "n_source_info" elements of "source_info"
+ * are the tokens of the accesses, if they need to be freed
+ * after the analysis.
+ */
+struct isl_compute_flow_task {
+	isl_access_info *access;
+	isl_flow *flow;
+	struct isl_sched_info *sink_info;
+	struct isl_sched_info **source_info;
+	int n_source_info;
+};
+
+/* Perform the dependence analysis of task "i" in the array "user".
+ */
+static isl_stat compute_flow_task(int i, void *user)
+{
+	struct isl_compute_flow_task *task = user;
+
+	task[i].flow = isl_access_info_compute_flow(task[i].access);
+	task[i].access = NULL;
+
+	return task[i].flow ? isl_stat_ok : isl_stat_error;
+}
+
+/* Free the accesses, results and tokens of the "n" tasks in "task",
+ * along with "task" itself.
+ */
+static void compute_flow_tasks_free(struct isl_compute_flow_task *task,
+	int n)
+{
+	int i;
+
+	if (!task)
+		return;
+
+	for (i = 0; i < n; ++i) {
+		isl_access_info_free(task[i].access);
+		isl_flow_free(task[i].flow);
+		sched_info_free(task[i].sink_info);
+		if (task[i].source_info) {
+			int j;
+
+			for (j = 0; j < task[i].n_source_info; ++j)
+				sched_info_free(task[i].source_info[j]);
+			free(task[i].source_info);
+		}
+	}
+	free(task);
+}
+
+/* Return a copy of "map" that can be used by the dependence analysis
+ * described by "data".
+ */
+static __isl_give isl_map *copy_access(__isl_keep isl_map *map,
+	struct isl_compute_flow_data *data)
+{
+	if (data->unshared)
+		return isl_map_dup_unshared(map);
+	return isl_map_copy(map);
+}
+
 static isl_stat count_matching_array(__isl_take isl_map *map, void *user)
 {
 	int eq;
@@ -1677,6 +1757,7 @@ static isl_stat collect_matching_array(__isl_take isl_map *map, void *user)
 	isl_space *dim;
 	struct isl_sched_info *info;
 	struct isl_compute_flow_data *data;
+	isl_map *copy;
 
 	data = (struct isl_compute_flow_data *)user;
 
@@ -1693,6 +1774,10 @@ static isl_stat collect_matching_array(__isl_take isl_map *map, void *user)
 		return isl_stat_ok;
 	}
 
+	copy = copy_access(map, data);
+	isl_map_free(map);
+	map = copy;
+
 	info = sched_info_alloc(map);
 	data->source_info[data->count] = info;
 
@@ -1752,20 +1837,31 @@ static int before(void *first, void *second)
 	return 2 * n1;
 }
 
-/* Given a sink access, look for all the source accesses that access
- * the same array and perform dataflow analysis on them using
- * isl_access_info_compute_flow.
+/* Free the tokens of the sink and source accesses in "data".
  */
-static isl_stat compute_flow(__isl_take isl_map *map, void *user)
+static void compute_flow_data_free_info(struct isl_compute_flow_data *data)
 {
 	int i;
-	isl_ctx *ctx;
-	struct isl_compute_flow_data *data;
-	isl_flow *flow;
-	isl_union_flow *df;
 
-	data = (struct isl_compute_flow_data *)user;
-	df = data->flow;
+	sched_info_free(data->sink_info);
+	if (data->source_info) {
+		for (i = 0; i < data->count; ++i)
+			sched_info_free(data->source_info[i]);
+		free(data->source_info);
+	}
+}
+
+/* Given a sink access, look for all the source accesses that access
+ * the same array and collect them in data->accesses, along with
+ * the sink access itself.
+ * The tokens of the accesses are kept in data->sink_info and
+ * data->source_info, the latter of which has data->count elements.
+ * They need to be freed by the caller, even if an error occurs.
+ */
+static isl_stat init_accesses(__isl_keep isl_map *map,
+	struct isl_compute_flow_data *data)
+{
+	isl_ctx *ctx;
 
 	ctx = isl_map_get_ctx(map);
 
@@ -1786,7 +1882,7 @@ static isl_stat compute_flow(__isl_take isl_map *map, void *user)
 	data->source_info = isl_calloc_array(ctx, struct isl_sched_info *,
 					     data->count);
 
-	data->accesses = isl_access_info_alloc(isl_map_copy(map),
+	data->accesses = isl_access_info_alloc(copy_access(map, data),
 				data->sink_info, &before, data->count);
 	if (!data->sink_info || (data->count && !data->source_info) ||
 	    !data->accesses)
@@ -1801,11 +1897,24 @@ static isl_stat compute_flow(__isl_take isl_map *map, void *user)
 					&collect_matching_array, data) < 0)
 		goto error;
 
-	flow = isl_access_info_compute_flow(data->accesses);
-	data->accesses = NULL;
+	isl_space_free(data->dim);
+	data->dim = NULL;
+	return isl_stat_ok;
+error:
+	isl_space_free(data->dim);
+	data->dim = NULL;
+	return isl_stat_error;
+}
+
+/* Add the results of the dependence analysis "flow" to "df".
+ */
+static isl_stat add_flow(__isl_keep isl_union_flow *df,
+	__isl_take isl_flow *flow)
+{
+	int i;
 
 	if (!flow)
-		goto error;
+		return isl_stat_error;
 
 	df->must_no_source = isl_union_map_union(df->must_no_source,
 		    isl_union_map_from_map(isl_flow_get_no_source(flow, 1)));
@@ -1823,30 +1932,63 @@ static isl_stat compute_flow(__isl_take isl_map *map, void *user)
 
 	isl_flow_free(flow);
 
-	sched_info_free(data->sink_info);
-	if (data->source_info) {
-		for (i = 0; i < data->count; ++i)
-			sched_info_free(data->source_info[i]);
-		free(data->source_info);
-	}
-	isl_space_free(data->dim);
+	return isl_stat_ok;
+}
+
+/* Given a sink access, look for all the source accesses that access
+ * the same array and perform dataflow analysis on them using
+ * isl_access_info_compute_flow.
+ */
+static isl_stat compute_flow(__isl_take isl_map *map, void *user)
+{
+	struct isl_compute_flow_data *data;
+	isl_flow *flow;
+
+	data = (struct isl_compute_flow_data *)user;
+
+	if (init_accesses(map, data) < 0)
+		goto error;
+
+	flow = isl_access_info_compute_flow(data->accesses);
+	data->accesses = NULL;
+
+	if (add_flow(data->flow, flow) < 0)
+		goto error;
+
+	compute_flow_data_free_info(data);
 	isl_map_free(map);
 
 	return isl_stat_ok;
 error:
 	isl_access_info_free(data->accesses);
-	sched_info_free(data->sink_info);
-	if (data->source_info) {
-		for (i = 0; i < data->count; ++i)
-			sched_info_free(data->source_info[i]);
-		free(data->source_info);
-	}
-	isl_space_free(data->dim);
+	compute_flow_data_free_info(data);
 	isl_map_free(map);
 
 	return isl_stat_error;
 }
 
+/* Given a sink access, collect the input of the corresponding
+ * dependence analysis in a new task in data->task.
+ * The tokens of the accesses are transferred to the task
+ * such that they remain available until the analysis has been performed.
+ */
+static isl_stat collect_flow_task(__isl_take isl_map *map, void *user)
+{
+	struct isl_compute_flow_data *data = user;
+	struct isl_compute_flow_task *task;
+	isl_stat r;
+
+	r = init_accesses(map, data);
+	task = &data->task[data->n_task++];
+	task->access = data->accesses;
+	task->sink_info = data->sink_info;
+	task->source_info = data->source_info;
+	task->n_source_info = data->count;
+	isl_map_free(map);
+
+	return r;
+}
+
 /* Remove the must accesses from the may accesses.
  *
  * A must access always trumps a may access, so there is no need
@@ -1867,6 +2009,56 @@ static __isl_give isl_union_access_info *isl_union_access_info_normalize(
 	return access;
 }
 
+/* Should the dependence analyses of the individual sink accesses
+ * in "access" be performed in parallel?
+ */
+static int compute_flow_parallel(__isl_keep isl_union_access_info *access)
+{
+	isl_ctx *ctx;
+
+	ctx = isl_union_map_get_ctx(access->sink);
+	return isl_ctx_parallel_n_thread(ctx,
+				isl_union_map_n_map(access->sink)) > 1;
+}
+
+/* Perform the dependence analyses of the individual sink accesses
+ * in "sink" in parallel, adding the results to data->flow.
+ *
+ * The inputs of the analyses are constructed up front and
+ * the analyses are then performed in separate tasks.
+ * The results are added to data->flow in the same order
+ * as that in which compute_flow would add them.
+ */
+static isl_stat compute_flow_union_map_parallel(
+	struct isl_compute_flow_data *data, __isl_keep isl_union_map *sink)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_stat r;
+
+	ctx = isl_union_map_get_ctx(sink);
+	data->unshared = 1;
+	data->n_task = 0;
+	data->task = isl_calloc_array(ctx, struct isl_compute_flow_task,
+					isl_union_map_n_map(sink));
+	if (!data->task)
+		return isl_stat_error;
+
+	r = isl_union_map_foreach_map(sink, &collect_flow_task, data);
+	if (r >= 0)
+		r = isl_ctx_parallel_for(ctx, data->n_task,
+					&compute_flow_task, data->task);
+	for (i = 0; r >= 0 && i < data->n_task; ++i) {
+		r = add_flow(data->flow, data->task[i].flow);
+		data->task[i].flow = NULL;
+	}
+
+	compute_flow_tasks_free(data->task, data->n_task);
+	data->task = NULL;
+
+	return r;
+}
+
 /* Given a description of the "sink" accesses, the "source" accesses and
  * a schedule, compute for each instance of a sink access
  * and for each element accessed by that instance,
@@ -1884,7 +2076,8 @@ static __isl_give isl_union_access_info *isl_union_access_info_normalize(
  *
  * We first prepend the schedule dimensions to the domain
  * of the accesses so that we can easily compare their relative order.
- * Then we consider each sink access individually in compute_flow.
+ * Then we consider each sink access individually in compute_flow,
+ * possibly in parallel.
  */
 static __isl_give isl_union_flow *compute_flow_union_map(
 	__isl_take isl_union_access_info *access)
@@ -1898,10 +2091,15 @@ static __isl_give isl_union_flow *compute_flow_union_map(
 
 	data.must_source = access->must_source;
 	data.may_source = access->may_source;
+	data.unshared = 0;
 
 	data.flow = isl_union_flow_alloc(isl_union_map_get_space(access->sink));
 
-	if (isl_union_map_foreach_map(access->sink, &compute_flow, &data) < 0)
+	if (compute_flow_parallel(access)) {
+		if (compute_flow_union_map_parallel(&data, access->sink) < 0)
+			goto error;
+	} else if (isl_union_map_foreach_map(access->sink,
+						&compute_flow, &data) < 0)
 		goto error;
 
 	data.flow = isl_union_flow_drop_schedule(data.flow);
@@ -1920,11 +2118,14 @@ error:
  * where S corresponds to the prefix schedule at "node".
  * "must" is only relevant for source accesses and indicates
  * whether the access is a must source or a may source.
+ * "leaf" is the index of the leaf "node" among the leaves
+ * visited by collect_sink_source.
  */
 struct isl_scheduled_access {
 	isl_map *access;
 	int must;
 	isl_schedule_node *node;
+	int leaf;
 };
 
 /* Data structure for keeping track of individual scheduled sink and source
@@ -1932,6 +2133,7 @@ struct isl_scheduled_access {
  *
  * "n_sink" is the number of used entries in "sink"
  * "n_source" is the number of used entries in "source"
+ * "n_leaf" is the number of leaves visited by collect_sink_source
  *
  * "set_sink", "must" and "node" are only used inside collect_sink_source,
  * to keep track of the current node and
@@ -1942,6 +2144,7 @@ struct isl_compute_flow_schedule_data {
 
 	int n_sink;
 	int n_source;
+	int n_leaf;
 
 	struct isl_scheduled_access *sink;
 	struct isl_scheduled_access *source;
@@ -2074,6 +2277,7 @@ static isl_stat extract_sink_source(__isl_take isl_map *map, void *user)
 	access->access = map;
 	access->must = data->must;
 	access->node = isl_schedule_node_copy(data->node);
+	access->leaf = data->n_leaf;
 
 	return isl_stat_ok;
 }
@@ -2143,6 +2347,8 @@ static isl_bool collect_sink_source(__isl_keep isl_schedule_node *node,
 
 	isl_union_map_free(prefix);
 
+	data->n_leaf++;
+
 	return r;
 }
 
@@ -2190,6 +2396,24 @@ static int before_node(void *first, void *second)
 	return 2 * depth + before;
 }
 
+/* Does the scheduled source access "source" access
+ * the same data space as the scheduled sink access "sink"?
+ */
+static isl_bool is_matching_source(struct isl_scheduled_access *sink,
+	struct isl_scheduled_access *source)
+{
+	isl_space *space, *source_space;
+	isl_bool eq;
+
+	space = isl_space_range(isl_map_get_space(sink->access));
+	source_space = isl_space_range(isl_map_get_space(source->access));
+	eq = isl_space_is_equal(space, source_space);
+	isl_space_free(source_space);
+	isl_space_free(space);
+
+	return eq;
+}
+
 /* Add the scheduled sources from "data" that access
  * the same data space as "sink" to "access".
  */
@@ -2198,60 +2422,38 @@ static __isl_give isl_access_info *add_matching_sources(
 	struct isl_compute_flow_schedule_data *data)
 {
 	int i;
-	isl_space *space;
 
-	space = isl_space_range(isl_map_get_space(sink->access));
 	for (i = 0; i < data->n_source; ++i) {
 		struct isl_scheduled_access *source;
-		isl_space *source_space;
-		int eq;
+		isl_bool eq;
 
 		source = &data->source[i];
-		source_space = isl_map_get_space(source->access);
-		source_space = isl_space_range(source_space);
-		eq = isl_space_is_equal(space, source_space);
-		isl_space_free(source_space);
-
+		eq = is_matching_source(sink, source);
+		if (eq < 0)
+			return isl_access_info_free(access);
 		if (!eq)
 			continue;
-		if (eq < 0)
-			goto error;
 
 		access = isl_access_info_add_source(access,
 		    isl_map_copy(source->access), source->must, source->node);
 	}
 
-	isl_space_free(space);
 	return access;
-error:
-	isl_space_free(space);
-	isl_access_info_free(access);
-	return NULL;
 }
 
-/* Given a scheduled sink access relation "sink", compute the corresponding
- * dependences on the sources in "data" and add the computed dependences
- * to "uf".
+/* Add the results of the dependence analysis "flow" on scheduled accesses
+ * to "uf", removing the prefix schedules from the domains.
  */
-static __isl_give isl_union_flow *compute_single_flow(
-	__isl_take isl_union_flow *uf, struct isl_scheduled_access *sink,
-	struct isl_compute_flow_schedule_data *data)
+static __isl_give isl_union_flow *add_scheduled_flow(
+	__isl_take isl_union_flow *uf, __isl_take isl_flow *flow)
 {
 	int i;
-	isl_access_info *access;
-	isl_flow *flow;
 	isl_map *map;
 
-	if (!uf)
-		return NULL;
-
-	access = isl_access_info_alloc(isl_map_copy(sink->access), sink->node,
-					&before_node, data->n_source);
-	access = add_matching_sources(access, sink, data);
-
-	flow = isl_access_info_compute_flow(access);
-	if (!flow)
+	if (!uf || !flow) {
+		isl_flow_free(flow);
 		return isl_union_flow_free(uf);
+	}
 
 	map = isl_map_domain_factor_range(isl_flow_get_no_source(flow, 1));
 	uf->must_no_source = isl_union_map_union(uf->must_no_source,
@@ -2276,6 +2478,208 @@ static __isl_give isl_union_flow *compute_single_flow(
 	return uf;
 }
 
+/* Given a scheduled sink access relation "sink", compute the corresponding
+ * dependences on the sources in "data" and add the computed dependences
+ * to "uf".
+ */
+static __isl_give isl_union_flow *compute_single_flow(
+	__isl_take isl_union_flow *uf, struct isl_scheduled_access *sink,
+	struct isl_compute_flow_schedule_data *data)
+{
+	isl_access_info *access;
+	isl_flow *flow;
+
+	if (!uf)
+		return NULL;
+
+	access = isl_access_info_alloc(isl_map_copy(sink->access), sink->node,
+					&before_node, data->n_source);
+	access = add_matching_sources(access, sink, data);
+
+	flow = isl_access_info_compute_flow(access);
+
+	return add_scheduled_flow(uf, flow);
+}
+
+/* The relative order of the leaves of a schedule tree,
+ * for use in a parallel region, where the schedule tree itself
+ * cannot be accessed.
+ *
+ * "order" is an "n_leaf" by "n_leaf" table where the element
+ * in row i and column j is the result of before_node on leaves i and j,
+ * provided the corresponding element of "known" is set.
+ */
+struct isl_leaf_order {
+	int n_leaf;
+	int *order;
+	char *known;
+};
+
+/* A token of a scheduled access referring to the leaf "leaf"
+ * in the table "order".
+ */
+struct isl_leaf_token {
+	int leaf;
+	struct isl_leaf_order *order;
+};
+
+/* isl_access_info_compute_flow callback for determining the shared
+ * nesting level and the ordering within that level of two scheduled
+ * accesses in a parallel region.
+ * The result is read off from the precomputed table of leaf orders.
+ */
+static int before_leaf(void *first, void *second)
+{
+	struct isl_leaf_token *token1 = first;
+	struct isl_leaf_token *token2 = second;
+	struct isl_leaf_order *order = token1->order;
+	int pos = token1->leaf * order->n_leaf + token2->leaf;
+
+	if (!order->known[pos])
+		return -1;
+	return order->order[pos];
+}
+
+/* Make sure the order of the leaves of the scheduled accesses
+ * "access1" and "access2" is available in "order", in both directions.
+ */
+static isl_stat set_leaf_order(struct isl_leaf_order *order,
+	struct isl_scheduled_access *access1,
+	struct isl_scheduled_access *access2)
+{
+	int pos1 = access1->leaf * order->n_leaf + access2->leaf;
+	int pos2 = access2->leaf * order->n_leaf + access1->leaf;
+
+	if (!order->known[pos1]) {
+		order->order[pos1] = before_node(access1->node, access2->node);
+		order->known[pos1] = 1;
+	}
+	if (!order->known[pos2]) {
+		order->order[pos2] = before_node(access2->node, access1->node);
+		order->known[pos2] = 1;
+	}
+	if (order->order[pos1] < 0 || order->order[pos2] < 0)
+		return isl_stat_error;
+	return isl_stat_ok;
+}
+
+/* Construct the input of the dependence analysis of the scheduled
+ * sink access "sink" for use in a parallel region.
+ * The access relations are unshared copies and the tokens
+ * refer to the leaves in "token".
+ * The relative order of each pair of accesses involved
+ * (including each access with itself) is computed and stored in "order"
+ * since the schedule tree cannot be accessed from within
+ * the parallel region.
+ * "match" is an array of size data->n_source that is used
+ * to keep track of the sources that access the same data space as "sink".
+ */
+static __isl_give isl_access_info *collect_leaf_access_info(
+	struct isl_scheduled_access *sink,
+	struct isl_compute_flow_schedule_data *data,
+	struct isl_leaf_order *order, struct isl_leaf_token *token, int *match)
+{
+	int i, j, n = 0;
+	isl_access_info *access;
+
+	access = isl_access_info_alloc(isl_map_dup_unshared(sink->access),
+			&token[sink->leaf], &before_leaf, data->n_source);
+	if (set_leaf_order(order, sink, sink) < 0)
+		return isl_access_info_free(access);
+
+	for (i = 0; i < data->n_source; ++i) {
+		struct isl_scheduled_access *source;
+		isl_bool eq;
+
+		source = &data->source[i];
+		eq = is_matching_source(sink, source);
+		if (eq < 0)
+			return isl_access_info_free(access);
+		if (!eq)
+			continue;
+
+		if (set_leaf_order(order, sink, source) < 0)
+			return isl_access_info_free(access);
+		for (j = 0; j < n; ++j)
+			if (set_leaf_order(order, &data->source[match[j]],
+					    source) < 0)
+				return isl_access_info_free(access);
+		if (set_leaf_order(order, source, source) < 0)
+			return isl_access_info_free(access);
+		match[n++] = i;
+
+		access = isl_access_info_add_source(access,
+				isl_map_dup_unshared(source->access),
+				source->must, &token[source->leaf]);
+	}
+
+	return access;
+}
+
+/* Compute the dependences of all scheduled sinks in "data"
+ * in parallel and add them to "uf".
+ *
+ * The inputs of the analyses are constructed up front and
+ * the analyses are then performed in separate tasks.
+ * The results are added to "uf" in the same order
+ * as that in which compute_single_flow would add them.
+ */
+static __isl_give isl_union_flow *compute_flow_schedule_parallel(
+	__isl_take isl_union_flow *uf,
+	struct isl_compute_flow_schedule_data *data)
+{
+	int i, n;
+	isl_ctx *ctx;
+	isl_stat r = isl_stat_ok;
+	struct isl_leaf_order order = { data->n_leaf };
+	struct isl_leaf_token *token;
+	struct isl_compute_flow_task *task;
+	int *match;
+
+	if (!uf)
+		return NULL;
+
+	ctx = isl_union_flow_get_ctx(uf);
+	n = data->n_leaf * data->n_leaf;
+	order.order = isl_alloc_array(ctx, int, n);
+	order.known = isl_calloc_array(ctx, char, n);
+	token = isl_alloc_array(ctx, struct isl_leaf_token, data->n_leaf);
+	task = isl_calloc_array(ctx, struct isl_compute_flow_task,
+				data->n_sink);
+	match = isl_alloc_array(ctx, int, data->n_source);
+	if ((n && (!order.order || !order.known || !token)) || !task ||
+	    (data->n_source && !match))
+		r = isl_stat_error;
+
+	for (i = 0; r >= 0 && i < data->n_leaf; ++i) {
+		token[i].leaf = i;
+		token[i].order = &order;
+	}
+	for (i = 0; r >= 0 && i < data->n_sink; ++i) {
+		task[i].access = collect_leaf_access_info(&data->sink[i], data,
+							&order, token, match);
+		if (!task[i].access)
+			r = isl_stat_error;
+	}
+	if (r >= 0)
+		r = isl_ctx_parallel_for(ctx, data->n_sink,
+					&compute_flow_task, task);
+	for (i = 0; r >= 0 && i < data->n_sink; ++i) {
+		uf = add_scheduled_flow(uf, task[i].flow);
+		task[i].flow = NULL;
+	}
+
+	compute_flow_tasks_free(task, data->n_sink);
+	free(match);
+	free(token);
+	free(order.known);
+	free(order.order);
+
+	if (r < 0)
+		return isl_union_flow_free(uf);
+	return uf;
+}
+
 /* Given a description of the "sink" accesses, the "source" accesses and
  * a schedule, compute for each instance of a sink access
  * and for each element accessed by that instance,
@@ -2292,7 +2696,8 @@ static __isl_give isl_union_flow *compute_single_flow(
  * is available.
  *
  * We extract the individual scheduled source and sink access relations and
- * then compute dependences for each scheduled sink individually.
+ * then compute dependences for each scheduled sink individually,
+ * possibly in parallel.
  */
 static __isl_give isl_union_flow *compute_flow_schedule(
 	__isl_take isl_union_access_info *access)
@@ -2318,6 +2723,7 @@ static __isl_give isl_union_flow *compute_flow_schedule(
 
 	data.n_sink = 0;
 	data.n_source = 0;
+	data.n_leaf = 0;
 	if (isl_schedule_foreach_schedule_node_top_down(access->schedule,
 					    &collect_sink_source, &data) < 0)
 		goto error;
@@ -2326,8 +2732,11 @@ static __isl_give isl_union_flow *compute_flow_schedule(
 
 	isl_compute_flow_schedule_data_align_params(&data);
 
-	for (i = 0; i < data.n_sink; ++i)
-		flow = compute_single_flow(flow, &data.sink[i], &data);
+	if (isl_ctx_parallel_n_thread(ctx, data.n_sink) > 1)
+		flow = compute_flow_schedule_parallel(flow, &data);
+	else
+		for (i = 0; i < data.n_sink; ++i)
+			flow = compute_single_flow(flow, &data.sink[i], &data);
 
 	isl_compute_flow_schedule_data_clear(&data);
 
@@ -2354,17 +2763,52 @@ error:
  * We check whether the schedule is available as a schedule tree
  * or a schedule map and call the correpsonding function to perform
  * the analysis.
+ *
+ * The call is recorded in the trace of the ctx with as arguments
+ * the sink, must-source and may-source accesses, the schedule tree and
+ * the schedule map and with as results the must and may dependences.
  */
 __isl_give isl_union_flow *isl_union_access_info_compute_flow(
 	__isl_take isl_union_access_info *access)
 {
+	isl_ctx *ctx;
+	isl_union_flow *flow;
+	struct isl_trace_call call;
+
 	access = isl_union_access_info_normalize(access);
 	if (!access)
 		return NULL;
+
+	ctx = isl_union_access_info_get_ctx(access);
+	isl_trace_enter(ctx, &call, "union_access_info_compute_flow");
+	if (call.op) {
+		isl_trace_add_arg(&call, isl_union_map_to_str(access->sink));
+		isl_trace_add_arg(&call,
+				isl_union_map_to_str(access->must_source));
+		isl_trace_add_arg(&call,
+				isl_union_map_to_str(access->may_source));
+		isl_trace_add_arg(&call,
+				isl_trace_schedule_to_str(access->schedule));
+		isl_trace_add_arg(&call,
+				isl_union_map_to_str(access->schedule_map));
+	}
 	if (access->schedule)
-		return compute_flow_schedule(access);
+		flow = compute_flow_schedule(access);
 	else
-		return compute_flow_union_map(access);
+		flow = compute_flow_union_map(access);
+	if (call.op) {
+		isl_union_map *dep;
+
+		dep = isl_union_flow_get_must_dependence(flow);
+		isl_trace_add_res(&call, isl_union_map_to_str(dep));
+		isl_union_map_free(dep);
+		dep = isl_union_flow_get_may_dependence(flow);
+		isl_trace_add_res(&call, isl_union_map_to_str(dep));
+		isl_union_map_free(dep);
+	}
+	isl_trace_leave(ctx, &call);
+
+	return flow;
 }
 
 /* Given a collection of "sink" and "source" accesses,
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <isl_ctx_private.h>
 #include <isl_id_private.h>
+#include <isl_thread.h>
 
 #undef BASE
 #define BASE id
@@ -96,11 +97,17 @@ static int isl_id_has_name_and_user(const void *entry, const void *val)
 	return !strcmp(id->name, nu->name);
 }
 
+/* Return the isl_id with the given name and user pointer,
+ * creating it if it does not exist yet.
+ * The table of identifiers is shared by all threads of a parallel region,
+ * so it is only accessed while holding the lock on "ctx".
+ */
 __isl_give isl_id *isl_id_alloc(isl_ctx *ctx, const char *name, void *user)
 {
 	struct isl_hash_table_entry *entry;
 	uint32_t id_hash;
 	struct isl_name_and_user nu = { name, user };
+	isl_id *id;
 
 	if (!ctx)
 		return NULL;
@@ -110,30 +117,37 @@ __isl_give isl_id *isl_id_alloc(isl_ctx *ctx, const char *name, void *user)
 		id_hash = isl_hash_string(id_hash, name);
 	else
 		id_hash = isl_hash_builtin(id_hash, user);
+	isl_ctx_lock(ctx);
 	entry = isl_hash_table_find(ctx, &ctx->id_table, id_hash,
 					isl_id_has_name_and_user, &nu, 1);
-	if (!entry)
-		return NULL;
-	if (entry->data)
-		return isl_id_copy(entry->data);
-	entry->data = id_alloc(ctx, name, user);
-	if (!entry->data)
-		ctx->id_table.n--;
-	return entry->data;
+	if (!entry) {
+		id = NULL;
+	} else if (entry->data) {
+		id = isl_id_copy(entry->data);
+	} else {
+		id = entry->data = id_alloc(ctx, name, user);
+		if (!id)
+			ctx->id_table.n--;
+	}
+	isl_ctx_unlock(ctx);
+	return id;
 }
 
 /* If the id has a negative refcount, then it is a static isl_id
  * which should not be changed.
+ * Such an id does not belong to any ctx, which is what is checked here
+ * since the refcount of other ids may be changed concurrently
+ * inside a parallel region.
  */
 __isl_give isl_id *isl_id_copy(isl_id *id)
 {
 	if (!id)
 		return NULL;
 
-	if (id->ref < 0)
+	if (!id->ctx)
 		return id;
 
-	id->ref++;
+	ISL_ATOMIC_INC(id->ctx, id->ref);
 	return id;
 }
 
@@ -191,28 +205,39 @@ __isl_give isl_id *isl_id_set_free_user(__isl_take isl_id *id,
 }
 
 /* If the id has a negative refcount, then it is a static isl_id
- * and should not be freed.
+ * and should not be freed.  As in isl_id_copy, such an id is
+ * recognized by it not belonging to any ctx.
+ *
+ * The last reference is dropped while holding the lock on the ctx
+ * such that isl_id_alloc cannot find the id after it has been
+ * removed from the table of identifiers.
  */
 __isl_null isl_id *isl_id_free(__isl_take isl_id *id)
 {
 	struct isl_hash_table_entry *entry;
+	isl_ctx *ctx;
 
 	if (!id)
 		return NULL;
 
-	if (id->ref < 0)
+	if (!id->ctx)
 		return NULL;
 
-	if (--id->ref > 0)
+	ctx = id->ctx;
+	isl_ctx_lock(ctx);
+	if (ISL_ATOMIC_DEC(ctx, id->ref) > 0) {
+		isl_ctx_unlock(ctx);
 		return NULL;
+	}
 
-	entry = isl_hash_table_find(id->ctx, &id->ctx->id_table, id->hash,
+	entry = isl_hash_table_find(ctx, &ctx->id_table, id->hash,
 					isl_id_eq, id, 0);
 	if (!entry)
-		isl_die(id->ctx, isl_error_unknown,
+		isl_die(ctx, isl_error_unknown,
 			"unable to find id", (void)0);
 	else
-		isl_hash_table_remove(id->ctx, &id->ctx->id_table, entry);
+		isl_hash_table_remove(ctx, &ctx->id_table, entry);
+	isl_ctx_unlock(ctx);
 
 	if (id->free_user)
 		id->free_user(id->user);
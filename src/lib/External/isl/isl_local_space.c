@@ -813,21 +813,21 @@ __isl_give isl_local_space *isl_local_space_add_dims(
  */
 static void normalize_div(__isl_keep isl_local_space *ls, int div)
 {
-	isl_ctx *ctx = ls->div->ctx;
 	unsigned total = ls->div->n_col - 2;
-
-	isl_seq_gcd(ls->div->row[div] + 2, total, &ctx->normalize_gcd);
-	isl_int_gcd(ctx->normalize_gcd,
-		    ctx->normalize_gcd, ls->div->row[div][0]);
-	if (isl_int_is_one(ctx->normalize_gcd))
-		return;
-
-	isl_seq_scale_down(ls->div->row[div] + 2, ls->div->row[div] + 2,
-			    ctx->normalize_gcd, total);
-	isl_int_divexact(ls->div->row[div][0], ls->div->row[div][0],
-			    ctx->normalize_gcd);
-	isl_int_fdiv_q(ls->div->row[div][1], ls->div->row[div][1],
-			    ctx->normalize_gcd);
+	isl_int gcd;
+
+	isl_int_init(gcd);
+	isl_seq_gcd(ls->div->row[div] + 2, total, &gcd);
+	isl_int_gcd(gcd, gcd, ls->div->row[div][0]);
+	if (!isl_int_is_one(gcd)) {
+		isl_seq_scale_down(ls->div->row[div] + 2,
+				    ls->div->row[div] + 2, gcd, total);
+		isl_int_divexact(ls->div->row[div][0],
+				    ls->div->row[div][0], gcd);
+		isl_int_fdiv_q(ls->div->row[div][1],
+				    ls->div->row[div][1], gcd);
+	}
+	isl_int_clear(gcd);
 }
 
 /* Exploit the equalities in "eq" to simplify the expressions of
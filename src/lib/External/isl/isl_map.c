@@ -19,6 +19,8 @@
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_blk.h>
+#include <isl_memo.h>
+#include <isl_trace.h>
 #include <isl/constraint.h>
 #include "isl_space_private.h"
 #include "isl_equalities.h"
@@ -972,7 +974,7 @@ struct isl_basic_map *isl_basic_map_alloc_space(__isl_take isl_space *dim,
 
 	if (!dim)
 		return NULL;
-	bmap = isl_calloc_type(dim->ctx, struct isl_basic_map);
+	bmap = isl_slab_calloc_type(dim->ctx, struct isl_basic_map);
 	if (!bmap)
 		goto error;
 	bmap->dim = dim;
@@ -1037,6 +1039,33 @@ struct isl_basic_map *isl_basic_map_dup(struct isl_basic_map *bmap)
 	return dup;
 }
 
+/* Return a copy of "bmap" that does not share any objects with "bmap"
+ * other than its space, i.e., that also has its own copy
+ * of the cached sample, if any.
+ * "bmap" itself is only read, so this function may be called
+ * on the same "bmap" from different threads of a parallel region.
+ */
+static __isl_give isl_basic_map *isl_basic_map_dup_unshared(
+	__isl_keep isl_basic_map *bmap)
+{
+	isl_basic_map *dup;
+
+	if (!bmap)
+		return NULL;
+	dup = isl_basic_map_alloc_space(isl_space_copy(bmap->dim),
+			bmap->n_div, bmap->n_eq, bmap->n_ineq);
+	if (!dup)
+		return NULL;
+	dup_constraints(dup, bmap);
+	dup->flags = bmap->flags;
+	if (bmap->sample) {
+		dup->sample = isl_vec_dup(bmap->sample);
+		if (!dup->sample)
+			return isl_basic_map_free(dup);
+	}
+	return dup;
+}
+
 struct isl_basic_set *isl_basic_set_dup(struct isl_basic_set *bset)
 {
 	struct isl_basic_map *dup;
@@ -1105,7 +1134,7 @@ __isl_null isl_basic_map *isl_basic_map_free(__isl_take isl_basic_map *bmap)
 	isl_blk_free(bmap->ctx, bmap->block);
 	isl_vec_free(bmap->sample);
 	isl_space_free(bmap->dim);
-	free(bmap);
+	isl_slab_free_type(bmap->ctx, bmap, struct isl_basic_map);
 
 	return NULL;
 }
@@ -5295,6 +5324,28 @@ struct isl_map *isl_map_dup(struct isl_map *map)
 	return dup;
 }
 
+/* Return a copy of "map" that does not share any objects with "map"
+ * other than spaces.
+ * Since the reference counts of spaces are updated atomically
+ * inside a parallel region, the result can be handed to another thread
+ * of such a region, while "map" remains in use by the calling thread.
+ * "map" itself is only read, so this function may also be called
+ * on the same "map" from different threads of a parallel region.
+ */
+__isl_give isl_map *isl_map_dup_unshared(__isl_keep isl_map *map)
+{
+	int i;
+	isl_map *dup;
+
+	if (!map)
+		return NULL;
+	dup = isl_map_alloc_space(isl_space_copy(map->dim), map->n, map->flags);
+	for (i = 0; i < map->n; ++i)
+		dup = isl_map_add_basic_map(dup,
+				isl_basic_map_dup_unshared(map->p[i]));
+	return dup;
+}
+
 __isl_give isl_map *isl_map_add_basic_map(__isl_take isl_map *map,
 						__isl_take isl_basic_map *bmap)
 {
@@ -6087,7 +6138,9 @@ error:
 #define EMPTY	isl_map_empty
 #undef ADD
 #define ADD	isl_map_union_disjoint
+#define MEMO
 #include "isl_map_lexopt_templ.c"
+#undef MEMO
 
 /* Given a map "map", compute the lexicographically minimal
  * (or maximal) image element for each domain element in dom.
@@ -7739,13 +7792,11 @@ isl_bool isl_basic_set_is_equal(__isl_keep isl_basic_set *bset1,
 		(struct isl_basic_map *)bset1, (struct isl_basic_map *)bset2);
 }
 
-isl_bool isl_map_is_empty(__isl_keep isl_map *map)
+static isl_bool map_is_empty(__isl_keep isl_map *map)
 {
 	int i;
 	int is_empty;
 
-	if (!map)
-		return isl_bool_error;
 	for (i = 0; i < map->n; ++i) {
 		is_empty = isl_basic_map_is_empty(map->p[i]);
 		if (is_empty < 0)
@@ -7756,6 +7807,29 @@ isl_bool isl_map_is_empty(__isl_keep isl_map *map)
 	return isl_bool_true;
 }
 
+/* Is "map" empty?
+ * Reuse the result of an earlier test on a structurally identical map
+ * if the memo table of the ctx is enabled.
+ */
+isl_bool isl_map_is_empty(__isl_keep isl_map *map)
+{
+	int found;
+	isl_bool is_empty;
+
+	if (!map)
+		return isl_bool_error;
+	if (map->n == 0 || !isl_memo_is_enabled(map->ctx))
+		return map_is_empty(map);
+
+	is_empty = isl_memo_find_bool(map->ctx, isl_memo_is_empty,
+					map, NULL, &found);
+	if (found)
+		return is_empty;
+	is_empty = map_is_empty(map);
+	isl_memo_add_bool(map->ctx, isl_memo_is_empty, map, NULL, is_empty);
+	return is_empty;
+}
+
 isl_bool isl_map_plain_is_empty(__isl_keep isl_map *map)
 {
 	return map ? map->n == 0 : isl_bool_error;
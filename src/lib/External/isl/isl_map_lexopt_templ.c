@@ -110,9 +110,36 @@ __isl_give TYPE *SF(isl_map_lexopt,SUFFIX)(__isl_take isl_map *map, int max)
 {
 	isl_set *dom = NULL;
 	isl_space *dom_space;
+#ifdef MEMO
+	isl_ctx *ctx;
+	isl_map *res, *key;
+	enum isl_memo_op op = max ? isl_memo_lexmax : isl_memo_lexmin;
+	struct isl_trace_call call;
+#endif
 
 	if (!map)
 		goto error;
+#ifdef MEMO
+	ctx = isl_map_get_ctx(map);
+	isl_trace_enter(ctx, &call, max ? "map_lexmax" : "map_lexmin");
+	if (call.op)
+		isl_trace_add_arg(&call, isl_map_to_str(map));
+	res = isl_memo_find_map(ctx, op, map);
+	if (res) {
+		isl_map_free(map);
+	} else {
+		key = isl_map_copy(map);
+		dom_space = isl_space_domain(isl_space_copy(map->dim));
+		dom = isl_set_universe(dom_space);
+		res = SF(isl_map_partial_lexopt,SUFFIX)(map, dom, NULL, max);
+		isl_memo_add_map(ctx, op, key, res);
+		isl_map_free(key);
+	}
+	if (call.op)
+		isl_trace_add_res(&call, isl_map_to_str(res));
+	isl_trace_leave(ctx, &call);
+	return res;
+#endif
 	dom_space = isl_space_domain(isl_space_copy(map->dim));
 	dom = isl_set_universe(dom_space);
 	return SF(isl_map_partial_lexopt,SUFFIX)(map, dom, NULL, max);
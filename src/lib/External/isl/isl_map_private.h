@@ -150,6 +150,7 @@ __isl_give isl_map *isl_map_alloc(isl_ctx *ctx,
 __isl_give isl_map *isl_map_add_basic_map(__isl_take isl_map *map,
 	__isl_take isl_basic_map *bmap);
 __isl_give isl_map *isl_map_dup(__isl_keep isl_map *map);
+__isl_give isl_map *isl_map_dup_unshared(__isl_keep isl_map *map);
 __isl_give isl_map *isl_map_finalize(__isl_take isl_map *map);
 
 __isl_give isl_basic_set *isl_basic_set_from_underlying_set(
@@ -318,6 +319,7 @@ struct isl_set *isl_set_remove_empty_parts(struct isl_set *set);
 __isl_give isl_map *isl_map_remove_obvious_duplicates(__isl_take isl_map *map);
 
 struct isl_set *isl_set_normalize(struct isl_set *set);
+__isl_give isl_map *isl_map_normalize(__isl_take isl_map *map);
 
 struct isl_set *isl_set_drop_vars(
 		struct isl_set *set, unsigned first, unsigned n);
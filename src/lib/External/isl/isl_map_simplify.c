@@ -465,20 +465,20 @@ static __isl_give isl_basic_map *remove_independent_vars_from_divs(
 static void normalize_div_expression(__isl_keep isl_basic_map *bmap, int div)
 {
 	unsigned total = isl_basic_map_total_dim(bmap);
-	isl_ctx *ctx = bmap->ctx;
+	isl_int gcd;
 
 	if (isl_int_is_zero(bmap->div[div][0]))
 		return;
-	isl_seq_gcd(bmap->div[div] + 2, total, &ctx->normalize_gcd);
-	isl_int_gcd(ctx->normalize_gcd, ctx->normalize_gcd, bmap->div[div][0]);
-	if (isl_int_is_one(ctx->normalize_gcd))
-		return;
-	isl_int_fdiv_q(bmap->div[div][1], bmap->div[div][1],
-			ctx->normalize_gcd);
-	isl_int_divexact(bmap->div[div][0], bmap->div[div][0],
-			ctx->normalize_gcd);
-	isl_seq_scale_down(bmap->div[div] + 2, bmap->div[div] + 2,
-			ctx->normalize_gcd, total);
+	isl_int_init(gcd);
+	isl_seq_gcd(bmap->div[div] + 2, total, &gcd);
+	isl_int_gcd(gcd, gcd, bmap->div[div][0]);
+	if (!isl_int_is_one(gcd)) {
+		isl_int_fdiv_q(bmap->div[div][1], bmap->div[div][1], gcd);
+		isl_int_divexact(bmap->div[div][0], bmap->div[div][0], gcd);
+		isl_seq_scale_down(bmap->div[div] + 2, bmap->div[div] + 2,
+				gcd, total);
+	}
+	isl_int_clear(gcd);
 }
 
 /* Remove any common factor in numerator and denominator of a div expression,
@@ -2840,6 +2840,147 @@ isl_bool isl_set_is_disjoint(__isl_keep isl_set *set1, __isl_keep isl_set *set2)
 	return isl_map_is_disjoint(set1, set2);
 }
 
+/* An object for checking many basic maps for disjointness
+ * against the same map.
+ *
+ * "map" is the map against which the basic maps are checked and
+ * "tab" contains a tableau for each of its basic maps,
+ * or NULL if the basic map is obviously empty.
+ * The tableaus are extended with the constraints of the basic map
+ * that is being checked and are then rolled back, such that they
+ * only need to be constructed once.
+ */
+struct isl_map_feasibility {
+	isl_map *map;
+	struct isl_tab **tab;
+};
+
+isl_ctx *isl_map_feasibility_get_ctx(__isl_keep isl_map_feasibility *f)
+{
+	return f ? isl_map_get_ctx(f->map) : NULL;
+}
+
+/* Construct an isl_map_feasibility object for checking basic maps
+ * for disjointness against "map".
+ */
+__isl_give isl_map_feasibility *isl_map_feasibility_alloc(
+	__isl_take isl_map *map)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_map_feasibility *f;
+
+	if (!map)
+		return NULL;
+	ctx = isl_map_get_ctx(map);
+	f = isl_calloc_type(ctx, struct isl_map_feasibility);
+	if (!f)
+		goto error;
+	f->map = map;
+	f->tab = isl_calloc_array(ctx, struct isl_tab *, map->n);
+	if (map->n && !f->tab)
+		return isl_map_feasibility_free(f);
+	for (i = 0; i < map->n; ++i) {
+		if (ISL_F_ISSET(map->p[i], ISL_BASIC_MAP_EMPTY))
+			continue;
+		f->tab[i] = isl_tab_from_basic_map(map->p[i], 0);
+		if (!f->tab[i])
+			return isl_map_feasibility_free(f);
+	}
+
+	return f;
+error:
+	isl_map_free(map);
+	return NULL;
+}
+
+__isl_null isl_map_feasibility *isl_map_feasibility_free(
+	__isl_take isl_map_feasibility *f)
+{
+	int i;
+
+	if (!f)
+		return NULL;
+	if (f->tab)
+		for (i = 0; i < f->map->n; ++i)
+			isl_tab_free(f->tab[i]);
+	free(f->tab);
+	isl_map_free(f->map);
+	free(f);
+	return NULL;
+}
+
+/* Is the intersection of the basic map at position "i" of f->map
+ * with "bmap" empty?
+ * This is the slow path, used whenever the tableau cannot
+ * produce a definitive answer.
+ */
+static isl_bool basic_map_intersect_is_empty(__isl_keep isl_map_feasibility *f,
+	int i, __isl_keep isl_basic_map *bmap)
+{
+	isl_basic_map *test;
+	isl_bool empty;
+
+	test = isl_basic_map_intersect(isl_basic_map_copy(f->map->p[i]),
+					isl_basic_map_copy(bmap));
+	empty = isl_basic_map_is_empty(test);
+	isl_basic_map_free(test);
+
+	return empty;
+}
+
+/* Are the map represented by "f" and "bmap" disjoint?
+ *
+ * If "bmap" does not have any existentially quantified variables,
+ * then we first check whether its constraints are (rationally) compatible
+ * with those of each of the basic maps in the tableaus of "f".
+ * If they are not, then this basic map is disjoint from "bmap".
+ * If they are and the tableau is rational or if it has an integral
+ * sample value while the basic map has no existentially quantified
+ * variables of its own, then the intersection is known to be non-empty.
+ * Otherwise, we fall back on computing the intersection explicitly.
+ */
+isl_bool isl_map_feasibility_is_disjoint(__isl_keep isl_map_feasibility *f,
+	__isl_keep isl_basic_map *bmap)
+{
+	int i;
+	isl_bool equal;
+
+	if (!f || !bmap)
+		return isl_bool_error;
+	equal = isl_space_is_equal(f->map->dim, bmap->dim);
+	if (equal < 0)
+		return isl_bool_error;
+	if (!equal)
+		isl_die(isl_map_feasibility_get_ctx(f), isl_error_invalid,
+			"spaces don't match", return isl_bool_error);
+
+	for (i = 0; i < f->map->n; ++i) {
+		int integral = 0;
+		isl_bool empty;
+
+		if (!f->tab[i])
+			continue;
+		if (bmap->n_div == 0) {
+			empty = isl_tab_is_empty_with(f->tab[i], bmap,
+							&integral);
+			if (empty < 0)
+				return isl_bool_error;
+			if (empty)
+				continue;
+			if (f->tab[i]->rational ||
+			    ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL) ||
+			    (integral && f->map->p[i]->n_div == 0))
+				return isl_bool_false;
+		}
+		empty = basic_map_intersect_is_empty(f, i, bmap);
+		if (empty < 0 || !empty)
+			return empty;
+	}
+
+	return isl_bool_true;
+}
+
 /* Check if we can combine a given div with lower bound l and upper
  * bound u with some other div and if so return that other div.
  * Otherwise return -1.
@@ -3441,24 +3582,24 @@ static int has_multiple_var_equality(__isl_keep isl_basic_map *bmap)
 static __isl_give isl_vec *normalize_constraint(__isl_take isl_vec *v,
 	int *tightened)
 {
-	isl_ctx *ctx;
+	isl_int gcd;
 
 	if (!v)
 		return NULL;
-	ctx = isl_vec_get_ctx(v);
-	isl_seq_gcd(v->el + 1, v->size - 1, &ctx->normalize_gcd);
-	if (isl_int_is_zero(ctx->normalize_gcd))
-		return v;
-	if (isl_int_is_one(ctx->normalize_gcd))
+	isl_int_init(gcd);
+	isl_seq_gcd(v->el + 1, v->size - 1, &gcd);
+	if (isl_int_is_zero(gcd) || isl_int_is_one(gcd)) {
+		isl_int_clear(gcd);
 		return v;
+	}
 	v = isl_vec_cow(v);
-	if (!v)
-		return NULL;
-	if (tightened && !isl_int_is_divisible_by(v->el[0], ctx->normalize_gcd))
-		*tightened = 1;
-	isl_int_fdiv_q(v->el[0], v->el[0], ctx->normalize_gcd);
-	isl_seq_scale_down(v->el + 1, v->el + 1, ctx->normalize_gcd,
-				v->size - 1);
+	if (v) {
+		if (tightened && !isl_int_is_divisible_by(v->el[0], gcd))
+			*tightened = 1;
+		isl_int_fdiv_q(v->el[0], v->el[0], gcd);
+		isl_seq_scale_down(v->el + 1, v->el + 1, gcd, v->size - 1);
+	}
+	isl_int_clear(gcd);
 	return v;
 }
 
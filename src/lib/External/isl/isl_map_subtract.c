@@ -8,7 +8,9 @@
  */
 
 #include <isl_map_private.h>
+#include <isl_memo.h>
 #include <isl_seq.h>
+#include <isl_trace.h>
 #include <isl/set.h>
 #include <isl/map.h>
 #include "isl_tab.h"
@@ -856,10 +858,55 @@ static isl_bool map_is_subset(__isl_keep isl_map *map1,
 	return is_subset;
 }
 
-isl_bool isl_map_is_subset(__isl_keep isl_map *map1, __isl_keep isl_map *map2)
+/* Is "map1" a subset of "map2"?
+ * Reuse the result of an earlier test on structurally identical maps
+ * if the memo table of the ctx is enabled.
+ */
+static isl_bool memo_is_subset(__isl_keep isl_map *map1,
+	__isl_keep isl_map *map2)
 {
-	return isl_map_align_params_map_map_and_test(map1, map2,
+	int found;
+	isl_ctx *ctx;
+	isl_bool is_subset;
+
+	if (!isl_memo_is_enabled(map1->ctx))
+		return isl_map_align_params_map_map_and_test(map1, map2,
 							&map_is_subset);
+
+	ctx = isl_map_get_ctx(map1);
+	is_subset = isl_memo_find_bool(ctx, isl_memo_is_subset,
+					map1, map2, &found);
+	if (found)
+		return is_subset;
+	is_subset = isl_map_align_params_map_map_and_test(map1, map2,
+							&map_is_subset);
+	isl_memo_add_bool(ctx, isl_memo_is_subset, map1, map2, is_subset);
+	return is_subset;
+}
+
+/* Is "map1" a subset of "map2"?
+ * Record the test in the trace of the ctx.
+ */
+isl_bool isl_map_is_subset(__isl_keep isl_map *map1, __isl_keep isl_map *map2)
+{
+	isl_ctx *ctx;
+	isl_bool is_subset;
+	struct isl_trace_call call;
+
+	if (!map1 || !map2)
+		return isl_bool_error;
+
+	ctx = isl_map_get_ctx(map1);
+	isl_trace_enter(ctx, &call, "map_is_subset");
+	if (call.op) {
+		isl_trace_add_arg(&call, isl_map_to_str(map1));
+		isl_trace_add_arg(&call, isl_map_to_str(map2));
+	}
+	is_subset = memo_is_subset(map1, map2);
+	if (call.op)
+		isl_trace_add_res(&call, isl_trace_bool_to_str(is_subset));
+	isl_trace_leave(ctx, &call);
+	return is_subset;
 }
 
 isl_bool isl_set_is_subset(__isl_keep isl_set *set1, __isl_keep isl_set *set2)
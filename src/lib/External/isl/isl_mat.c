@@ -30,7 +30,7 @@ struct isl_mat *isl_mat_alloc(struct isl_ctx *ctx,
 	int i;
 	struct isl_mat *mat;
 
-	mat = isl_alloc_type(ctx, struct isl_mat);
+	mat = isl_slab_alloc_type(ctx, struct isl_mat);
 	if (!mat)
 		return NULL;
 
@@ -56,7 +56,7 @@ struct isl_mat *isl_mat_alloc(struct isl_ctx *ctx,
 	return mat;
 error:
 	isl_blk_free(ctx, mat->block);
-	free(mat);
+	isl_slab_free_type(ctx, mat, struct isl_mat);
 	return NULL;
 }
 
@@ -123,7 +123,7 @@ __isl_give isl_mat *isl_mat_sub_alloc6(isl_ctx *ctx, isl_int **row,
 	int i;
 	struct isl_mat *mat;
 
-	mat = isl_alloc_type(ctx, struct isl_mat);
+	mat = isl_slab_alloc_type(ctx, struct isl_mat);
 	if (!mat)
 		return NULL;
 	mat->row = isl_alloc_array(ctx, isl_int *, n_row);
@@ -140,7 +140,7 @@ __isl_give isl_mat *isl_mat_sub_alloc6(isl_ctx *ctx, isl_int **row,
 	mat->flags = ISL_MAT_BORROWED;
 	return mat;
 error:
-	free(mat);
+	isl_slab_free_type(ctx, mat, struct isl_mat);
 	return NULL;
 }
 
@@ -221,7 +221,7 @@ __isl_null isl_mat *isl_mat_free(__isl_take isl_mat *mat)
 		isl_blk_free(mat->ctx, mat->block);
 	isl_ctx_deref(mat->ctx);
 	free(mat->row);
-	free(mat);
+	isl_slab_free_type(mat->ctx, mat, struct isl_mat);
 
 	return NULL;
 }
@@ -0,0 +1,377 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl_map_private.h>
+#include <isl_space_private.h>
+#include <isl_options_private.h>
+#include <isl/hash.h>
+#include <isl_memo.h>
+
+/* An entry in the memo table of an isl_ctx.
+ *
+ * "op" is the operation that was performed on "key1" (and "key2"
+ * for binary operations) and "hash" is the structural hash of the inputs.
+ * The keys are normalized copies of the inputs, such that they are not
+ * affected by later changes in the representation of the original inputs.
+ * "map" is the result of operations that produce a map and
+ * "b" is the result of the other operations.
+ * "next" points to the next entry in order of insertion.
+ */
+struct isl_memo_entry {
+	enum isl_memo_op	op;
+	uint32_t		hash;
+	isl_map			*key1;
+	isl_map			*key2;
+
+	isl_map			*map;
+	isl_bool		b;
+
+	struct isl_memo_entry	*next;
+};
+
+/* The memo table of an isl_ctx.
+ *
+ * The entries are kept in a hash table and in a list in order
+ * of insertion, from "first" to "last".  When the table is full,
+ * the oldest entry is evicted.
+ */
+struct isl_memo {
+	struct isl_hash_table	table;
+	int			n;
+	struct isl_memo_entry	*first;
+	struct isl_memo_entry	*last;
+
+	unsigned long		n_hit[isl_memo_n_op];
+	unsigned long		n_miss[isl_memo_n_op];
+	unsigned long		n_evict;
+};
+
+static const char *op_name[] = {
+	[isl_memo_coalesce] = "coalesce",
+	[isl_memo_lexmin] = "lexmin",
+	[isl_memo_lexmax] = "lexmax",
+	[isl_memo_is_empty] = "is_empty",
+	[isl_memo_is_subset] = "is_subset",
+};
+
+/* Is the memo table of "ctx" enabled?
+ * The table is not used inside a parallel region since
+ * the maps it holds are shared by all threads.
+ */
+int isl_memo_is_enabled(isl_ctx *ctx)
+{
+	return ctx && !ctx->parallel && ctx->opt->memo_max_entries > 0;
+}
+
+/* Return the memo table of "ctx", allocating it if needed.
+ */
+static struct isl_memo *get_memo(isl_ctx *ctx)
+{
+	struct isl_memo *memo;
+
+	if (ctx->memo)
+		return ctx->memo;
+	memo = isl_calloc_type(ctx, struct isl_memo);
+	if (!memo)
+		return NULL;
+	if (isl_hash_table_init(ctx, &memo->table, 0) < 0) {
+		free(memo);
+		return NULL;
+	}
+	ctx->memo = memo;
+	return memo;
+}
+
+/* Do "space1" and "space2" have the same identifiers on all their
+ * input and output dimensions?
+ * isl_space_is_equal only compares the tuples as a whole.
+ */
+static isl_bool has_equal_dim_ids(__isl_keep isl_space *space1,
+	__isl_keep isl_space *space2)
+{
+	enum isl_dim_type types[] = { isl_dim_in, isl_dim_out };
+	int i, t;
+
+	for (t = 0; t < 2; ++t) {
+		unsigned n = isl_space_dim(space1, types[t]);
+
+		for (i = 0; i < n; ++i) {
+			isl_id *id1, *id2;
+
+			id1 = isl_space_get_dim_id(space1, types[t], i);
+			id2 = isl_space_get_dim_id(space2, types[t], i);
+			isl_id_free(id1);
+			isl_id_free(id2);
+			if (id1 != id2)
+				return isl_bool_false;
+		}
+	}
+
+	return isl_bool_true;
+}
+
+/* Are "map1" and "map2" structurally equal, including
+ * the identifiers of their dimensions?
+ * Either of them may be NULL, in which case both need to be NULL.
+ */
+static isl_bool key_is_equal(__isl_keep isl_map *map1,
+	__isl_keep isl_map *map2)
+{
+	isl_bool equal;
+
+	if (!map1 || !map2)
+		return map1 == map2;
+	equal = isl_map_plain_is_equal(map1, map2);
+	if (equal <= 0)
+		return equal;
+	return has_equal_dim_ids(map1->dim, map2->dim);
+}
+
+static uint32_t key_hash(enum isl_memo_op op, __isl_keep isl_map *map1,
+	__isl_keep isl_map *map2)
+{
+	uint32_t hash = isl_hash_init();
+
+	isl_hash_byte(hash, op);
+	isl_hash_hash(hash, isl_space_get_hash(map1->dim));
+	isl_hash_hash(hash, isl_map_get_hash(map1));
+	if (map2) {
+		isl_hash_hash(hash, isl_space_get_hash(map2->dim));
+		isl_hash_hash(hash, isl_map_get_hash(map2));
+	}
+	return hash;
+}
+
+/* The value that is being looked up in the hash table.
+ */
+struct isl_memo_lookup {
+	enum isl_memo_op	op;
+	isl_map			*map1;
+	isl_map			*map2;
+};
+
+static int has_key(const void *entry, const void *val)
+{
+	const struct isl_memo_entry *e = entry;
+	const struct isl_memo_lookup *l = val;
+
+	if (e->op != l->op)
+		return 0;
+	return key_is_equal(e->key1, l->map1) == isl_bool_true &&
+	       key_is_equal(e->key2, l->map2) == isl_bool_true;
+}
+
+static int is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+static struct isl_memo_entry *find(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map1, __isl_keep isl_map *map2)
+{
+	struct isl_memo *memo;
+	struct isl_memo_lookup l = { op, map1, map2 };
+	struct isl_hash_table_entry *entry;
+	uint32_t hash;
+
+	if (!isl_memo_is_enabled(ctx) || !map1)
+		return NULL;
+	memo = get_memo(ctx);
+	if (!memo)
+		return NULL;
+
+	hash = key_hash(op, map1, map2);
+	entry = isl_hash_table_find(ctx, &memo->table, hash, &has_key, &l, 0);
+	if (!entry) {
+		memo->n_miss[op]++;
+		return NULL;
+	}
+	memo->n_hit[op]++;
+	return entry->data;
+}
+
+static void entry_free(struct isl_memo_entry *e)
+{
+	isl_map_free(e->key1);
+	isl_map_free(e->key2);
+	isl_map_free(e->map);
+	free(e);
+}
+
+/* Remove the oldest entry from the memo table.
+ */
+static void evict(isl_ctx *ctx, struct isl_memo *memo)
+{
+	struct isl_memo_entry *e = memo->first;
+	struct isl_hash_table_entry *entry;
+
+	memo->first = e->next;
+	if (!memo->first)
+		memo->last = NULL;
+	entry = isl_hash_table_find(ctx, &memo->table, e->hash,
+					&is_entry, e, 0);
+	if (entry)
+		isl_hash_table_remove(ctx, &memo->table, entry);
+	memo->n--;
+	memo->n_evict++;
+	entry_free(e);
+}
+
+/* Return a private normalized copy of "map" for use as a key.
+ */
+static __isl_give isl_map *key_copy(__isl_keep isl_map *map)
+{
+	if (!map)
+		return NULL;
+	return isl_map_normalize(isl_map_dup(map));
+}
+
+/* Add an entry for the result of applying "op" to "map1" (and "map2").
+ * If the table already contains the maximal number of entries,
+ * then the oldest entries are evicted first.
+ * Failures are ignored since the table is only a cache.
+ */
+static struct isl_memo_entry *add(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map1, __isl_keep isl_map *map2)
+{
+	struct isl_memo *memo;
+	struct isl_memo_entry *e;
+	struct isl_memo_lookup l = { op, map1, map2 };
+	struct isl_hash_table_entry *entry;
+	uint32_t hash;
+
+	if (!isl_memo_is_enabled(ctx) || !map1)
+		return NULL;
+	memo = get_memo(ctx);
+	if (!memo)
+		return NULL;
+
+	while (memo->n >= ctx->opt->memo_max_entries)
+		evict(ctx, memo);
+
+	hash = key_hash(op, map1, map2);
+	entry = isl_hash_table_find(ctx, &memo->table, hash, &has_key, &l, 1);
+	if (!entry)
+		return NULL;
+	if (entry->data)
+		return NULL;
+
+	e = isl_calloc_type(ctx, struct isl_memo_entry);
+	if (!e)
+		goto error;
+	e->op = op;
+	e->hash = hash;
+	e->key1 = key_copy(map1);
+	e->key2 = key_copy(map2);
+	if (!e->key1 || (map2 && !e->key2))
+		goto error;
+
+	entry->data = e;
+	if (memo->last)
+		memo->last->next = e;
+	else
+		memo->first = e;
+	memo->last = e;
+	memo->n++;
+	return e;
+error:
+	if (e)
+		entry_free(e);
+	isl_hash_table_remove(ctx, &memo->table, entry);
+	return NULL;
+}
+
+/* Return a copy of the memoized result of applying "op" to "map",
+ * or NULL if there is no such result.
+ */
+__isl_give isl_map *isl_memo_find_map(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map)
+{
+	struct isl_memo_entry *e;
+
+	e = find(ctx, op, map, NULL);
+	return e ? isl_map_copy(e->map) : NULL;
+}
+
+/* Remember that applying "op" to "map" resulted in "res".
+ */
+void isl_memo_add_map(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map, __isl_keep isl_map *res)
+{
+	struct isl_memo_entry *e;
+
+	if (!res)
+		return;
+	e = add(ctx, op, map, NULL);
+	if (e)
+		e->map = isl_map_copy(res);
+}
+
+/* Look up the memoized result of applying "op" to "map1" and "map2".
+ * "map2" is NULL for unary operations.
+ * Set *found to 1 and return the result if there is such a result.
+ * Otherwise, set *found to 0.
+ */
+isl_bool isl_memo_find_bool(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map1, __isl_keep isl_map *map2, int *found)
+{
+	struct isl_memo_entry *e;
+
+	e = find(ctx, op, map1, map2);
+	*found = e != NULL;
+	return e ? e->b : isl_bool_error;
+}
+
+/* Remember that applying "op" to "map1" and "map2" resulted in "res".
+ */
+void isl_memo_add_bool(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map1, __isl_keep isl_map *map2, isl_bool res)
+{
+	struct isl_memo_entry *e;
+
+	if (res < 0)
+		return;
+	e = add(ctx, op, map1, map2);
+	if (e)
+		e->b = res;
+}
+
+void isl_memo_print_stats(isl_ctx *ctx)
+{
+	int i;
+	struct isl_memo *memo = ctx->memo;
+
+	if (!memo)
+		return;
+	for (i = 0; i < isl_memo_n_op; ++i) {
+		unsigned long n = memo->n_hit[i] + memo->n_miss[i];
+
+		if (!n)
+			continue;
+		fprintf(stderr, "memo %s: lookups: %lu, hits: %lu (%.1f%%)\n",
+			op_name[i], n, memo->n_hit[i],
+			100.0 * memo->n_hit[i] / n);
+	}
+	fprintf(stderr, "memo entries: %d, evicted: %lu\n",
+		memo->n, memo->n_evict);
+}
+
+/* Free the memo table of "ctx" along with all the maps it keeps alive.
+ */
+void isl_memo_free(isl_ctx *ctx)
+{
+	struct isl_memo *memo = ctx->memo;
+	struct isl_memo_entry *e, *next;
+
+	if (!memo)
+		return;
+	for (e = memo->first; e; e = next) {
+		next = e->next;
+		entry_free(e);
+	}
+	isl_hash_table_clear(&memo->table);
+	free(memo);
+	ctx->memo = NULL;
+}
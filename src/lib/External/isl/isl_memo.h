@@ -0,0 +1,41 @@
+#ifndef ISL_MEMO_H
+#define ISL_MEMO_H
+
+#include <isl/ctx.h>
+#include <isl/map.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* The operations whose results can be kept in the memo table
+ * of an isl_ctx.
+ */
+enum isl_memo_op {
+	isl_memo_coalesce,
+	isl_memo_lexmin,
+	isl_memo_lexmax,
+	isl_memo_is_empty,
+	isl_memo_is_subset,
+	isl_memo_n_op
+};
+
+struct isl_memo;
+
+int isl_memo_is_enabled(isl_ctx *ctx);
+__isl_give isl_map *isl_memo_find_map(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map);
+void isl_memo_add_map(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map, __isl_keep isl_map *res);
+isl_bool isl_memo_find_bool(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map1, __isl_keep isl_map *map2, int *found);
+void isl_memo_add_bool(isl_ctx *ctx, enum isl_memo_op op,
+	__isl_keep isl_map *map1, __isl_keep isl_map *map2, isl_bool res);
+void isl_memo_print_stats(isl_ctx *ctx);
+void isl_memo_free(isl_ctx *ctx);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
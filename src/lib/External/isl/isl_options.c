@@ -199,8 +199,21 @@ ISL_ARG_BOOL(struct isl_options, ast_build_allow_or, 0,
 	"ast-build-allow-or", 1, "generate if conditions with disjunctions")
 ISL_ARG_BOOL(struct isl_options, print_stats, 0, "print-stats", 0,
 	"print statistics for every isl_ctx")
+ISL_ARG_BOOL(struct isl_options, slab_alloc, 0, "slab-alloc", 1,
+	"allocate small objects from a per-isl_ctx slab arena")
+ISL_ARG_INT(struct isl_options, memo_max_entries, 0,
+	"memo-max-entries", "n", 0, "keep the results of up to <n> "
+	"coalesce, lexmin, lexmax, emptiness and subset computations "
+	"per isl_ctx for reuse on structurally identical inputs")
+ISL_ARG_STR(struct isl_options, trace_file, 0, "trace-file", "file", NULL,
+	"record the outermost calls to expensive operations in <file>")
+ISL_ARG_INT(struct isl_options, union_map_threads, 0,
+	"union-map-threads", "n", 0, "use <n> threads for the independent "
+	"per-space work in some union map operations")
 ISL_ARG_ULONG(struct isl_options, max_operations, 0,
 	"max-operations", 0, "default number of maximal operations per isl_ctx")
+ISL_ARG_ULONG(struct isl_options, max_memory, 0,
+	"max-memory", 0, "default maximal memory usage in bytes per isl_ctx")
 ISL_ARG_VERSION(print_version)
 ISL_ARGS_END
 
@@ -325,3 +338,28 @@ ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_allow_or)
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_allow_or)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	slab_alloc)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	slab_alloc)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	print_stats)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	print_stats)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	memo_max_entries)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	memo_max_entries)
+
+ISL_CTX_SET_STR_DEF(isl_options, struct isl_options, isl_options_args,
+	trace_file)
+ISL_CTX_GET_STR_DEF(isl_options, struct isl_options, isl_options_args,
+	trace_file)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	union_map_threads)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	union_map_threads)
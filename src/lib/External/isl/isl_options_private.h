@@ -61,7 +61,12 @@ struct isl_options {
 	int			ast_build_allow_or;
 
 	int			print_stats;
+	int			slab_alloc;
+	int			memo_max_entries;
+	char			*trace_file;
+	int			union_map_threads;
 	unsigned long		max_operations;
+	unsigned long		max_memory;
 };
 
 #endif
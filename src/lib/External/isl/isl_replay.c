@@ -0,0 +1,133 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+/* Replay a trace of calls recorded through the "trace-file" option.
+ *
+ * The trace is read from standard input and each recorded call is
+ * performed again on the recorded arguments.
+ * For each call, the time recorded in the trace and the time it takes
+ * to perform the call now are printed, followed by a summary per operation.
+ * The result of each call is compared to the recorded result and
+ * the program exits with a non-zero status if any of them differ.
+ *
+ * The recorded calls are performed using the isl options specified
+ * on the command line, which may therefore need to match the options
+ * that were in effect when the trace was recorded.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <isl/options.h>
+#include <isl_trace.h>
+
+struct replay_options {
+	struct isl_options	*isl;
+	int			 repeat;
+	int			 verbose;
+};
+
+ISL_ARGS_START(struct replay_options, replay_options_args)
+ISL_ARG_CHILD(struct replay_options, isl, "isl", &isl_options_args,
+	"isl options")
+ISL_ARG_INT(struct replay_options, repeat, 0, "repeat", "n", 1,
+	"perform each call <n> times")
+ISL_ARG_BOOL(struct replay_options, verbose, 0, "verbose", 1,
+	"print the timings of each call")
+ISL_ARGS_END
+
+ISL_ARG_DEF(replay_options, struct replay_options, replay_options_args)
+
+/* The total times spent in all calls to a given operation.
+ */
+struct replay_summary {
+	const char	*op;
+	int		n;
+	double		recorded;
+	double		replayed;
+};
+
+
+/* Add the times of "call" to the summary of its operation in "summary",
+ * which has room for "n" operations.
+ */
+static void add_to_summary(struct replay_summary *summary, int n,
+	const char *op, double recorded, double replayed)
+{
+	int i;
+
+	for (i = 0; i < n && summary[i].op; ++i)
+		if (!strcmp(summary[i].op, op))
+			break;
+	if (i >= n)
+		return;
+	if (!summary[i].op)
+		summary[i].op = strdup(op);
+	summary[i].n++;
+	summary[i].recorded += recorded;
+	summary[i].replayed += replayed;
+}
+
+#define N_OP	16
+
+int main(int argc, char **argv)
+{
+	int i, r;
+	int n_call = 0, n_differ = 0, n_fail = 0;
+	isl_ctx *ctx;
+	struct replay_options *options;
+	struct isl_trace_record call = { { 0 } };
+	struct replay_summary summary[N_OP] = { { 0 } };
+
+	options = replay_options_new_with_defaults();
+	assert(options);
+	argc = replay_options_parse(options, argc, argv, ISL_ARG_ALL);
+	if (options->repeat < 1)
+		options->repeat = 1;
+
+	ctx = isl_ctx_alloc_with_options(&replay_options_args, options);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+
+	while ((r = isl_trace_read_record(stdin, &call)) > 0) {
+		double replayed = 0;
+		int differs;
+
+		differs = isl_trace_replay(ctx, &call, options->repeat,
+					    &replayed);
+
+		if (options->verbose)
+			printf("%d %s %.6f %.6f%s\n", n_call, call.op,
+				call.recorded, replayed,
+				differs < 0 ? " unknown" :
+				differs ? " differs" : "");
+		if (differs < 0)
+			n_fail++;
+		else if (differs)
+			n_differ++;
+		else
+			add_to_summary(summary, N_OP, call.op,
+					call.recorded, replayed);
+		n_call++;
+		isl_trace_record_clear(&call);
+	}
+	isl_trace_record_clear(&call);
+	if (r < 0) {
+		fprintf(stderr, "malformed trace after %d calls\n", n_call);
+		n_fail++;
+	}
+
+	for (i = 0; i < N_OP && summary[i].op; ++i) {
+		printf("%s: calls: %d, recorded: %.3f, replayed: %.3f\n",
+			summary[i].op, summary[i].n,
+			summary[i].recorded, summary[i].replayed);
+		free((char *) summary[i].op);
+	}
+	printf("calls: %d, differing: %d, failed: %d\n",
+		n_call, n_differ, n_fail);
+
+	isl_ctx_free(ctx);
+
+	return n_differ || n_fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
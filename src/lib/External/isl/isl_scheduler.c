@@ -31,6 +31,7 @@
 #include <isl_options_private.h>
 #include <isl_tarjan.h>
 #include <isl_morph.h>
+#include <isl_trace.h>
 
 /*
  * The scheduling algorithm implemented in this file was inspired by
@@ -4274,7 +4275,7 @@ static __isl_give isl_schedule_node *compute_schedule(isl_schedule_node *node,
  * However, the returned schedule contains the original domain
  * (before this intersection).
  */
-__isl_give isl_schedule *isl_schedule_constraints_compute_schedule(
+static __isl_give isl_schedule *compute_schedule_constraints(
 	__isl_take isl_schedule_constraints *sc)
 {
 	isl_ctx *ctx = isl_schedule_constraints_get_ctx(sc);
@@ -4343,6 +4344,41 @@ error:
 	return NULL;
 }
 
+/* Compute a schedule on sc->domain that respects the given schedule
+ * constraints.
+ *
+ * The call is recorded in the trace of the ctx with as arguments
+ * the domain, the context and the constraints of each type
+ * in the order of isl_edge_type and with as result the schedule tree.
+ */
+__isl_give isl_schedule *isl_schedule_constraints_compute_schedule(
+	__isl_take isl_schedule_constraints *sc)
+{
+	isl_ctx *ctx;
+	isl_schedule *sched;
+	enum isl_edge_type i;
+	struct isl_trace_call call;
+
+	if (!sc)
+		return NULL;
+
+	ctx = isl_schedule_constraints_get_ctx(sc);
+	isl_trace_enter(ctx, &call, "schedule_constraints_compute_schedule");
+	if (call.op) {
+		isl_trace_add_arg(&call, isl_union_set_to_str(sc->domain));
+		isl_trace_add_arg(&call, isl_set_to_str(sc->context));
+		for (i = isl_edge_first; i <= isl_edge_last; ++i)
+			isl_trace_add_arg(&call,
+				    isl_union_map_to_str(sc->constraint[i]));
+	}
+	sched = compute_schedule_constraints(sc);
+	if (call.op)
+		isl_trace_add_res(&call, isl_trace_schedule_to_str(sched));
+	isl_trace_leave(ctx, &call);
+
+	return sched;
+}
+
 /* Compute a schedule for the given union of domains that respects
  * all the validity dependences and minimizes
  * the dependence distances over the proximity dependences.
@@ -101,15 +101,99 @@ void isl_seq_fdiv_r(isl_int *dst, isl_int *src, isl_int m, unsigned len)
 		isl_int_fdiv_r(dst[i], src[i], m);
 }
 
+#ifdef USE_SMALL_INT_OPT
+
+/* Return 1 if all "len" elements of "p" are stored in small representation.
+ * The tags are combined without branching such that the loop
+ * can be vectorized.
+ */
+static int isl_seq_is_small(isl_int *p, unsigned len)
+{
+	int i;
+	isl_sioimath tag = 1;
+
+	for (i = 0; i < len; ++i)
+		tag &= p[i];
+
+	return isl_sioimath_is_small(tag);
+}
+
+/* Try and compute dst = m1 * src1 + m2 * src2 on native 64-bit integers.
+ * This is only possible if m1, m2 and all elements of src1 and src2
+ * are stored in small representation.  Their absolute values are then
+ * at most INT32_MAX such that neither the products nor their sum
+ * can overflow an int64_t.  Only results that do not fit
+ * in small representation are promoted to big representation.
+ *
+ * Return 1 if the result has been computed and 0 if the caller
+ * needs to fall back to arbitrary precision arithmetic.
+ */
+static int isl_seq_combine_small(isl_int *dst, isl_int m1, isl_int *src1,
+	isl_int m2, isl_int *src2, unsigned len)
+{
+	int i;
+	int32_t s1, s2;
+
+	if (!isl_sioimath_decode_small(m1, &s1) ||
+	    !isl_sioimath_decode_small(m2, &s2))
+		return 0;
+	if (!isl_seq_is_small(src1, len) || !isl_seq_is_small(src2, len))
+		return 0;
+
+	for (i = 0; i < len; ++i) {
+		int64_t v;
+
+		v = (int64_t) s1 * isl_sioimath_get_small(src1[i]) +
+		    (int64_t) s2 * isl_sioimath_get_small(src2[i]);
+		if (isl_sioimath_is_small(dst[i]) &&
+		    ISL_SIOIMATH_SMALL_MIN <= v && v <= ISL_SIOIMATH_SMALL_MAX)
+			dst[i] = isl_sioimath_encode_small(v);
+		else
+			isl_sioimath_set_int64(&dst[i], v);
+	}
+
+	return 1;
+}
+
+/* Compute the gcd of the elements of "p" on native integers,
+ * assuming they are all stored in small representation.
+ */
+static int32_t isl_seq_gcd_small(isl_int *p, unsigned len)
+{
+	int i;
+	uint32_t gcd = 0;
+
+	for (i = 0; gcd != 1 && i < len; ++i) {
+		int32_t v = isl_sioimath_get_small(p[i]);
+		uint32_t a = v < 0 ? -v : v;
+
+		while (a != 0) {
+			uint32_t t = gcd % a;
+			gcd = a;
+			a = t;
+		}
+	}
+
+	return gcd;
+}
+
+#endif /* USE_SMALL_INT_OPT */
+
 void isl_seq_combine(isl_int *dst, isl_int m1, isl_int *src1,
 			isl_int m2, isl_int *src2, unsigned len)
 {
 	int i;
 	isl_int tmp;
 
+	if (dst == src1 && isl_int_is_one(m1) && isl_int_is_zero(m2))
+		return;
+
+#ifdef USE_SMALL_INT_OPT
+	if (isl_seq_combine_small(dst, m1, src1, m2, src2, len))
+		return;
+#endif
+
 	if (dst == src1 && isl_int_is_one(m1)) {
-		if (isl_int_is_zero(m2))
-			return;
 		for (i = 0; i < len; ++i)
 			isl_int_addmul(src1[i], m2, src2[i]);
 		return;
@@ -236,8 +320,16 @@ int isl_seq_abs_min_non_zero(isl_int *p, unsigned len)
 
 void isl_seq_gcd(isl_int *p, unsigned len, isl_int *gcd)
 {
-	int i, min = isl_seq_abs_min_non_zero(p, len);
+	int i, min;
 
+#ifdef USE_SMALL_INT_OPT
+	if (isl_seq_is_small(p, len)) {
+		isl_int_set_si(*gcd, isl_seq_gcd_small(p, len));
+		return;
+	}
+#endif
+
+	min = isl_seq_abs_min_non_zero(p, len);
 	if (min < 0) {
 		isl_int_set_si(*gcd, 0);
 		return;
@@ -252,14 +344,21 @@ void isl_seq_gcd(isl_int *p, unsigned len, isl_int *gcd)
 	}
 }
 
+/* Divide the elements of "p" by their greatest common divisor.
+ * The divisor is kept in a local variable rather than in "ctx"
+ * since "ctx" may be shared by the threads of a parallel region.
+ */
 void isl_seq_normalize(struct isl_ctx *ctx, isl_int *p, unsigned len)
 {
+	isl_int gcd;
+
 	if (len == 0)
 		return;
-	isl_seq_gcd(p, len, &ctx->normalize_gcd);
-	if (!isl_int_is_zero(ctx->normalize_gcd) &&
-	    !isl_int_is_one(ctx->normalize_gcd))
-		isl_seq_scale_down(p, p, ctx->normalize_gcd, len);
+	isl_int_init(gcd);
+	isl_seq_gcd(p, len, &gcd);
+	if (!isl_int_is_zero(gcd) && !isl_int_is_one(gcd))
+		isl_seq_scale_down(p, p, gcd, len);
+	isl_int_clear(gcd);
 }
 
 void isl_seq_lcm(isl_int *p, unsigned len, isl_int *lcm)
@@ -0,0 +1,192 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <string.h>
+#include <isl_slab.h>
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl_thread.h>
+
+/* A chunk of objects of a single size class.
+ * The objects follow the header, which is padded to ISL_SLAB_ALIGN bytes
+ * such that the objects are as well aligned as memory returned by malloc.
+ */
+struct isl_slab_chunk {
+	union {
+		struct isl_slab_chunk	*next;
+		char			pad[ISL_SLAB_ALIGN];
+	} u;
+};
+
+/* Return the index of the smallest size class that can hold
+ * an object of "size" bytes.
+ */
+static int size_class(size_t size)
+{
+	int c = 0;
+	size_t class_size = ISL_SLAB_ALIGN;
+
+	while (class_size < size) {
+		class_size <<= 1;
+		c++;
+	}
+	return c;
+}
+
+/* Is the slab arena of "ctx" in use?
+ * The decision is taken at the first allocation such that
+ * the "slab_alloc" option can still be changed after the ctx
+ * has been created.
+ */
+static int slab_enabled(isl_ctx *ctx)
+{
+	if (ctx->slab.enabled < 0)
+		ctx->slab.enabled = ctx->opt->slab_alloc;
+	return ctx->slab.enabled;
+}
+
+/* Allocate a new chunk for size class "c" and put all its objects
+ * on the free list.
+ */
+static int add_chunk(isl_ctx *ctx, int c)
+{
+	int i;
+	size_t class_size = (size_t) ISL_SLAB_ALIGN << c;
+	struct isl_slab_pool *pool = &ctx->slab.pool[c];
+	struct isl_slab_chunk *chunk;
+	char *obj;
+
+	chunk = malloc(sizeof(*chunk) + ISL_SLAB_CHUNK_SIZE * class_size);
+	if (!chunk)
+		isl_die(ctx, isl_error_alloc, "allocation failure",
+			return -1);
+	chunk->u.next = ctx->slab.chunks;
+	ctx->slab.chunks = chunk;
+	pool->n_chunk++;
+
+	obj = (char *) (chunk + 1);
+	for (i = ISL_SLAB_CHUNK_SIZE - 1; i >= 0; --i) {
+		void **p = (void **) (obj + i * class_size);
+		*p = pool->free;
+		pool->free = p;
+	}
+	return 0;
+}
+
+/* Allocate an object of "size" bytes for use inside "ctx",
+ * assuming the caller holds the lock on "ctx".
+ */
+static void *slab_alloc(isl_ctx *ctx, size_t size)
+{
+	int c;
+	void *p;
+	struct isl_slab_pool *pool;
+
+	if (!slab_enabled(ctx) || size > ISL_SLAB_MAX_SIZE)
+		return isl_malloc_or_die(ctx, size);
+	if (isl_ctx_next_operation(ctx) < 0)
+		return NULL;
+
+	c = size_class(size);
+	pool = &ctx->slab.pool[c];
+	if (pool->free)
+		pool->n_reuse++;
+	else if (add_chunk(ctx, c) < 0)
+		return NULL;
+	p = pool->free;
+	pool->free = *(void **) p;
+	pool->n_alloc++;
+	if (++pool->n_live > pool->max_live)
+		pool->max_live = pool->n_live;
+	return p;
+}
+
+/* Allocate an object of "size" bytes for use inside "ctx".
+ * Small objects are taken from the free list of their size class,
+ * larger objects or all objects if the slab arena has been disabled
+ * are allocated using isl_malloc_or_die.
+ * The object needs to be released using isl_slab_free
+ * with the same "size".
+ * The arena is shared by all threads of a parallel region,
+ * so it is only accessed while holding the lock on "ctx".
+ */
+void *isl_slab_alloc(isl_ctx *ctx, size_t size)
+{
+	void *p;
+
+	if (!ctx)
+		return NULL;
+	isl_ctx_lock(ctx);
+	p = slab_alloc(ctx, size);
+	isl_ctx_unlock(ctx);
+	return p;
+}
+
+/* Allocate a zero-initialized object of "size" bytes for use inside "ctx".
+ */
+void *isl_slab_calloc(isl_ctx *ctx, size_t size)
+{
+	void *p;
+
+	p = isl_slab_alloc(ctx, size);
+	if (p)
+		memset(p, 0, size);
+	return p;
+}
+
+/* Release an object of "size" bytes allocated by isl_slab_alloc.
+ * The memory is put back on the free list of its size class and
+ * only returned to the system when the ctx is freed.
+ */
+void isl_slab_free(isl_ctx *ctx, void *p, size_t size)
+{
+	struct isl_slab_pool *pool;
+
+	if (!p)
+		return;
+	if (ctx->slab.enabled <= 0 || size > ISL_SLAB_MAX_SIZE) {
+		free(p);
+		return;
+	}
+
+	isl_ctx_lock(ctx);
+	pool = &ctx->slab.pool[size_class(size)];
+	*(void **) p = pool->free;
+	pool->free = p;
+	pool->n_live--;
+	isl_ctx_unlock(ctx);
+}
+
+void isl_slab_print_stats(isl_ctx *ctx)
+{
+	int c;
+
+	if (ctx->slab.enabled <= 0)
+		return;
+	for (c = 0; c < ISL_SLAB_N_CLASS; ++c) {
+		struct isl_slab_pool *pool = &ctx->slab.pool[c];
+
+		if (!pool->n_alloc)
+			continue;
+		fprintf(stderr, "slab %d: allocations: %lu, reused: %lu, "
+			"chunks: %lu, live: %lu, max live: %lu\n",
+			ISL_SLAB_ALIGN << c, pool->n_alloc, pool->n_reuse,
+			pool->n_chunk, pool->n_live, pool->max_live);
+	}
+}
+
+/* Release all chunks of the slab arena of "ctx" in one go.
+ * No objects allocated from the arena may be used afterwards.
+ */
+void isl_slab_clear(isl_ctx *ctx)
+{
+	struct isl_slab_chunk *chunk, *next;
+
+	for (chunk = ctx->slab.chunks; chunk; chunk = next) {
+		next = chunk->u.next;
+		free(chunk);
+	}
+	memset(&ctx->slab, 0, sizeof(ctx->slab));
+	ctx->slab.enabled = -1;
+}
@@ -0,0 +1,64 @@
+#ifndef ISL_SLAB_H
+#define ISL_SLAB_H
+
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Objects of at most ISL_SLAB_MAX_SIZE bytes are carved out of chunks
+ * of ISL_SLAB_CHUNK_SIZE objects of the same size class.
+ * The size classes are multiples of ISL_SLAB_ALIGN,
+ * doubling from ISL_SLAB_ALIGN to ISL_SLAB_MAX_SIZE.
+ */
+#define ISL_SLAB_ALIGN		16
+#define ISL_SLAB_N_CLASS	5
+#define ISL_SLAB_MAX_SIZE	(ISL_SLAB_ALIGN << (ISL_SLAB_N_CLASS - 1))
+#define ISL_SLAB_CHUNK_SIZE	64
+
+struct isl_slab_chunk;
+
+/* A free list of objects of a given size class and statistics
+ * on how it has been used.
+ */
+struct isl_slab_pool {
+	void			*free;
+
+	unsigned long		n_alloc;
+	unsigned long		n_reuse;
+	unsigned long		n_chunk;
+	unsigned long		n_live;
+	unsigned long		max_live;
+};
+
+/* The slab arena of an isl_ctx.
+ * "enabled" is -1 as long as no object has been allocated from the arena.
+ * At the first allocation, it is set from the "slab_alloc" option and
+ * it remains fixed until the arena is released.
+ */
+struct isl_slab {
+	int			enabled;
+	struct isl_slab_chunk	*chunks;
+	struct isl_slab_pool	pool[ISL_SLAB_N_CLASS];
+};
+
+struct isl_ctx;
+
+void *isl_slab_alloc(struct isl_ctx *ctx, size_t size);
+void *isl_slab_calloc(struct isl_ctx *ctx, size_t size);
+void isl_slab_free(struct isl_ctx *ctx, void *p, size_t size);
+void isl_slab_print_stats(struct isl_ctx *ctx);
+void isl_slab_clear(struct isl_ctx *ctx);
+
+#define isl_slab_alloc_type(ctx,type)	((type *)isl_slab_alloc(ctx,\
+							sizeof(type)))
+#define isl_slab_calloc_type(ctx,type)	((type *)isl_slab_calloc(ctx,\
+							sizeof(type)))
+#define isl_slab_free_type(ctx,p,type)	isl_slab_free(ctx, p, sizeof(type))
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
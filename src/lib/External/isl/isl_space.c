@@ -17,6 +17,7 @@
 #include <isl_space_private.h>
 #include <isl_id_private.h>
 #include <isl_reordering.h>
+#include <isl_thread.h>
 
 isl_ctx *isl_space_get_ctx(__isl_keep isl_space *dim)
 {
@@ -318,15 +319,22 @@ error:
 	return NULL;
 }
 
+/* Return a copy of "dim" that can be modified.
+ * Since other threads may hold references to "dim" as well,
+ * the reference is dropped through isl_space_free.
+ */
 __isl_give isl_space *isl_space_cow(__isl_take isl_space *dim)
 {
+	isl_space *space;
+
 	if (!dim)
 		return NULL;
 
-	if (dim->ref == 1)
+	if (ISL_ATOMIC_GET(dim->ctx, dim->ref) == 1)
 		return dim;
-	dim->ref--;
-	return isl_space_dup(dim);
+	space = isl_space_dup(dim);
+	isl_space_free(dim);
+	return space;
 }
 
 __isl_give isl_space *isl_space_copy(__isl_keep isl_space *dim)
@@ -334,7 +342,7 @@ __isl_give isl_space *isl_space_copy(__isl_keep isl_space *dim)
 	if (!dim)
 		return NULL;
 
-	dim->ref++;
+	ISL_ATOMIC_INC(dim->ctx, dim->ref);
 	return dim;
 }
 
@@ -345,7 +353,7 @@ __isl_null isl_space *isl_space_free(__isl_take isl_space *space)
 	if (!space)
 		return NULL;
 
-	if (--space->ref > 0)
+	if (ISL_ATOMIC_DEC(space->ctx, space->ref) > 0)
 		return NULL;
 
 	isl_id_free(space->tuple_id[0]);
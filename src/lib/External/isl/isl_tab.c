@@ -1110,6 +1110,7 @@ int isl_tab_pivot(struct isl_tab *tab, int row, int col)
 	int i, j;
 	int sgn;
 	int t;
+	isl_int n_ic;
 	isl_ctx *ctx;
 	struct isl_mat *mat = tab->mat;
 	struct isl_tab_var *var;
@@ -1132,25 +1133,24 @@ int isl_tab_pivot(struct isl_tab *tab, int row, int col)
 		}
 	if (!isl_int_is_one(mat->row[row][0]))
 		isl_seq_normalize(mat->ctx, mat->row[row], off + tab->n_col);
+	isl_int_init(n_ic);
 	for (i = 0; i < tab->n_row; ++i) {
 		if (i == row)
 			continue;
 		if (isl_int_is_zero(mat->row[i][off + col]))
 			continue;
 		isl_int_mul(mat->row[i][0], mat->row[i][0], mat->row[row][0]);
-		for (j = 0; j < off - 1 + tab->n_col; ++j) {
-			if (j == off - 1 + col)
-				continue;
-			isl_int_mul(mat->row[i][1 + j],
-				    mat->row[i][1 + j], mat->row[row][0]);
-			isl_int_addmul(mat->row[i][1 + j],
-				    mat->row[i][off + col], mat->row[row][1 + j]);
-		}
+		isl_int_set(n_ic, mat->row[i][off + col]);
+		/* Update the whole row at once and fix up column col after. */
+		isl_seq_combine(mat->row[i] + 1, mat->row[row][0],
+				mat->row[i] + 1, n_ic, mat->row[row] + 1,
+				off - 1 + tab->n_col);
 		isl_int_mul(mat->row[i][off + col],
-			    mat->row[i][off + col], mat->row[row][off + col]);
+			    n_ic, mat->row[row][off + col]);
 		if (!isl_int_is_one(mat->row[i][0]))
 			isl_seq_normalize(mat->ctx, mat->row[i], off + tab->n_col);
 	}
+	isl_int_clear(n_ic);
 	t = tab->row_var[row];
 	tab->row_var[row] = tab->col_var[col];
 	tab->col_var[col] = t;
@@ -3194,6 +3194,66 @@ struct isl_tab_undo *isl_tab_snap(struct isl_tab *tab)
 	return tab->top;
 }
 
+/* Would "tab" become empty if the constraints of "bmap" were added?
+ * The variables of "bmap" correspond to the first variables of "tab",
+ * such that "tab" may have additional (existentially quantified)
+ * variables, but "bmap" itself should not have any.
+ *
+ * The constraints are added on top of a snapshot and
+ * "tab" is rolled back to this snapshot afterwards, such that
+ * it can be reused for other constraints.
+ * The test is performed over the rationals (unless "tab" is rational).
+ * If the extended tableau is not empty and "integral" is not NULL,
+ * then *integral is set to whether its sample value is integral.
+ */
+isl_bool isl_tab_is_empty_with(struct isl_tab *tab,
+	__isl_keep isl_basic_map *bmap, int *integral)
+{
+	int i;
+	unsigned total;
+	isl_bool empty;
+	isl_vec *v;
+	struct isl_tab_undo *snap;
+
+	if (!tab || !bmap)
+		return isl_bool_error;
+	total = isl_basic_map_total_dim(bmap);
+	if (bmap->n_div || total > tab->n_var)
+		isl_die(tab->mat->ctx, isl_error_invalid,
+			"unexpected constraints", return isl_bool_error);
+	if (tab->empty)
+		return isl_bool_true;
+	if (isl_tab_extend_cons(tab, bmap->n_eq + bmap->n_ineq) < 0)
+		return isl_bool_error;
+	v = isl_vec_alloc(tab->mat->ctx, 1 + tab->n_var);
+	if (!v)
+		return isl_bool_error;
+	isl_seq_clr(v->el + 1 + total, tab->n_var - total);
+
+	snap = isl_tab_snap(tab);
+	for (i = 0; !tab->empty && i < bmap->n_eq; ++i) {
+		isl_seq_cpy(v->el, bmap->eq[i], 1 + total);
+		if (isl_tab_add_eq(tab, v->el) < 0)
+			goto error;
+	}
+	for (i = 0; !tab->empty && i < bmap->n_ineq; ++i) {
+		isl_seq_cpy(v->el, bmap->ineq[i], 1 + total);
+		if (isl_tab_add_ineq(tab, v->el) < 0)
+			goto error;
+	}
+	empty = tab->empty;
+	if (!empty && integral)
+		*integral = isl_tab_sample_is_integer(tab);
+	isl_vec_free(v);
+
+	if (isl_tab_rollback(tab, snap) < 0)
+		return isl_bool_error;
+	return empty;
+error:
+	isl_vec_free(v);
+	return isl_bool_error;
+}
+
 /* Undo the operation performed by isl_tab_relax.
  */
 static int unrelax(struct isl_tab *tab, struct isl_tab_var *var) WARN_UNUSED;
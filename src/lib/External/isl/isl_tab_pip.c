@@ -782,18 +782,19 @@ static struct isl_vec *get_row_parameter_ineq(struct isl_tab *tab, int row)
  */
 static void normalize_div(__isl_keep isl_vec *div)
 {
-	isl_ctx *ctx = isl_vec_get_ctx(div);
 	int len = div->size - 2;
+	isl_int gcd;
 
-	isl_seq_gcd(div->el + 2, len, &ctx->normalize_gcd);
-	isl_int_gcd(ctx->normalize_gcd, ctx->normalize_gcd, div->el[0]);
-
-	if (isl_int_is_one(ctx->normalize_gcd))
-		return;
+	isl_int_init(gcd);
+	isl_seq_gcd(div->el + 2, len, &gcd);
+	isl_int_gcd(gcd, gcd, div->el[0]);
 
-	isl_int_divexact(div->el[0], div->el[0], ctx->normalize_gcd);
-	isl_int_fdiv_q(div->el[1], div->el[1], ctx->normalize_gcd);
-	isl_seq_scale_down(div->el + 2, div->el + 2, ctx->normalize_gcd, len);
+	if (!isl_int_is_one(gcd)) {
+		isl_int_divexact(div->el[0], div->el[0], gcd);
+		isl_int_fdiv_q(div->el[1], div->el[1], gcd);
+		isl_seq_scale_down(div->el + 2, div->el + 2, gcd, len);
+	}
+	isl_int_clear(gcd);
 }
 
 /* Return a integer division for use in a parametric cut based on the given row.
@@ -37,6 +37,7 @@
 #include <isl/ilp.h>
 #include <isl_ast_build_expr.h>
 #include <isl/options.h>
+#include <isl_trace.h>
 
 #define ARRAY_SIZE(array) (sizeof(array)/sizeof(*array))
 
@@ -4192,6 +4193,69 @@ int test_product(isl_ctx *ctx)
 	return 0;
 }
 
+/* Basic maps that are checked for disjointness against
+ * "feasibility_map" using a single isl_map_feasibility object.
+ * The queries include cases that are only rationally feasible and
+ * cases involving existentially quantified variables.
+ */
+static const char *feasibility_map =
+	"[N] -> { [i, j] -> [i', j'] : 0 <= i < i' < N and j' = j + 1 and "
+		"0 <= j < N; [i, j] -> [i', j'] : 2i' = i + 1 and j' = j and "
+		"0 <= i, j < N; [i, j] -> [i', j'] : i' = i and "
+		"exists (e : j = 3e and j' = j + 2) and 0 <= i, j < N }";
+static const char *feasibility_queries[] = {
+	"[N] -> { [i, j] -> [i', j'] : i' = i and j' = j }",
+	"[N] -> { [i, j] -> [i', j'] : i' = i and j' > j }",
+	"[N] -> { [i, j] -> [i', j'] : i' > i }",
+	"[N] -> { [i, j] -> [i', j'] : i' = i and j' = j + 1 }",
+	"[N] -> { [i, j] -> [i', j'] : i = 0 and j' = j }",
+	"[N] -> { [i, j] -> [i', j'] : i = 2 and j' = j }",
+	"[N] -> { [i, j] -> [i', j'] : i = 1 and j' = j }",
+	"[N] -> { [i, j] -> [i', j'] : j = 1 and j' = j + 2 }",
+	"[N] -> { [i, j] -> [i', j'] : j = 3 and j' = j + 2 and i' = i }",
+	"[N] -> { [i, j] -> [i', j'] : i' = i and exists (e : j = 3e + 1) }",
+	"[N] -> { [i, j] -> [i', j'] : N < 0 }",
+};
+
+/* Check that isl_map_feasibility_is_disjoint produces the same results
+ * as isl_map_is_disjoint when reusing the same object for many queries.
+ */
+static int test_feasibility(isl_ctx *ctx)
+{
+	int i;
+	isl_map *map;
+	isl_map_feasibility *f;
+
+	map = isl_map_read_from_str(ctx, feasibility_map);
+	f = isl_map_feasibility_alloc(isl_map_copy(map));
+	if (!f)
+		goto error;
+	for (i = 0; i < ARRAY_SIZE(feasibility_queries); ++i) {
+		isl_basic_map *bmap;
+		isl_map *map2;
+		isl_bool disjoint, expected;
+
+		bmap = isl_basic_map_read_from_str(ctx, feasibility_queries[i]);
+		disjoint = isl_map_feasibility_is_disjoint(f, bmap);
+		map2 = isl_map_from_basic_map(bmap);
+		expected = isl_map_is_disjoint(map, map2);
+		isl_map_free(map2);
+		if (disjoint < 0 || expected < 0)
+			goto error;
+		if (disjoint != expected)
+			isl_die(ctx, isl_error_unknown, "unexpected result",
+				goto error);
+	}
+	isl_map_feasibility_free(f);
+	isl_map_free(map);
+
+	return 0;
+error:
+	isl_map_feasibility_free(f);
+	isl_map_free(map);
+	return -1;
+}
+
 /* Check that two sets are not considered disjoint just because
  * they have a different set of (named) parameters.
  */
@@ -4213,6 +4277,9 @@ static int test_disjoint(isl_ctx *ctx)
 	if (disjoint)
 		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
+	if (test_feasibility(ctx) < 0)
+		return -1;
+
 	return 0;
 }
 
@@ -5885,6 +5952,364 @@ static int test_tile(isl_ctx *ctx)
 	return 0;
 }
 
+/* Inputs to the memoized operations.  Some of them only differ
+ * in the names of their tuples or dimensions, which should prevent
+ * the result of one from being reused for the other.
+ */
+const char *memo_tests[] = {
+	"{ A[i] : 0 <= i <= 5 or 6 <= i <= 10 }",
+	"{ A[j] : 0 <= j <= 5 or 6 <= j <= 10 }",
+	"{ B[i] : 0 <= i <= 5 or 6 <= i <= 10 }",
+	"[N] -> { A[i, j] : 0 <= i < N and 0 <= j <= i or i = N and j = 0 }",
+	"[M] -> { A[i, j] : 0 <= i < M and 0 <= j <= i or i = M and j = 0 }",
+	"{ A[i] -> B[j] : 0 <= i <= 5 and j = i or 6 <= i <= 10 and j = i }",
+	"{ A[i] : i >= 0 and i < 0 or 2i = 1 }",
+};
+
+/* Check that the results of coalescing, lexicographic optimization,
+ * emptiness and subset tests are the same whether or not they are
+ * taken from the memo table of the ctx.
+ * Each input is processed twice with a table that is small enough
+ * to trigger evictions.
+ */
+static int test_memo(isl_ctx *ctx)
+{
+	int i, r;
+	int max_entries;
+	int equal = 1;
+
+	max_entries = isl_options_get_memo_max_entries(ctx);
+	isl_options_set_memo_max_entries(ctx, 8);
+
+	for (r = 0; equal == 1 && r < 2 * ARRAY_SIZE(memo_tests); ++r) {
+		isl_map *map, *c, *min, *max, *prev;
+		isl_bool empty, subset;
+		const char *s1, *s2;
+
+		i = r % ARRAY_SIZE(memo_tests);
+		map = isl_map_read_from_str(ctx, memo_tests[i]);
+		c = isl_map_coalesce(isl_map_copy(map));
+		min = isl_map_lexmin(isl_map_copy(map));
+		max = isl_map_lexmax(isl_map_copy(map));
+		empty = isl_map_is_empty(map);
+		subset = isl_map_is_subset(min, map);
+
+		isl_options_set_memo_max_entries(ctx, 0);
+		equal = isl_map_is_equal(c, map);
+		if (equal == 1)
+			equal = isl_map_has_equal_space(c, map);
+		if (equal == 1) {
+			s1 = isl_map_get_dim_name(c, isl_dim_out, 0);
+			s2 = isl_map_get_dim_name(map, isl_dim_out, 0);
+			equal = s1 && s2 && !strcmp(s1, s2);
+		}
+		if (equal == 1) {
+			prev = isl_map_lexmin(isl_map_copy(map));
+			equal = isl_map_is_equal(min, prev);
+			isl_map_free(prev);
+		}
+		if (equal == 1) {
+			prev = isl_map_lexmax(isl_map_copy(map));
+			equal = isl_map_is_equal(max, prev);
+			isl_map_free(prev);
+		}
+		if (equal == 1 && empty != isl_map_is_empty(map))
+			equal = 0;
+		if (equal == 1 && subset != isl_map_is_subset(min, map))
+			equal = 0;
+		isl_options_set_memo_max_entries(ctx, 8);
+
+		isl_map_free(map);
+		isl_map_free(c);
+		isl_map_free(min);
+		isl_map_free(max);
+	}
+
+	isl_options_set_memo_max_entries(ctx, max_entries);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"memoized result differs", return -1);
+
+	return 0;
+}
+
+/* The operations that are expected to be recorded by test_trace,
+ * in order.
+ */
+static const char *trace_ops[] = {
+	"map_coalesce",
+	"map_is_subset",
+	"map_lexmin",
+	"ast_build_node_from_schedule_map",
+};
+
+/* Check that exceeding the maximal memory usage makes the computation fail
+ * with an isl_error_quota error and that computations succeed again
+ * after the bound has been lifted.
+ */
+static int test_max_memory(isl_ctx *ctx)
+{
+	int i;
+	int on_error;
+	const char *str;
+	isl_set *set;
+
+	str = "[N] -> { [i, j] : 0 <= i < N and 0 <= j < i and "
+					"exists (e : j = 3e + 1) }";
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	isl_ctx_reset_memory(ctx);
+	isl_ctx_set_max_memory(ctx, 1);
+	for (i = 0; i < 100000; ++i) {
+		set = isl_set_read_from_str(ctx, str);
+		set = isl_set_coalesce(isl_set_union(set, isl_set_copy(set)));
+		isl_set_free(set);
+		if (!set)
+			break;
+	}
+	isl_ctx_set_max_memory(ctx, 0);
+	isl_options_set_on_error(ctx, on_error);
+
+	if (isl_ctx_last_error(ctx) != isl_error_quota)
+		isl_die(ctx, isl_error_unknown,
+			"expecting memory usage to be exceeded", return -1);
+	isl_ctx_reset_error(ctx);
+
+	set = isl_set_read_from_str(ctx, str);
+	isl_set_free(set);
+	if (!set)
+		return -1;
+
+	return 0;
+}
+
+/* Perform some operations on a separate isl_ctx with tracing enabled
+ * and check that only the outermost calls have been recorded.
+ * In particular, the calls performed by the subset test and
+ * by the AST generator should not be recorded.
+ * Each recorded call is then replayed on "ctx", which does not have
+ * tracing enabled, and its result is compared to the recorded result.
+ */
+static int test_trace(isl_ctx *ctx)
+{
+	const char *name = "isl_test_trace.tmp";
+	isl_ctx *trace_ctx;
+	isl_set *set, *hull;
+	isl_ast_build *build;
+	isl_ast_node *node;
+	isl_union_map *schedule;
+	FILE *file;
+	struct isl_trace_record call = { { 0 } };
+	double time;
+	int r, n = 0, ok = 1;
+
+	trace_ctx = isl_ctx_alloc();
+	if (!trace_ctx)
+		return -1;
+	isl_options_set_trace_file(trace_ctx, name);
+	set = isl_set_read_from_str(trace_ctx,
+		"{ [i] : 0 <= i <= 10; [i] : 11 <= i <= 20 }");
+	set = isl_set_coalesce(set);
+	hull = isl_set_read_from_str(trace_ctx, "{ [i] : 0 <= i <= 30 }");
+	if (isl_set_is_subset(set, hull) != isl_bool_true)
+		ok = 0;
+	isl_set_free(hull);
+	set = isl_set_lexmin(set);
+	isl_set_free(set);
+	build = isl_ast_build_from_context(isl_set_universe(
+				isl_space_params_alloc(trace_ctx, 0)));
+	schedule = isl_union_map_read_from_str(trace_ctx,
+		"{ A[i] -> [i] : 0 <= i < 10; B[i] -> [i] : 10 <= i < 20 }");
+	node = isl_ast_build_node_from_schedule_map(build, schedule);
+	isl_ast_node_free(node);
+	isl_ast_build_free(build);
+	isl_ctx_free(trace_ctx);
+
+	file = fopen(name, "r");
+	if (!file)
+		isl_die(ctx, isl_error_unknown, "trace file not written",
+			return -1);
+	while (ok && (r = isl_trace_read_record(file, &call)) != 0) {
+		if (r < 0 || n >= ARRAY_SIZE(trace_ops) ||
+		    strcmp(call.op, trace_ops[n]) ||
+		    isl_trace_replay(ctx, &call, 1, &time) != 0)
+			ok = 0;
+		isl_trace_record_clear(&call);
+		n++;
+	}
+	isl_trace_record_clear(&call);
+	fclose(file);
+	remove(name);
+
+	if (!ok || n != ARRAY_SIZE(trace_ops))
+		isl_die(ctx, isl_error_unknown, "unexpected trace",
+			return -1);
+
+	return 0;
+}
+
+/* Append the string representation of "umap" to "str" and free "umap".
+ * Return the extended string or NULL if anything went wrong.
+ */
+static char *append_union_map(char *str, __isl_take isl_union_map *umap)
+{
+	char *s;
+	char *res;
+
+	s = isl_union_map_to_str(umap);
+	isl_union_map_free(umap);
+	if (!str || !s) {
+		free(str);
+		free(s);
+		return NULL;
+	}
+	res = realloc(str, strlen(str) + strlen(s) + 2);
+	if (res) {
+		strcat(res, s);
+		strcat(res, "\n");
+	} else
+		free(str);
+	free(s);
+	return res;
+}
+
+/* Accesses used by test_union_map_threads.
+ */
+static const char *threads_map =
+	"{ A[i] -> a[i] : 0 <= i < 10; A[i] -> a[i] : 10 <= i < 20; "
+	"B[i, j] -> b[i + j] : 0 <= i, j < 5; "
+	"B[i, j] -> b[i + j] : 5 <= i < 10 and 0 <= j < 5; "
+	"C[i] -> a[i + 1] : 0 <= i < 30 and exists (e : i = 2e); "
+	"D[i] -> c[i] : i >= 0 }";
+static const char *threads_sink =
+	"{ C[i] -> a[i] : 0 <= i < 30; B[i, j] -> b[i] : 0 <= i, j < 10; "
+	"D[i] -> a[i] : 0 <= i < 20; D[i] -> c[i - 1] : 1 <= i < 10 }";
+static const char *threads_must_source =
+	"{ A[i] -> a[i] : 0 <= i < 20; B[i, j] -> b[i + j] : 0 <= i, j < 10; "
+	"D[i] -> c[i] : 0 <= i < 10 }";
+static const char *threads_may_source = "{ C[i] -> a[i + 1] : 0 <= i < 30 }";
+static const char *threads_schedule_map =
+	"{ A[i] -> [0, i, 0]; B[i, j] -> [1, i, j]; C[i] -> [2, i, 0]; "
+	"D[i] -> [3, i, 0] }";
+static const char *threads_schedule =
+	"domain: \"{ A[i] : 0 <= i < 20; B[i, j] : 0 <= i, j < 10; "
+	"C[i] : 0 <= i < 30; D[i] : 0 <= i < 20 }\"\n"
+	"child:\n"
+	"  sequence:\n"
+	"  - filter: \"{ A[i] }\"\n"
+	"  - filter: \"{ B[i, j] }\"\n"
+	"    child:\n"
+	"      schedule: \"[{ B[i, j] -> [i] }]\"\n"
+	"  - filter: \"{ C[i]; D[i] }\"\n"
+	"    child:\n"
+	"      schedule: \"[{ C[i] -> [i]; D[i] -> [i] }]\"\n"
+	"      child:\n"
+	"        set:\n"
+	"        - filter: \"{ C[i] }\"\n"
+	"        - filter: \"{ D[i] }\"\n";
+
+/* Compute the dependences between the accesses above
+ * using either the schedule map or the schedule tree,
+ * depending on "tree", and append them to "str".
+ */
+static char *append_threads_flow(isl_ctx *ctx, char *str, int tree)
+{
+	isl_union_access_info *access;
+	isl_union_flow *flow;
+	isl_union_map *umap;
+
+	umap = isl_union_map_read_from_str(ctx, threads_sink);
+	access = isl_union_access_info_from_sink(umap);
+	umap = isl_union_map_read_from_str(ctx, threads_must_source);
+	access = isl_union_access_info_set_must_source(access, umap);
+	umap = isl_union_map_read_from_str(ctx, threads_may_source);
+	access = isl_union_access_info_set_may_source(access, umap);
+	if (tree) {
+		isl_schedule *schedule;
+
+		schedule = isl_schedule_read_from_str(ctx, threads_schedule);
+		access = isl_union_access_info_set_schedule(access, schedule);
+	} else {
+		umap = isl_union_map_read_from_str(ctx, threads_schedule_map);
+		access = isl_union_access_info_set_schedule_map(access, umap);
+	}
+	flow = isl_union_access_info_compute_flow(access);
+	str = append_union_map(str, isl_union_flow_get_must_dependence(flow));
+	str = append_union_map(str, isl_union_flow_get_may_dependence(flow));
+	str = append_union_map(str, isl_union_flow_get_must_no_source(flow));
+	str = append_union_map(str, isl_union_flow_get_may_no_source(flow));
+	isl_union_flow_free(flow);
+
+	return str;
+}
+
+/* Perform the union map operations that may be performed in parallel
+ * on the accesses above and return a string representation
+ * of all the results.
+ */
+static char *union_map_threads_results(isl_ctx *ctx)
+{
+	isl_union_map *umap, *umap2;
+	char *str;
+
+	str = strdup("");
+	umap = isl_union_map_read_from_str(ctx, threads_map);
+	str = append_union_map(str, isl_union_map_coalesce(
+						isl_union_map_copy(umap)));
+	str = append_union_map(str, isl_union_map_detect_equalities(
+						isl_union_map_copy(umap)));
+	str = append_union_map(str, isl_union_map_remove_redundancies(
+						isl_union_map_copy(umap)));
+	str = append_union_map(str, isl_union_map_compute_divs(
+						isl_union_map_copy(umap)));
+	umap2 = isl_union_map_reverse(isl_union_map_copy(umap));
+	str = append_union_map(str, isl_union_map_apply_range(
+			isl_union_map_copy(umap), isl_union_map_copy(umap2)));
+	str = append_union_map(str, isl_union_map_lex_lt_union_map(
+			isl_union_map_copy(umap), isl_union_map_copy(umap)));
+	str = append_union_map(str, isl_union_map_range_product(
+			isl_union_map_copy(umap), isl_union_map_copy(umap)));
+	str = append_union_map(str, isl_union_map_product(
+			isl_union_map_copy(umap), umap2));
+	isl_union_map_free(umap);
+	str = append_threads_flow(ctx, str, 0);
+	str = append_threads_flow(ctx, str, 1);
+
+	return str;
+}
+
+/* Check that performing union map operations using multiple threads
+ * produces exactly the same results as performing them sequentially.
+ * If isl was built without thread support, then this simply compares
+ * two sequential runs.
+ */
+static int test_union_map_threads(isl_ctx *ctx)
+{
+	int n_thread;
+	char *seq, *par;
+	int equal;
+
+	n_thread = isl_options_get_union_map_threads(ctx);
+	isl_options_set_union_map_threads(ctx, 0);
+	seq = union_map_threads_results(ctx);
+	isl_options_set_union_map_threads(ctx, 4);
+	par = union_map_threads_results(ctx);
+	isl_options_set_union_map_threads(ctx, n_thread);
+
+	equal = seq && par && !strcmp(seq, par);
+	free(seq);
+	free(par);
+
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"parallel results differ", return -1);
+
+	return 0;
+}
+
 struct {
 	const char *name;
 	int (*fn)(isl_ctx *ctx);
@@ -5933,6 +6358,10 @@ struct {
 	{ "subset", &test_subset },
 	{ "subtract", &test_subtract },
 	{ "lexmin", &test_lexmin },
+	{ "memo", &test_memo },
+	{ "maximal memory", &test_max_memory },
+	{ "trace", &test_trace },
+	{ "union map threads", &test_union_map_threads },
 	{ "min", &test_min },
 	{ "gist", &test_gist },
 	{ "piecewise quasi-polynomials", &test_pwqp },
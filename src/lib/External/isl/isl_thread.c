@@ -0,0 +1,338 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl_thread.h>
+
+/* Is "ctx" inside a parallel region, i.e., may other threads
+ * be performing work in "ctx" at the same time?
+ */
+int isl_ctx_is_parallel(isl_ctx *ctx)
+{
+	return ctx && ctx->parallel;
+}
+
+/* Return the number of threads that isl_ctx_parallel_for would use
+ * to perform "n" tasks in "ctx".
+ * A single thread is used if the "union-map-threads" option
+ * is not set to more than one thread, if there is only one task or
+ * if the call is performed from within a parallel region.
+ */
+int isl_ctx_parallel_n_thread(isl_ctx *ctx, int n)
+{
+#ifdef ISL_USE_THREADS
+	int n_thread;
+
+	if (!ctx || ctx->parallel || n < 2)
+		return 1;
+	n_thread = ctx->opt->union_map_threads;
+	if (n_thread > n)
+		n_thread = n;
+	return n_thread < 1 ? 1 : n_thread;
+#else
+	return 1;
+#endif
+}
+
+#ifdef ISL_USE_THREADS
+
+/* A pool of worker threads of an isl_ctx.
+ *
+ * "n_thread" is the number of threads in "thread".
+ * The thread calling isl_ctx_parallel_for also performs tasks,
+ * so the pool is used by n_thread + 1 threads in total.
+ *
+ * "lock" protects all other fields.
+ * "work" is signaled when a new job is posted or when the pool
+ * is shut down, while "done" is signaled when the last thread
+ * performing tasks of the current job has finished.
+ * "job" is incremented for every job that is posted.
+ *
+ * The current job consists of calling "fn" on "n_task" tasks,
+ * the first "next_task" of which have already been handed out.
+ * "n_busy" is the number of threads performing tasks of the job and
+ * "failed" is set if any of the tasks failed.
+ */
+struct isl_thread_pool {
+	int			n_thread;
+	pthread_t		*thread;
+
+	pthread_mutex_t		lock;
+	pthread_cond_t		work;
+	pthread_cond_t		done;
+	unsigned long		job;
+	int			shutdown;
+
+	isl_stat		(*fn)(int i, void *user);
+	void			*user;
+	int			n_task;
+	int			next_task;
+	int			n_busy;
+	int			failed;
+};
+
+/* Perform tasks of the current job of "pool" until none are left.
+ * The lock on "pool" is held on entry and on exit, but it is released
+ * while the tasks themselves are being performed.
+ * Once a task has failed, no further tasks are handed out.
+ */
+static void perform_tasks(struct isl_thread_pool *pool)
+{
+	isl_stat (*fn)(int i, void *user) = pool->fn;
+	void *user = pool->user;
+
+	pool->n_busy++;
+	while (pool->next_task < pool->n_task) {
+		int i = pool->next_task++;
+		isl_stat r;
+
+		pthread_mutex_unlock(&pool->lock);
+		r = fn(i, user);
+		pthread_mutex_lock(&pool->lock);
+		if (r < 0) {
+			pool->failed = 1;
+			pool->next_task = pool->n_task;
+		}
+	}
+	if (--pool->n_busy == 0)
+		pthread_cond_broadcast(&pool->done);
+}
+
+/* The main function of a worker thread of the pool "user".
+ * Wait for a job to be posted, help performing its tasks and
+ * repeat until the pool is shut down.
+ * A worker that only wakes up after all tasks of a job
+ * have been handed out simply waits for the next job.
+ */
+static void *worker(void *user)
+{
+	struct isl_thread_pool *pool = user;
+	unsigned long job = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->shutdown && pool->job == job)
+			pthread_cond_wait(&pool->work, &pool->lock);
+		if (pool->shutdown)
+			break;
+		job = pool->job;
+		perform_tasks(pool);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* Shut down the threads of "pool" and release all its resources.
+ */
+static void pool_free(struct isl_thread_pool *pool)
+{
+	int i;
+
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->n_thread; ++i)
+		pthread_join(pool->thread[i], NULL);
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->thread);
+	free(pool);
+}
+
+/* Create a pool of "n_thread" worker threads in "ctx".
+ * If not all threads can be created, then the pool
+ * simply uses fewer threads.
+ */
+static struct isl_thread_pool *pool_alloc(isl_ctx *ctx, int n_thread)
+{
+	struct isl_thread_pool *pool;
+
+	pool = isl_calloc_type(ctx, struct isl_thread_pool);
+	if (!pool)
+		return NULL;
+	pool->thread = isl_calloc_array(ctx, pthread_t, n_thread);
+	if (!pool->thread) {
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	for (pool->n_thread = 0; pool->n_thread < n_thread; ++pool->n_thread)
+		if (pthread_create(&pool->thread[pool->n_thread], NULL,
+				    &worker, pool) != 0)
+			break;
+
+	return pool;
+}
+
+/* Return the thread pool of "ctx", (re)creating it if it does not
+ * have the number of worker threads required by the "union-map-threads"
+ * option, i.e., one less than the option value.
+ */
+static struct isl_thread_pool *get_pool(isl_ctx *ctx)
+{
+	int n_thread = ctx->opt->union_map_threads - 1;
+
+	if (ctx->pool && ctx->pool->n_thread == n_thread)
+		return ctx->pool;
+	pool_free(ctx->pool);
+	ctx->pool = pool_alloc(ctx, n_thread);
+	return ctx->pool;
+}
+
+/* Call "fn" on each integer in [0, n).
+ *
+ * If isl_ctx_parallel_n_thread allows for more than one thread,
+ * then the calls are distributed over the threads in the pool of "ctx"
+ * and the calling thread.  The calls may then be performed
+ * in any order and "fn" should only access data that is not accessed
+ * by any other call, except for reading shared objects that are
+ * not modified by any of the calls.
+ * Objects that are created during the parallel region
+ * may only share spaces and identifiers with each other,
+ * since only the reference counts of those are updated atomically
+ * (along with that of "ctx").
+ *
+ * While the calls are being performed, ctx->parallel is set
+ * such that the internal state of "ctx" is updated in a thread-safe way.
+ * Otherwise, the calls are performed in order and the first
+ * failing call interrupts the loop.
+ */
+isl_stat isl_ctx_parallel_for(isl_ctx *ctx, int n,
+	isl_stat (*fn)(int i, void *user), void *user)
+{
+	int i;
+	int failed;
+	struct isl_thread_pool *pool = NULL;
+
+	if (!ctx)
+		return isl_stat_error;
+
+	if (isl_ctx_parallel_n_thread(ctx, n) > 1)
+		pool = get_pool(ctx);
+	if (!pool) {
+		for (i = 0; i < n; ++i)
+			if (fn(i, user) < 0)
+				return isl_stat_error;
+		return isl_stat_ok;
+	}
+
+	ctx->parallel = 1;
+	pthread_mutex_lock(&pool->lock);
+	pool->fn = fn;
+	pool->user = user;
+	pool->n_task = n;
+	pool->next_task = 0;
+	pool->failed = 0;
+	pool->job++;
+	pthread_cond_broadcast(&pool->work);
+	perform_tasks(pool);
+	while (pool->n_busy > 0)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	failed = pool->failed;
+	pool->fn = NULL;
+	pool->user = NULL;
+	pthread_mutex_unlock(&pool->lock);
+	ctx->parallel = 0;
+
+	return failed ? isl_stat_error : isl_stat_ok;
+}
+
+/* Acquire the lock on the internal state of "ctx".
+ * The lock is only needed inside a parallel region.
+ */
+void isl_ctx_lock(isl_ctx *ctx)
+{
+	if (ctx->parallel)
+		pthread_mutex_lock(&ctx->lock);
+}
+
+/* Release the lock acquired by isl_ctx_lock.
+ */
+void isl_ctx_unlock(isl_ctx *ctx)
+{
+	if (ctx->parallel)
+		pthread_mutex_unlock(&ctx->lock);
+}
+
+/* Initialize the thread related fields of "ctx".
+ * The lock is recursive since, e.g., errors may be reported or
+ * memory may be allocated while it is being held.
+ */
+isl_stat isl_thread_init(isl_ctx *ctx)
+{
+	pthread_mutexattr_t attr;
+	int r;
+
+	ctx->pool = NULL;
+	ctx->parallel = 0;
+	if (pthread_mutexattr_init(&attr) != 0)
+		return isl_stat_error;
+	r = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	if (r == 0)
+		r = pthread_mutex_init(&ctx->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	return r == 0 ? isl_stat_ok : isl_stat_error;
+}
+
+/* Shut down the thread pool of "ctx", if any, and
+ * release the thread related resources of "ctx".
+ */
+void isl_thread_free(isl_ctx *ctx)
+{
+	pool_free(ctx->pool);
+	ctx->pool = NULL;
+	pthread_mutex_destroy(&ctx->lock);
+}
+
+#else
+
+/* Without thread support, isl_ctx_parallel_n_thread always returns 1,
+ * so the calls are simply performed in order.
+ */
+isl_stat isl_ctx_parallel_for(isl_ctx *ctx, int n,
+	isl_stat (*fn)(int i, void *user), void *user)
+{
+	int i;
+
+	if (!ctx)
+		return isl_stat_error;
+
+	for (i = 0; i < n; ++i)
+		if (fn(i, user) < 0)
+			return isl_stat_error;
+	return isl_stat_ok;
+}
+
+void isl_ctx_lock(isl_ctx *ctx)
+{
+}
+
+void isl_ctx_unlock(isl_ctx *ctx)
+{
+}
+
+isl_stat isl_thread_init(isl_ctx *ctx)
+{
+	ctx->pool = NULL;
+	ctx->parallel = 0;
+	return isl_stat_ok;
+}
+
+void isl_thread_free(isl_ctx *ctx)
+{
+}
+
+#endif
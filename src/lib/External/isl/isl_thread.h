@@ -0,0 +1,45 @@
+#ifndef ISL_THREAD_H
+#define ISL_THREAD_H
+
+#include <isl_ctx_private.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Read, increment or decrement the reference count or counter "x"
+ * of an object that may be shared between the threads
+ * of a parallel region of "ctx".
+ * Outside of a parallel region, only a single thread is active
+ * and the counter is accessed without any synchronization.
+ * ISL_ATOMIC_DEC evaluates to the decremented value.
+ */
+#ifdef ISL_USE_THREADS
+#define ISL_ATOMIC_GET(ctx,x)						\
+	((ctx)->parallel ? __sync_fetch_and_add(&(x), 0) : (x))
+#define ISL_ATOMIC_INC(ctx,x)						\
+	((ctx)->parallel ? (void) __sync_fetch_and_add(&(x), 1) : (void) (x)++)
+#define ISL_ATOMIC_DEC(ctx,x)						\
+	((ctx)->parallel ? __sync_sub_and_fetch(&(x), 1) : --(x))
+#else
+#define ISL_ATOMIC_GET(ctx,x)	(x)
+#define ISL_ATOMIC_INC(ctx,x)	((void) (x)++)
+#define ISL_ATOMIC_DEC(ctx,x)	(--(x))
+#endif
+
+int isl_ctx_is_parallel(isl_ctx *ctx);
+void isl_ctx_lock(isl_ctx *ctx);
+void isl_ctx_unlock(isl_ctx *ctx);
+
+int isl_ctx_parallel_n_thread(isl_ctx *ctx, int n);
+isl_stat isl_ctx_parallel_for(isl_ctx *ctx, int n,
+	isl_stat (*fn)(int i, void *user), void *user);
+
+isl_stat isl_thread_init(isl_ctx *ctx);
+void isl_thread_free(isl_ctx *ctx);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -0,0 +1,578 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl/printer.h>
+#include <isl/map.h>
+#include <isl/union_map.h>
+#include <isl/union_set.h>
+#include <isl/flow.h>
+#include <isl/ast_build.h>
+#include <isl_trace.h>
+
+/* The trace of an isl_ctx.
+ *
+ * "file" is the file to which the calls are written.
+ * It is opened when the first call is entered.
+ * "failed" is set if the file could not be opened.
+ * "depth" is the number of traced calls that are currently active.
+ * "n_call" is the number of calls that have been recorded.
+ */
+struct isl_trace {
+	FILE		*file;
+	int		failed;
+	int		depth;
+	unsigned long	n_call;
+};
+
+/* Return the trace of "ctx" if the "trace_file" option is set,
+ * allocating it and opening the trace file if needed.
+ * Return NULL if tracing is disabled or if the file cannot be opened.
+ */
+static struct isl_trace *get_trace(isl_ctx *ctx)
+{
+	struct isl_trace *trace;
+	const char *name;
+
+	name = ctx->opt->trace_file;
+	if (!ctx->trace && (!name || !*name))
+		return NULL;
+	if (!ctx->trace) {
+		ctx->trace = isl_calloc_type(ctx, struct isl_trace);
+		if (!ctx->trace)
+			return NULL;
+		ctx->trace->file = fopen(name, "w");
+		if (!ctx->trace->file) {
+			fprintf(stderr, "isl: unable to open trace file '%s'\n",
+				name);
+			ctx->trace->failed = 1;
+		}
+	}
+	trace = ctx->trace;
+	return trace->failed ? NULL : trace;
+}
+
+/* Enter a call to the operation "op" and initialize "call".
+ * The call is recorded if tracing is enabled on "ctx" and
+ * if it is not performed from within another traced call.
+ * Calls performed inside a parallel region are performed from
+ * within a union map operation and are therefore never recorded.
+ * The caller should only serialize the arguments if call->op is set.
+ */
+void isl_trace_enter(isl_ctx *ctx, struct isl_trace_call *call,
+	const char *op)
+{
+	struct isl_trace *trace;
+
+	call->active = 0;
+	call->op = NULL;
+	call->n_arg = 0;
+	call->n_res = 0;
+	call->end = 0;
+	if (!ctx || ctx->parallel)
+		return;
+	trace = get_trace(ctx);
+	if (!trace)
+		return;
+	call->active = 1;
+	if (trace->depth++ == 0)
+		call->op = op;
+	call->start = clock();
+}
+
+/* Add the serialized argument "str" to "call" and (re)start the clock.
+ * A NULL "str" represents a missing argument.
+ */
+void isl_trace_add_arg(struct isl_trace_call *call, char *str)
+{
+	if (!call->op || call->n_arg + call->n_res >= ISL_TRACE_MAX_STR) {
+		free(str);
+		return;
+	}
+	call->str[call->n_arg++] = str;
+	call->start = clock();
+}
+
+/* Add the serialized result "str" to "call", stopping the clock
+ * if this is the first result.
+ */
+void isl_trace_add_res(struct isl_trace_call *call, char *str)
+{
+	if (call->op && !call->end)
+		call->end = clock();
+	if (!call->op || call->n_arg + call->n_res >= ISL_TRACE_MAX_STR) {
+		free(str);
+		return;
+	}
+	call->str[call->n_arg + call->n_res++] = str;
+}
+
+/* Write "str" on a single line of "file", using "-" for a missing string.
+ */
+static void write_line(FILE *file, const char *str)
+{
+	if (!str)
+		str = "-";
+	for (; *str; ++str)
+		putc(*str == '\n' ? ' ' : *str, file);
+	putc('\n', file);
+}
+
+/* Leave "call" and write it to the trace file if it should be recorded.
+ *
+ * Each call is written as a header line containing the name
+ * of the operation, the number of arguments, the number of results and
+ * the time spent in the operation in seconds,
+ * followed by one line per argument and one line per result.
+ */
+void isl_trace_leave(isl_ctx *ctx, struct isl_trace_call *call)
+{
+	int i;
+	struct isl_trace *trace;
+
+	if (!call->active)
+		return;
+	trace = ctx->trace;
+	trace->depth--;
+	if (!call->op)
+		return;
+	if (!call->end)
+		call->end = clock();
+
+	fprintf(trace->file, "%s %d %d %.6f\n", call->op,
+		call->n_arg, call->n_res,
+		(double) (call->end - call->start) / CLOCKS_PER_SEC);
+	for (i = 0; i < call->n_arg + call->n_res; ++i) {
+		write_line(trace->file, call->str[i]);
+		free(call->str[i]);
+	}
+	trace->n_call++;
+}
+
+/* Return a serialization of "b", or NULL if "b" represents an error.
+ */
+__isl_give char *isl_trace_bool_to_str(isl_bool b)
+{
+	if (b < 0)
+		return NULL;
+	return strdup(b ? "1" : "0");
+}
+
+/* Return a serialization of "schedule" on a single line.
+ */
+__isl_give char *isl_trace_schedule_to_str(__isl_keep isl_schedule *schedule)
+{
+	isl_printer *p;
+	char *s;
+
+	if (!schedule)
+		return NULL;
+	p = isl_printer_to_str(isl_schedule_get_ctx(schedule));
+	p = isl_printer_set_yaml_style(p, ISL_YAML_STYLE_FLOW);
+	p = isl_printer_print_schedule(p, schedule);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+
+	return s;
+}
+
+/* Return a serialization of "node" in C format on a single line.
+ */
+__isl_give char *isl_trace_ast_node_to_str(__isl_keep isl_ast_node *node)
+{
+	isl_printer *p;
+	char *s, *c;
+
+	if (!node)
+		return NULL;
+	p = isl_printer_to_str(isl_ast_node_get_ctx(node));
+	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
+	p = isl_printer_print_ast_node(p, node);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+
+	for (c = s; c && *c; ++c)
+		if (*c == '\n')
+			*c = ' ';
+
+	return s;
+}
+
+/* Close the trace file of "ctx", if any.
+ */
+void isl_trace_free(isl_ctx *ctx)
+{
+	struct isl_trace *trace = ctx->trace;
+
+	if (!trace)
+		return;
+	if (ctx->opt->print_stats)
+		fprintf(stderr, "trace calls: %lu\n", trace->n_call);
+	if (trace->file)
+		fclose(trace->file);
+	free(trace);
+	ctx->trace = NULL;
+}
+
+/* Read a line from "file", without the trailing newline.
+ * Return NULL at the end of the file.
+ */
+static char *read_line(FILE *file)
+{
+	size_t size = 256, len = 0;
+	char *line;
+
+	line = malloc(size);
+	if (!line)
+		return NULL;
+	while (fgets(line + len, size - len, file)) {
+		len += strlen(line + len);
+		if (len > 0 && line[len - 1] == '\n') {
+			line[len - 1] = '\0';
+			return line;
+		}
+		size *= 2;
+		line = realloc(line, size);
+		if (!line)
+			return NULL;
+	}
+	if (len > 0)
+		return line;
+	free(line);
+	return NULL;
+}
+
+/* Free the strings of "call", which has been read
+ * by isl_trace_read_record.
+ */
+void isl_trace_record_clear(struct isl_trace_record *call)
+{
+	int i;
+
+	for (i = 0; i < call->n_arg + call->n_res; ++i)
+		free(call->str[i]);
+	call->n_arg = call->n_res = 0;
+}
+
+/* Read the next call from "file".
+ * Return 0 at the end of the file and -1 if the trace is malformed.
+ */
+int isl_trace_read_record(FILE *file, struct isl_trace_record *call)
+{
+	int i, n;
+	char *header;
+
+	header = read_line(file);
+	if (!header)
+		return 0;
+	n = sscanf(header, "%99s %d %d %lf", call->op,
+		    &call->n_arg, &call->n_res, &call->recorded);
+	free(header);
+	if (n != 4 || call->n_arg < 0 || call->n_res < 0 ||
+	    call->n_arg + call->n_res > ISL_TRACE_MAX_STR) {
+		call->n_arg = call->n_res = 0;
+		return -1;
+	}
+	for (i = 0; i < call->n_arg + call->n_res; ++i) {
+		call->str[i] = read_line(file);
+		if (!call->str[i]) {
+			call->n_res = i - call->n_arg;
+			return -1;
+		}
+	}
+	return 1;
+}
+
+/* Is "str" the representation of a missing object?
+ */
+static int is_missing(const char *str)
+{
+	return !strcmp(str, "-");
+}
+
+static __isl_give isl_map *read_map(isl_ctx *ctx, const char *str)
+{
+	return is_missing(str) ? NULL : isl_map_read_from_str(ctx, str);
+}
+
+static __isl_give isl_union_map *read_union_map(isl_ctx *ctx,
+	const char *str)
+{
+	return is_missing(str) ? NULL : isl_union_map_read_from_str(ctx, str);
+}
+
+/* Does "map" differ from the map represented by "str",
+ * either in the elements it contains or in the number
+ * of basic maps it consists of?
+ */
+static int map_differs(isl_ctx *ctx, __isl_keep isl_map *map, const char *str)
+{
+	isl_map *expected;
+	int differs;
+
+	expected = read_map(ctx, str);
+	if (!map || !expected) {
+		isl_map_free(expected);
+		return !!map != !!expected;
+	}
+	differs = isl_map_is_equal(map, expected) != isl_bool_true ||
+		isl_map_n_basic_map(map) != isl_map_n_basic_map(expected);
+	isl_map_free(expected);
+	return differs;
+}
+
+/* Does "umap" differ from the union map represented by "str"?
+ */
+static int union_map_differs(isl_ctx *ctx, __isl_keep isl_union_map *umap,
+	const char *str)
+{
+	isl_union_map *expected;
+	int differs;
+
+	expected = read_union_map(ctx, str);
+	if (!umap || !expected) {
+		isl_union_map_free(expected);
+		return !!umap != !!expected;
+	}
+	differs = isl_union_map_is_equal(umap, expected) != isl_bool_true;
+	isl_union_map_free(expected);
+	return differs;
+}
+
+/* Does "str" differ from the expected string "expected"?
+ * A NULL "str" is represented by "-".
+ */
+static int str_differs(const char *str, const char *expected)
+{
+	return strcmp(str ? str : "-", expected);
+}
+
+/* Return the average time spent in each of "repeat" calls
+ * performed since "start".
+ */
+static double elapsed(clock_t start, int repeat)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC / repeat;
+}
+
+/* Perform "call", whose operation is a unary operation on maps,
+ * "repeat" times and check the result.
+ */
+static int replay_map_op(isl_ctx *ctx, struct isl_trace_record *call,
+	int repeat, double *time,
+	__isl_give isl_map *(*fn)(__isl_take isl_map *map))
+{
+	int i, differs;
+	clock_t start;
+	isl_map *map, *res = NULL;
+
+	map = read_map(ctx, call->str[0]);
+	start = clock();
+	for (i = 0; i < repeat; ++i) {
+		isl_map_free(res);
+		res = fn(isl_map_copy(map));
+	}
+	*time = elapsed(start, repeat);
+	differs = map_differs(ctx, res, call->str[1]);
+	isl_map_free(res);
+	isl_map_free(map);
+	return differs;
+}
+
+static int replay_map_is_subset(isl_ctx *ctx, struct isl_trace_record *call,
+	int repeat, double *time)
+{
+	int i, differs;
+	clock_t start;
+	isl_map *map1, *map2;
+	isl_bool res = isl_bool_error;
+	char *s;
+
+	map1 = read_map(ctx, call->str[0]);
+	map2 = read_map(ctx, call->str[1]);
+	start = clock();
+	for (i = 0; i < repeat; ++i)
+		res = isl_map_is_subset(map1, map2);
+	*time = elapsed(start, repeat);
+	s = isl_trace_bool_to_str(res);
+	differs = str_differs(s, call->str[2]);
+	free(s);
+	isl_map_free(map1);
+	isl_map_free(map2);
+	return differs;
+}
+
+static int replay_compute_flow(isl_ctx *ctx, struct isl_trace_record *call,
+	int repeat, double *time)
+{
+	int i, differs;
+	clock_t start;
+	isl_union_access_info *access;
+	isl_union_flow *flow = NULL;
+	isl_union_map *must, *may;
+
+	access = isl_union_access_info_from_sink(
+					read_union_map(ctx, call->str[0]));
+	access = isl_union_access_info_set_must_source(access,
+					read_union_map(ctx, call->str[1]));
+	access = isl_union_access_info_set_may_source(access,
+					read_union_map(ctx, call->str[2]));
+	if (!is_missing(call->str[3]))
+		access = isl_union_access_info_set_schedule(access,
+				isl_schedule_read_from_str(ctx, call->str[3]));
+	else
+		access = isl_union_access_info_set_schedule_map(access,
+					read_union_map(ctx, call->str[4]));
+	start = clock();
+	for (i = 0; i < repeat; ++i) {
+		isl_union_flow_free(flow);
+		flow = isl_union_access_info_compute_flow(
+					isl_union_access_info_copy(access));
+	}
+	*time = elapsed(start, repeat);
+	must = flow ? isl_union_flow_get_must_dependence(flow) : NULL;
+	may = flow ? isl_union_flow_get_may_dependence(flow) : NULL;
+	differs = union_map_differs(ctx, must, call->str[5]) ||
+		  union_map_differs(ctx, may, call->str[6]);
+	isl_union_map_free(must);
+	isl_union_map_free(may);
+	isl_union_flow_free(flow);
+	isl_union_access_info_free(access);
+	return differs;
+}
+
+/* Perform a recorded call to isl_schedule_constraints_compute_schedule.
+ * The arguments are the domain, the context and the validity,
+ * coincidence, condition, conditional validity and proximity constraints.
+ * The schedules are compared through their schedule maps.
+ */
+static int replay_compute_schedule(isl_ctx *ctx,
+	struct isl_trace_record *call, int repeat, double *time)
+{
+	int i, differs;
+	clock_t start;
+	isl_schedule_constraints *sc;
+	isl_schedule *sched = NULL;
+	isl_union_map *umap;
+	char *s;
+
+	sc = isl_schedule_constraints_on_domain(
+			isl_union_set_read_from_str(ctx, call->str[0]));
+	sc = isl_schedule_constraints_set_context(sc,
+			isl_set_read_from_str(ctx, call->str[1]));
+	sc = isl_schedule_constraints_set_validity(sc,
+			read_union_map(ctx, call->str[2]));
+	sc = isl_schedule_constraints_set_coincidence(sc,
+			read_union_map(ctx, call->str[3]));
+	sc = isl_schedule_constraints_set_conditional_validity(sc,
+			read_union_map(ctx, call->str[4]),
+			read_union_map(ctx, call->str[5]));
+	sc = isl_schedule_constraints_set_proximity(sc,
+			read_union_map(ctx, call->str[6]));
+	start = clock();
+	for (i = 0; i < repeat; ++i) {
+		isl_schedule_free(sched);
+		sched = isl_schedule_constraints_compute_schedule(
+					isl_schedule_constraints_copy(sc));
+	}
+	*time = elapsed(start, repeat);
+	umap = sched ? isl_schedule_get_map(sched) : NULL;
+	if (is_missing(call->str[7])) {
+		differs = umap != NULL;
+	} else {
+		isl_schedule *expected;
+		expected = isl_schedule_read_from_str(ctx, call->str[7]);
+		s = expected ? isl_union_map_to_str(
+				isl_schedule_get_map(expected)) : NULL;
+		isl_schedule_free(expected);
+		differs = !s || union_map_differs(ctx, umap, s);
+		free(s);
+	}
+	isl_union_map_free(umap);
+	isl_schedule_free(sched);
+	isl_schedule_constraints_free(sc);
+	return differs;
+}
+
+static int replay_ast(isl_ctx *ctx, struct isl_trace_record *call,
+	int repeat, double *time)
+{
+	int i, differs;
+	clock_t start;
+	isl_ast_build *build;
+	isl_union_map *schedule;
+	isl_ast_node *node = NULL;
+	char *s;
+
+	build = isl_ast_build_from_context(
+			isl_set_read_from_str(ctx, call->str[0]));
+	if (!is_missing(call->str[1]))
+		build = isl_ast_build_set_options(build,
+				read_union_map(ctx, call->str[1]));
+	schedule = read_union_map(ctx, call->str[2]);
+	start = clock();
+	for (i = 0; i < repeat; ++i) {
+		isl_ast_node_free(node);
+		node = isl_ast_build_node_from_schedule_map(build,
+						isl_union_map_copy(schedule));
+	}
+	*time = elapsed(start, repeat);
+	s = isl_trace_ast_node_to_str(node);
+	differs = str_differs(s, call->str[3]);
+	free(s);
+	isl_ast_node_free(node);
+	isl_union_map_free(schedule);
+	isl_ast_build_free(build);
+	return differs;
+}
+
+/* Perform "call" "repeat" times and store the average time
+ * spent in each call in *time.
+ * Return 1 if the result differs from the recorded result,
+ * 0 if it is the same and -1 if the operation is not known or
+ * if it has an unexpected number of arguments or results.
+ */
+int isl_trace_replay(isl_ctx *ctx, struct isl_trace_record *call,
+	int repeat, double *time)
+{
+	const char *op = call->op;
+
+#define CHECK(n,r)							\
+	if (call->n_arg != n || call->n_res != r)			\
+		return -1
+
+	if (!strcmp(op, "map_coalesce")) {
+		CHECK(1, 1);
+		return replay_map_op(ctx, call, repeat, time,
+					&isl_map_coalesce);
+	} else if (!strcmp(op, "map_lexmin")) {
+		CHECK(1, 1);
+		return replay_map_op(ctx, call, repeat, time,
+					&isl_map_lexmin);
+	} else if (!strcmp(op, "map_lexmax")) {
+		CHECK(1, 1);
+		return replay_map_op(ctx, call, repeat, time,
+					&isl_map_lexmax);
+	} else if (!strcmp(op, "map_is_subset")) {
+		CHECK(2, 1);
+		return replay_map_is_subset(ctx, call, repeat, time);
+	} else if (!strcmp(op, "union_access_info_compute_flow")) {
+		CHECK(5, 2);
+		return replay_compute_flow(ctx, call, repeat, time);
+	} else if (!strcmp(op, "schedule_constraints_compute_schedule")) {
+		CHECK(7, 1);
+		return replay_compute_schedule(ctx, call, repeat, time);
+	} else if (!strcmp(op, "ast_build_node_from_schedule_map")) {
+		CHECK(3, 1);
+		return replay_ast(ctx, call, repeat, time);
+	}
+
+#undef CHECK
+
+	return -1;
+}
@@ -0,0 +1,73 @@
+#ifndef ISL_TRACE_H
+#define ISL_TRACE_H
+
+#include <stdio.h>
+#include <time.h>
+#include <isl/ctx.h>
+#include <isl/schedule.h>
+#include <isl/ast.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define ISL_TRACE_MAX_STR	8
+
+/* A call that is being traced.
+ *
+ * "active" is set if the call was entered while tracing was enabled
+ * and "op" is only set if the call is also the outermost traced call,
+ * i.e., if it should be recorded.
+ * "str" contains the "n_arg" serialized arguments followed by
+ * the "n_res" serialized results.
+ * The clock is started after the last argument has been serialized and
+ * it is stopped before the first result is serialized.
+ */
+struct isl_trace_call {
+	int		active;
+	const char	*op;
+
+	int		n_arg;
+	int		n_res;
+	char		*str[ISL_TRACE_MAX_STR];
+
+	clock_t		start;
+	clock_t		end;
+};
+
+struct isl_trace;
+
+/* A call read from the trace.
+ *
+ * "str" contains the "n_arg" arguments followed by the "n_res" results.
+ * "recorded" is the time spent in the call when it was recorded.
+ */
+struct isl_trace_record {
+	char	op[100];
+	int	n_arg;
+	int	n_res;
+	char	*str[ISL_TRACE_MAX_STR];
+	double	recorded;
+};
+
+void isl_trace_enter(isl_ctx *ctx, struct isl_trace_call *call,
+	const char *op);
+void isl_trace_add_arg(struct isl_trace_call *call, char *str);
+void isl_trace_add_res(struct isl_trace_call *call, char *str);
+void isl_trace_leave(isl_ctx *ctx, struct isl_trace_call *call);
+void isl_trace_free(isl_ctx *ctx);
+
+__isl_give char *isl_trace_bool_to_str(isl_bool b);
+__isl_give char *isl_trace_schedule_to_str(__isl_keep isl_schedule *schedule);
+__isl_give char *isl_trace_ast_node_to_str(__isl_keep isl_ast_node *node);
+
+int isl_trace_read_record(FILE *file, struct isl_trace_record *record);
+void isl_trace_record_clear(struct isl_trace_record *record);
+int isl_trace_replay(isl_ctx *ctx, struct isl_trace_record *record,
+	int repeat, double *time);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -21,6 +21,7 @@
 #include <isl/map.h>
 #include <isl/set.h>
 #include <isl_space_private.h>
+#include <isl_thread.h>
 #include <isl/union_set.h>
 #include <isl/deprecated/union_map_int.h>
 
@@ -1216,23 +1217,53 @@ __isl_give isl_union_map *isl_union_map_intersect_range(
 	return gen_bin_op(umap, uset, &intersect_range_entry);
 }
 
+/* Data used by bin_op and its callbacks.
+ *
+ * "fn" is called on each pair of a map in the first union map and
+ * a map ("*entry") in the second union map ("umap2") for which "match"
+ * returns true (or on all pairs if "match" is NULL).
+ * "map" is the map in the first union map and
+ * "fn" may add maps to "res".
+ */
 struct isl_union_map_bin_data {
 	isl_union_map *umap2;
 	isl_union_map *res;
 	isl_map *map;
+	isl_bool (*match)(__isl_keep isl_map *map1, __isl_keep isl_map *map2);
 	isl_stat (*fn)(void **entry, void *user);
 };
 
+/* Is the range space of "map1" equal to the domain space of "map2"?
+ */
+static isl_bool match_range_domain(__isl_keep isl_map *map1,
+	__isl_keep isl_map *map2)
+{
+	return isl_space_tuple_is_equal(map1->dim, isl_dim_out,
+					map2->dim, isl_dim_in);
+}
+
+/* Do "map1" and "map2" have the same range space?
+ */
+static isl_bool match_range(__isl_keep isl_map *map1, __isl_keep isl_map *map2)
+{
+	return isl_space_tuple_is_equal(map1->dim, isl_dim_out,
+					map2->dim, isl_dim_out);
+}
+
+/* Do "map1" and "map2" have the same domain space?
+ */
+static isl_bool match_domain(__isl_keep isl_map *map1, __isl_keep isl_map *map2)
+{
+	return isl_space_tuple_is_equal(map1->dim, isl_dim_in,
+					map2->dim, isl_dim_in);
+}
+
 static isl_stat apply_range_entry(void **entry, void *user)
 {
 	struct isl_union_map_bin_data *data = user;
 	isl_map *map2 = *entry;
 	isl_bool empty;
 
-	if (!isl_space_tuple_is_equal(data->map->dim, isl_dim_out,
-				 map2->dim, isl_dim_in))
-		return isl_stat_ok;
-
 	map2 = isl_map_apply_range(isl_map_copy(data->map), isl_map_copy(map2));
 
 	empty = isl_map_is_empty(map2);
@@ -1250,6 +1281,23 @@ static isl_stat apply_range_entry(void **entry, void *user)
 	return isl_stat_ok;
 }
 
+/* Call data->fn on "entry" if it matches data->map.
+ */
+static isl_stat bin_match_entry(void **entry, void *user)
+{
+	struct isl_union_map_bin_data *data = user;
+	isl_bool match = isl_bool_true;
+
+	if (data->match)
+		match = data->match(data->map, *entry);
+	if (match < 0)
+		return isl_stat_error;
+	if (!match)
+		return isl_stat_ok;
+
+	return data->fn(entry, data);
+}
+
 static isl_stat bin_entry(void **entry, void *user)
 {
 	struct isl_union_map_bin_data *data = user;
@@ -1257,17 +1305,154 @@ static isl_stat bin_entry(void **entry, void *user)
 
 	data->map = map;
 	if (isl_hash_table_foreach(data->umap2->dim->ctx, &data->umap2->table,
-				   data->fn, data) < 0)
+				   &bin_match_entry, data) < 0)
+		return isl_stat_error;
+
+	return isl_stat_ok;
+}
+
+/* A pair of maps for which bin_op_parallel calls the "fn"
+ * of an isl_union_map_bin_data in a separate task and
+ * the maps added to the result by that call.
+ */
+struct isl_union_map_bin_task {
+	isl_map *map1;
+	isl_map *map2;
+	isl_union_map *res;
+};
+
+/* Data used by bin_op_parallel.
+ *
+ * "data" is the data of the sequential version and
+ * "task" contains the "n" matching pairs of maps.
+ */
+struct isl_union_map_bin_par_data {
+	struct isl_union_map_bin_data *data;
+	int n;
+	struct isl_union_map_bin_task *task;
+};
+
+/* Call data->fn on the pair of maps of task "i",
+ * collecting the result in a union map of the task.
+ * The task operates on unshared copies of the maps since
+ * the same map may appear in several pairs.
+ */
+static isl_stat bin_task(int i, void *user)
+{
+	struct isl_union_map_bin_par_data *par = user;
+	struct isl_union_map_bin_task *task = &par->task[i];
+	struct isl_union_map_bin_data data = *par->data;
+	isl_map *map2;
+	isl_stat r;
+
+	data.res = isl_union_map_alloc(isl_space_copy(par->data->res->dim), 1);
+	data.map = isl_map_dup_unshared(task->map1);
+	map2 = isl_map_dup_unshared(task->map2);
+	if (!data.map || !map2)
+		r = isl_stat_error;
+	else
+		r = data.fn((void **) &map2, &data);
+	isl_map_free(map2);
+	isl_map_free(data.map);
+	task->res = data.res;
+
+	return r < 0 || !task->res ? isl_stat_error : isl_stat_ok;
+}
+
+/* Add a pair consisting of par->data->map and the map in "entry"
+ * to par->task if they match.
+ * If par->task has not been allocated yet, then only count the pair.
+ */
+static isl_stat add_bin_task(void **entry, void *user)
+{
+	struct isl_union_map_bin_par_data *par = user;
+	struct isl_union_map_bin_data *data = par->data;
+	isl_bool match = isl_bool_true;
+
+	if (data->match)
+		match = data->match(data->map, *entry);
+	if (match < 0)
 		return isl_stat_error;
+	if (!match)
+		return isl_stat_ok;
+
+	if (par->task) {
+		par->task[par->n].map1 = data->map;
+		par->task[par->n].map2 = *entry;
+	}
+	par->n++;
 
 	return isl_stat_ok;
 }
 
+/* Add the pairs of data->map with the maps of data->umap2 to par->task.
+ */
+static isl_stat add_bin_tasks(void **entry, void *user)
+{
+	struct isl_union_map_bin_par_data *par = user;
+	struct isl_union_map_bin_data *data = par->data;
+
+	data->map = *entry;
+	return isl_hash_table_foreach(data->umap2->dim->ctx,
+				&data->umap2->table, &add_bin_task, par);
+}
+
+/* Perform the bulk of bin_op using multiple threads.
+ *
+ * The matching pairs are first counted and then collected in the order
+ * in which the sequential version visits them and data->fn is then called
+ * on each pair in a separate task.
+ * Each call adds at most one map to its own result.
+ * These results are added to data->res in the original order of the pairs,
+ * such that the final result is the same as that of the sequential version.
+ */
+static isl_stat bin_op_parallel(struct isl_union_map_bin_data *data,
+	__isl_keep isl_union_map *umap1)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_stat r = isl_stat_ok;
+	struct isl_union_map_bin_par_data par = { data, 0, NULL };
+
+	ctx = isl_union_map_get_ctx(umap1);
+	if (isl_hash_table_foreach(ctx, &umap1->table,
+				   &add_bin_tasks, &par) < 0)
+		return isl_stat_error;
+	if (par.n == 0)
+		return isl_stat_ok;
+	par.task = isl_calloc_array(ctx, struct isl_union_map_bin_task, par.n);
+	if (!par.task)
+		return isl_stat_error;
+	par.n = 0;
+	if (isl_hash_table_foreach(ctx, &umap1->table,
+				   &add_bin_tasks, &par) < 0)
+		r = isl_stat_error;
+	if (r >= 0)
+		r = isl_ctx_parallel_for(ctx, par.n, &bin_task, &par);
+	for (i = 0; i < par.n; ++i) {
+		if (r >= 0 && isl_union_map_foreach_map(par.task[i].res,
+						&add_map, &data->res) < 0)
+			r = isl_stat_error;
+		isl_union_map_free(par.task[i].res);
+	}
+	free(par.task);
+
+	return r;
+}
+
+/* Call "fn" on each pair of a map in "umap1" and a map in "umap2"
+ * for which "match" returns true (or on all pairs if "match" is NULL),
+ * collecting the results in a new union map.
+ * If the "union-map-threads" option allows for it,
+ * then the calls are performed in parallel.
+ */
 static __isl_give isl_union_map *bin_op(__isl_take isl_union_map *umap1,
 	__isl_take isl_union_map *umap2,
+	isl_bool (*match)(__isl_keep isl_map *map1, __isl_keep isl_map *map2),
 	isl_stat (*fn)(void **entry, void *user))
 {
-	struct isl_union_map_bin_data data = { NULL, NULL, NULL, fn };
+	isl_stat r;
+	struct isl_union_map_bin_data data = { NULL, NULL, NULL, match, fn };
 
 	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
 	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
@@ -1278,8 +1463,12 @@ static __isl_give isl_union_map *bin_op(__isl_take isl_union_map *umap1,
 	data.umap2 = umap2;
 	data.res = isl_union_map_alloc(isl_space_copy(umap1->dim),
 				       umap1->table.n);
-	if (isl_hash_table_foreach(umap1->dim->ctx, &umap1->table,
-				   &bin_entry, &data) < 0)
+	if (isl_ctx_parallel_n_thread(umap1->dim->ctx, 2) > 1)
+		r = bin_op_parallel(&data, umap1);
+	else
+		r = isl_hash_table_foreach(umap1->dim->ctx, &umap1->table,
+					   &bin_entry, &data);
+	if (r < 0)
 		goto error;
 
 	isl_union_map_free(umap1);
@@ -1295,7 +1484,7 @@ error:
 __isl_give isl_union_map *isl_union_map_apply_range(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &apply_range_entry);
+	return bin_op(umap1, umap2, &match_range_domain, &apply_range_entry);
 }
 
 __isl_give isl_union_map *isl_union_map_apply_domain(
@@ -1317,10 +1506,6 @@ static isl_stat map_lex_lt_entry(void **entry, void *user)
 	struct isl_union_map_bin_data *data = user;
 	isl_map *map2 = *entry;
 
-	if (!isl_space_tuple_is_equal(data->map->dim, isl_dim_out,
-				 map2->dim, isl_dim_out))
-		return isl_stat_ok;
-
 	map2 = isl_map_lex_lt_map(isl_map_copy(data->map), isl_map_copy(map2));
 
 	data->res = isl_union_map_add_map(data->res, map2);
@@ -1331,7 +1516,7 @@ static isl_stat map_lex_lt_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_lex_lt_union_map(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &map_lex_lt_entry);
+	return bin_op(umap1, umap2, &match_range, &map_lex_lt_entry);
 }
 
 static isl_stat map_lex_le_entry(void **entry, void *user)
@@ -1339,10 +1524,6 @@ static isl_stat map_lex_le_entry(void **entry, void *user)
 	struct isl_union_map_bin_data *data = user;
 	isl_map *map2 = *entry;
 
-	if (!isl_space_tuple_is_equal(data->map->dim, isl_dim_out,
-				 map2->dim, isl_dim_out))
-		return isl_stat_ok;
-
 	map2 = isl_map_lex_le_map(isl_map_copy(data->map), isl_map_copy(map2));
 
 	data->res = isl_union_map_add_map(data->res, map2);
@@ -1353,7 +1534,7 @@ static isl_stat map_lex_le_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_lex_le_union_map(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &map_lex_le_entry);
+	return bin_op(umap1, umap2, &match_range, &map_lex_le_entry);
 }
 
 static isl_stat product_entry(void **entry, void *user)
@@ -1371,7 +1552,7 @@ static isl_stat product_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_product(__isl_take isl_union_map *umap1,
 	__isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &product_entry);
+	return bin_op(umap1, umap2, NULL, &product_entry);
 }
 
 static isl_stat set_product_entry(void **entry, void *user)
@@ -1389,7 +1570,7 @@ static isl_stat set_product_entry(void **entry, void *user)
 __isl_give isl_union_set *isl_union_set_product(__isl_take isl_union_set *uset1,
 	__isl_take isl_union_set *uset2)
 {
-	return bin_op(uset1, uset2, &set_product_entry);
+	return bin_op(uset1, uset2, NULL, &set_product_entry);
 }
 
 static isl_stat domain_product_entry(void **entry, void *user)
@@ -1397,10 +1578,6 @@ static isl_stat domain_product_entry(void **entry, void *user)
 	struct isl_union_map_bin_data *data = user;
 	isl_map *map2 = *entry;
 
-	if (!isl_space_tuple_is_equal(data->map->dim, isl_dim_out,
-				 map2->dim, isl_dim_out))
-		return isl_stat_ok;
-
 	map2 = isl_map_domain_product(isl_map_copy(data->map),
 				     isl_map_copy(map2));
 
@@ -1414,7 +1591,7 @@ static isl_stat domain_product_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_domain_product(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &domain_product_entry);
+	return bin_op(umap1, umap2, &match_range, &domain_product_entry);
 }
 
 static isl_stat range_product_entry(void **entry, void *user)
@@ -1422,10 +1599,6 @@ static isl_stat range_product_entry(void **entry, void *user)
 	struct isl_union_map_bin_data *data = user;
 	isl_map *map2 = *entry;
 
-	if (!isl_space_tuple_is_equal(data->map->dim, isl_dim_in,
-				 map2->dim, isl_dim_in))
-		return isl_stat_ok;
-
 	map2 = isl_map_range_product(isl_map_copy(data->map),
 				     isl_map_copy(map2));
 
@@ -1437,7 +1610,7 @@ static isl_stat range_product_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_range_product(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &range_product_entry);
+	return bin_op(umap1, umap2, &match_domain, &range_product_entry);
 }
 
 /* If data->map A -> B and "map2" C -> D have the same range space,
@@ -1448,10 +1621,6 @@ static isl_stat flat_domain_product_entry(void **entry, void *user)
 	struct isl_union_map_bin_data *data = user;
 	isl_map *map2 = *entry;
 
-	if (!isl_space_tuple_is_equal(data->map->dim, isl_dim_out,
-				 map2->dim, isl_dim_out))
-		return isl_stat_ok;
-
 	map2 = isl_map_flat_domain_product(isl_map_copy(data->map),
 					  isl_map_copy(map2));
 
@@ -1465,7 +1634,7 @@ static isl_stat flat_domain_product_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_flat_domain_product(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &flat_domain_product_entry);
+	return bin_op(umap1, umap2, &match_range, &flat_domain_product_entry);
 }
 
 static isl_stat flat_range_product_entry(void **entry, void *user)
@@ -1473,10 +1642,6 @@ static isl_stat flat_range_product_entry(void **entry, void *user)
 	struct isl_union_map_bin_data *data = user;
 	isl_map *map2 = *entry;
 
-	if (!isl_space_tuple_is_equal(data->map->dim, isl_dim_in,
-				 map2->dim, isl_dim_in))
-		return isl_stat_ok;
-
 	map2 = isl_map_flat_range_product(isl_map_copy(data->map),
 					  isl_map_copy(map2));
 
@@ -1488,7 +1653,7 @@ static isl_stat flat_range_product_entry(void **entry, void *user)
 __isl_give isl_union_map *isl_union_map_flat_range_product(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &flat_range_product_entry);
+	return bin_op(umap1, umap2, &match_domain, &flat_range_product_entry);
 }
 
 static __isl_give isl_union_set *cond_un_op(__isl_take isl_union_map *umap,
@@ -1637,14 +1802,95 @@ static isl_stat inplace_entry(void **entry, void *user)
 	return isl_stat_ok;
 }
 
+/* Data used by inplace_parallel.
+ *
+ * "fn" is the function that is applied to each map.
+ * "entry" contains the "n" entries of the union map and
+ * "res" the results of applying "fn" to the maps in those entries.
+ */
+struct isl_union_map_inplace_data {
+	__isl_give isl_map *(*fn)(__isl_take isl_map *);
+	int n;
+	void ***entry;
+	isl_map **res;
+};
+
+/* Add "entry" to data->entry.
+ */
+static isl_stat collect_entry(void **entry, void *user)
+{
+	struct isl_union_map_inplace_data *data = user;
+
+	data->entry[data->n++] = entry;
+	return isl_stat_ok;
+}
+
+/* Apply data->fn to the map in entry "i".
+ * The map may be shared with other objects, so data->fn is applied
+ * to an unshared copy.
+ */
+static isl_stat inplace_task(int i, void *user)
+{
+	struct isl_union_map_inplace_data *data = user;
+
+	data->res[i] = data->fn(isl_map_dup_unshared(*data->entry[i]));
+	return data->res[i] ? isl_stat_ok : isl_stat_error;
+}
+
+/* Apply "fn" to each map in "umap" using multiple threads.
+ * The entries are first collected such that each of them
+ * can be handled by a separate task.
+ * The original maps are only replaced after all tasks have finished.
+ */
+static isl_stat inplace_parallel(__isl_keep isl_union_map *umap,
+	__isl_give isl_map *(*fn)(__isl_take isl_map *))
+{
+	int i;
+	isl_ctx *ctx = umap->dim->ctx;
+	isl_stat r;
+	struct isl_union_map_inplace_data data = { fn, 0 };
+
+	data.entry = isl_calloc_array(ctx, void **, umap->table.n);
+	data.res = isl_calloc_array(ctx, isl_map *, umap->table.n);
+	if (!data.entry || !data.res)
+		r = isl_stat_error;
+	else
+		r = isl_hash_table_foreach(ctx, &umap->table,
+					    &collect_entry, &data);
+	if (r >= 0)
+		r = isl_ctx_parallel_for(ctx, data.n, &inplace_task, &data);
+	for (i = 0; i < data.n; ++i) {
+		if (r < 0) {
+			isl_map_free(data.res[i]);
+			continue;
+		}
+		isl_map_free(*data.entry[i]);
+		*data.entry[i] = data.res[i];
+	}
+	free(data.res);
+	free(data.entry);
+
+	return r;
+}
+
+/* Apply "fn" to each map in "umap", replacing the map by the result.
+ * If the "union-map-threads" option allows for it,
+ * then the maps are handled in parallel.
+ */
 static __isl_give isl_union_map *inplace(__isl_take isl_union_map *umap,
 	__isl_give isl_map *(*fn)(__isl_take isl_map *))
 {
+	isl_stat r;
+
 	if (!umap)
 		return NULL;
 
-	if (isl_hash_table_foreach(umap->dim->ctx, &umap->table,
-				    &inplace_entry, &fn) < 0)
+	if (isl_ctx_parallel_n_thread(umap->dim->ctx, umap->table.n) > 1)
+		r = inplace_parallel(umap, fn);
+	else
+		r = isl_hash_table_foreach(umap->dim->ctx, &umap->table,
+					    &inplace_entry, &fn);
+	if (r < 0)
 		goto error;
 
 	return umap;
@@ -367,7 +367,7 @@ isl_ctx *isl_val_get_ctx(__isl_keep isl_val *val)
  */
 __isl_give isl_val *isl_val_normalize(__isl_take isl_val *v)
 {
-	isl_ctx *ctx;
+	isl_int gcd;
 
 	if (!v)
 		return NULL;
@@ -379,12 +379,13 @@ __isl_give isl_val *isl_val_normalize(__isl_take isl_val *v)
 		isl_int_neg(v->d, v->d);
 		isl_int_neg(v->n, v->n);
 	}
-	ctx = isl_val_get_ctx(v);
-	isl_int_gcd(ctx->normalize_gcd, v->n, v->d);
-	if (isl_int_is_one(ctx->normalize_gcd))
-		return v;
-	isl_int_divexact(v->n, v->n, ctx->normalize_gcd);
-	isl_int_divexact(v->d, v->d, ctx->normalize_gcd);
+	isl_int_init(gcd);
+	isl_int_gcd(gcd, v->n, v->d);
+	if (!isl_int_is_one(gcd)) {
+		isl_int_divexact(v->n, v->n, gcd);
+		isl_int_divexact(v->d, v->d, gcd);
+	}
+	isl_int_clear(gcd);
 	return v;
 }
 
@@ -24,7 +24,7 @@ struct isl_vec *isl_vec_alloc(struct isl_ctx *ctx, unsigned size)
 {
 	struct isl_vec *vec;
 
-	vec = isl_alloc_type(ctx, struct isl_vec);
+	vec = isl_slab_alloc_type(ctx, struct isl_vec);
 	if (!vec)
 		return NULL;
 
@@ -41,6 +41,7 @@ struct isl_vec *isl_vec_alloc(struct isl_ctx *ctx, unsigned size)
 	return vec;
 error:
 	isl_blk_free(ctx, vec->block);
+	isl_slab_free_type(ctx, vec, struct isl_vec);
 	return NULL;
 }
 
@@ -170,7 +171,7 @@ __isl_null isl_vec *isl_vec_free(__isl_take isl_vec *vec)
 
 	isl_ctx_deref(vec->ctx);
 	isl_blk_free(vec->ctx, vec->block);
-	free(vec);
+	isl_slab_free_type(vec->ctx, vec, struct isl_vec);
 
 	return NULL;
 }
@@ -13,6 +13,9 @@
 /* define if your compiler has __attribute__ */
 #cmakedefine HAVE___ATTRIBUTE__ /**/
 
+/* use POSIX threads to perform union map operations in parallel */
+#cmakedefine ISL_USE_THREADS
+
 /* use gmp to implement isl_int */
 #cmakedefine USE_GMP_FOR_MP
 
@@ -379,8 +379,8 @@ static void yy_fatal_error (yyconst char msg[]  );
 	(yy_more_offset) = 0; \
 	(yy_c_buf_p) = yy_cp;
 
-#define YY_NUM_RULES 11
-#define YY_END_OF_BUFFER 12
+#define YY_NUM_RULES 12
+#define YY_END_OF_BUFFER 13
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -388,23 +388,24 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_acclist[60] =
+static yyconst flex_int16_t yy_acclist[67] =
     {   0,
-       12,   10,   11,    9,   10,   11,    9,   11,    8,   10,
-       11,    6,   10,   11,    7,   10,   11,    7,   10,   11,
-        7,   10,   11,    7,   10,   11,    7,   10,   11,   10,
-       11,    9,    6,    7,    7,    7,    7,    7,    1,    7,
-        7,    7,    7,    1,    7,    7,    5,    7,    7,    7,
-        7,    7,    4,    7,    3,    7,    7,    2,    7
+       13,   11,   12,   10,   11,   12,   10,   12,    9,   11,
+       12,    7,   11,   12,    8,   11,   12,    8,   11,   12,
+        8,   11,   12,    8,   11,   12,    8,   11,   12,    8,
+       11,   12,   11,   12,   10,    7,    8,    8,    8,    8,
+        8,    8,    1,    8,    8,    8,    8,    8,    1,    8,
+        6,    8,    8,    5,    8,    8,    8,    8,    8,    4,
+        8,    3,    8,    8,    2,    8
     } ;
 
-static yyconst flex_int16_t yy_accept[45] =
+static yyconst flex_int16_t yy_accept[49] =
     {   0,
         1,    1,    1,    2,    4,    7,    9,   12,   15,   18,
-       21,   24,   27,   30,   32,   33,   34,   35,   36,   37,
-       38,   39,   39,   39,   40,   41,   42,   43,   44,   44,
-       44,   45,   46,   47,   49,   50,   51,   52,   53,   55,
-       57,   58,   60,   60
+       21,   24,   27,   30,   33,   35,   36,   37,   38,   39,
+       40,   41,   42,   43,   43,   43,   44,   45,   46,   47,
+       48,   49,   49,   49,   50,   51,   53,   54,   56,   57,
+       58,   59,   60,   62,   64,   65,   67,   67
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
@@ -421,8 +422,8 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    8,    1,    1,    1,    1,    9,    7,    7,    7,
 
        10,   11,   12,    7,   13,    7,    7,   14,    7,   15,
-        7,   16,    7,   17,   18,   19,    7,    7,    7,    7,
-        7,    7,   20,    1,   21,    1,    1,    1,    1,    1,
+        7,   16,    7,   17,   18,   19,   20,    7,    7,    7,
+        7,    7,   21,    1,   22,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
@@ -439,67 +440,69 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int32_t yy_meta[22] =
+static yyconst flex_int32_t yy_meta[23] =
     {   0,
         1,    1,    1,    2,    1,    3,    3,    1,    3,    3,
-        3,    3,    3,    3,    3,    3,    3,    3,    3,    1,
-        1
+        3,    3,    3,    3,    3,    3,    3,    3,    3,    3,
+        1,    1
     } ;
 
-static yyconst flex_int16_t yy_base[47] =
+static yyconst flex_int16_t yy_base[51] =
     {   0,
-        0,    0,   66,   87,   20,   22,   87,   59,    0,   53,
-       42,   46,   48,   18,   25,   51,    0,   45,   39,   43,
-       44,   21,   40,   24,   39,   37,   31,   35,   25,   59,
-       26,   26,   27,    0,   25,   27,   17,   23,    0,    0,
-       16,    0,   87,   27,   80,   83
+        0,    0,   71,   91,   21,   23,   91,   63,    0,   57,
+       47,   45,   49,   51,   19,   26,   54,    0,   48,   40,
+       41,   45,   46,   22,   42,   25,   41,   43,   38,   32,
+       29,   26,   62,   27,   27,    0,   27,    0,   26,   28,
+       18,   24,    0,    0,   17,    0,   91,   28,   84,   87
     } ;
 
-static yyconst flex_int16_t yy_def[47] =
+static yyconst flex_int16_t yy_def[51] =
     {   0,
-       43,    1,   43,   43,   43,   43,   43,   43,   44,   44,
-       44,   44,   44,   45,   43,   43,   44,   44,   44,   44,
-       44,   45,   46,   45,   44,   44,   44,   44,   45,   46,
-       45,   44,   44,   44,   44,   44,   44,   44,   44,   44,
-       44,   44,    0,   43,   43,   43
+       47,    1,   47,   47,   47,   47,   47,   47,   48,   48,
+       48,   48,   48,   48,   49,   47,   47,   48,   48,   48,
+       48,   48,   48,   49,   50,   49,   48,   48,   48,   48,
+       48,   49,   50,   49,   48,   48,   48,   48,   48,   48,
+       48,   48,   48,   48,   48,   48,    0,   47,   47,   47
     } ;
 
-static yyconst flex_int16_t yy_nxt[109] =
+static yyconst flex_int16_t yy_nxt[114] =
     {   0,
         4,    5,    6,    4,    7,    8,    9,    4,   10,    9,
-        9,    9,   11,   12,    9,    9,   13,    9,    9,   14,
-        4,   15,   15,   15,   15,   23,   15,   15,   23,   17,
-       42,   23,   23,   23,   41,   40,   39,   38,   24,   37,
-       36,   24,   22,   22,   24,   24,   24,   30,   35,   34,
-       33,   32,   28,   27,   26,   25,   16,   21,   20,   19,
-       31,   22,   22,   18,   16,   43,   30,   43,   43,   43,
-       43,   43,   43,   43,   43,   43,   43,   43,   43,   31,
-       22,   43,   22,   29,   29,   29,    3,   43,   43,   43,
-       43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
-
-       43,   43,   43,   43,   43,   43,   43,   43
+       11,    9,   12,   13,    9,    9,   14,    9,    9,    9,
+       15,    4,   16,   16,   16,   16,   25,   16,   16,   25,
+       18,   46,   25,   25,   25,   45,   44,   43,   42,   41,
+       26,   40,   39,   26,   24,   24,   26,   26,   26,   33,
+       38,   37,   36,   35,   31,   30,   29,   28,   27,   17,
+       23,   22,   21,   34,   24,   24,   20,   19,   17,   33,
+       47,   47,   47,   47,   47,   47,   47,   47,   47,   47,
+       47,   47,   47,   34,   24,   47,   24,   32,   32,   32,
+        3,   47,   47,   47,   47,   47,   47,   47,   47,   47,
+
+       47,   47,   47,   47,   47,   47,   47,   47,   47,   47,
+       47,   47,   47
     } ;
 
-static yyconst flex_int16_t yy_chk[109] =
+static yyconst flex_int16_t yy_chk[114] =
     {   0,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    5,    5,    6,    6,   14,   15,   15,   22,   44,
-       41,   24,   29,   31,   38,   37,   36,   35,   14,   33,
-       32,   22,   23,   23,   24,   29,   31,   23,   28,   27,
-       26,   25,   21,   20,   19,   18,   16,   13,   12,   11,
-       23,   30,   30,   10,    8,    3,   30,    0,    0,    0,
-        0,    0,    0,    0,    0,    0,    0,    0,    0,   30,
-       45,    0,   45,   46,   46,   46,   43,   43,   43,   43,
-       43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
-
-       43,   43,   43,   43,   43,   43,   43,   43
+        1,    1,    5,    5,    6,    6,   15,   16,   16,   24,
+       48,   45,   26,   32,   34,   42,   41,   40,   39,   37,
+       15,   35,   31,   24,   25,   25,   26,   32,   34,   25,
+       30,   29,   28,   27,   23,   22,   21,   20,   19,   17,
+       14,   13,   12,   25,   33,   33,   11,   10,    8,   33,
+        3,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+        0,    0,    0,   33,   49,    0,   49,   50,   50,   50,
+       47,   47,   47,   47,   47,   47,   47,   47,   47,   47,
+
+       47,   47,   47,   47,   47,   47,   47,   47,   47,   47,
+       47,   47,   47
     } ;
 
 /* Table of booleans, true if rule could match eol. */
-static yyconst flex_int32_t yy_rule_can_match_eol[12] =
+static yyconst flex_int32_t yy_rule_can_match_eol[13] =
     {   0,
-1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0,     };
+1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0,     };
 
 extern int yy_flex_debug;
 int yy_flex_debug = 0;
@@ -539,7 +542,7 @@ char *yytext_ptr;
 #include "y.tab.h"
 
 void yyerror(char *);
-#line 543 "lex.yy.c"
+#line 546 "lex.yy.c"
 
 #define INITIAL 0
 
@@ -724,7 +727,7 @@ YY_DECL
 #line 10 "optparser.l"
 
 
-#line 728 "lex.yy.c"
+#line 731 "lex.yy.c"
 
 	if ( !(yy_init) )
 		{
@@ -782,14 +785,14 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 44 )
+				if ( yy_current_state >= 48 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
 			*(yy_state_ptr)++ = yy_current_state;
 			++yy_cp;
 			}
-		while ( yy_base[yy_current_state] != 87 );
+		while ( yy_base[yy_current_state] != 91 );
 
 yy_find_action:
 		yy_current_state = *--(yy_state_ptr);
@@ -867,43 +870,50 @@ YY_RULE_SETUP
 case 6:
 YY_RULE_SETUP
 #line 33 "optparser.l"
+{
+		return FUSE;
+	    }
+	YY_BREAK
+case 7:
+YY_RULE_SETUP
+#line 37 "optparser.l"
 {
             yylval.intValue = atoi(yytext);
             return INT;
         }
 	YY_BREAK
-case 7:
+case 8:
 YY_RULE_SETUP
-#line 38 "optparser.l"
+#line 42 "optparser.l"
 { 
                 yylval.sValue = strdup(yytext);
                 return VAR;
             }
 	YY_BREAK
-case 8:
+case 9:
 YY_RULE_SETUP
-#line 43 "optparser.l"
+#line 47 "optparser.l"
 {
                 return *yytext;
              }
 	YY_BREAK
-case 9:
-/* rule 9 can match eol */
+case 10:
+/* rule 10 can match eol */
 YY_RULE_SETUP
-#line 47 "optparser.l"
+#line 51 "optparser.l"
 ;       /* ignore whitespace */
 	YY_BREAK
-case 10:
+case 11:
 YY_RULE_SETUP
-#line 49 "optparser.l"
+#line 53 "optparser.l"
 yyerror("Unknown character");
 	YY_BREAK
-case 11:
+case 12:
 YY_RULE_SETUP
-#line 50 "optparser.l"
+#line 54 "optparser.l"
 ECHO;
 	YY_BREAK
-#line 907 "lex.yy.c"
+#line 917 "lex.yy.c"
 			case YY_STATE_EOF(INITIAL):
 				yyterminate();
 
@@ -1164,7 +1174,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 44 )
+			if ( yy_current_state >= 48 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1187,11 +1197,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 44 )
+		if ( yy_current_state >= 48 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 43);
+	yy_is_jam = (yy_current_state == 47);
 	if ( ! yy_is_jam )
 		*(yy_state_ptr)++ = yy_current_state;
 
@@ -1886,7 +1896,7 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 50 "optparser.l"
+#line 54 "optparser.l"
 
 
 int yywrap(void) {
@@ -8,9 +8,16 @@ nodeType *realign(varNodeType *, varNodeType *, unsigned);
 nodeType *isplit(varNodeType *, varNodeType *, varNodeType *, char *, unsigned);
 nodeType *affine(varNodeType *, char *);
 nodeType *lift(varNodeType *, varNodeType *, unsigned);
+nodeType *fuse(varNodeType *, varNodeType *, varNodeType *, unsigned, unsigned);
+nodeType *op(char *, varNodeType *);
+void arg(unsigned);
 
 nodeType *stmtPtr;
 
+/* arguments of the labelled operation being parsed */
+unsigned opArgs[MAX_OP_ARGS];
+unsigned opNArgs;
+
 int yylex(void);
 
 void yyerror(char *s);
@@ -24,7 +31,7 @@ void yyerror(char *s);
 
 %token <intValue> INT
 %token <sValue> VAR STRING
-%token REALIGN ISPLIT AFFINE LIFT
+%token REALIGN ISPLIT AFFINE LIFT FUSE
 
 %type <nPtr> stmt
 
@@ -36,6 +43,14 @@ stmt:
 	| '(' VAR ',' VAR ')' '=' ISPLIT '(' VAR ',' STRING ',' INT ')'  { stmtPtr = isplit(var($2), var($4), var($9), $11, $13);}
 	| AFFINE '(' VAR ',' STRING ')'                                  { stmtPtr  = affine(var($3), $5); }
 	| VAR '=' LIFT '(' VAR ',' INT ')'                               { stmtPtr = lift(var($1), var($5), $7);}
+	| VAR '=' FUSE '(' VAR ',' VAR ',' INT ')'                       { stmtPtr = fuse(var($1), var($5), var($7), $9, 0);}
+	| VAR '=' FUSE '(' VAR ',' VAR ',' INT ',' INT ')'               { stmtPtr = fuse(var($1), var($5), var($7), $9, $11);}
+	| VAR '(' VAR ',' args ')'                                       { stmtPtr = op($1, var($3));}
+        ;
+
+args:
+        INT                                                             { opNArgs = 0; arg($1); }
+	| args ',' INT                                                   { arg($3); }
         ;
 
 %%
@@ -119,3 +134,49 @@ nodeType *lift(varNodeType *r, varNodeType *l, unsigned n){
 
     return p;
 }
+
+nodeType *fuse(varNodeType *r, varNodeType *l1, varNodeType *l2, unsigned n, unsigned shift){
+    nodeType *p;
+
+    /* allocate node */
+    if ((p = malloc(sizeof(nodeType))) == NULL)
+        yyerror("out of memory");
+
+    /* copy information */
+    p->type = typeFuse;
+    p->f.r = r;
+    p->f.l1 = l1;
+    p->f.l2 = l2;
+    p->f.n = n;
+    p->f.shift = shift;
+
+    return p;
+}
+
+void arg(unsigned n){
+    if (opNArgs < MAX_OP_ARGS)
+        opArgs[opNArgs] = n;
+    else
+        yyerror("too many arguments");
+    opNArgs++;
+}
+
+nodeType *op(char *name, varNodeType *l){
+    nodeType *p;
+
+    if (opNArgs > MAX_OP_ARGS)
+        return NULL;
+
+    /* allocate node */
+    if ((p = malloc(sizeof(nodeType))) == NULL)
+        yyerror("out of memory");
+
+    /* copy information */
+    p->type = typeOp;
+    p->o.name = strdup(name);
+    p->o.l = l;
+    p->o.nargs = opNArgs;
+    memcpy(p->o.args, opArgs, sizeof(opArgs));
+
+    return p;
+}
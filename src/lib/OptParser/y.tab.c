@@ -72,7 +72,8 @@
      REALIGN = 261,
      ISPLIT = 262,
      AFFINE = 263,
-     LIFT = 264
+     LIFT = 264,
+     FUSE = 265
    };
 #endif
 /* Tokens.  */
@@ -83,6 +84,7 @@
 #define ISPLIT 262
 #define AFFINE 263
 #define LIFT 264
+#define FUSE 265
 
 
 
@@ -99,9 +101,16 @@ nodeType *realign(varNodeType *, varNodeType *, unsigned);
 nodeType *isplit(varNodeType *, varNodeType *, varNodeType *, char *, unsigned);
 nodeType *affine(varNodeType *, char *);
 nodeType *lift(varNodeType *, varNodeType *, unsigned);
+nodeType *fuse(varNodeType *, varNodeType *, varNodeType *, unsigned, unsigned);
+nodeType *op(char *, varNodeType *);
+void arg(unsigned);
 
 nodeType *stmtPtr;
 
+/* arguments of the labelled operation being parsed */
+unsigned opArgs[MAX_OP_ARGS];
+unsigned opNArgs;
+
 int yylex(void);
 
 void yyerror(char *s);
@@ -127,14 +136,14 @@ void yyerror(char *s);
 
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 typedef union YYSTYPE
-#line 19 "optparser.y"
+#line 26 "optparser.y"
 {
     char* sValue;                /* variable name */
     nodeType *nPtr;
     unsigned intValue;
 }
 /* Line 193 of yacc.c.  */
-#line 138 "y.tab.c"
+#line 147 "y.tab.c"
 	YYSTYPE;
 # define yystype YYSTYPE /* obsolescent; will be withdrawn */
 # define YYSTYPE_IS_DECLARED 1
@@ -147,7 +156,7 @@ typedef union YYSTYPE
 
 
 /* Line 216 of yacc.c.  */
-#line 151 "y.tab.c"
+#line 160 "y.tab.c"
 
 #ifdef short
 # undef short
@@ -360,22 +369,22 @@ union yyalloc
 #endif
 
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL  10
+#define YYFINAL  11
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   38
+#define YYLAST   60
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  14
+#define YYNTOKENS  15
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  2
+#define YYNNTS  3
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  5
+#define YYNRULES  10
 /* YYNRULES -- Number of states.  */
-#define YYNSTATES  39
+#define YYNSTATES  58
 
 /* YYTRANSLATE(YYLEX) -- Bison symbol number corresponding to YYLEX.  */
 #define YYUNDEFTOK  2
-#define YYMAXUTOK   264
+#define YYMAXUTOK   265
 
 #define YYTRANSLATE(YYX)						\
   ((unsigned int) (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
@@ -387,9 +396,9 @@ static const yytype_uint8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-      10,    12,     2,     2,    11,     2,     2,     2,     2,     2,
+      11,    13,     2,     2,    12,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,    13,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,    14,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -409,7 +418,7 @@ static const yytype_uint8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
-       5,     6,     7,     8,     9
+       5,     6,     7,     8,     9,    10
 };
 
 #if YYDEBUG
@@ -417,23 +426,28 @@ static const yytype_uint8 yytranslate[] =
    YYRHS.  */
 static const yytype_uint8 yyprhs[] =
 {
-       0,     0,     3,    12,    27,    34
+       0,     0,     3,    12,    27,    34,    43,    54,    67,    74,
+      76
 };
 
 /* YYRHS -- A `-1'-separated list of the rules' RHS.  */
 static const yytype_int8 yyrhs[] =
 {
-      15,     0,    -1,     6,    10,     4,    11,     4,    11,     3,
-      12,    -1,    10,     4,    11,     4,    12,    13,     7,    10,
-       4,    11,     5,    11,     3,    12,    -1,     8,    10,     4,
-      11,     5,    12,    -1,     4,    13,     9,    10,     4,    11,
-       3,    12,    -1
+      16,     0,    -1,     6,    11,     4,    12,     4,    12,     3,
+      13,    -1,    11,     4,    12,     4,    13,    14,     7,    11,
+       4,    12,     5,    12,     3,    13,    -1,     8,    11,     4,
+      12,     5,    13,    -1,     4,    14,     9,    11,     4,    12,
+       3,    13,    -1,     4,    14,    10,    11,     4,    12,     4,
+      12,     3,    13,    -1,     4,    14,    10,    11,     4,    12,
+       4,    12,     3,    12,     3,    13,    -1,     4,    11,     4,
+      12,    17,    13,    -1,     3,    -1,    17,    12,     3,    -1
 };
 
 /* YYRLINE[YYN] -- source line where rule number YYN was defined.  */
 static const yytype_uint8 yyrline[] =
 {
-       0,    35,    35,    36,    37,    38
+       0,    42,    42,    43,    44,    45,    46,    47,    48,    52,
+      53
 };
 #endif
 
@@ -443,8 +457,8 @@ static const yytype_uint8 yyrline[] =
 static const char *const yytname[] =
 {
   "$end", "error", "$undefined", "INT", "VAR", "STRING", "REALIGN",
-  "ISPLIT", "AFFINE", "LIFT", "'('", "','", "')'", "'='", "$accept",
-  "stmt", 0
+  "ISPLIT", "AFFINE", "LIFT", "FUSE", "'('", "','", "')'", "'='",
+  "$accept", "stmt", "args", 0
 };
 #endif
 
@@ -454,20 +468,22 @@ static const char *const yytname[] =
 static const yytype_uint16 yytoknum[] =
 {
        0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-      40,    44,    41,    61
+     265,    40,    44,    41,    61
 };
 # endif
 
 /* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
 static const yytype_uint8 yyr1[] =
 {
-       0,    14,    15,    15,    15,    15
+       0,    15,    16,    16,    16,    16,    16,    16,    16,    17,
+      17
 };
 
 /* YYR2[YYN] -- Number of symbols composing right hand side of rule YYN.  */
 static const yytype_uint8 yyr2[] =
 {
-       0,     2,     8,    14,     6,     8
+       0,     2,     8,    14,     6,     8,    10,    12,     6,     1,
+       3
 };
 
 /* YYDEFACT[STATE-NAME] -- Default rule to reduce with in state
@@ -476,32 +492,36 @@ static const yytype_uint8 yyr2[] =
 static const yytype_uint8 yydefact[] =
 {
        0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
-       1,     0,     0,     0,     0,     0,     0,     0,     0,     0,
-       0,     0,     0,     0,     0,     4,     0,     0,     0,     0,
-       5,     2,     0,     0,     0,     0,     0,     0,     3
+       0,     1,     0,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     9,     0,     0,     0,     0,     0,
+       0,     0,     8,     0,     0,     0,     4,     0,    10,     0,
+       0,     0,     0,     5,     0,     2,     0,     0,     0,     0,
+       6,     0,     0,     0,     7,     0,     0,     3
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-      -1,     5
+      -1,     5,    25
 };
 
 /* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
    STATE-NUM.  */
-#define YYPACT_NINF -13
+#define YYPACT_NINF -11
 static const yytype_int8 yypact[] =
 {
-      -4,   -12,    -7,    -5,     3,     8,     0,     6,     7,     1,
-     -13,     4,     2,     5,    11,    13,    14,    15,     9,    12,
-      16,    10,    17,    21,    22,   -13,    19,    20,    23,    18,
-     -13,   -13,    25,    26,    28,    27,    31,    24,   -13
+      -4,    -8,   -10,    -6,    10,    15,    12,    -1,    13,    14,
+       7,   -11,     8,    11,    16,     9,    17,    19,    21,    22,
+      24,    26,    20,    18,   -11,    -2,    23,    25,    27,    28,
+      29,    30,   -11,    31,    32,    35,   -11,    33,   -11,    34,
+      36,    37,    38,   -11,    39,   -11,    40,     0,    41,    42,
+     -11,    46,    43,    45,   -11,    49,    47,   -11
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -13,   -13
+     -11,   -11,   -11
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]].  What to do in state STATE-NUM.  If
@@ -511,28 +531,36 @@ static const yytype_int8 yypgoto[] =
 #define YYTABLE_NINF -1
 static const yytype_uint8 yytable[] =
 {
-       1,     6,     2,     7,     3,     8,     4,     9,    10,    11,
-      12,    13,    14,    16,    15,    18,    17,    19,    20,     0,
-      21,    22,    25,    23,    27,    28,    29,    24,    32,    33,
-      26,     0,    30,    35,    37,    31,    38,    34,    36
+       1,     8,     2,     6,     3,     9,     7,     4,    13,    14,
+      31,    32,    49,    50,    10,    11,    12,    15,    16,    17,
+      18,    21,    19,    23,    24,    29,    26,    20,    27,    22,
+      28,    30,     0,    38,    39,    33,    40,    34,    41,    35,
+      42,    36,    47,    37,    48,    52,     0,    43,    44,    46,
+      45,    53,    56,    51,     0,     0,    54,    55,     0,     0,
+      57
 };
 
 static const yytype_int8 yycheck[] =
 {
-       4,    13,     6,    10,     8,    10,    10,     4,     0,     9,
-       4,     4,    11,    11,    10,     4,    11,     4,     4,    -1,
-       5,    12,    12,    11,     3,     3,     7,    11,    10,     4,
-      13,    -1,    12,     5,     3,    12,    12,    11,    11
+       4,    11,     6,    11,     8,    11,    14,    11,     9,    10,
+      12,    13,    12,    13,     4,     0,     4,     4,     4,    12,
+      12,    12,    11,     4,     3,     5,     4,    11,     4,    12,
+       4,    13,    -1,     3,     3,    12,     4,    12,     3,    12,
+       7,    13,     3,    14,     4,     3,    -1,    13,    12,    11,
+      13,     5,     3,    12,    -1,    -1,    13,    12,    -1,    -1,
+      13
 };
 
 /* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
    symbol of state STATE-NUM.  */
 static const yytype_uint8 yystos[] =
 {
-       0,     4,     6,     8,    10,    15,    13,    10,    10,     4,
-       0,     9,     4,     4,    11,    10,    11,    11,     4,     4,
-       4,     5,    12,    11,    11,    12,    13,     3,     3,     7,
-      12,    12,    10,     4,    11,     5,    11,     3,    12
+       0,     4,     6,     8,    11,    16,    11,    14,    11,    11,
+       4,     0,     4,     9,    10,     4,     4,    12,    12,    11,
+      11,    12,    12,     4,     3,    17,     4,     4,     4,     5,
+      13,    12,    13,    12,    12,    12,    13,    14,     3,     3,
+       4,     3,     7,    13,    12,    13,    11,     3,     4,    12,
+      13,    12,     3,     5,    13,    12,     3,    13
 };
 
 #define yyerrok		(yyerrstatus = 0)
@@ -1347,28 +1375,53 @@ yyreduce:
   switch (yyn)
     {
         case 2:
-#line 35 "optparser.y"
+#line 42 "optparser.y"
     { stmtPtr = realign(var((yyvsp[(3) - (8)].sValue)), var((yyvsp[(5) - (8)].sValue)), (yyvsp[(7) - (8)].intValue)); }
     break;
 
   case 3:
-#line 36 "optparser.y"
+#line 43 "optparser.y"
     { stmtPtr = isplit(var((yyvsp[(2) - (14)].sValue)), var((yyvsp[(4) - (14)].sValue)), var((yyvsp[(9) - (14)].sValue)), (yyvsp[(11) - (14)].sValue), (yyvsp[(13) - (14)].intValue));}
     break;
 
   case 4:
-#line 37 "optparser.y"
+#line 44 "optparser.y"
     { stmtPtr  = affine(var((yyvsp[(3) - (6)].sValue)), (yyvsp[(5) - (6)].sValue)); }
     break;
 
   case 5:
-#line 38 "optparser.y"
+#line 45 "optparser.y"
     { stmtPtr = lift(var((yyvsp[(1) - (8)].sValue)), var((yyvsp[(5) - (8)].sValue)), (yyvsp[(7) - (8)].intValue));}
     break;
 
+  case 6:
+#line 46 "optparser.y"
+    { stmtPtr = fuse(var((yyvsp[(1) - (10)].sValue)), var((yyvsp[(5) - (10)].sValue)), var((yyvsp[(7) - (10)].sValue)), (yyvsp[(9) - (10)].intValue), 0);}
+    break;
+
+  case 7:
+#line 47 "optparser.y"
+    { stmtPtr = fuse(var((yyvsp[(1) - (12)].sValue)), var((yyvsp[(5) - (12)].sValue)), var((yyvsp[(7) - (12)].sValue)), (yyvsp[(9) - (12)].intValue), (yyvsp[(11) - (12)].intValue));}
+    break;
+
+  case 8:
+#line 48 "optparser.y"
+    { stmtPtr = op((yyvsp[(1) - (6)].sValue), var((yyvsp[(3) - (6)].sValue)));}
+    break;
+
+  case 9:
+#line 52 "optparser.y"
+    { opNArgs = 0; arg((yyvsp[(1) - (1)].intValue)); }
+    break;
+
+  case 10:
+#line 53 "optparser.y"
+    { arg((yyvsp[(3) - (3)].intValue)); }
+    break;
+
 
 /* Line 1267 of yacc.c.  */
-#line 1372 "y.tab.c"
+#line 1425 "y.tab.c"
       default: break;
     }
   YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
@@ -1582,7 +1635,7 @@ yyreturn:
 }
 
 
-#line 41 "optparser.y"
+#line 56 "optparser.y"
 
 
 void yyerror(char *s) {
@@ -1665,3 +1718,49 @@ nodeType *lift(varNodeType *r, varNodeType *l, unsigned n){
     return p;
 }
 
+nodeType *fuse(varNodeType *r, varNodeType *l1, varNodeType *l2, unsigned n, unsigned shift){
+    nodeType *p;
+
+    /* allocate node */
+    if ((p = malloc(sizeof(nodeType))) == NULL)
+        yyerror("out of memory");
+
+    /* copy information */
+    p->type = typeFuse;
+    p->f.r = r;
+    p->f.l1 = l1;
+    p->f.l2 = l2;
+    p->f.n = n;
+    p->f.shift = shift;
+
+    return p;
+}
+
+void arg(unsigned n){
+    if (opNArgs < MAX_OP_ARGS)
+        opArgs[opNArgs] = n;
+    else
+        yyerror("too many arguments");
+    opNArgs++;
+}
+
+nodeType *op(char *name, varNodeType *l){
+    nodeType *p;
+
+    if (opNArgs > MAX_OP_ARGS)
+        return NULL;
+
+    /* allocate node */
+    if ((p = malloc(sizeof(nodeType))) == NULL)
+        yyerror("out of memory");
+
+    /* copy information */
+    p->type = typeOp;
+    p->o.name = strdup(name);
+    p->o.l = l;
+    p->o.nargs = opNArgs;
+    memcpy(p->o.args, opArgs, sizeof(opArgs));
+
+    return p;
+}
+
@@ -45,7 +45,8 @@
      REALIGN = 261,
      ISPLIT = 262,
      AFFINE = 263,
-     LIFT = 264
+     LIFT = 264,
+     FUSE = 265
    };
 #endif
 /* Tokens.  */
@@ -56,20 +57,21 @@
 #define ISPLIT 262
 #define AFFINE 263
 #define LIFT 264
+#define FUSE 265
 
 
 
 
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 typedef union YYSTYPE
-#line 19 "optparser.y"
+#line 26 "optparser.y"
 {
     char* sValue;                /* variable name */
     nodeType *nPtr;
     unsigned intValue;
 }
 /* Line 1529 of yacc.c.  */
-#line 73 "y.tab.h"
+#line 75 "y.tab.h"
 	YYSTYPE;
 # define yystype YYSTYPE /* obsolescent; will be withdrawn */
 # define YYSTYPE_IS_DECLARED 1
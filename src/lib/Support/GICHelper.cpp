@@ -13,6 +13,7 @@
 #include "polly/Support/GICHelper.h"
 #include "llvm/IR/Value.h"
 #include "isl/aff.h"
+#include "isl/ast.h"
 #include "isl/map.h"
 #include "isl/schedule.h"
 #include "isl/set.h"
@@ -122,6 +123,11 @@ std::string polly::stringFromIslObj(__isl_keep isl_pw_aff *pwaff) {
                                   isl_printer_print_pw_aff);
 }
 
+std::string polly::stringFromIslObj(__isl_keep isl_ast_expr *expr) {
+  return stringFromIslObjInternal(expr, isl_ast_expr_get_ctx,
+                                  isl_printer_print_ast_expr);
+}
+
 static void replace(std::string &str, const std::string &find,
                     const std::string &replace) {
   size_t pos = 0;
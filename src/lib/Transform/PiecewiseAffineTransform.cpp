@@ -19,12 +19,14 @@
 #include "polly/Options.h"
 #include "polly/Support/GICHelper.h"
 #include "polly/OptParser.h"
+#include "json/reader.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "isl/flow.h"
 #include "isl/aff.h"
 #include "isl/band.h"
 #include "isl/constraint.h"
+#include "isl/local_space.h"
 #include "isl/set.h"
 #include "isl/map.h"
 #include "isl/options.h"
@@ -34,8 +36,14 @@
 #include "isl/space.h"
 #include "isl/union_map.h"
 #include "isl/union_set.h"
-#include <string>
+#include "isl/val.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <map>
+#include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace polly;
@@ -54,6 +62,31 @@ cl::opt<std::string> TransformFilename(
 		cl::value_desc("filename"),
 		cl::cat(PollyCategory));
 
+cl::opt<std::string> BenchDir(
+		"polly-trans-bench-dir",
+		cl::desc("Directory in which the transformed SCoPs are stored as "
+		         "kernels for isl_bench_corpus"),
+		cl::value_desc("directory"),
+		cl::cat(PollyCategory));
+
+cl::list<std::string> TransformVariants(
+		"polly-trans-variants",
+		cl::desc("Alternative transformation scripts, the best of which is "
+		         "selected by profiling"),
+		cl::value_desc("filenames"),
+		cl::CommaSeparated,
+		cl::cat(PollyCategory));
+
+cl::opt<std::string> VariantProfile(
+		"polly-trans-variant-profile",
+		cl::desc("Profile of the alternative transformation scripts used to "
+		         "keep the best ones. Without a profile, all alternatives are "
+		         "compiled and profiled"),
+		cl::value_desc("filename"),
+		cl::cat(PollyCategory));
+
+// Largest factor tried when skewing a loop for time tiling
+const int MaxSkew = 16;
 
 class PiecewiseAffineTransform : public ScopPass {
 public:
@@ -68,11 +101,38 @@ public:
 private:
     static __isl_give isl_map *iterToScheduleMap(Scop &, unsigned, unsigned);
     static __isl_give isl_map *zeroIterDims(Scop &, isl_space *);
-    static __isl_give isl_map *applyUnitTransform(Scop &, const char *, __isl_take isl_map *);
-    static __isl_give isl_map *scheduleLexGt(Scop &, unsigned, unsigned);
-    static __isl_give isl_map *scheduleLexEq(Scop &, unsigned, unsigned);
+    __isl_give isl_map *applyUnitTransform(Scop &, const char *, __isl_keep isl_set *, __isl_take isl_map *);
+    static __isl_give isl_map *applyAffine(Scop &, const char *, __isl_take isl_map *, __isl_keep isl_set *, __isl_keep isl_map *);
+    __isl_give isl_set *loopDistances(Scop &, const char *, unsigned, __isl_keep isl_set *, __isl_keep isl_map *);
+    static int minimalSkew(__isl_keep isl_set *, unsigned, unsigned, int, int);
+    __isl_give isl_map *applyTimeTile(Scop &, const char *, bool, unsigned, const unsigned *, __isl_keep isl_set *, __isl_keep isl_map *);
+    __isl_give isl_map *applyWavefront(Scop &, const char *, unsigned, const unsigned *, __isl_keep isl_set *, __isl_keep isl_map *);
+    __isl_give isl_map *scheduleLexGt(Scop &, unsigned, unsigned);
+    __isl_give isl_map *scheduleLexEq(Scop &, unsigned, unsigned);
+    void clearLexOrders();
     static int computeScheduleGap(__isl_keep isl_set *, __isl_keep isl_set *, unsigned);
-    __isl_give isl_map *getTransform(Scop &S);
+    static __isl_give isl_set *readParamCondition(Scop &, const std::string &);
+    static __isl_give isl_map *versionScheduleMap(Scop &, unsigned, unsigned, unsigned);
+    static void restoreLoopMaps(Scop &, const std::map<const std::string, isl_set *> &,
+                                const std::map<const std::string, unsigned> &);
+    __isl_give isl_map *applyScript(Scop &S, const std::vector<std::string> &);
+    static __isl_give isl_map *combineVersions(Scop &, const std::vector<isl_map *> &);
+    __isl_give isl_map *getTransform(Scop &S, const std::string &);
+    static std::vector<isl_set *> readVariantGuards(Scop &, const std::vector<std::string> &);
+    __isl_give isl_map *getVariantTransform(Scop &S, __isl_keep isl_map *);
+    bool checkTransform(__isl_keep isl_map *, __isl_keep isl_map *);
+    static isl_stat checkDisjoint(__isl_take isl_basic_map *, void *);
+    static isl_bool isDisjoint(__isl_keep isl_map *, __isl_keep isl_map *);
+    static void writeBenchKernel(Scop &, __isl_keep isl_union_map *, __isl_keep isl_union_map *);
+
+    // Lexicographic orders built for the current SCoP, keyed by the number of
+    // schedule dimensions and the number of constant dimensions compared.
+    std::map<std::pair<unsigned, unsigned>, isl_map *> LexGtOrders;
+    std::map<std::pair<unsigned, unsigned>, isl_map *> LexEqOrders;
+
+    // Dependences between the points of the original schedule, used to
+    // derive the transformations that depend on them (NULL if unknown).
+    isl_map *ScheduleDeps = nullptr;
 };
 }
 
@@ -108,6 +168,10 @@ __isl_give isl_map *PiecewiseAffineTransform::iterToScheduleMap(Scop &S, unsigne
  */
 __isl_give isl_map *PiecewiseAffineTransform::scheduleLexGt(Scop &S, unsigned scheduleSize, unsigned n){
     
+    auto cached = LexGtOrders.find(std::make_pair(scheduleSize, n));
+    if (cached != LexGtOrders.end())
+        return isl_map_copy(cached->second);
+
     isl_space *scheduleSpace = isl_space_set_alloc(S.getIslCtx(), 0, scheduleSize);
     
     isl_map *lex = isl_map_from_domain_and_range(isl_set_empty(isl_space_copy(scheduleSpace)),
@@ -132,7 +196,9 @@ __isl_give isl_map *PiecewiseAffineTransform::scheduleLexGt(Scop &S, unsigned sc
     }
 
     lex = isl_map_align_params(lex, S.getParamSpace());
-    
+    isl_space_free(scheduleSpace);
+
+    LexGtOrders[std::make_pair(scheduleSize, n)] = isl_map_copy(lex);
     return lex;
 }
 /*
@@ -141,6 +207,10 @@ __isl_give isl_map *PiecewiseAffineTransform::scheduleLexGt(Scop &S, unsigned sc
  */
 __isl_give isl_map *PiecewiseAffineTransform::scheduleLexEq(Scop &S, unsigned scheduleSize, unsigned n){
     
+    auto cached = LexEqOrders.find(std::make_pair(scheduleSize, n));
+    if (cached != LexEqOrders.end())
+        return isl_map_copy(cached->second);
+
     isl_space *scheduleSpace = isl_space_set_alloc(S.getIslCtx(), 0, scheduleSize);
     isl_map *lex = isl_map_from_domain_and_range(isl_set_universe(isl_space_copy(scheduleSpace)),
                                                    isl_set_universe(isl_space_copy(scheduleSpace)));
@@ -150,10 +220,77 @@ __isl_give isl_map *PiecewiseAffineTransform::scheduleLexEq(Scop &S, unsigned sc
     }
 
     lex = isl_map_align_params(lex, S.getParamSpace());
-    
+    isl_space_free(scheduleSpace);
+
+    LexEqOrders[std::make_pair(scheduleSize, n)] = isl_map_copy(lex);
     return lex;
 }
 
+/*
+ * State of a disjointness check of dependences against an order.
+ */
+struct DisjointCheck {
+    isl_map_feasibility *feasibility;
+    isl_bool disjoint;
+};
+
+/*
+ * Checks a single basic map of the order against the dependences
+ * represented by the DisjointCheck in user.
+ * Stops the iteration as soon as an intersection is found.
+ */
+isl_stat PiecewiseAffineTransform::checkDisjoint(__isl_take isl_basic_map *bmap, void *user){
+    DisjointCheck *check = (DisjointCheck *) user;
+
+    check->disjoint = isl_map_feasibility_is_disjoint(check->feasibility, bmap);
+    isl_basic_map_free(bmap);
+    return check->disjoint == isl_bool_true ? isl_stat_ok : isl_stat_error;
+}
+
+/*
+ * Checks whether deps and order are disjoint.
+ * The tableaus of deps are built once and each basic map of order
+ * is checked against them, rather than intersecting both maps.
+ */
+isl_bool PiecewiseAffineTransform::isDisjoint(__isl_keep isl_map *deps, __isl_keep isl_map *order){
+    DisjointCheck check;
+    isl_space *space, *depsSpace;
+    isl_map *aligned;
+    isl_bool equal;
+
+    aligned = isl_map_align_params(isl_map_copy(order), isl_map_get_space(deps));
+    space = isl_map_get_space(aligned);
+    depsSpace = isl_space_align_params(isl_map_get_space(deps), isl_space_copy(space));
+    equal = isl_space_is_equal(space, depsSpace);
+    isl_space_free(depsSpace);
+    if (equal != isl_bool_true){
+        isl_space_free(space);
+        isl_map_free(aligned);
+        return equal < 0 ? isl_bool_error : isl_map_is_disjoint(deps, order);
+    }
+
+    check.feasibility = isl_map_feasibility_alloc(isl_map_align_params(isl_map_copy(deps), space));
+    check.disjoint = check.feasibility ? isl_bool_true : isl_bool_error;
+    if (check.feasibility)
+        isl_map_foreach_basic_map(aligned, &checkDisjoint, &check);
+    isl_map_feasibility_free(check.feasibility);
+    isl_map_free(aligned);
+
+    return check.disjoint;
+}
+
+/*
+ * Frees the lexicographic orders built for the current SCoP
+ */
+void PiecewiseAffineTransform::clearLexOrders(){
+    for (auto &order : LexGtOrders)
+        isl_map_free(order.second);
+    LexGtOrders.clear();
+    for (auto &order : LexEqOrders)
+        isl_map_free(order.second);
+    LexEqOrders.clear();
+}
+
 /*
  */
 __isl_give isl_map *PiecewiseAffineTransform::zeroIterDims(Scop &S, isl_space *space){
@@ -173,10 +310,364 @@ __isl_give isl_map *PiecewiseAffineTransform::zeroIterDims(Scop &S, isl_space *s
     return map;
 }
 
+/*
+ * Applies the affine transform @amap of the iterators of loop @sl to @transform
+ * and returns the resulting unit transformation of the schedule.
+ *
+ * @postDomain is the schedule domain of the program after @transform
+ */
+__isl_give isl_map *PiecewiseAffineTransform::applyAffine(Scop &S, const char *sl, __isl_take isl_map *amap, __isl_keep isl_set *postDomain, __isl_keep isl_map *transform){
+    isl_set *postLoopDomain;
+    unsigned loopDim = S.LoopDimMap[sl];
+
+    // Get tranformed domain
+    postLoopDomain = isl_set_apply(isl_set_copy(S.LoopDomainMap[sl]), isl_map_copy(transform));
+
+    // ----------------------
+    // 1. Affine Transform
+    //
+    // Suppose [i, j] -> [i', j', k', l'], schInDim = 7, loopDim = 2, schOutDim = 2 * 2 + 1 + (4 - 2)*2 
+    // amap = [o1, i, o2, j, o3, p3, o4] -> [o1, i', o2, j', 0, k', 0, l', o3]  
+    // loopDim' = 2 - 2 + 4
+    //
+    // Suppose [i, j] -> [i', j', k', l'], schInDim = 7, loopDim = 3, schOutDim = 3 * 2 + 1 + (4 - 2)*2 
+    // amap = [o1, i, o2, j, o3, p3, o4] -> [o1, i', o2, j', 0, k', 0, l', o3, p3, o4]  
+    // loopDim' = 3 - 2 + 4
+    //
+    // Suppose [i, j] -> [i'], schInDim = 7, loopDim = 3, schOutDim = 7 
+    // amap = [o1, i, o2, j, o3, p3, o4] -> [o1, i', o3, p3, o4, 0, 0]  
+    // loopDim' = 3 - 2 + 1
+    // ----------------------
+
+    // Input and Output Map Dimensions
+    unsigned amapInDim = isl_map_dim(amap, isl_dim_in);
+    unsigned amapOutDim = isl_map_dim(amap, isl_dim_out);
+
+    // Input and Output Schedule Dimensions 
+    unsigned schInDim = isl_set_dim(postDomain, isl_dim_set);
+    unsigned schOutDim = schInDim;
+    unsigned offset = (amapOutDim - amapInDim)*2; 
+    if(loopDim * 2 + 1 + offset > schInDim)
+        schOutDim = loopDim * 2 + 1 + offset;
+
+    // New Loop Dimension
+    loopDim = loopDim + offset/2;
+
+    // Extend map to match input and output schedule dimensions
+    amap = isl_map_apply_domain(amap, iterToScheduleMap(S, amapInDim, schInDim));
+    amap = isl_map_apply_range(amap, iterToScheduleMap(S, amapOutDim, schOutDim));
+
+    // Equate input and output dimensions
+    for (unsigned i = 0; i < amapInDim*2 && i < amapOutDim*2; i = i+2)
+        amap = isl_map_equate(amap, isl_dim_out, i, isl_dim_in, i);
+
+    for (unsigned i = amapInDim*2; i < schInDim && i + offset < schOutDim; i = i+1)
+        amap = isl_map_equate(amap, isl_dim_out, i + offset, isl_dim_in, i);
+
+    // Set remaining dimensions to 0
+    for (unsigned i = 0; i < offset; i+=2)
+        amap = isl_map_fix_si(amap, isl_dim_out, amapInDim*2 + i, 0);
+
+    for (unsigned i = schInDim + offset; i < schOutDim; i+=1)
+        amap = isl_map_fix_si(amap, isl_dim_out, i, 0);
+
+    amap = isl_map_intersect_domain(amap, isl_set_copy(postLoopDomain));
+    amap = isl_map_intersect_domain(amap, isl_set_copy(postDomain));
+
+    // -------------------------------------------
+    // 2. Identity Transform for remaining indices
+    // -------------------------------------------
+    isl_space *newSpace = isl_space_set_alloc(S.getIslCtx(), 0, schOutDim);
+
+    isl_map *cmap = isl_map_from_domain_and_range(isl_set_complement(postLoopDomain),
+                                                  isl_set_universe(newSpace)); // postLoopDomain USED
+    // Equate input and output dimensions
+    for (unsigned i = 0; i < schInDim; i++)
+        cmap = isl_map_equate(cmap, isl_dim_out, i, isl_dim_in, i);
+
+    // Set remaining dimensions to 0
+    for (unsigned i = schInDim; i < schOutDim; i += 1)
+        cmap = isl_map_fix_si(cmap, isl_dim_out, i, 0);
+
+    cmap = isl_map_intersect_domain(cmap, isl_set_copy(postDomain));
+    // -------------------------------------------
+
+    S.LoopDimMap[sl] = loopDim;
+
+    DEBUG(dbgs() << "  - # Loops for "<< sl << " := " << S.LoopDimMap[sl] << ";\n");
+
+    return isl_map_union(amap, cmap); // amap, cmap USED
+}
+
+/*
+ * Returns the distances between the points of loop @sl after @transform that
+ * depend on each other and share the outer @n loops of @sl.
+ *
+ * @postDomain is the schedule domain of the program after @transform
+ */
+__isl_give isl_set *PiecewiseAffineTransform::loopDistances(Scop &S, const char *sl, unsigned n, __isl_keep isl_set *postDomain, __isl_keep isl_map *transform){
+    isl_set *postLoopDomain = isl_set_apply(isl_set_copy(S.LoopDomainMap[sl]), isl_map_copy(transform));
+    postLoopDomain = isl_set_intersect(postLoopDomain, isl_set_copy(postDomain));
+
+    isl_map *deps = isl_map_apply_range(isl_map_copy(ScheduleDeps), isl_map_copy(transform));
+    deps = isl_map_apply_domain(deps, isl_map_copy(transform));
+    deps = isl_map_intersect_domain(deps, isl_set_copy(postLoopDomain));
+    deps = isl_map_intersect_range(deps, postLoopDomain); // postLoopDomain USED
+
+    // Only the dependences that are not carried by the outer loops
+    for (unsigned i = 0; i <= 2 * n; ++i)
+        deps = isl_map_equate(deps, isl_dim_in, i, isl_dim_out, i);
+
+    return isl_map_deltas(deps); // deps USED
+}
+
+/*
+ * Returns the smallest factor f in [0, MaxSkew] such that sign * d_k + f * d_t >= lower
+ * for all dependence distances d in @deltas, or -1 if there is no such factor.
+ *
+ * @t and @k are the positions of the two loops in the schedule
+ */
+int PiecewiseAffineTransform::minimalSkew(__isl_keep isl_set *deltas, unsigned t, unsigned k, int sign, int lower){
+    for (int f = 0; f <= MaxSkew; ++f){
+        isl_local_space *ls = isl_local_space_from_space(isl_set_get_space(deltas));
+        isl_constraint *c = isl_inequality_alloc(ls);
+
+        // Distances violated by the skew: sign * d_k + f * d_t <= lower - 1
+        c = isl_constraint_set_coefficient_si(c, isl_dim_set, k, -sign);
+        c = isl_constraint_set_coefficient_si(c, isl_dim_set, t, -f);
+        c = isl_constraint_set_constant_si(c, lower - 1);
+
+        isl_set *violated = isl_set_add_constraint(isl_set_copy(deltas), c);
+        isl_bool empty = isl_set_is_empty(violated);
+        isl_set_free(violated);
+
+        if (empty == isl_bool_error) return -1;
+        if (empty == isl_bool_true) return f;
+    }
+    return -1;
+}
+
+/*
+ * Returns floor((ft * x_t + fk * x_k) / size) on the iterators @ls of a loop
+ */
+static __isl_give isl_aff *hyperplaneAff(__isl_keep isl_local_space *ls, unsigned t, int ft, unsigned k, int fk, unsigned size){
+    isl_aff *aff = isl_aff_zero_on_domain(isl_local_space_copy(ls));
+
+    aff = isl_aff_add_coefficient_si(aff, isl_dim_in, t, ft);
+    aff = isl_aff_add_coefficient_si(aff, isl_dim_in, k, fk);
+    if (size > 1)
+        aff = isl_aff_floor(isl_aff_scale_down_ui(aff, size));
+
+    return aff;
+}
+
+/*
+ * Time tiles the loops of @sl starting at loop @args[0] (the time loop)
+ *
+ * The remaining @nargs - 1 arguments are the tile sizes of the band of loops
+ * starting at the time loop. Each space loop k of the band is skewed by the
+ * smallest factor f_k such that all dependence distances carried inside the
+ * band are non-negative in x_k + f_k * x_t, which makes rectangular tiling legal:
+ *
+ *   [.., t, i, j, ..] -> [.., [t/s0], [(i + f_i t)/s1], [(j + f_j t)/s2], t, i + f_i t, j + f_j t, ..]
+ *
+ * With @diamond, the time loop and the first space loop are instead tiled
+ * by diamonds of size @args[1] along the hyperplanes f_i t + i and g_i t - i,
+ * which allows the tiles along a time band to start concurrently:
+ *
+ *   [.., t, i, j, ..] -> [.., [(f_i t + i)/s], [(g_i t - i)/s], [(j + f_j t)/s2], t, i, j + f_j t, ..]
+ *
+ * The factors are computed from the dependences between points of the label
+ * that share the outer loops, after @transform. Returns NULL if the loops
+ * cannot be time tiled.
+ */
+__isl_give isl_map *PiecewiseAffineTransform::applyTimeTile(Scop &S, const char *sl, bool diamond, unsigned nargs, const unsigned *args, __isl_keep isl_set *postDomain, __isl_keep isl_map *transform){
+    unsigned loopDim = S.LoopDimMap[sl];
+
+    if (nargs < 2){
+        dbgs() << "##### Missing tile sizes for time tiling " << sl << "\n";
+        return NULL;
+    }
+
+    // The band starts at the time loop and has a loop per tile size, a diamond
+    // covers the time loop and the first space loop.
+    unsigned timeDim = args[0];
+    const unsigned *sizes = args + 1;
+    unsigned bandDim = diamond ? nargs : nargs - 1;
+
+    if (bandDim < 2 || timeDim + bandDim > loopDim){
+        dbgs() << "##### Cannot time tile " << bandDim << " loops from loop " << timeDim << " of " << sl << "\n";
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < nargs - 1; ++i)
+        if (sizes[i] == 0){
+            dbgs() << "##### Invalid tile size for time tiling " << sl << "\n";
+            return NULL;
+        }
+
+    if (ScheduleDeps == NULL){
+        dbgs() << "##### Cannot time tile " << sl << " without dependences\n";
+        return NULL;
+    }
+
+    // ----------------------
+    // 1. Dependence distances inside the band
+    // ----------------------
+    isl_set *deltas = loopDistances(S, sl, timeDim, postDomain, transform);
+
+    // ----------------------
+    // 2. Skew factors
+    // ----------------------
+    unsigned t = 2 * timeDim + 1;
+    std::vector<int> skew(loopDim, 0);
+    int skewDown = 0;
+
+    isl_set *backward = isl_set_upper_bound_si(isl_set_copy(deltas), isl_dim_set, t, -1);
+    bool legal = isl_set_is_empty(backward) == isl_bool_true;
+    isl_set_free(backward);
+
+    for (unsigned k = timeDim + 1; k < timeDim + bandDim && legal; ++k){
+        skew[k] = minimalSkew(deltas, t, 2 * k + 1, 1, 0);
+        legal = skew[k] >= 0;
+    }
+
+    if (diamond && legal){
+        skewDown = minimalSkew(deltas, t, t + 2, -1, 0);
+        legal = skewDown >= 0;
+
+        // Without dependences along the time loop, any diamond will do
+        if (skew[timeDim + 1] + skewDown == 0)
+            skew[timeDim + 1] = skewDown = 1;
+    }
+
+    isl_set_free(deltas);
+
+    if (!legal){
+        dbgs() << "##### Cannot time tile " << sl << ": no skew of at most " << MaxSkew << " makes the band permutable\n";
+        return NULL;
+    }
+
+    DEBUG({
+        dbgs() << "  - Skew for " << sl << " :=";
+        for (unsigned k = timeDim + 1; k < timeDim + bandDim; ++k)
+            dbgs() << " " << skew[k];
+        if (diamond)
+            dbgs() << " (diamond " << skew[timeDim + 1] << ", " << skewDown << ")";
+        dbgs() << ";\n";
+    });
+
+    // ----------------------
+    // 3. Tiling of the skewed band
+    // ----------------------
+    isl_space *space = isl_space_set_alloc(S.getIslCtx(), 0, loopDim);
+    isl_local_space *ls = isl_local_space_from_space(isl_space_copy(space));
+    isl_space *tiledSpace = isl_space_set_alloc(S.getIslCtx(), 0, loopDim + bandDim);
+    isl_multi_aff *ma = isl_multi_aff_zero(isl_space_map_from_domain_and_range(space, tiledSpace));
+    unsigned pos = 0;
+
+    // Outer loops
+    for (unsigned k = 0; k < timeDim; ++k)
+        ma = isl_multi_aff_set_aff(ma, pos++, hyperplaneAff(ls, k, 0, k, 1, 1));
+
+    // Tile loops
+    unsigned first = timeDim;
+    if (diamond){
+        ma = isl_multi_aff_set_aff(ma, pos++, hyperplaneAff(ls, timeDim, skew[timeDim + 1], timeDim + 1, 1, sizes[0]));
+        ma = isl_multi_aff_set_aff(ma, pos++, hyperplaneAff(ls, timeDim, skewDown, timeDim + 1, -1, sizes[0]));
+        first = timeDim + 2;
+    }
+    for (unsigned k = first; k < timeDim + bandDim; ++k)
+        ma = isl_multi_aff_set_aff(ma, pos++, hyperplaneAff(ls, timeDim, skew[k], k, 1, sizes[k - first + (diamond ? 1 : 0)]));
+
+    // Point loops, the loops in the diamond are not skewed
+    for (unsigned k = timeDim; k < timeDim + bandDim; ++k){
+        int f = diamond && k == timeDim + 1 ? 0 : skew[k];
+        ma = isl_multi_aff_set_aff(ma, pos++, hyperplaneAff(ls, timeDim, f, k, 1, 1));
+    }
+
+    // Inner loops
+    for (unsigned k = timeDim + bandDim; k < loopDim; ++k)
+        ma = isl_multi_aff_set_aff(ma, pos++, hyperplaneAff(ls, k, 0, k, 1, 1));
+
+    isl_local_space_free(ls);
+
+    return applyAffine(S, sl, isl_map_from_multi_aff(ma), postDomain, transform);
+}
+
+/*
+ * Skews loop @args[0] of @sl by loop @args[1] such that the dependences between
+ * the points that share the outer loops are all carried by the skewed loop,
+ * except for those with a zero distance on both loops:
+ *
+ *   [.., i, .., j, ..] -> [.., f i + j, .., i, ..]
+ *
+ * with the smallest such factor f. The loops inside the skewed loop, e.g., the
+ * inner loop of the pair, are then free of these dependences and the outermost
+ * loop that the AST generator proves parallel is executed in parallel.
+ * Returns NULL if there is no such skew.
+ */
+__isl_give isl_map *PiecewiseAffineTransform::applyWavefront(Scop &S, const char *sl, unsigned nargs, const unsigned *args, __isl_keep isl_set *postDomain, __isl_keep isl_map *transform){
+    unsigned loopDim = S.LoopDimMap[sl];
+
+    if (nargs != 2 || args[0] >= args[1] || args[1] >= loopDim){
+        dbgs() << "##### Cannot apply wavefront to " << sl << ": expected two of its " << loopDim << " loops in order\n";
+        return NULL;
+    }
+
+    if (ScheduleDeps == NULL){
+        dbgs() << "##### Cannot apply wavefront to " << sl << " without dependences\n";
+        return NULL;
+    }
+
+    unsigned outer = args[0], inner = args[1];
+
+    // Dependences with a zero distance on both loops are carried by the inner
+    // loops or by the order of the statements and stay within one iteration of
+    // the skewed loop, such that no skew needs to carry them.
+    isl_set *deltas = loopDistances(S, sl, outer, postDomain, transform);
+    isl_set *zero = isl_set_universe(isl_set_get_space(deltas));
+    zero = isl_set_fix_si(zero, isl_dim_set, 2 * outer + 1, 0);
+    zero = isl_set_fix_si(zero, isl_dim_set, 2 * inner + 1, 0);
+    deltas = isl_set_subtract(deltas, zero);
+    int skew = minimalSkew(deltas, 2 * outer + 1, 2 * inner + 1, 1, 1);
+    isl_set_free(deltas);
+
+    if (skew < 0){
+        dbgs() << "##### Cannot apply wavefront to " << sl << ": no skew of at most " << MaxSkew << " carries all dependences\n";
+        return NULL;
+    }
+
+    DEBUG(dbgs() << "  - Wavefront skew for " << sl << " := " << skew << ";\n");
+
+    isl_space *space = isl_space_set_alloc(S.getIslCtx(), 0, loopDim);
+    isl_local_space *ls = isl_local_space_from_space(isl_space_copy(space));
+    isl_multi_aff *ma = isl_multi_aff_zero(isl_space_map_from_set(space));
+
+    for (unsigned k = 0; k < loopDim; ++k){
+        isl_aff *aff;
+        if (k == outer)
+            aff = hyperplaneAff(ls, outer, skew, inner, 1, 1);
+        else if (k == inner)
+            aff = hyperplaneAff(ls, outer, 1, outer, 0, 1);
+        else
+            aff = hyperplaneAff(ls, k, 1, k, 0, 1);
+        ma = isl_multi_aff_set_aff(ma, k, aff);
+    }
+
+    isl_local_space_free(ls);
+
+    S.WavefrontLabels.insert(sl);
+
+    return applyAffine(S, sl, isl_map_from_multi_aff(ma), postDomain, transform);
+}
+
 /*
  * Applies a unit transform given by @str to @transform
+ *
+ * @scheduleRange is the (coalesced) range of the original schedule
  */
-__isl_give isl_map *PiecewiseAffineTransform::applyUnitTransform(Scop &S, const char *str, __isl_take isl_map *transform){
+__isl_give isl_map *PiecewiseAffineTransform::applyUnitTransform(Scop &S, const char *str, __isl_keep isl_set *scheduleRange, __isl_take isl_map *transform){
     // Parse str to get unit transformation
     stmtPtr = NULL;
     
@@ -190,11 +681,8 @@ __isl_give isl_map *PiecewiseAffineTransform::applyUnitTransform(Scop &S, const
     // Stores the unit transformation
     isl_map *map = nullptr;
     
-    // Original Schedule
-    isl_union_map *schedule = isl_union_map_intersect_domain(S.getSchedule(), S.getDomains());
-    
     // New schedule domain of the program (note after application of transform)
-    isl_set *postDomain = isl_set_apply(isl_set_coalesce(isl_set_from_union_set(isl_union_map_range(schedule))), isl_map_copy(transform)); // schedule USED
+    isl_set *postDomain = isl_set_apply(isl_set_copy(scheduleRange), isl_map_copy(transform));
 
     DEBUG(dbgs() << "------------------- Unit Transform -------------------\n"<< str << ";\n");
 
@@ -357,96 +845,14 @@ __isl_give isl_map *PiecewiseAffineTransform::applyUnitTransform(Scop &S, const
         }	
         case typeAffine:
         {	
-    	    isl_set *preLoopDomain, *postLoopDomain;
 	    char *sl;
     
             sl = (stmtPtr->a.l)->name;
 
 	    if (S.LoopDomainMap[sl] == NULL) return transform;
             
-            preLoopDomain = isl_set_copy(S.LoopDomainMap[sl]);
-	    unsigned loopDim = S.LoopDimMap[sl];
-
-	    // Get tranformed domain
-	    postLoopDomain = isl_set_apply(isl_set_copy(preLoopDomain), isl_map_copy(transform));
-
-	    // ----------------------
-            // 1. Affine Transform
-	    //
-	    // Suppose [i, j] -> [i', j', k', l'], schInDim = 7, loopDim = 2, schOutDim = 2 * 2 + 1 + (4 - 2)*2 
-	    // amap = [o1, i, o2, j, o3, p3, o4] -> [o1, i', o2, j', 0, k', 0, l', o3]  
-	    // loopDim' = 2 - 2 + 4
-	    //
-	    // Suppose [i, j] -> [i', j', k', l'], schInDim = 7, loopDim = 3, schOutDim = 3 * 2 + 1 + (4 - 2)*2 
-	    // amap = [o1, i, o2, j, o3, p3, o4] -> [o1, i', o2, j', 0, k', 0, l', o3, p3, o4]  
-	    // loopDim' = 3 - 2 + 4
-	    //
-	    // Suppose [i, j] -> [i'], schInDim = 7, loopDim = 3, schOutDim = 7 
-	    // amap = [o1, i, o2, j, o3, p3, o4] -> [o1, i', o3, p3, o4, 0, 0]  
-	    // loopDim' = 3 - 2 + 1
-	    // ----------------------
             isl_map *amap = isl_map_read_from_str(S.getIslCtx(), stmtPtr->a.trans);
-
-	    // Input and Output Map Dimensions
-            unsigned amapInDim = isl_map_dim(amap, isl_dim_in);
-            unsigned amapOutDim = isl_map_dim(amap, isl_dim_out);
-	   
-	    // Input and Output Schedule Dimensions 
-            unsigned schInDim = isl_set_dim(postDomain, isl_dim_set);
-            unsigned schOutDim = schInDim;
-	    unsigned offset = (amapOutDim - amapInDim)*2; 
-            if(loopDim * 2 + 1 + offset > schInDim)
-                schOutDim = loopDim * 2 + 1 + offset;
-
-	    // New Loop Dimension
-	    loopDim = loopDim + offset/2;
-            
-	    // Extend map to match input and output schedule dimensions
-            amap = isl_map_apply_domain(amap, iterToScheduleMap(S, amapInDim, schInDim));
-            amap = isl_map_apply_range(amap, iterToScheduleMap(S, amapOutDim, schOutDim));
-
-	    // Initialize remaining dimensions
-	    
-            // Equate input and output dimensions
-    	    for (unsigned i = 0; i < amapInDim*2 && i < amapOutDim*2; i = i+2)
-		amap = isl_map_equate(amap, isl_dim_out, i, isl_dim_in, i);
-
- 	    for (unsigned i = amapInDim*2; i < schInDim && i + offset < schOutDim; i = i+1)
-		amap = isl_map_equate(amap, isl_dim_out, i + offset, isl_dim_in, i);
-
-           // Set remaining dimensions to 0
-            for (unsigned i = 0; i < offset; i+=2)
-	        amap = isl_map_fix_si(amap, isl_dim_out, amapInDim*2 + i, 0);
-	    
-            for (unsigned i = schInDim + offset; i < schOutDim; i+=1)
-	        amap = isl_map_fix_si(amap, isl_dim_out, i, 0);
-
-            amap = isl_map_intersect_domain(amap, isl_set_copy(postLoopDomain));
-            amap = isl_map_intersect_domain(amap, isl_set_copy(postDomain));
-
-	    // -------------------------------------------
-	    // 2. Identity Transform for remaining indices
-	    // -------------------------------------------
-    	    isl_space *newSpace = isl_space_set_alloc(S.getIslCtx(), 0, schOutDim);
-    
-            isl_map *cmap = isl_map_from_domain_and_range(isl_set_complement(postLoopDomain),
-                                                   isl_set_universe(newSpace)); // postLoopDomain USED
-            // Equate input and output dimensions
-    	    for (unsigned i = 0; i < schInDim; i++)
-		cmap = isl_map_equate(cmap, isl_dim_out, i, isl_dim_in, i);
-
-            // Set remaining dimensions to 0
-            for (unsigned i = schInDim; i < schOutDim; i += 1)
-	        cmap = isl_map_fix_si(cmap, isl_dim_out, i, 0);
-
-            cmap = isl_map_intersect_domain(cmap, isl_set_copy(postDomain));
-	    // -------------------------------------------
-	    
-	    map = isl_map_union(amap, cmap); // amap, cmap USED
-
-	    S.LoopDimMap[sl] = loopDim;
-
-            DEBUG(dbgs() << "  - # Loops for "<< sl << " := " << S.LoopDimMap[sl] << ";\n");
+	    map = applyAffine(S, sl, amap, postDomain, transform);
 
 	    break;
 	}    
@@ -482,6 +888,167 @@ __isl_give isl_map *PiecewiseAffineTransform::applyUnitTransform(Scop &S, const
             break;
  
 	}
+	case typeFuse:
+	{
+	    isl_set *preLoopDomain1, *postLoopDomain1;
+	    isl_set *preLoopDomain2, *postLoopDomain2;
+	    char *sl1, *sl2, *sr;
+	    unsigned n, shift;
+
+            sl1 = (stmtPtr->f.l1)->name;
+            sl2 = (stmtPtr->f.l2)->name;
+            sr = (stmtPtr->f.r)->name;
+            n = stmtPtr->f.n;
+            shift = stmtPtr->f.shift;
+
+	    if (S.LoopDomainMap[sl1] == NULL || S.LoopDomainMap[sl2] == NULL) return transform;
+
+	    if (n == 0 || n > S.LoopDimMap[sl1] || n > S.LoopDimMap[sl2]){
+		dbgs() << "##### Cannot fuse " << sl1 << " and " << sl2 << " at depth " << n << "\n";
+		isl_set_free(postDomain);
+		free(stmtPtr);
+		return transform;
+	    }
+
+            preLoopDomain1 = isl_set_copy(S.LoopDomainMap[sl1]);
+	    postLoopDomain1 = isl_set_apply(preLoopDomain1, isl_map_copy(transform)); //  preLoopDomain1 USED
+            preLoopDomain2 = isl_set_copy(S.LoopDomainMap[sl2]);
+	    postLoopDomain2 = isl_set_apply(preLoopDomain2, isl_map_copy(transform)); //  preLoopDomain2 USED
+	    postLoopDomain2 = isl_set_intersect(postLoopDomain2, isl_set_copy(postDomain));
+
+	    unsigned schDim = isl_set_dim(postDomain, isl_dim_set);
+
+	    // ----------------------
+	    // Nest Domain: Stmts sharing the first n constant dimensions with l1, i.e. the body of the
+	    // n outer loops of l1 that l2 is moved into.
+	    // ----------------------
+	    isl_set *nestDomain = isl_set_apply(postLoopDomain1, scheduleLexEq(S, schDim, n)); // postLoopDomain1 USED
+	    nestDomain = isl_set_intersect(nestDomain, isl_set_copy(postDomain));
+	    nestDomain = isl_set_subtract(nestDomain, isl_set_copy(postLoopDomain2));
+
+	    isl_map *zeroIters = zeroIterDims(S, isl_set_get_space(postDomain));
+	    isl_set *nestMax = isl_set_apply(nestDomain, isl_map_copy(zeroIters)); // nestDomain USED
+	    isl_set *fuseMin = isl_set_apply(isl_set_copy(postLoopDomain2), zeroIters); // zeroIters USED
+	    nestMax = isl_set_lexmax(nestMax);
+	    fuseMin = isl_set_lexmin(fuseMin);
+
+    	    DEBUG(dbgs() << "  - nest max := " << stringFromIslObj(nestMax) << ";\n");
+    	    DEBUG(dbgs() << "  - fuse min := " << stringFromIslObj(fuseMin) << ";\n");
+
+	    // ----------------------
+	    // Gap: Align the first n constant dimensions of l2 with l1 and place l2 after the body of
+	    // the nest at the nth constant dimension. The nth loop of l2 is shifted by shift
+	    // iterations. All other dimensions of l2 remain unchanged.
+	    //
+	    // Suppose n = 1, shift = 1, nest max = [0, 0, 2, 0, 0], fuse min = [1, 0, 0, 0, 0]
+	    // gap = [-1, 1, 3, 0, 0]
+	    // ----------------------
+	    isl_set *gap = isl_set_sum(isl_set_neg(fuseMin), nestMax); // fuseMin, nestMax USED
+	    isl_map *alignMap = isl_map_universe(isl_space_map_from_set(isl_set_get_space(gap)));
+    	    for (unsigned i = 0; i < schDim; i = i+1){
+		if (i % 2 == 0 && i <= n*2)
+		    alignMap = isl_map_equate(alignMap, isl_dim_out, i, isl_dim_in, i);
+		else if (i == n*2 - 1)
+		    alignMap = isl_map_fix_si(alignMap, isl_dim_out, i, shift);
+		else
+		    alignMap = isl_map_fix_si(alignMap, isl_dim_out, i, 0);
+	    }
+	    gap = isl_set_apply(gap, alignMap); // alignMap USED
+
+	    isl_set *inc = isl_set_universe(isl_set_get_space(gap));
+    	    for (unsigned i = 0; i < schDim; i = i+1)
+	        inc = isl_set_fix_si(inc, isl_dim_set, i, i == n*2 ? 1 : 0);
+	    gap = isl_set_sum(gap, inc); // inc USED
+
+    	    DEBUG(dbgs() << "  - gap := " << stringFromIslObj(gap) << ";\n");
+
+	    // ----------------------
+	    // Fuse Map: Move l2 by gap, identity for all other stmts
+	    // ----------------------
+	    isl_map *fuseMap = isl_set_identity(isl_set_copy(postLoopDomain2));
+	    fuseMap = isl_map_sum(fuseMap, isl_map_from_domain_and_range(isl_set_copy(postLoopDomain2), gap)); // gap USED
+	    isl_map *restMap = isl_set_identity(isl_set_subtract(isl_set_copy(postDomain), postLoopDomain2)); // postLoopDomain2 USED
+
+    	    DEBUG(dbgs() << "\n  - fuse map := " << stringFromIslObj(fuseMap) << ";\n");
+
+	    map = isl_map_union(restMap, fuseMap); // restMap, fuseMap USED
+
+	    // Assign the fused loop domain to the new label. Its loops are the n common loops.
+	    isl_set *fusedDomain = isl_set_union(isl_set_copy(S.LoopDomainMap[sl1]), isl_set_copy(S.LoopDomainMap[sl2]));
+	    isl_set_free(S.LoopDomainMap[sr]);
+	    S.LoopDomainMap[sr] = isl_set_coalesce(fusedDomain);
+	    S.LoopDimMap[sr] = n;
+
+            DEBUG(dbgs() << "  - Domain for "<< sr << " := " << stringFromIslObj(S.LoopDomainMap[sr]) << ";\n");
+
+            break;
+	}
+	case typeOp:
+	{
+	    // Operations on a loop with integer arguments, such as hints, which do
+	    // not change the schedule but are attached to the innermost loops
+	    // generated for the label, time tiling and wavefronts.
+	    char *name, *sl;
+	    unsigned nargs;
+	    const unsigned *args;
+
+            name = stmtPtr->o.name;
+            sl = (stmtPtr->o.l)->name;
+            nargs = stmtPtr->o.nargs;
+            args = stmtPtr->o.args;
+
+	    if (S.LoopDomainMap[sl] == NULL){
+		dbgs() << "##### Cannot apply " << name << " to " << sl << "\n";
+		isl_set_free(postDomain);
+		free(stmtPtr);
+		return transform;
+	    }
+
+	    if (strcmp(name, "timetile") == 0 || strcmp(name, "diamondtile") == 0){
+		map = applyTimeTile(S, sl, strcmp(name, "diamondtile") == 0, nargs, args, postDomain, transform);
+		if (map == NULL){
+		    isl_set_free(postDomain);
+		    free(stmtPtr);
+		    return transform;
+		}
+		break;
+	    }
+
+	    if (strcmp(name, "wavefront") == 0){
+		map = applyWavefront(S, sl, nargs, args, postDomain, transform);
+		if (map == NULL){
+		    isl_set_free(postDomain);
+		    free(stmtPtr);
+		    return transform;
+		}
+		break;
+	    }
+
+	    if (nargs != 1 || args[0] == 0){
+		dbgs() << "##### Cannot apply " << name << " hint to " << sl << "\n";
+		isl_set_free(postDomain);
+		free(stmtPtr);
+		return transform;
+	    }
+
+	    LoopHints &hints = S.LoopHintMap[sl];
+	    if (strcmp(name, "vectorize") == 0)
+		hints.VectorizeWidth = args[0];
+	    else if (strcmp(name, "interleave") == 0)
+		hints.InterleaveCount = args[0];
+	    else if (strcmp(name, "unroll") == 0)
+		hints.UnrollCount = args[0];
+	    else if (strcmp(name, "collapse") == 0)
+		hints.CollapseCount = args[0];
+	    else if (strcmp(name, "tasks") == 0)
+		hints.TaskDepth = args[0];
+	    else
+		dbgs() << "##### Unknown operation: " << name << "\n";
+
+	    map = isl_set_identity(isl_set_copy(postDomain));
+
+            break;
+	}
     }
 
     // Cleanup data-structures
@@ -498,29 +1065,452 @@ __isl_give isl_map *PiecewiseAffineTransform::applyUnitTransform(Scop &S, const
 }
 
 
-__isl_give isl_map *PiecewiseAffineTransform::getTransform(Scop &S){
+/*
+ * Applies the operations of a script in order to the identity transform
+ */
+__isl_give isl_map *PiecewiseAffineTransform::applyScript(Scop &S, const std::vector<std::string> &script){
      
     // Define identity transform
     isl_union_map *schedule = isl_union_map_intersect_domain(S.getSchedule(), S.getDomains());    
     isl_set *domain = isl_set_coalesce(isl_set_from_union_set(isl_union_map_range(schedule)));
-    isl_map *Transform = isl_set_identity(domain);
+    isl_map *Transform = isl_set_identity(isl_set_copy(domain));
     Transform = isl_map_align_params(Transform, S.getParamSpace());
- 
+
+    // The original schedule does not change while the script is applied, so
+    // its range is only computed once.
+    for (const std::string &line : script)
+        Transform = applyUnitTransform(S, line.c_str(), domain, Transform);
+
+    isl_set_free(domain);
+    return Transform;
+}
+
+/*
+ * Reads a parameter condition like "[N] -> { : N >= 256 }" and binds its
+ * parameters to the parameters of the SCoP with the same name.
+ *
+ * Returns NULL if the condition cannot be parsed or refers to a parameter
+ * unknown to the SCoP.
+ */
+__isl_give isl_set *PiecewiseAffineTransform::readParamCondition(Scop &S, const std::string &str){
+    isl_set *cond = isl_set_read_from_str(S.getIslCtx(), str.c_str());
+    if (cond == NULL)
+        return NULL;
+
+    if (isl_set_dim(cond, isl_dim_set) != 0){
+        dbgs() << "##### Version condition must only constrain parameters: " << str << "\n";
+        isl_set_free(cond);
+        return NULL;
+    }
+
+    isl_space *paramSpace = S.getParamSpace();
+    for (unsigned i = 0; i < isl_set_dim(cond, isl_dim_param); ++i){
+        const char *name = isl_set_get_dim_name(cond, isl_dim_param, i);
+        int pos = isl_space_find_dim_by_name(paramSpace, isl_dim_param, name);
+        if (pos < 0){
+            dbgs() << "##### Unknown parameter in version condition: " << name << "\n";
+            isl_set_free(cond);
+            isl_space_free(paramSpace);
+            return NULL;
+        }
+        cond = isl_set_set_dim_id(cond, isl_dim_param, i, isl_space_get_dim_id(paramSpace, isl_dim_param, pos));
+    }
+
+    return isl_set_align_params(cond, paramSpace); // paramSpace USED
+}
+
+/*
+ * Map to prefix a schedule vector [s0, ..., sn] of a version with the version
+ * number and to pad it to a common number of schedule dimensions:
+ *
+ *   [s0, ..., sn] -> [version, 0, s0, ..., sn, 0, ..., 0]
+ *
+ * The version number takes the place of a constant schedule dimension, such
+ * that constant dimensions remain at even positions.
+ */
+__isl_give isl_map *PiecewiseAffineTransform::versionScheduleMap(Scop &S, unsigned version, unsigned inSize, unsigned outSize){
+    isl_space *inSpace = isl_space_set_alloc(S.getIslCtx(), 0, inSize);
+    isl_space *outSpace = isl_space_set_alloc(S.getIslCtx(), 0, outSize + 2);
+
+    isl_map *map = isl_map_from_domain_and_range(isl_set_universe(inSpace),
+                                                 isl_set_universe(outSpace));
+
+    map = isl_map_fix_si(map, isl_dim_out, 0, version);
+    map = isl_map_fix_si(map, isl_dim_out, 1, 0);
+    for (unsigned i = 0; i < inSize; ++i)
+        map = isl_map_equate(map, isl_dim_out, i + 2, isl_dim_in, i);
+    for (unsigned i = inSize; i < outSize; ++i)
+        map = isl_map_fix_si(map, isl_dim_out, i + 2, 0);
+
+    return isl_map_align_params(map, S.getParamSpace());
+}
+
+/*
+ * Resets the loop components of the SCoP to @domains and @dims
+ */
+void PiecewiseAffineTransform::restoreLoopMaps(Scop &S, const std::map<const std::string, isl_set *> &domains,
+                                               const std::map<const std::string, unsigned> &dims){
+    for (auto &loop : S.LoopDomainMap)
+        isl_set_free(loop.second);
+    S.LoopDomainMap.clear();
+
+    for (auto &loop : domains)
+        S.LoopDomainMap[loop.first] = isl_set_copy(loop.second);
+    S.LoopDimMap = dims;
+}
+
+/*
+ * Reads the transformation script and computes the transform it describes.
+ *
+ * A script may be specialized to ranges of the SCoP parameters. A line
+ *
+ *   version [N] -> { : N >= 256 }
+ *
+ * starts a version whose operations are only applied if the parameters satisfy
+ * the condition. Versions are tried in order, the first one whose condition
+ * holds is selected. The operations before the first version apply to all
+ * remaining parameter values.
+ *
+ * Each version is applied to the original schedule. The resulting transforms
+ * are prefixed with the version number and restricted to the parameter values
+ * of the version, so that code generation emits a dispatch among the versions.
+ */
+__isl_give isl_map *PiecewiseAffineTransform::getTransform(Scop &S, const std::string &filename){
+
+    // Read the script, split into versions. The first entry holds the
+    // operations before the first version.
+    std::vector<std::pair<std::string, std::vector<std::string> > > versions(1);
+    
     std::ifstream src;
-    src.open(TransformFilename.c_str(), std::ios::in);
+    src.open(filename.c_str(), std::ios::in);
     if (src.is_open())
     {
  	std::string line;
-        // char *tok = strtok(str, "\n");
-        while (getline(src, line)) // tok != NULL)
+        while (getline(src, line))
         {
-	    if (!(line.find("//") == 0))
-        	Transform = applyUnitTransform(S, line.c_str(), Transform);
+	    if (line.find("//") == 0)
+		continue;
+
+	    size_t start = line.find_first_not_of(" \t");
+	    if (start != std::string::npos && line.compare(start, 8, "version ") == 0)
+		versions.push_back(std::make_pair(line.substr(start + 8), std::vector<std::string>()));
+	    else
+		versions.back().second.push_back(line);
         } 
     }
     src.close();
 
-    return Transform;
+    if (versions.size() == 1)
+        return applyScript(S, versions[0].second);
+
+    // Each version starts from the original loop components.
+    std::map<const std::string, isl_set *> loopDomains;
+    for (auto &loop : S.LoopDomainMap)
+	loopDomains[loop.first] = isl_set_copy(loop.second);
+    std::map<const std::string, unsigned> loopDims = S.LoopDimMap;
+
+    std::vector<isl_map *> transforms;
+    isl_set *covered = isl_set_empty(S.getParamSpace());
+
+    for (unsigned v = 1; v <= versions.size(); ++v){
+	// The default version is handled last.
+	unsigned idx = v % versions.size();
+	isl_set *cond;
+
+	if (idx == 0)
+	    cond = isl_set_complement(isl_set_copy(covered));
+	else
+	    cond = readParamCondition(S, versions[idx].first);
+
+	if (cond == NULL){
+	    dbgs() << "##### Skipping version: " << versions[idx].first << "\n";
+	    continue;
+	}
+
+	DEBUG(dbgs() << "==================== Version " << idx << " ====================\n");
+	DEBUG(dbgs() << "Condition := " << stringFromIslObj(cond) << ";\n");
+
+	restoreLoopMaps(S, loopDomains, loopDims);
+	isl_map *transform = applyScript(S, versions[idx].second);
+
+	// Only the parameter values not selected by an earlier version remain.
+	isl_set *params = isl_set_subtract(isl_set_copy(cond), isl_set_copy(covered));
+	covered = isl_set_union(covered, cond); // cond USED
+	transform = isl_map_intersect_params(transform, params); // params USED
+
+	transforms.push_back(transform);
+    }
+    isl_set_free(covered);
+
+    restoreLoopMaps(S, loopDomains, loopDims);
+    for (auto &loop : loopDomains)
+	isl_set_free(loop.second);
+
+    return combineVersions(S, transforms);
+}
+
+/*
+ * Prefixes each of the transforms with its version number and pads all of them
+ * to the same number of schedule dimensions. The transforms are consumed.
+ */
+__isl_give isl_map *PiecewiseAffineTransform::combineVersions(Scop &S, const std::vector<isl_map *> &transforms){
+    unsigned maxDim = 0;
+    for (isl_map *transform : transforms)
+	maxDim = std::max(maxDim, isl_map_dim(transform, isl_dim_out));
+
+    isl_map *Transform = NULL;
+    for (unsigned v = 0; v < transforms.size(); ++v){
+	unsigned inDim = isl_map_dim(transforms[v], isl_dim_out);
+	isl_map *transform = isl_map_apply_range(transforms[v], versionScheduleMap(S, v, inDim, maxDim));
+	Transform = Transform ? isl_map_union(Transform, transform) : transform;
+    }
+
+    return isl_map_coalesce(Transform);
+}
+
+/*
+ * Reads the profile of the alternative transformations of S and computes for
+ * each of the variants the parameter values for which it is selected.
+ *
+ * The profile holds one JSON object per execution of a SCoP, as written by the
+ * code generated for the variants (see VariantProfiler), e.g.,
+ *
+ *   {"function": "f", "region": "for.cond => for.end", "variant": "tile.t",
+ *    "params": {"N": 1024}, "cycles": 123456}
+ *
+ * For every parameter vector observed for S, the variant with the smallest
+ * average number of cycles wins. The guard of a variant is the convex hull of
+ * the parameter vectors it won, without the guards of the variants before it.
+ * The variants are ordered by the number of vectors they won, and the variant
+ * that won most of them is selected for all remaining parameter values. The
+ * guards of the variants that never won are empty.
+ */
+std::vector<isl_set *> PiecewiseAffineTransform::readVariantGuards(Scop &S, const std::vector<std::string> &names){
+    std::string function = S.getRegion().getEntry()->getParent()->getName();
+    std::string region = S.getNameStr();
+    isl_space *paramSpace = S.getParamSpace();
+    unsigned nparam = isl_space_dim(paramSpace, isl_dim_param);
+
+    // Total cycles and number of executions of each variant, per parameter
+    // vector.
+    std::map<std::vector<long>, std::map<unsigned, std::pair<double, unsigned> > > runs;
+
+    std::ifstream src(VariantProfile.c_str());
+    if (!src)
+        dbgs() << "##### Could not open variant profile: " << VariantProfile << "\n";
+
+    std::string line;
+    while (getline(src, line)){
+        Json::Reader reader;
+        Json::Value run;
+        if (!reader.parse(line, run) || !run.isObject())
+            continue;
+        if (run["function"].asString() != function || run["region"].asString() != region)
+            continue;
+
+        auto name = std::find(names.begin(), names.end(), run["variant"].asString());
+        if (name == names.end())
+            continue;
+
+        std::vector<long> params;
+        Json::Value values = run["params"];
+        for (unsigned i = 0; i < nparam; ++i){
+            const char *param = isl_space_get_dim_name(paramSpace, isl_dim_param, i);
+            if (!values.isObject() || !values.isMember(param))
+                break;
+            // Values that do not fit into 32 bits are read as doubles, which
+            // are only exact up to 2^53.
+            Json::Value value = values[param];
+            if (value.isInt())
+                params.push_back(value.asInt());
+            else if (value.isUInt())
+                params.push_back(value.asUInt());
+            else if (value.isDouble() && std::fabs(value.asDouble()) <= 9007199254740992.0 &&
+                     value.asDouble() == std::floor(value.asDouble()))
+                params.push_back((long) value.asDouble());
+            else
+                break;
+        }
+        if (params.size() != nparam)
+            continue;
+
+        auto &total = runs[params][name - names.begin()];
+        total.first += run["cycles"].asDouble();
+        total.second++;
+    }
+
+    // Collect the parameter vectors won by each variant.
+    std::vector<isl_set *> won;
+    std::vector<unsigned> wins(names.size(), 0);
+    for (unsigned v = 0; v < names.size(); ++v)
+        won.push_back(isl_set_empty(isl_space_copy(paramSpace)));
+
+    for (auto &params : runs){
+        unsigned best = 0;
+        double bestCycles = -1;
+        for (auto &total : params.second){
+            double cycles = total.second.first / total.second.second;
+            if (bestCycles < 0 || cycles < bestCycles){
+                best = total.first;
+                bestCycles = cycles;
+            }
+        }
+
+        isl_set *point = isl_set_universe(isl_space_copy(paramSpace));
+        for (unsigned i = 0; i < nparam; ++i)
+            point = isl_set_fix_val(point, isl_dim_param, i, isl_val_int_from_si(S.getIslCtx(), params.first[i]));
+        won[best] = isl_set_union(won[best], point);
+        wins[best]++;
+    }
+    isl_space_free(paramSpace);
+
+    std::vector<unsigned> order;
+    for (unsigned v = 0; v < names.size(); ++v)
+        order.push_back(v);
+    std::stable_sort(order.begin(), order.end(), [&wins](unsigned a, unsigned b){
+        return wins[a] < wins[b];
+    });
+
+    // Without a profile, the first variant is selected.
+    if (runs.empty()){
+        dbgs() << "##### No profile for the variants, selecting " << names[0] << "\n";
+        std::swap(order.front(), order.back());
+    }
+
+    std::vector<isl_set *> guards(names.size(), NULL);
+    isl_set *covered = isl_set_empty(S.getParamSpace());
+    for (unsigned i = 0; i < order.size(); ++i){
+        unsigned v = order[i];
+        isl_set *guard;
+
+        if (i + 1 == order.size())
+            guard = isl_set_complement(isl_set_copy(covered));
+        else if (wins[v] == 0)
+            guard = isl_set_empty(S.getParamSpace());
+        else
+            guard = isl_set_from_basic_set(isl_set_convex_hull(isl_set_copy(won[v])));
+
+        guard = isl_set_subtract(guard, isl_set_copy(covered));
+        guard = isl_set_gist_params(guard, S.getContext());
+        covered = isl_set_union(covered, isl_set_copy(guard));
+        guards[v] = guard;
+
+        DEBUG(dbgs() << "Variant " << names[v] << " won " << wins[v]
+                     << " parameter vectors, guard := " << stringFromIslObj(guard) << ";\n");
+    }
+    isl_set_free(covered);
+    for (isl_set *set : won)
+        isl_set_free(set);
+
+    return guards;
+}
+
+/*
+ * Computes the transform of S from the alternative scripts given with
+ * -polly-trans-variants.
+ *
+ * Each script is applied to the original schedule and the scripts that do not
+ * preserve correctness are dropped. The remaining variants are combined in the
+ * same way as the versions of a single script. Without a profile, all variants
+ * are compiled and the variant executed is selected at run time through the
+ * parameter Scop::VariantSelector, such that code generation can record the
+ * parameter values and the cycles of every execution. With a profile, only the
+ * variants that won for the profiled parameter values are kept, each guarded by
+ * the parameter values for which it won (see readVariantGuards).
+ */
+__isl_give isl_map *PiecewiseAffineTransform::getVariantTransform(Scop &S, __isl_keep isl_map *Deps){
+
+    std::map<const std::string, isl_set *> loopDomains;
+    for (auto &loop : S.LoopDomainMap)
+	loopDomains[loop.first] = isl_set_copy(loop.second);
+    std::map<const std::string, unsigned> loopDims = S.LoopDimMap;
+
+    std::vector<std::string> names;
+    std::vector<isl_map *> transforms;
+    for (const std::string &script : TransformVariants){
+	dbgs() << "------------------ Variant " << script << " ------------------\n";
+
+	restoreLoopMaps(S, loopDomains, loopDims);
+	isl_map *transform = getTransform(S, script);
+	if (!transform || !checkTransform(transform, Deps)){
+	    dbgs() << "##### Skipping variant: " << script << "\n";
+	    isl_map_free(transform);
+	    continue;
+	}
+
+	names.push_back(script);
+	transforms.push_back(transform);
+    }
+
+    restoreLoopMaps(S, loopDomains, loopDims);
+    for (auto &loop : loopDomains)
+	isl_set_free(loop.second);
+
+    if (transforms.empty())
+	return getTransform(S, TransformFilename);
+
+    std::vector<isl_set *> guards;
+    if (VariantProfile.empty()){
+	isl_id_free(S.VariantSelector);
+	S.VariantSelector = isl_id_alloc(S.getIslCtx(), "polly_variant", NULL);
+	S.VariantNames = names;
+
+	isl_space *space = isl_space_params_alloc(S.getIslCtx(), 1);
+	space = isl_space_set_dim_id(space, isl_dim_param, 0, isl_id_copy(S.VariantSelector));
+	for (unsigned v = 0; v < transforms.size(); ++v)
+	    guards.push_back(isl_set_fix_si(isl_set_universe(isl_space_copy(space)), isl_dim_param, 0, v));
+	isl_space_free(space);
+    } else
+	guards = readVariantGuards(S, names);
+
+    // Drop the variants that are never selected.
+    std::vector<isl_map *> selected;
+    for (unsigned v = 0; v < transforms.size(); ++v){
+	if (isl_set_is_empty(guards[v]) == isl_bool_true){
+	    isl_map_free(transforms[v]);
+	    isl_set_free(guards[v]);
+	    continue;
+	}
+	selected.push_back(isl_map_intersect_params(transforms[v], guards[v]));
+    }
+
+    if (selected.empty())
+	return getTransform(S, TransformFilename);
+    if (selected.size() == 1)
+	return isl_map_coalesce(selected[0]);
+
+    return combineVersions(S, selected);
+}
+
+/*
+ * Checks that the transform is injective and, unless Deps is NULL, that it
+ * preserves the dependences Deps between schedule points.
+ */
+bool PiecewiseAffineTransform::checkTransform(__isl_keep isl_map *Transform, __isl_keep isl_map *Deps){
+    bool legal = true;
+
+    isl_bool flag = isl_map_is_injective(Transform);
+    dbgs() << "Is the transform Injective? " << (flag == isl_bool_true ? "True": "False") << ";\n";
+    if (flag == isl_bool_false) legal = false;
+
+    if (Deps){
+        //Check if dependences are preserved
+        isl_map *NewDeps = isl_map_apply_range(isl_map_copy(Deps),isl_map_copy(Transform));
+        NewDeps = isl_map_apply_domain(NewDeps, isl_map_copy(Transform));
+        NewDeps = isl_map_coalesce(NewDeps);
+        isl_map *LexOrder = isl_map_lex_ge(isl_set_get_space(isl_map_domain(isl_map_copy(NewDeps))));
+        flag = isDisjoint(NewDeps, LexOrder);
+        dbgs() << "Does the transform preserve dependences? " << (flag == isl_bool_true ? "True": "False") << ";\n";
+        if (flag == isl_bool_false){
+            legal = false;
+            dbgs() << " Counter Examples: " << stringFromIslObj(isl_map_coalesce(isl_map_intersect(isl_map_copy(NewDeps), isl_map_copy(LexOrder)))) << ";\n";
+        }
+
+        isl_map_free(NewDeps);
+        isl_map_free(LexOrder);
+    }
+
+    return legal;
 }
     
 
@@ -578,12 +1568,23 @@ bool PiecewiseAffineTransform::runOnScop(Scop &S) {
     
     isl_options_set_on_error(isl_union_set_get_ctx(Domain), ISL_ON_ERROR_WARN);
 
+    // Bound the memory used while composing and checking the transformation
+    size_t MaxMemoryOld = isl_ctx_get_max_memory(S.getIslCtx());
+    if (PollyIslMaxMemory)
+        isl_ctx_set_max_memory(S.getIslCtx(), (size_t) PollyIslMaxMemory << 20);
+
     //******************************************
     // Update and Check Schedule
     //******************************************
      
     // Get Transformation   
-    isl_map *Transform = getTransform(S);
+    ScheduleDeps = depsCheck ? Deps : NULL;
+    isl_map *Transform;
+    if (TransformVariants.empty())
+        Transform = getTransform(S, TransformFilename);
+    else
+        Transform = getVariantTransform(S, depsCheck ? Deps : NULL);
+    ScheduleDeps = NULL;
 
     // Update the schedule
     isl_union_map *NewSchedule = isl_union_map_coalesce(isl_union_map_apply_range(isl_union_map_copy(Schedule), isl_union_map_from_map(isl_map_copy(Transform))));
@@ -591,30 +1592,23 @@ bool PiecewiseAffineTransform::runOnScop(Scop &S) {
     
     dbgs() << "------------------ Transform Checks ------------------\n";
 	// boolean about whether it is safe to apply the transformation
-	bool applyTransform = true;
+	bool applyTransform = checkTransform(Transform, depsCheck ? Deps : NULL);
+    dbgs() << "------------------------------------------------------\n";
 
-    // Check that the transformation is injective
-    isl_bool flag = isl_map_is_injective(Transform);
-    dbgs() << "Is the transform Injective? " << (flag == isl_bool_true ? "True": "False") << ";\n";
-	if (flag == isl_bool_false) applyTransform = false;
-   
-    if (depsCheck){ 
-        //Check if dependences are preserved
-        isl_map *NewDeps = isl_map_apply_range(isl_map_copy(Deps),isl_map_copy(Transform));
-        NewDeps = isl_map_apply_domain(NewDeps, isl_map_copy(Transform));
-        NewDeps = isl_map_coalesce(NewDeps);
-        isl_map *LexOrder = isl_map_lex_ge(isl_set_get_space(isl_map_domain(isl_map_copy(NewDeps))));
-        flag = isl_map_is_disjoint(isl_map_copy(NewDeps), isl_map_copy(LexOrder));
-        dbgs() << "Does the transform preserve dependences? " << (flag == isl_bool_true ? "True": "False") << ";\n";
-        if (flag == isl_bool_false){
-			    applyTransform = false;
-                dbgs() << " Counter Examples: " << stringFromIslObj(isl_map_coalesce(isl_map_intersect(NewDeps, LexOrder))) << ";\n";
-        }        
-	
-        isl_map_free(NewDeps);
-        isl_map_free(LexOrder);
+    // Keep the original schedule if isl ran out of its memory budget
+    bool outOfMemory = isl_ctx_last_error(S.getIslCtx()) == isl_error_quota;
+    if (outOfMemory){
+        applyTransform = false;
+        isl_ctx_reset_error(S.getIslCtx());
+    }
+    isl_ctx_set_max_memory(S.getIslCtx(), MaxMemoryOld);
+
+    // The variants are only selected at run time if the transform is applied
+    if (!applyTransform && S.VariantSelector){
+        isl_id_free(S.VariantSelector);
+        S.VariantSelector = NULL;
+        S.VariantNames.clear();
     }
-    dbgs() << "------------------------------------------------------\n";
 
     // TODO Generate feedback when transformation goes wrong
     // TODO Do incremental tranformation and dependence check rather than monolithic transformation
@@ -623,6 +1617,9 @@ bool PiecewiseAffineTransform::runOnScop(Scop &S) {
     S.markAsOptimized();
     
 	if(applyTransform){
+		if (!BenchDir.empty())
+		    writeBenchKernel(S, Schedule, NewSchedule);
+
 		for (ScopStmt &Stmt : S) {
 			isl_map *StmtSchedule;
 			isl_set *Domain = Stmt.getDomain();
@@ -640,6 +1637,9 @@ bool PiecewiseAffineTransform::runOnScop(Scop &S) {
 		    Stmt.setSchedule(StmtSchedule);
 		}
     }
+	else if (outOfMemory) {
+		dbgs() << "ERROR!!! isl memory limit exceeded (peak " << (isl_ctx_get_peak_memory(S.getIslCtx()) >> 20) << " MB)! Transformation not implemented.\n";
+	}
 	else {
 		dbgs() << "ERROR!!! Transformation script does not preserve correctness! Transformation not implemented.\n";
 	}
@@ -650,12 +1650,48 @@ bool PiecewiseAffineTransform::runOnScop(Scop &S) {
     isl_map_free(Transform);
     isl_union_map_free(NewSchedule);
     if (depsCheck) isl_map_free(Deps);
+    clearLexOrders();
 
     return false;
 
 
 }
 
+/*
+ * Store the SCoP in the corpus format read by isl_bench_corpus, such that
+ * the isl operations performed on it can be benchmarked outside the compiler.
+ * The kernel is named after the function and the region of the SCoP.
+ */
+void PiecewiseAffineTransform::writeBenchKernel(Scop &S, __isl_keep isl_union_map *Schedule,
+                                                __isl_keep isl_union_map *NewSchedule){
+
+    std::string FunctionName = S.getRegion().getEntry()->getParent()->getName();
+    std::string FileName = BenchDir + "/" + FunctionName + "." + S.getNameStr() + ".bench";
+    std::ofstream File(FileName.c_str());
+    if (!File){
+        dbgs() << "Could not open " << FileName << "\n";
+        return;
+    }
+
+    isl_set *Context = S.getContext();
+    isl_union_set *Domain = S.getDomains();
+    isl_union_map *Reads = S.getReads();
+    isl_union_map *Writes = S.getWrites();
+
+    File << "# " << FunctionName << " " << S.getNameStr() << "\n";
+    File << "context: " << stringFromIslObj(Context) << "\n";
+    File << "domain: " << stringFromIslObj(Domain) << "\n";
+    File << "schedule: " << stringFromIslObj(Schedule) << "\n";
+    File << "reads: " << stringFromIslObj(Reads) << "\n";
+    File << "writes: " << stringFromIslObj(Writes) << "\n";
+    File << "transform: " << stringFromIslObj(NewSchedule) << "\n";
+
+    isl_set_free(Context);
+    isl_union_set_free(Domain);
+    isl_union_map_free(Reads);
+    isl_union_map_free(Writes);
+}
+
 void PiecewiseAffineTransform::printScop(raw_ostream &, Scop &) const {}
 
 void PiecewiseAffineTransform::getAnalysisUsage(AnalysisUsage &AU) const {
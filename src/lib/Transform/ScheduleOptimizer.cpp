@@ -437,6 +437,9 @@ bool IslScheduleOptimizer::runOnScop(Scop &S) {
   isl_options_set_tile_scale_tile_loops(S.getIslCtx(), 0);
 
   isl_options_set_on_error(S.getIslCtx(), ISL_ON_ERROR_CONTINUE);
+  size_t MaxMemoryOld = isl_ctx_get_max_memory(S.getIslCtx());
+  if (PollyIslMaxMemory)
+    isl_ctx_set_max_memory(S.getIslCtx(), (size_t)PollyIslMaxMemory << 20);
 
   isl_schedule_constraints *ScheduleConstraints;
   ScheduleConstraints = isl_schedule_constraints_on_domain(Domain);
@@ -449,11 +452,18 @@ bool IslScheduleOptimizer::runOnScop(Scop &S) {
   isl_schedule *Schedule;
   Schedule = isl_schedule_constraints_compute_schedule(ScheduleConstraints);
   isl_options_set_on_error(S.getIslCtx(), ISL_ON_ERROR_ABORT);
+  isl_ctx_set_max_memory(S.getIslCtx(), MaxMemoryOld);
 
   // In cases the scheduler is not able to optimize the code, we just do not
   // touch the schedule.
-  if (!Schedule)
+  if (!Schedule) {
+    if (isl_ctx_last_error(S.getIslCtx()) == isl_error_quota) {
+      DEBUG(dbgs() << "isl memory limit exceeded, keeping the original "
+                      "schedule\n");
+      isl_ctx_reset_error(S.getIslCtx());
+    }
     return false;
+  }
 
   DEBUG({
     auto *P = isl_printer_to_str(S.getIslCtx());
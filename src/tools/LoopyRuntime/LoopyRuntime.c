@@ -0,0 +1,359 @@
+/******************* LoopyRuntime.c - Loopy parallel runtime ******************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  This file implements the Loopy runtime, a team of persistent threads      */
+/*  executing the parallel loops generated by Polly.                          */
+/*                                                                            */
+/******************************************************************************/
+
+#define _GNU_SOURCE
+#include "LoopyRuntime.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define LOOPY_RELAX() __builtin_ia32_pause()
+#else
+#define LOOPY_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/* A parallel loop. The iterations are numbered from 0 to NumIterations - 1,
+ * iteration I is LB + I * Stride. */
+typedef struct LoopyLoopT {
+  void (*SubFn)(void *);
+  void *Data;
+  long LB;
+  long Stride;
+  long NumIterations;
+  unsigned NumThreads;
+
+  /* The next iteration handed out by the dynamic schedule. */
+  long NextIteration;
+
+  /* The loop and the state of the calling thread in the enclosing loop, if
+   * this loop is executed by a single thread inside another parallel loop. */
+  struct LoopyLoopT *Outer;
+  int OuterTaken;
+} LoopyLoop;
+
+/* The team of worker threads. The calling thread is thread 0 and the workers
+ * are threads 1 to NumWorkers. */
+static struct {
+  unsigned NumWorkers;
+  pthread_t *Workers;
+
+  int Dynamic;
+  long Chunk;
+  unsigned long SpinCount;
+  int Pin;
+  cpu_set_t CPUs;
+
+  /* Held while the team executes a loop, such that the loops started by
+   * different threads of the program are executed one after the other. */
+  pthread_mutex_t LoopLock;
+
+  /* Lock protects the sleeping threads: WorkCond is signaled when a new loop
+   * is started or the team shuts down, DoneCond when the last worker has
+   * finished a loop. */
+  pthread_mutex_t Lock;
+  pthread_cond_t WorkCond;
+  pthread_cond_t DoneCond;
+
+  /* Incremented for every loop started. */
+  unsigned long Generation;
+  /* The number of workers that have not yet finished the current loop. */
+  unsigned Busy;
+  int Shutdown;
+
+  LoopyLoop Loop;
+} Team = {.Chunk = 1, .SpinCount = 100000, .Pin = 1};
+
+static pthread_once_t TeamOnce = PTHREAD_ONCE_INIT;
+
+/* The state of the current thread: its number, the loop it is executing and
+ * whether it has taken its block of iterations under the static schedule. */
+static __thread unsigned ThreadNum;
+static __thread LoopyLoop *CurrentLoop;
+static __thread int Taken;
+
+static long getEnvLong(const char *Name, long Default) {
+  const char *Value = getenv(Name);
+  if (!Value || !*Value)
+    return Default;
+  return strtol(Value, NULL, 10);
+}
+
+/* Pin the current thread to the Num-th CPU it may run on. */
+static void pinThread(unsigned Num) {
+  unsigned Count = CPU_COUNT(&Team.CPUs);
+  unsigned CPU, Seen = 0;
+  cpu_set_t Set;
+
+  if (!Team.Pin || Count == 0)
+    return;
+
+  Num %= Count;
+  for (CPU = 0; CPU < CPU_SETSIZE; ++CPU) {
+    if (!CPU_ISSET(CPU, &Team.CPUs))
+      continue;
+    if (Seen++ == Num)
+      break;
+  }
+
+  CPU_ZERO(&Set);
+  CPU_SET(CPU, &Set);
+  pthread_setaffinity_np(pthread_self(), sizeof(Set), &Set);
+}
+
+/* Wait until *Value differs from Old, first by spinning and then by sleeping
+ * on Cond. Returns the new value. */
+static unsigned long waitForChange(unsigned long *Value, unsigned long Old,
+                                   pthread_cond_t *Cond) {
+  unsigned long New, i;
+
+  for (i = 0; i < Team.SpinCount; ++i) {
+    New = __atomic_load_n(Value, __ATOMIC_ACQUIRE);
+    if (New != Old || __atomic_load_n(&Team.Shutdown, __ATOMIC_ACQUIRE))
+      return New;
+    LOOPY_RELAX();
+  }
+
+  pthread_mutex_lock(&Team.Lock);
+  while ((New = __atomic_load_n(Value, __ATOMIC_ACQUIRE)) == Old &&
+         !Team.Shutdown)
+    pthread_cond_wait(Cond, &Team.Lock);
+  pthread_mutex_unlock(&Team.Lock);
+
+  return New;
+}
+
+/* Wait until all workers have finished the current loop, first by spinning
+ * and then by sleeping on DoneCond. */
+static void waitForWorkers(void) {
+  unsigned long i;
+
+  for (i = 0; i < Team.SpinCount; ++i) {
+    if (__atomic_load_n(&Team.Busy, __ATOMIC_ACQUIRE) == 0)
+      return;
+    LOOPY_RELAX();
+  }
+
+  pthread_mutex_lock(&Team.Lock);
+  while (__atomic_load_n(&Team.Busy, __ATOMIC_ACQUIRE) != 0)
+    pthread_cond_wait(&Team.DoneCond, &Team.Lock);
+  pthread_mutex_unlock(&Team.Lock);
+}
+
+static void *worker(void *User) {
+  unsigned long Generation = 0;
+
+  ThreadNum = (unsigned)(size_t)User;
+  pinThread(ThreadNum);
+
+  for (;;) {
+    Generation = waitForChange(&Team.Generation, Generation, &Team.WorkCond);
+    if (__atomic_load_n(&Team.Shutdown, __ATOMIC_ACQUIRE))
+      break;
+
+    if (ThreadNum < Team.Loop.NumThreads) {
+      CurrentLoop = &Team.Loop;
+      Taken = 0;
+      Team.Loop.SubFn(Team.Loop.Data);
+      CurrentLoop = NULL;
+    }
+
+    if (__atomic_sub_fetch(&Team.Busy, 1, __ATOMIC_ACQ_REL) == 0) {
+      pthread_mutex_lock(&Team.Lock);
+      pthread_cond_broadcast(&Team.DoneCond);
+      pthread_mutex_unlock(&Team.Lock);
+    }
+  }
+
+  return NULL;
+}
+
+static void shutdownTeam(void) {
+  unsigned i;
+
+  pthread_mutex_lock(&Team.Lock);
+  __atomic_store_n(&Team.Shutdown, 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&Team.WorkCond);
+  pthread_mutex_unlock(&Team.Lock);
+
+  for (i = 0; i < Team.NumWorkers; ++i)
+    pthread_join(Team.Workers[i], NULL);
+  free(Team.Workers);
+  Team.Workers = NULL;
+  Team.NumWorkers = 0;
+}
+
+static void initTeam(void) {
+  const char *Schedule = getenv("LOOPY_SCHEDULE");
+  long NumThreads;
+  unsigned i;
+
+  if (sched_getaffinity(0, sizeof(Team.CPUs), &Team.CPUs) != 0)
+    CPU_ZERO(&Team.CPUs);
+
+  NumThreads = getEnvLong("OMP_NUM_THREADS", CPU_COUNT(&Team.CPUs));
+  NumThreads = getEnvLong("LOOPY_NUM_THREADS", NumThreads);
+  if (NumThreads < 1)
+    NumThreads = 1;
+
+  if (Schedule && strncmp(Schedule, "dynamic", 7) == 0) {
+    Team.Dynamic = 1;
+    if (Schedule[7] == ',')
+      Team.Chunk = strtol(Schedule + 8, NULL, 10);
+    if (Team.Chunk < 1)
+      Team.Chunk = 1;
+  }
+
+  /* Spinning threads only slow down the others if there are more threads than
+   * CPUs. */
+  if (NumThreads > CPU_COUNT(&Team.CPUs))
+    Team.SpinCount = 0;
+  Team.SpinCount = getEnvLong("LOOPY_SPIN_COUNT", Team.SpinCount);
+  Team.Pin = getEnvLong("LOOPY_PIN", Team.Pin) != 0;
+
+  pthread_mutex_init(&Team.LoopLock, NULL);
+  pthread_mutex_init(&Team.Lock, NULL);
+  pthread_cond_init(&Team.WorkCond, NULL);
+  pthread_cond_init(&Team.DoneCond, NULL);
+
+  /* Only the workers pin themselves, to the CPUs after the first one. The
+   * calling thread belongs to the program and keeps its affinity, which the
+   * threads the program creates later inherit. If not all threads can be
+   * created, the team is simply smaller. */
+  Team.Workers = calloc(NumThreads - 1, sizeof(pthread_t));
+  if (Team.Workers)
+    for (i = 0; i < NumThreads - 1; ++i) {
+      if (pthread_create(&Team.Workers[i], NULL, worker,
+                         (void *)(size_t)(i + 1)) != 0)
+        break;
+      Team.NumWorkers++;
+    }
+
+  atexit(shutdownTeam);
+}
+
+static void initLoop(LoopyLoop *Loop, void (*SubFn)(void *), void *Data,
+                     unsigned NumThreads, long LB, long UB, long Stride) {
+  Loop->SubFn = SubFn;
+  Loop->Data = Data;
+  Loop->LB = LB;
+  Loop->Stride = Stride;
+  Loop->NumIterations = UB > LB ? (UB - LB + Stride - 1) / Stride : 0;
+  Loop->NumThreads = NumThreads;
+  Loop->NextIteration = 0;
+  Loop->Outer = NULL;
+  Loop->OuterTaken = 0;
+}
+
+void loopy_parallel_loop_start(void (*SubFn)(void *), void *Data,
+                               unsigned NumThreads, long LB, long UB,
+                               long Stride) {
+  LoopyLoop *Loop;
+
+  /* Parallel loops started inside a parallel loop are executed by the
+   * thread that starts them. */
+  if (CurrentLoop) {
+    Loop = malloc(sizeof(LoopyLoop));
+    initLoop(Loop, SubFn, Data, 1, LB, UB, Stride);
+    Loop->Outer = CurrentLoop;
+    Loop->OuterTaken = Taken;
+    CurrentLoop = Loop;
+    Taken = 0;
+    return;
+  }
+
+  pthread_once(&TeamOnce, initTeam);
+
+  if (NumThreads == 0 || NumThreads > Team.NumWorkers + 1)
+    NumThreads = Team.NumWorkers + 1;
+
+  pthread_mutex_lock(&Team.LoopLock);
+  initLoop(&Team.Loop, SubFn, Data, NumThreads, LB, UB, Stride);
+  CurrentLoop = &Team.Loop;
+  ThreadNum = 0;
+  Taken = 0;
+
+  if (Team.NumWorkers == 0)
+    return;
+
+  /* All workers acknowledge every loop, also those they do not take part
+   * in, such that they all agree on the current generation. */
+  __atomic_store_n(&Team.Busy, Team.NumWorkers, __ATOMIC_RELAXED);
+  pthread_mutex_lock(&Team.Lock);
+  __atomic_add_fetch(&Team.Generation, 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&Team.WorkCond);
+  pthread_mutex_unlock(&Team.Lock);
+}
+
+unsigned char loopy_loop_next(long *LB, long *UB) {
+  LoopyLoop *Loop = CurrentLoop;
+  long Begin, End;
+
+  if (!Loop)
+    return 0;
+
+  if (Team.Dynamic && Loop->NumThreads > 1) {
+    Begin = __atomic_fetch_add(&Loop->NextIteration, Team.Chunk,
+                               __ATOMIC_RELAXED);
+    if (Begin >= Loop->NumIterations)
+      return 0;
+    End = Begin + Team.Chunk;
+    if (End > Loop->NumIterations)
+      End = Loop->NumIterations;
+  } else {
+    long Size = Loop->NumIterations / Loop->NumThreads;
+    long Rest = Loop->NumIterations % Loop->NumThreads;
+    unsigned Num = Loop->NumThreads > 1 ? ThreadNum : 0;
+
+    if (Taken)
+      return 0;
+    Taken = 1;
+
+    Begin = Num * Size + (Num < Rest ? Num : Rest);
+    End = Begin + Size + (Num < Rest ? 1 : 0);
+    if (Begin >= End)
+      return 0;
+  }
+
+  *LB = Loop->LB + Begin * Loop->Stride;
+  *UB = Loop->LB + End * Loop->Stride;
+  return 1;
+}
+
+unsigned loopy_get_max_threads(void) {
+  pthread_once(&TeamOnce, initTeam);
+  return Team.NumWorkers + 1;
+}
+
+void loopy_loop_end_nowait(void) {}
+
+void loopy_parallel_end(void) {
+  LoopyLoop *Loop = CurrentLoop;
+
+  if (Loop && Loop->Outer) {
+    CurrentLoop = Loop->Outer;
+    Taken = Loop->OuterTaken;
+    free(Loop);
+    return;
+  }
+
+  CurrentLoop = NULL;
+
+  if (Team.NumWorkers != 0)
+    waitForWorkers();
+
+  pthread_mutex_unlock(&Team.LoopLock);
+}
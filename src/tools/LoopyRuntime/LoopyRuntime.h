@@ -0,0 +1,83 @@
+/******************************************************************************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  This file defines the Loopy runtime for parallel loops.                   */
+/*                                                                            */
+/******************************************************************************/
+
+#ifndef LOOPYRUNTIME_H_
+#define LOOPYRUNTIME_H_
+
+/*
+ * The Loopy runtime executes the parallel loops generated with
+ * -polly-parallel -polly-parallel-runtime=loopy. It has the same interface as
+ * the subset of the GNU OpenMP runtime used by Polly, but keeps a team of
+ * persistent worker threads that are pinned to the available CPUs and that
+ * wait for the next loop by spinning for a while before they go to sleep.
+ * Starting a parallel loop inside a sequential loop, e.g., the time loop of a
+ * stencil, is then much cheaper than with a team that has to be woken up.
+ *
+ * The generated code for a parallel loop looks like
+ *
+ * loopy_parallel_loop_start(subfn, data, 0, LB, UB, Stride);
+ * subfn(data);
+ * loopy_parallel_end();
+ *
+ * void subfn(void *data) {
+ *   long lb, ub;
+ *   while (loopy_loop_next(&lb, &ub))
+ *     for (long i = lb; i < ub; i += Stride)
+ *       S(i);
+ *   loopy_loop_end_nowait();
+ * }
+ *
+ * The runtime is configured by the following environment variables:
+ *
+ * LOOPY_NUM_THREADS  The number of threads, including the calling thread
+ *                    (default: OMP_NUM_THREADS or the number of CPUs).
+ * LOOPY_SCHEDULE     "static" to give each thread one contiguous block of
+ *                    iterations (the default), or "dynamic[,chunk]" to hand
+ *                    out chunks of iterations (default 1) on demand.
+ * LOOPY_SPIN_COUNT   The number of times an idle thread checks for new work
+ *                    before it goes to sleep (default 100000).
+ * LOOPY_PIN          0 to not pin the worker threads to CPUs (default 1).
+ *                    The thread calling the runtime is never pinned, such
+ *                    that the threads it creates keep its CPU affinity.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start a parallel loop with iterations LB, LB + Stride, ... below UB that is
+ * executed by NumThreads threads (0 = all) calling SubFn(Data). The calling
+ * thread takes part by calling SubFn(Data) itself. */
+void loopy_parallel_loop_start(void (*SubFn)(void *), void *Data,
+                               unsigned NumThreads, long LB, long UB,
+                               long Stride);
+
+/* Get the next block [*LB, *UB) of iterations of the current thread.
+ * Returns zero if there are no iterations left. */
+unsigned char loopy_loop_next(long *LB, long *UB);
+
+/* Get the number of threads that execute a parallel loop started with
+ * NumThreads = 0. */
+unsigned loopy_get_max_threads(void);
+
+/* Mark the end of the iterations of the current thread. */
+void loopy_loop_end_nowait(void);
+
+/* Wait until all threads have finished the current parallel loop. */
+void loopy_parallel_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOOPYRUNTIME_H_ */
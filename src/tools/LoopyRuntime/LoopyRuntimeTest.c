@@ -0,0 +1,124 @@
+/**************** LoopyRuntimeTest.c - Test of the Loopy runtime **************/
+/*                                                                            */
+/*                     The LLVM Compiler Infrastructure                       */
+/*                                                                            */
+/* This file is dual licensed under the MIT and the University of Illinois    */
+/* Open Source License. See LICENSE.TXT for details.                          */
+/*                                                                            */
+/******************************************************************************/
+/*                                                                            */
+/*  This file drives the Loopy runtime the way the generated code does and    */
+/*  checks that every iteration of a parallel loop is executed exactly once.  */
+/*  It exits with a non-zero status on failure. Run it with                   */
+/*  LOOPY_SCHEDULE=static and LOOPY_SCHEDULE=dynamic,<chunk> to test both     */
+/*  schedules.                                                                */
+/*                                                                            */
+/******************************************************************************/
+
+#define _GNU_SOURCE
+#include "LoopyRuntime.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIZE 1000
+
+static int Count[SIZE];
+static long Stride;
+static int Failed;
+
+static void check(int Cond, const char *Msg) {
+  if (!Cond) {
+    fprintf(stderr, "FAIL: %s\n", Msg);
+    Failed = 1;
+  }
+}
+
+/* Count the executions of the iterations handed out to the current thread. */
+static void subFn(void *Data) {
+  long LB, UB, I;
+
+  check(Data == (void *)Count, "subfunction data");
+  while (loopy_loop_next(&LB, &UB))
+    for (I = LB; I < UB; I += Stride)
+      __sync_fetch_and_add(&Count[I], 1);
+  loopy_loop_end_nowait();
+}
+
+/* Run the loop LB, LB + Stride, ... below UB and check that each of its
+ * iterations was executed once. */
+static void runLoop(long LB, long UB, long S, unsigned NumThreads) {
+  long I;
+
+  for (I = 0; I < SIZE; ++I)
+    Count[I] = 0;
+  Stride = S;
+
+  loopy_parallel_loop_start(subFn, Count, NumThreads, LB, UB, S);
+  subFn(Count);
+  loopy_parallel_end();
+
+  for (I = 0; I < SIZE; ++I) {
+    int Expected = I >= LB && I < UB && (I - LB) % S == 0;
+    if (Count[I] != Expected) {
+      fprintf(stderr, "FAIL: iteration %ld of [%ld, %ld) step %ld executed "
+                      "%d times\n",
+              I, LB, UB, S, Count[I]);
+      Failed = 1;
+      return;
+    }
+  }
+}
+
+/* A parallel loop started inside a parallel loop is executed by the thread
+ * that starts it. */
+static void nestedFn(void *Data) {
+  long LB, UB, I, J;
+
+  while (loopy_loop_next(&LB, &UB))
+    for (I = LB; I < UB; ++I) {
+      loopy_parallel_loop_start(subFn, Data, 0, I * 100, I * 100 + 100, 1);
+      subFn(Data);
+      loopy_parallel_end();
+      for (J = I * 100; J < I * 100 + 100; ++J)
+        check(Count[J] == 1, "nested loop iteration");
+    }
+  loopy_loop_end_nowait();
+}
+
+int main(void) {
+  cpu_set_t Before, After;
+  long I;
+
+  CPU_ZERO(&Before);
+  CPU_ZERO(&After);
+  sched_getaffinity(0, sizeof(Before), &Before);
+
+  check(loopy_get_max_threads() >= 1, "number of threads");
+
+  runLoop(0, SIZE, 1, 0);
+  runLoop(1, SIZE, 3, 0);
+  runLoop(7, 8, 1, 0);
+  runLoop(5, 5, 1, 0);
+  runLoop(0, SIZE, 1, 1);
+  runLoop(0, SIZE, 2, 2);
+
+  /* Many short loops in a row, as in the time loop of a stencil. */
+  for (I = 0; I < 1000 && !Failed; ++I)
+    runLoop(0, 16, 1, 0);
+
+  for (I = 0; I < SIZE; ++I)
+    Count[I] = 0;
+  Stride = 1;
+  loopy_parallel_loop_start(nestedFn, Count, 0, 0, SIZE / 100, 1);
+  nestedFn(Count);
+  loopy_parallel_end();
+
+  /* The runtime only pins its workers, not the calling thread. */
+  sched_getaffinity(0, sizeof(After), &After);
+  check(CPU_EQUAL(&Before, &After), "affinity of the calling thread");
+
+  if (!Failed)
+    printf("PASS\n");
+  return Failed;
+}